@@ -507,7 +507,8 @@ at::Tensor woq_linear_kernel(
     int64_t lowp_mode,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation,
-    const c10::optional<at::Tensor>& g_idx) {
+    const c10::optional<at::Tensor>& g_idx,
+    const c10::optional<at::Tensor>& x_perm) {
   int64_t quant_w_mode = zps_list[0].defined()
       ? (group_size > 0 ? QUANT_W_PER_K_BLOCK : QUANT_W_PER_CHANNEL)
       : (group_size > 0 ? QUANT_W_PER_K_BLOCK_SYM : QUANT_W_PER_CHANNEL_SYM);
@@ -536,7 +537,8 @@ at::Tensor woq_linear_kernel(
       quant_w_mode,
       group_size,
       compensation,
-      g_idx);
+      g_idx,
+      x_perm);
   if (m_padded) {
     auto out_size = self.sizes().vec();
     out_size.back() = y.size(-1);
@@ -630,7 +632,8 @@ at::Tensor woq_linear_unary_kernel(
     int64_t lowp_mode,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation,
-    const c10::optional<at::Tensor>& g_idx) {
+    const c10::optional<at::Tensor>& g_idx,
+    const c10::optional<at::Tensor>& x_perm) {
   int64_t post_op_fusion_type = WOQ_FUSE_NONE;
   if (post_op == "gelu") {
     if (algorithm == "none") {
@@ -671,7 +674,8 @@ at::Tensor woq_linear_unary_kernel(
       quant_w_mode,
       group_size,
       compensation,
-      g_idx);
+      g_idx,
+      x_perm);
   if (m_padded) {
     auto out_size = self.sizes().vec();
     out_size.back() = y.size(-1);
@@ -727,7 +731,8 @@ at::Tensor woq_linear_binary_kernel(
     const std::vector<at::Tensor>& others,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation,
-    const c10::optional<at::Tensor>& g_idx) {
+    const c10::optional<at::Tensor>& g_idx,
+    const c10::optional<at::Tensor>& x_perm) {
   int64_t post_op_fusion_type = WOQ_FUSE_NONE;
   if (post_op == "add") {
     post_op_fusion_type = WOQ_FUSE_ADD;
@@ -764,7 +769,8 @@ at::Tensor woq_linear_binary_kernel(
       quant_w_mode,
       group_size,
       compensation,
-      g_idx);
+      g_idx,
+      x_perm);
   if (m_padded) {
     auto out_size = self.sizes().vec();
     out_size.back() = y.size(-1);
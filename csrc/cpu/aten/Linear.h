@@ -159,7 +159,8 @@ at::Tensor woq_linear_kernel(
     int64_t lowp_mode,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation = c10::nullopt,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt);
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt);
 
 at::Tensor woq_linear_unary_kernel(
     const at::Tensor& self,
@@ -175,7 +176,8 @@ at::Tensor woq_linear_unary_kernel(
     int64_t lowp_mode,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation = c10::nullopt,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt);
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt);
 
 at::Tensor woq_linear_binary_kernel(
     const at::Tensor& self,
@@ -190,7 +192,8 @@ at::Tensor woq_linear_binary_kernel(
     const std::vector<at::Tensor>& others,
     int64_t act_quant_mode,
     const c10::optional<at::Tensor>& compensation = c10::nullopt,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt);
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt);
 
 namespace {
 void woq_gemm_kernel_impl(
@@ -237,6 +240,7 @@ using woq_tpp_gemm_kernel_fn = at::Tensor (*)(
     int64_t,
     int64_t,
     const c10::optional<at::Tensor>&,
+    const c10::optional<at::Tensor>&,
     const c10::optional<at::Tensor>&);
 
 using woq_gemm_kernel_fn = at::Tensor (*)(
@@ -250,6 +254,7 @@ using woq_gemm_kernel_fn = at::Tensor (*)(
     const std::vector<at::Tensor>&,
     int64_t,
     int64_t,
+    const c10::optional<at::Tensor>&,
     const c10::optional<at::Tensor>&);
 
 using woq_int8_gemm_kernel_fn = at::Tensor (*)(
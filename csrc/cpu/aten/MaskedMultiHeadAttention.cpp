@@ -7,6 +7,7 @@ namespace cpu {
 
 IPEX_DEFINE_DISPATCH(masked_multihead_self_attention_kernel_stub);
 IPEX_DEFINE_DISPATCH(deepseekv2_mla_kernel_stub);
+IPEX_DEFINE_DISPATCH(compact_indirect_access_kv_cache_kernel_stub);
 IPEX_DEFINE_DISPATCH(prepare_4d_causal_attention_mask_kernel_stub);
 
 /*
@@ -92,6 +93,23 @@ deepseekv2_mla_forward_cpu(
       w_scale,
       add_casual_mask);
 }
+
+/*
+ *Materialize the beam history of the indirect access kv cache into
+ *contiguous cache rows and reset beam_idx, it is done in place.
+ *@param key_cache
+ *@param value_cache
+ *@param beam_idx
+ *@param offset
+ */
+void compact_indirect_access_kv_cache_forward_cpu(
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& beam_idx,
+    int64_t offset) {
+  compact_indirect_access_kv_cache_kernel_stub(
+      kCPU, key_cache, value_cache, beam_idx, offset);
+}
 at::Tensor prepare_4d_causal_attention_mask_forward_cpu(
     at::Tensor& attention_mask,
     at::Tensor& inputs_embeds,
@@ -129,6 +147,13 @@ TORCH_LIBRARY_FRAGMENT(torch_ipex, m) {
       "deepseekv2_mla",
       c10::DispatchKey::CPU,
       torch_ipex::cpu::deepseekv2_mla_forward_cpu);
+  m.def(
+      "compact_indirect_access_kv_cache(Tensor(a!) key_cache, Tensor(b!) value_cache, \
+       Tensor(c!) beam_idx, int offset)-> ()");
+  m.impl(
+      "compact_indirect_access_kv_cache",
+      c10::DispatchKey::CPU,
+      torch_ipex::cpu::compact_indirect_access_kv_cache_forward_cpu);
 }
 
 TORCH_LIBRARY_FRAGMENT(torch_ipex, m) {
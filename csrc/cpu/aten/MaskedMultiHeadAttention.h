@@ -48,6 +48,12 @@ at::Tensor prepare_4d_causal_attention_mask_forward_cpu(
     at::Tensor& past_kv_len,
     at::Tensor& finfo_min,
     int64_t sliding_window);
+
+void compact_indirect_access_kv_cache(
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& beam_idx,
+    int64_t offset);
 } // namespace
 
 using masked_multihead_self_attention_kernel_fn =
@@ -87,6 +93,14 @@ IPEX_DECLARE_DISPATCH(
     masked_multihead_self_attention_kernel_fn,
     masked_multihead_self_attention_kernel_stub);
 IPEX_DECLARE_DISPATCH(deepseekv2_mla_kernel_fn, deepseekv2_mla_kernel_stub);
+using compact_indirect_access_kv_cache_kernel_fn = void (*)(
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& beam_idx,
+    int64_t offset);
+IPEX_DECLARE_DISPATCH(
+    compact_indirect_access_kv_cache_kernel_fn,
+    compact_indirect_access_kv_cache_kernel_stub);
 using prepare_4d_causal_attention_mask_kernel_fn = at::Tensor (*)(
     at::Tensor& attention_mask,
     at::Tensor& inputs_embeds,
@@ -9,6 +9,11 @@ namespace cpu {
 IPEX_DEFINE_DISPATCH(single_query_cached_kv_attention_kernel_stub);
 IPEX_DEFINE_DISPATCH(reshape_and_cache_kernel_stub);
 IPEX_DEFINE_DISPATCH(flash_attn_var_len_kernel_stub);
+IPEX_DEFINE_DISPATCH(multi_query_cached_kv_attention_kernel_stub);
+IPEX_DEFINE_DISPATCH(evict_kv_blocks_kernel_stub);
+IPEX_DEFINE_DISPATCH(single_query_cached_kv_attention_with_rope_kernel_stub);
+IPEX_DEFINE_DISPATCH(copy_blocks_kernel_stub);
+IPEX_DEFINE_DISPATCH(swap_blocks_kernel_stub);
 
 /*
  *Caculate the masked multihead attention for decoder layer in decoder only
@@ -28,7 +33,9 @@ at::Tensor single_query_cached_kv_attention_forward_cpu(
     int64_t window_size,
     const double k_scale,
     const double v_scale,
-    const double softcap) {
+    const double softcap,
+    const c10::optional<at::Tensor>& evicted_lens, // [num_seqs]
+    int64_t num_sink_tokens) {
   // SymInt is used for max_context_len to support dynamic
   int64_t max_context_len_int = max_context_len.expect_int();
   single_query_cached_kv_attention_kernel_stub(
@@ -47,7 +54,9 @@ at::Tensor single_query_cached_kv_attention_forward_cpu(
       window_size,
       k_scale,
       v_scale,
-      softcap);
+      softcap,
+      evicted_lens,
+      num_sink_tokens);
   return out;
 }
 
@@ -117,6 +126,144 @@ at::Tensor flash_attn_varlen_cpu(
   return out;
 }
 
+/*
+ *Caculate the attention of the multiple query tokens of each sequence, such as
+ *the draft tokens of speculative decoding
+ */
+at::Tensor multi_query_cached_kv_attention_forward_cpu(
+    at::Tensor& out, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& query, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    c10::SymInt max_context_len,
+    int64_t num_queries,
+    const c10::optional<at::Tensor>& query_mask, // [num_queries, num_queries]
+    const double k_scale,
+    const double v_scale,
+    const double softcap) {
+  // SymInt is used for max_context_len to support dynamic
+  int64_t max_context_len_int = max_context_len.expect_int();
+  multi_query_cached_kv_attention_kernel_stub(
+      kCPU,
+      out,
+      query,
+      key_cache,
+      value_cache,
+      scale,
+      block_tables,
+      context_lens,
+      block_size,
+      max_context_len_int,
+      num_queries,
+      query_mask,
+      k_scale,
+      v_scale,
+      softcap);
+  return out;
+}
+
+/*
+ *Evict the KV blocks out of the sliding window except the attention sinks
+ */
+at::Tensor evict_kv_blocks_cpu(
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    at::Tensor& evicted_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t num_sink_tokens,
+    int64_t window_size) {
+  return evict_kv_blocks_kernel_stub(
+      kCPU,
+      block_tables,
+      context_lens,
+      evicted_lens,
+      block_size,
+      num_sink_tokens,
+      window_size);
+}
+
+/*
+ *Apply RoPE to the query/key of the new token, store the key/value into the
+ *cache and calculate the decoding attention in one op
+ */
+at::Tensor single_query_cached_kv_attention_with_rope_forward_cpu(
+    at::Tensor& out, // [num_seqs, num_heads, head_size]
+    at::Tensor& query, // [num_seqs, num_heads, head_size]
+    at::Tensor& key, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& value, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& slot_mapping, // [num_seqs]
+    at::Tensor& rope_emb_pos, // [max_position, rotary_ndims]
+    at::Tensor& positions, // [num_seqs]
+    int64_t rotary_offset,
+    int64_t rotary_ndims,
+    at::Tensor& head_mapping, // [num_heads]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    c10::SymInt max_context_len,
+    const c10::optional<at::Tensor>& alibi_slopes,
+    int64_t window_size,
+    const std::string& kv_cache_dtype,
+    const double k_scale,
+    const double v_scale,
+    const double softcap) {
+  // SymInt is used for max_context_len to support dynamic
+  int64_t max_context_len_int = max_context_len.expect_int();
+  single_query_cached_kv_attention_with_rope_kernel_stub(
+      kCPU,
+      out,
+      query,
+      key,
+      value,
+      key_cache,
+      value_cache,
+      slot_mapping,
+      rope_emb_pos,
+      positions,
+      rotary_offset,
+      rotary_ndims,
+      head_mapping,
+      scale,
+      block_tables,
+      context_lens,
+      block_size,
+      max_context_len_int,
+      alibi_slopes,
+      window_size,
+      kv_cache_dtype,
+      k_scale,
+      v_scale,
+      softcap);
+  return out;
+}
+
+/*
+ *Copy the KV blocks in the caches of all the layers
+ */
+void copy_blocks_cpu(
+    const std::vector<at::Tensor>& key_caches,
+    const std::vector<at::Tensor>& value_caches,
+    const at::Tensor& block_mapping) {
+  copy_blocks_kernel_stub(kCPU, key_caches, value_caches, block_mapping);
+}
+
+/*
+ *Copy the KV blocks from the source caches to the destination caches
+ */
+void swap_blocks_cpu(
+    const std::vector<at::Tensor>& src_caches,
+    const std::vector<at::Tensor>& dst_caches,
+    const at::Tensor& block_mapping) {
+  swap_blocks_kernel_stub(kCPU, src_caches, dst_caches, block_mapping);
+}
+
 } // namespace cpu
 } // namespace torch_ipex
 
@@ -135,5 +282,21 @@ TORCH_LIBRARY_FRAGMENT(torch_ipex, m) {
       "flash_attn_varlen_func",
       torch_ipex::cpu::flash_attn_varlen_cpu,
       c10::DispatchKey::CPU);
+  IPEX_OP_REGISTER_DISPATCH(
+      "multi_query_cached_kv_attention",
+      torch_ipex::cpu::multi_query_cached_kv_attention_forward_cpu,
+      c10::DispatchKey::CPU);
+  IPEX_OP_REGISTER_DISPATCH(
+      "evict_kv_blocks",
+      torch_ipex::cpu::evict_kv_blocks_cpu,
+      c10::DispatchKey::CPU);
+  IPEX_OP_REGISTER_DISPATCH(
+      "single_query_cached_kv_attention_with_rope",
+      torch_ipex::cpu::single_query_cached_kv_attention_with_rope_forward_cpu,
+      c10::DispatchKey::CPU);
+  IPEX_OP_REGISTER_DISPATCH(
+      "copy_blocks", torch_ipex::cpu::copy_blocks_cpu, c10::DispatchKey::CPU);
+  IPEX_OP_REGISTER_DISPATCH(
+      "swap_blocks", torch_ipex::cpu::swap_blocks_cpu, c10::DispatchKey::CPU);
 }
 } // namespace
@@ -23,7 +23,9 @@ at::Tensor single_query_cached_kv_attention_forward_cpu(
     int64_t window_size,
     const double k_scale,
     const double v_scale,
-    const double softcap);
+    const double softcap,
+    const c10::optional<at::Tensor>& evicted_lens, // [num_seqs]
+    int64_t num_sink_tokens);
 
 std::tuple<at::Tensor, at::Tensor> reshape_and_cache_cpu(
     at::Tensor& key,
@@ -55,6 +57,65 @@ at::Tensor flash_attn_varlen_cpu(
     const double v_scale,
     const double softcap);
 
+at::Tensor multi_query_cached_kv_attention_forward_cpu(
+    at::Tensor& out, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& query, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    int64_t num_queries,
+    const c10::optional<at::Tensor>& query_mask, // [num_queries, num_queries]
+    const double k_scale,
+    const double v_scale,
+    const double softcap);
+
+at::Tensor evict_kv_blocks_cpu(
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    at::Tensor& evicted_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t num_sink_tokens,
+    int64_t window_size);
+
+at::Tensor single_query_cached_kv_attention_with_rope_forward_cpu(
+    at::Tensor& out, // [num_seqs, num_heads, head_size]
+    at::Tensor& query, // [num_seqs, num_heads, head_size]
+    at::Tensor& key, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& value, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& slot_mapping, // [num_seqs]
+    at::Tensor& rope_emb_pos, // [max_position, rotary_ndims]
+    at::Tensor& positions, // [num_seqs]
+    int64_t rotary_offset,
+    int64_t rotary_ndims,
+    at::Tensor& head_mapping, // [num_heads]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    const c10::optional<at::Tensor>& alibi_slopes,
+    int64_t window_size,
+    const std::string& kv_cache_dtype,
+    const double k_scale,
+    const double v_scale,
+    const double softcap);
+
+void copy_blocks_cpu(
+    const std::vector<at::Tensor>& key_caches,
+    const std::vector<at::Tensor>& value_caches,
+    const at::Tensor& block_mapping); // [num_pairs, 2]
+
+void swap_blocks_cpu(
+    const std::vector<at::Tensor>& src_caches,
+    const std::vector<at::Tensor>& dst_caches,
+    const at::Tensor& block_mapping); // [num_pairs, 2]
+
 } // namespace
 
 using single_query_cached_kv_attention_fn = void (*)(
@@ -72,7 +133,9 @@ using single_query_cached_kv_attention_fn = void (*)(
     int64_t window_size,
     const double k_scale,
     const double v_scale,
-    const double softcap);
+    const double softcap,
+    const c10::optional<at::Tensor>& evicted_lens, // [num_seqs]
+    int64_t num_sink_tokens);
 
 using reshape_and_cache_fn = void (*)(
     at::Tensor& key,
@@ -104,11 +167,79 @@ using flash_attn_var_len_fn = void (*)(
     const double v_scale,
     const double softcap);
 
+using multi_query_cached_kv_attention_fn = void (*)(
+    at::Tensor& out, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& query, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    int64_t num_queries,
+    const c10::optional<at::Tensor>& query_mask, // [num_queries, num_queries]
+    const double k_scale,
+    const double v_scale,
+    const double softcap);
+
+using evict_kv_blocks_fn = at::Tensor (*)(
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    at::Tensor& evicted_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t num_sink_tokens,
+    int64_t window_size);
+
+using single_query_cached_kv_attention_with_rope_fn = void (*)(
+    at::Tensor& out, // [num_seqs, num_heads, head_size]
+    at::Tensor& query, // [num_seqs, num_heads, head_size]
+    at::Tensor& key, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& value, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& slot_mapping, // [num_seqs]
+    at::Tensor& rope_emb_pos, // [max_position, rotary_ndims]
+    at::Tensor& positions, // [num_seqs]
+    int64_t rotary_offset,
+    int64_t rotary_ndims,
+    at::Tensor& head_mapping, // [num_heads]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    const c10::optional<at::Tensor>& alibi_slopes,
+    int64_t window_size,
+    const std::string& kv_cache_dtype,
+    const double k_scale,
+    const double v_scale,
+    const double softcap);
+
+using copy_blocks_fn = void (*)(
+    const std::vector<at::Tensor>& key_caches,
+    const std::vector<at::Tensor>& value_caches,
+    const at::Tensor& block_mapping); // [num_pairs, 2]
+
+using swap_blocks_fn = void (*)(
+    const std::vector<at::Tensor>& src_caches,
+    const std::vector<at::Tensor>& dst_caches,
+    const at::Tensor& block_mapping); // [num_pairs, 2]
+
 IPEX_DECLARE_DISPATCH(
     single_query_cached_kv_attention_fn,
     single_query_cached_kv_attention_kernel_stub);
 IPEX_DECLARE_DISPATCH(reshape_and_cache_fn, reshape_and_cache_kernel_stub);
 IPEX_DECLARE_DISPATCH(flash_attn_var_len_fn, flash_attn_var_len_kernel_stub);
+IPEX_DECLARE_DISPATCH(
+    multi_query_cached_kv_attention_fn,
+    multi_query_cached_kv_attention_kernel_stub);
+IPEX_DECLARE_DISPATCH(evict_kv_blocks_fn, evict_kv_blocks_kernel_stub);
+IPEX_DECLARE_DISPATCH(
+    single_query_cached_kv_attention_with_rope_fn,
+    single_query_cached_kv_attention_with_rope_kernel_stub);
+IPEX_DECLARE_DISPATCH(copy_blocks_fn, copy_blocks_kernel_stub);
+IPEX_DECLARE_DISPATCH(swap_blocks_fn, swap_blocks_kernel_stub);
 
 } // namespace cpu
 } // namespace torch_ipex
@@ -3,11 +3,28 @@
 namespace torch_ipex {
 namespace cpu {
 IPEX_DEFINE_DISPATCH(tpp_allreduce_kernel_stub);
+IPEX_DEFINE_DISPATCH(tpp_hierarchical_allreduce_kernel_stub);
 void tpp_shmallreduce_forward(
     at::Tensor t_in,
-    c10::intrusive_ptr<c10d::ProcessGroup> process_group) {
+    c10::intrusive_ptr<c10d::ProcessGroup> process_group,
+    const std::string& wire_dtype) {
+  TORCH_CHECK(
+      wire_dtype == "auto" || wire_dtype == "bf16" || wire_dtype == "fp16" ||
+          wire_dtype == "fp8" || wire_dtype == "fp8_e5m2",
+      "not supported wire_dtype of tpp_shm_allreduce: ",
+      wire_dtype);
   RECORD_FUNCTION("tpp_all_reduce_add", c10::ArrayRef<c10::IValue>({}));
-  return tpp_allreduce_kernel_stub(kCPU, t_in, process_group);
+  return tpp_allreduce_kernel_stub(kCPU, t_in, process_group, wire_dtype);
+}
+
+void tpp_shm_hierarchical_allreduce_forward(
+    at::Tensor t_in,
+    c10::intrusive_ptr<c10d::ProcessGroup> local_process_group,
+    c10::intrusive_ptr<c10d::ProcessGroup> cross_process_group) {
+  RECORD_FUNCTION(
+      "tpp_hierarchical_all_reduce_add", c10::ArrayRef<c10::IValue>({}));
+  return tpp_hierarchical_allreduce_kernel_stub(
+      kCPU, t_in, local_process_group, cross_process_group);
 }
 
 } // namespace cpu
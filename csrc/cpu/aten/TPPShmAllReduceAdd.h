@@ -6,14 +6,41 @@
 namespace torch_ipex {
 namespace cpu {
 
+// wire_dtype is the data type moved through the shared memory, "auto" is the
+// dtype of t_in. "bf16" and "fp16" halve the bytes of the float tensors, "fp8"
+// (e5m2 with per-block scales) also applies to the bf16 and fp16 tensors. The
+// reduction is always accumulated in float.
 void tpp_shmallreduce_forward(
     at::Tensor t_in,
-    c10::intrusive_ptr<c10d::ProcessGroup> process_group);
+    c10::intrusive_ptr<c10d::ProcessGroup> process_group,
+    const std::string& wire_dtype = "auto");
 
-using tpp_allreduce_impl_fn =
-    void (*)(at::Tensor, c10::intrusive_ptr<c10d::ProcessGroup>);
+using tpp_allreduce_impl_fn = void (*)(
+    at::Tensor,
+    c10::intrusive_ptr<c10d::ProcessGroup>,
+    const std::string&);
 
 IPEX_DECLARE_DISPATCH(tpp_allreduce_impl_fn, tpp_allreduce_kernel_stub);
 
+// Hierarchical allreduce across nodes. local_process_group is the ranks of
+// this node and cross_process_group is the ranks with the same local rank on
+// all the nodes. The tensor is reduce-scattered inside the node through the
+// shared memory, each local rank allreduces its own shard across the nodes,
+// then the shards are gathered inside the node. So each node only sends
+// 1/local_size of the tensor per rank to the other nodes.
+void tpp_shm_hierarchical_allreduce_forward(
+    at::Tensor t_in,
+    c10::intrusive_ptr<c10d::ProcessGroup> local_process_group,
+    c10::intrusive_ptr<c10d::ProcessGroup> cross_process_group);
+
+using tpp_hierarchical_allreduce_impl_fn = void (*)(
+    at::Tensor,
+    c10::intrusive_ptr<c10d::ProcessGroup>,
+    c10::intrusive_ptr<c10d::ProcessGroup>);
+
+IPEX_DECLARE_DISPATCH(
+    tpp_hierarchical_allreduce_impl_fn,
+    tpp_hierarchical_allreduce_kernel_stub);
+
 } // namespace cpu
 } // namespace torch_ipex
\ No newline at end of file
@@ -1117,6 +1117,298 @@ inline void copy_key_value(
   }
 }
 
+// Number of the context tokens of a partition in the flash decoding.
+#define IAKV_FD_PARTITION_SIZE 256
+
+/*
+ *Use the flash decoding for the next token when batch * kv_head cannot occupy
+ *the threads, e.g. the long context decoding with batch 1.
+ */
+inline bool use_iakv_flash_decoding(
+    int64_t bs,
+    int64_t kv_head,
+    int64_t cur_len,
+    int64_t offset) {
+  return offset > 0 && cur_len == 1 &&
+      offset + 1 >= 2 * IAKV_FD_PARTITION_SIZE &&
+      bs * kv_head < omp_get_max_threads();
+}
+
+/*
+ *The flash decoding (split-K) version of
+ *scale_dot_product_for_indirect_access_kv_cache for the next token. The
+ *context is split into partitions, and every (batch, kv head, partition)
+ *computes the attention of its tokens with the local max and exp sum, then
+ *the partial results of the partitions are merged.
+ *@return attn_outs, None, key_cache, value_cache, beam_idx
+ */
+template <typename QT, typename VT, typename KCT, typename VCT>
+std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+scale_dot_product_for_indirect_access_kv_cache_fd(
+    at::Tensor query,
+    at::Tensor key,
+    at::Tensor value,
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& beam_idx,
+    const int64_t offset,
+    const double scale_factor,
+    at::Tensor& attention_mask) {
+  RECORD_FUNCTION(
+      "ipex::scale_dot_product_for_indirect_access_kv_cache_fd",
+      c10::ArrayRef<c10::IValue>({}));
+  int beam_batch = beam_idx.size(1);
+  auto bs = query.size(0);
+  auto head_num = query.size(2);
+  auto head_size = query.size(3);
+  auto b_ptr = beam_idx.data_ptr<long>();
+  auto max_cache_size = beam_idx.size(0);
+  auto prompt_len = b_ptr[(max_cache_size - 2) * beam_batch];
+  auto prompt_bs = b_ptr[(max_cache_size - 1) * beam_batch];
+  auto beam_size = 1;
+  if (prompt_bs != 0) {
+    beam_size = beam_batch / prompt_bs;
+  }
+  auto need_update_beam_idx = beam_size > 1;
+  auto kv_head = key.size(2);
+  auto group_size = head_num / kv_head;
+  auto seq_len = offset + 1;
+  int64_t partition_size = IAKV_FD_PARTITION_SIZE;
+  auto num_partitions = (seq_len + partition_size - 1) / partition_size;
+  auto thread_numbers = omp_get_max_threads();
+  query = query.contiguous();
+  key = key.contiguous();
+  value = value.contiguous();
+  auto q_ptr = query.data_ptr<QT>();
+  auto k_ptr = key.data_ptr<QT>();
+  auto k_cache_ptr = key_cache.data_ptr<KCT>();
+  auto mask_ptr = attention_mask.data_ptr<QT>();
+  auto mask_head_num = attention_mask.size(1);
+  auto mask_dim2 = attention_mask.size(2);
+  auto mask_bs_stride = mask_head_num * mask_dim2 * seq_len;
+  auto v_ptr = value.data_ptr<VT>();
+  auto v_cache_ptr = value_cache.data_ptr<VCT>();
+  auto attn_outs = at::empty({bs, head_num, 1, head_size}, value.options());
+  auto attn_out_ptr = attn_outs.data_ptr<VT>();
+  // the partial results of every partition
+  auto tmp_outs =
+      at::empty({bs, head_num, num_partitions, head_size}, at::kFloat);
+  auto max_logits = at::empty({bs, head_num, num_partitions}, at::kFloat);
+  auto exp_sums = at::empty({bs, head_num, num_partitions}, at::kFloat);
+  auto logits =
+      at::empty({thread_numbers, group_size, partition_size}, at::kFloat);
+  auto tmp_out_ptr = tmp_outs.data_ptr<float>();
+  auto max_logits_ptr = max_logits.data_ptr<float>();
+  auto exp_sums_ptr = exp_sums.data_ptr<float>();
+  auto logits_ptr = logits.data_ptr<float>();
+
+  // stride information
+  auto qStrideB = query.stride(0);
+  auto qStrideH = query.stride(2);
+  auto kStrideB = key.stride(0);
+  auto kStrideH = key.stride(2);
+  auto kcStrideB = key_cache.stride(1);
+  auto kcStrideS = key_cache.stride(0);
+  auto kcStrideH = key_cache.stride(2);
+  auto vStrideB = value.stride(0);
+  auto vStrideH = value.stride(2);
+  auto vcStrideB = value_cache.stride(1);
+  auto vcStrideS = value_cache.stride(0);
+  auto vcStrideH = value_cache.stride(2);
+  auto tmp_out_strideH = num_partitions * head_size;
+
+  // the target beam of every past token, see
+  // scale_dot_product_for_indirect_access_kv_cache
+  std::vector<long> new_beam_idx(need_update_beam_idx ? bs * seq_len : 0);
+  if (need_update_beam_idx) {
+    for (int i = 0; i < bs; i++) {
+      auto beam_idx_start = new_beam_idx.data() + i * seq_len;
+      beam_idx_start[offset - 1] = b_ptr[(offset - 1) * bs + i];
+      for (int j = offset - 2; j >= prompt_len; j--) {
+        beam_idx_start[j] = b_ptr[j * bs + beam_idx_start[j + 1]];
+      }
+    }
+  }
+  {
+    RECORD_FUNCTION(
+        "ipex::iakv_sdp_fd::partial_attention", c10::ArrayRef<c10::IValue>({}));
+#pragma omp parallel for collapse(3)
+    for (auto bi = 0; bi < bs; bi++) {
+      for (auto kv_hi = 0; kv_hi < kv_head; kv_hi++) {
+        for (auto pi = 0; pi < num_partitions; pi++) {
+          auto ti_start = pi * partition_size;
+          auto ti_end = std::min(ti_start + partition_size, seq_len);
+          int len = ti_end - ti_start;
+          auto bsi = bi / beam_size;
+          auto head_group_start = kv_hi * group_size;
+          auto q_ptr_start =
+              q_ptr + bi * qStrideB + head_group_start * qStrideH;
+          auto logits_start =
+              logits_ptr + omp_get_thread_num() * group_size * partition_size;
+          // q * k of the tokens in the partition
+          for (auto ti = ti_start; ti < ti_end; ti++) {
+            auto attn_w_pos = logits_start + ti - ti_start;
+            if (ti == offset) {
+              // caculate the innerproduct for the current token and store
+              // the key
+              auto kc_head_start = k_cache_ptr + ti * kcStrideS +
+                  bi * kcStrideB + kv_hi * kcStrideH;
+              auto k_ptr_start = k_ptr + bi * kStrideB + kv_hi * kStrideH;
+              reduce_head<QT, QT, KCT>(
+                  q_ptr_start,
+                  group_size,
+                  k_ptr_start,
+                  attn_w_pos,
+                  partition_size,
+                  head_size,
+                  true,
+                  kc_head_start);
+            } else {
+              auto beam = need_update_beam_idx && ti >= prompt_len
+                  ? new_beam_idx[bi * seq_len + ti]
+                  : bsi * beam_size;
+              auto kc_head_start = k_cache_ptr + ti * kcStrideS +
+                  beam * kcStrideB + kv_hi * kcStrideH;
+              reduce_head<QT, KCT, KCT>(
+                  q_ptr_start,
+                  group_size,
+                  kc_head_start,
+                  attn_w_pos,
+                  partition_size,
+                  head_size,
+                  false,
+                  nullptr);
+            }
+          }
+          // div+add and the softmax of the partition without normalization
+          for (auto gi = 0; gi < group_size; gi++) {
+            auto hi = head_group_start + gi;
+            auto logits_head_start = logits_start + gi * partition_size;
+            auto mask_ptr_start = mask_ptr + bi * mask_bs_stride +
+                (hi % mask_head_num) * mask_dim2 * seq_len + ti_start;
+            auto max_val = std::numeric_limits<float>::lowest();
+#if defined(CPU_CAPABILITY_AVX512)
+            torch_ipex::cpu::kernel::
+                _dil_div_add_reduce_max_fusion_kernel<float, QT>(
+                    logits_head_start,
+                    mask_ptr_start,
+                    scale_factor,
+                    len,
+                    logits_head_start,
+                    max_val);
+            auto exp_sum = max_val;
+            torch_ipex::cpu::kernel::_dil_exp_reduce_sum_fusion_kernel(
+                logits_head_start, len, logits_head_start, exp_sum);
+#else
+            for (auto si = 0; si < len; si++) {
+              logits_head_start[si] = logits_head_start[si] / scale_factor +
+                  static_cast<float>(mask_ptr_start[si]);
+              max_val = std::max(max_val, logits_head_start[si]);
+            }
+            float exp_sum = 0.0f;
+            for (auto si = 0; si < len; si++) {
+              logits_head_start[si] = exp(logits_head_start[si] - max_val);
+              exp_sum += logits_head_start[si];
+            }
+#endif
+            max_logits_ptr[(bi * head_num + hi) * num_partitions + pi] =
+                max_val;
+            exp_sums_ptr[(bi * head_num + hi) * num_partitions + pi] = exp_sum;
+          }
+          // attn_w * v of the tokens in the partition
+          auto tmp_out_start = tmp_out_ptr +
+              (bi * head_num + head_group_start) * tmp_out_strideH +
+              pi * head_size;
+          std::vector<uint8_t> flag_access(group_size, 0);
+          for (auto vi = ti_start; vi < ti_end; vi++) {
+            auto attn_w_start = logits_start + vi - ti_start;
+            if (vi == offset) {
+              // store the value of the current token
+              auto v_cache_head_start = v_cache_ptr + vi * vcStrideS +
+                  bi * vcStrideB + kv_hi * vcStrideH;
+              auto v_ptr_start = v_ptr + bi * vStrideB + kv_hi * vStrideH;
+              mul_attenion_weights_and_value_of_head<VT, float, VCT>(
+                  attn_w_start,
+                  partition_size,
+                  v_ptr_start,
+                  tmp_out_start,
+                  tmp_out_strideH,
+                  group_size,
+                  head_size,
+                  true,
+                  v_cache_head_start,
+                  flag_access.data());
+            } else {
+              auto beam = need_update_beam_idx && vi >= prompt_len
+                  ? new_beam_idx[bi * seq_len + vi]
+                  : bsi * beam_size;
+              auto v_cache_head_start = v_cache_ptr + vi * vcStrideS +
+                  beam * vcStrideB + kv_hi * vcStrideH;
+              mul_attenion_weights_and_value_of_head<VCT, float, VCT>(
+                  attn_w_start,
+                  partition_size,
+                  v_cache_head_start,
+                  tmp_out_start,
+                  tmp_out_strideH,
+                  group_size,
+                  head_size,
+                  false,
+                  nullptr,
+                  flag_access.data());
+            }
+          }
+        }
+      }
+    }
+  }
+  {
+    RECORD_FUNCTION(
+        "ipex::iakv_sdp_fd::reduce_partitions", c10::ArrayRef<c10::IValue>({}));
+#pragma omp parallel for collapse(2)
+    for (auto bi = 0; bi < bs; bi++) {
+      for (auto hi = 0; hi < head_num; hi++) {
+        auto max_logits_start =
+            max_logits_ptr + (bi * head_num + hi) * num_partitions;
+        auto exp_sums_start =
+            exp_sums_ptr + (bi * head_num + hi) * num_partitions;
+        auto tmp_out_start =
+            tmp_out_ptr + (bi * head_num + hi) * tmp_out_strideH;
+        auto global_max = std::numeric_limits<float>::lowest();
+        for (auto pi = 0; pi < num_partitions; pi++) {
+          global_max = std::max(global_max, max_logits_start[pi]);
+        }
+        // the rescale factor of every partition with the global max
+        float global_exp_sum = 0.0f;
+        for (auto pi = 0; pi < num_partitions; pi++) {
+          max_logits_start[pi] = exp(max_logits_start[pi] - global_max);
+          global_exp_sum += exp_sums_start[pi] * max_logits_start[pi];
+        }
+        // accumulate the rescaled partial outputs into the first partition
+        for (auto pi = 0; pi < num_partitions; pi++) {
+          auto rescale = max_logits_start[pi] / global_exp_sum;
+          auto out_start = tmp_out_start + pi * head_size;
+          if (pi == 0) {
+            for (auto hsi = 0; hsi < head_size; hsi++) {
+              tmp_out_start[hsi] = out_start[hsi] * rescale;
+            }
+          } else {
+            for (auto hsi = 0; hsi < head_size; hsi++) {
+              tmp_out_start[hsi] += out_start[hsi] * rescale;
+            }
+          }
+        }
+        torch_ipex::cpu::kernel::move_ker<VT, float>(
+            attn_out_ptr + (bi * head_num + hi) * head_size,
+            tmp_out_start,
+            head_size);
+      }
+    }
+  }
+
+  return std::make_tuple(
+      attn_outs, at::Tensor(), key_cache, value_cache, beam_idx);
+}
+
 /*
  *The scale-dot product for indirect access kv chache and fuse
  *matmul+div+add+softmax to improve data reuse
@@ -1153,6 +1445,19 @@ scale_dot_product_for_indirect_access_kv_cache(
   RECORD_FUNCTION(
       "ipex::scale_dot_product_for_indirect_access_kv_cache",
       c10::ArrayRef<c10::IValue>({}));
+  if (use_iakv_flash_decoding(
+          query.size(0), key.size(2), query.size(1), offset)) {
+    return scale_dot_product_for_indirect_access_kv_cache_fd<QT, VT, KCT, VCT>(
+        query,
+        key,
+        value,
+        key_cache,
+        value_cache,
+        beam_idx,
+        offset,
+        scale_factor,
+        attention_mask);
+  }
   int beam_batch = beam_idx.size(1);
   auto bs = query.size(0);
   auto cur_len = query.size(1); // only process cur_len==1
@@ -1760,6 +2065,23 @@ scale_dot_product_for_indirect_access_kv_cache_half(
   RECORD_FUNCTION(
       "ipex::scale_dot_product_for_indirect_access_kv_cache_half",
       c10::ArrayRef<c10::IValue>({}));
+  if (use_iakv_flash_decoding(
+          query.size(0), key.size(2), query.size(1), offset)) {
+    return scale_dot_product_for_indirect_access_kv_cache_fd<
+        at::Half,
+        at::Half,
+        at::Half,
+        at::Half>(
+        query,
+        key,
+        value,
+        key_cache,
+        value_cache,
+        beam_idx,
+        offset,
+        scale_factor,
+        attention_mask);
+  }
   int beam_batch = beam_idx.size(1);
   auto bs = query.size(0);
   auto cur_len = query.size(1); // only process cur_len==1
@@ -3096,6 +3418,105 @@ deepseekv2_mla_kernel_impl(
   return std::make_tuple(attn_output, attn_weights, kv_cache, beam_idx);
 }
 
+/*
+ *Materialize the beam history of the generated tokens into the cache rows of
+ *their beams, and reset the history in beam_idx, so that the following
+ *decoding steps read the kv cache contiguously instead of following the beam
+ *chain of every token.
+ *@param  key_cache Cache past key embeeding with the of [max_len,
+ *beam_size*batch, kv_head_num, head_size]
+ *@param  value_cache Cache past value embeeding with the of [max_len,
+ *beam_size*batch, kv_head_num, head_size]
+ *@param  beam_idx Beam info for every token [max_len + 2, beam_size*batch]
+ *@param  offset  The length of decoded(past) token, beam_idx[offset - 1]
+ *should be the latest reordered beams.
+ */
+void compact_indirect_access_kv_cache_kernel_impl(
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& beam_idx,
+    int64_t offset) {
+  RECORD_FUNCTION(
+      "ipex::compact_indirect_access_kv_cache", c10::ArrayRef<c10::IValue>({}));
+  TORCH_CHECK(
+      key_cache.dim() == 4 && value_cache.dim() == 4,
+      "compact_indirect_access_kv_cache: expect 4-D key_cache and value_cache");
+  TORCH_CHECK(
+      key_cache.is_contiguous() && value_cache.is_contiguous(),
+      "compact_indirect_access_kv_cache: expect contiguous kv cache");
+  TORCH_CHECK(
+      beam_idx.dim() == 2 && beam_idx.scalar_type() == at::kLong &&
+          beam_idx.is_contiguous(),
+      "compact_indirect_access_kv_cache: expect a contiguous long beam_idx");
+  int64_t beam_batch = beam_idx.size(1);
+  auto max_cache_size = beam_idx.size(0);
+  TORCH_CHECK(
+      key_cache.size(1) == beam_batch && value_cache.size(1) == beam_batch,
+      "compact_indirect_access_kv_cache: the kv cache does not match beam_idx");
+  TORCH_CHECK(
+      offset <= key_cache.size(0) && offset <= max_cache_size - 2,
+      "compact_indirect_access_kv_cache: offset is out of the kv cache");
+  auto b_ptr = beam_idx.data_ptr<long>();
+  auto prompt_len = b_ptr[(max_cache_size - 2) * beam_batch];
+  auto prompt_bs = b_ptr[(max_cache_size - 1) * beam_batch];
+  auto beam_size = 1;
+  if (prompt_bs != 0) {
+    beam_size = beam_batch / prompt_bs;
+  }
+  // the prompt tokens are only stored in the first beam of each batch
+  if (beam_size <= 1 || offset <= prompt_len) {
+    return;
+  }
+  // the target beam of every generated token, see
+  // scale_dot_product_for_indirect_access_kv_cache
+  auto num_tokens = offset - prompt_len;
+  std::vector<long> src_beam(num_tokens * beam_batch);
+  for (auto bi = 0; bi < beam_batch; bi++) {
+    src_beam[(num_tokens - 1) * beam_batch + bi] =
+        b_ptr[(offset - 1) * beam_batch + bi];
+    for (auto ti = num_tokens - 2; ti >= 0; ti--) {
+      src_beam[ti * beam_batch + bi] = b_ptr
+          [(ti + prompt_len) * beam_batch +
+           src_beam[(ti + 1) * beam_batch + bi]];
+    }
+  }
+  auto k_row_bytes = key_cache.stride(1) * key_cache.element_size();
+  auto v_row_bytes = value_cache.stride(1) * value_cache.element_size();
+  auto k_cache_ptr = static_cast<char*>(key_cache.data_ptr());
+  auto v_cache_ptr = static_cast<char*>(value_cache.data_ptr());
+#pragma omp parallel for
+  for (auto ti = 0; ti < num_tokens; ti++) {
+    auto src_beam_start = src_beam.data() + ti * beam_batch;
+    bool in_place = true;
+    for (auto bi = 0; bi < beam_batch; bi++) {
+      in_place = in_place && src_beam_start[bi] == bi;
+    }
+    if (in_place) {
+      continue;
+    }
+    // the rows of a token are permuted, so gather them into a buffer first
+    std::vector<char> buffer(beam_batch * std::max(k_row_bytes, v_row_bytes));
+    auto gather_rows = [&](char* cache_ptr, int64_t row_bytes) {
+      auto token_start = cache_ptr + (ti + prompt_len) * beam_batch * row_bytes;
+      for (auto bi = 0; bi < beam_batch; bi++) {
+        std::memcpy(
+            buffer.data() + bi * row_bytes,
+            token_start + src_beam_start[bi] * row_bytes,
+            row_bytes);
+      }
+      std::memcpy(token_start, buffer.data(), beam_batch * row_bytes);
+    };
+    gather_rows(k_cache_ptr, k_row_bytes);
+    gather_rows(v_cache_ptr, v_row_bytes);
+  }
+  // every generated token is in its own beam now
+  for (auto ti = prompt_len; ti < offset; ti++) {
+    for (auto bi = 0; bi < beam_batch; bi++) {
+      b_ptr[ti * beam_batch + bi] = bi;
+    }
+  }
+}
+
 template <typename T>
 void attention_mask_2d_to_4d(
     const T* attention_mask_ptr,
@@ -3200,6 +3621,9 @@ IPEX_REGISTER_DISPATCH(
     masked_multihead_self_attention_kernel_stub,
     &masked_multihead_self_attention_kernel_impl);
 IPEX_REGISTER_DISPATCH(deepseekv2_mla_kernel_stub, &deepseekv2_mla_kernel_impl);
+IPEX_REGISTER_DISPATCH(
+    compact_indirect_access_kv_cache_kernel_stub,
+    &compact_indirect_access_kv_cache_kernel_impl);
 
 IPEX_REGISTER_DISPATCH(
     prepare_4d_causal_attention_mask_kernel_stub,
@@ -21,7 +21,17 @@
 #endif
 
 #include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include "csrc/cpu/tpp/woq/tla.h"
 #include "vec/vec.h"
 
@@ -162,6 +172,417 @@ at::Half* flexible_dequantize_cache<at::Half, at::Half>(
   return cache;
 }
 
+namespace kv_quant {
+
+// The INT8/INT4 KV caches are uint8 tensors with the shape of [num_blocks,
+// num_kv_heads, block_size + 1, head_size * BITS / 8]. Each (block, head) page
+// starts with a row holding the float scale and zero point of the page, the
+// quantized tokens follow. A value is dequantized as (q - zero_point) * scale.
+struct Int8 {
+  static constexpr int64_t BITS = 8;
+  uint8_t val;
+};
+
+// Two values per byte, the even one in the low nibble.
+struct Int4 {
+  static constexpr int64_t BITS = 4;
+  uint8_t val;
+};
+
+template <typename T>
+struct is_quantized : std::false_type {};
+template <>
+struct is_quantized<Int8> : std::true_type {};
+template <>
+struct is_quantized<Int4> : std::true_type {};
+template <typename T>
+constexpr bool is_quantized_v = is_quantized<T>::value;
+
+struct PageParams {
+  float scale;
+  float zero_point;
+};
+
+template <typename QT>
+constexpr float qmax() {
+  return (1 << QT::BITS) - 1;
+}
+
+template <typename QT>
+inline int64_t packed_head_size(int64_t head_size) {
+  return head_size * QT::BITS / 8;
+}
+
+inline PageParams get_params(const uint8_t* page) {
+  PageParams params;
+  std::memcpy(&params, page, sizeof(PageParams));
+  return params;
+}
+
+inline void set_params(uint8_t* page, const PageParams& params) {
+  std::memcpy(page, &params, sizeof(PageParams));
+}
+
+template <typename QT>
+inline uint8_t get_q(const uint8_t* row, int64_t i) {
+  if constexpr (QT::BITS == 8) {
+    return row[i];
+  } else {
+    return (row[i / 2] >> ((i % 2) * 4)) & 0xf;
+  }
+}
+
+template <typename QT>
+inline void set_q(uint8_t* row, int64_t i, uint8_t q) {
+  if constexpr (QT::BITS == 8) {
+    row[i] = q;
+  } else {
+    auto shift = (i % 2) * 4;
+    row[i / 2] = (row[i / 2] & ~(0xf << shift)) | (q << shift);
+  }
+}
+
+// Asymmetric params of the range [lo, hi], which contains 0 so that 0 is
+// exact.
+template <typename QT>
+inline PageParams compute_params(float lo, float hi) {
+  PageParams params;
+  params.scale = (hi - lo) / qmax<QT>();
+  if (params.scale == 0) {
+    params.scale = 1;
+  }
+  params.zero_point =
+      std::min(std::max(std::nearbyint(-lo / params.scale), 0.f), qmax<QT>());
+  return params;
+}
+
+template <typename QT>
+inline uint8_t quantize_value(float value, float inv_scale, float zero_point) {
+  float q = std::nearbyint(value * inv_scale) + zero_point;
+  return static_cast<uint8_t>(std::min(std::max(q, 0.f), qmax<QT>()));
+}
+
+// Dequantize the first tokens of the page into dst of [tokens, head_size].
+template <typename scalar_t, typename QT>
+void dequantize_page(
+    const uint8_t* page,
+    scalar_t* dst,
+    int64_t tokens,
+    int64_t head_size) {
+  auto params = get_params(page);
+  auto row_size = packed_head_size<QT>(head_size);
+  float scale = params.scale;
+  float bias = -params.zero_point * params.scale;
+  for (int64_t t = 0; t < tokens; t++) {
+    const uint8_t* row = page + (t + 1) * row_size;
+    scalar_t* dst_row = dst + t * head_size;
+    if constexpr (QT::BITS == 8) {
+      for (int64_t i = 0; i < head_size; i++) {
+        dst_row[i] = static_cast<scalar_t>(row[i] * scale + bias);
+      }
+    } else {
+      for (int64_t i = 0; i < row_size; i++) {
+        dst_row[2 * i] = static_cast<scalar_t>((row[i] & 0xf) * scale + bias);
+        dst_row[2 * i + 1] =
+            static_cast<scalar_t>((row[i] >> 4) * scale + bias);
+      }
+    }
+  }
+}
+
+// Quantize the tokens srcs[i] into the rows offsets[i] of the page. The tokens
+// of a block are written in order, so the rows before the smallest offset are
+// the existing tokens of the page, and the page is new when it is 0. The range
+// of a page only grows, the existing tokens are requantized when it grows.
+template <typename SRC_T, typename QT>
+void quantize_into_page(
+    uint8_t* page,
+    const std::vector<const SRC_T*>& srcs,
+    const std::vector<int64_t>& offsets,
+    int64_t head_size) {
+  auto row_size = packed_head_size<QT>(head_size);
+  float lo = 0, hi = 0;
+  for (auto src : srcs) {
+    for (int64_t i = 0; i < head_size; i++) {
+      lo = std::min(lo, static_cast<float>(src[i]));
+      hi = std::max(hi, static_cast<float>(src[i]));
+    }
+  }
+  auto existing_tokens = *std::min_element(offsets.begin(), offsets.end());
+  PageParams params;
+  if (existing_tokens == 0) {
+    params = compute_params<QT>(lo, hi);
+  } else {
+    auto old_params = get_params(page);
+    float old_lo = -old_params.zero_point * old_params.scale;
+    float old_hi = (qmax<QT>() - old_params.zero_point) * old_params.scale;
+    if (lo >= old_lo && hi <= old_hi) {
+      params = old_params;
+    } else {
+      params = compute_params<QT>(std::min(lo, old_lo), std::max(hi, old_hi));
+      float inv_scale = 1 / params.scale;
+      for (int64_t t = 0; t < existing_tokens; t++) {
+        uint8_t* row = page + (t + 1) * row_size;
+        for (int64_t i = 0; i < head_size; i++) {
+          float value = (get_q<QT>(row, i) - old_params.zero_point) *
+              old_params.scale;
+          set_q<QT>(
+              row,
+              i,
+              quantize_value<QT>(value, inv_scale, params.zero_point));
+        }
+      }
+    }
+  }
+  set_params(page, params);
+  float inv_scale = 1 / params.scale;
+  for (size_t t = 0; t < srcs.size(); t++) {
+    uint8_t* row = page + (offsets[t] + 1) * row_size;
+    for (int64_t i = 0; i < head_size; i++) {
+      set_q<QT>(
+          row,
+          i,
+          quantize_value<QT>(
+              static_cast<float>(srcs[t][i]), inv_scale, params.zero_point));
+    }
+  }
+}
+
+} // namespace kv_quant
+
+namespace kv_vnni {
+
+// The BF16 KV cache can be stored in the VNNI packed layout read by the
+// BRGEMMs of the decoding directly, which is selected by the 5-D cache
+// tensors (kv_cache_dtype "vnni" of reshape_and_cache):
+//   key_cache:   [num_blocks, num_kv_heads, head_size / 2, block_size, 2]
+//   value_cache: [num_blocks, num_kv_heads, block_size / 2, head_size, 2]
+// i.e. each (block, head) page of the key is K^T and that of the value is V,
+// with every two rows interleaved.
+constexpr int64_t VNNI_SIZE = 2;
+
+inline bool is_vnni_kv_cache(const at::Tensor& cache) {
+  return cache.dim() == 5;
+}
+
+inline int64_t get_block_size(const at::Tensor& key_cache) {
+  return key_cache.size(3);
+}
+
+inline void check_kv_cache(
+    const at::Tensor& key_cache,
+    const at::Tensor& value_cache,
+    int64_t head_size) {
+  TORCH_CHECK(
+      is_vnni_kv_cache(value_cache),
+      "The key and value caches should have the same layout");
+  TORCH_CHECK(
+      key_cache.scalar_type() == at::ScalarType::BFloat16 &&
+          value_cache.scalar_type() == at::ScalarType::BFloat16,
+      "The VNNI packed KV cache should be BFloat16");
+  TORCH_CHECK(
+      key_cache.is_contiguous() && value_cache.is_contiguous(),
+      "The VNNI packed KV cache should be contiguous");
+  auto block_size = get_block_size(key_cache);
+  // Otherwise the value page is short of the rows of the last token
+  TORCH_CHECK(
+      block_size % VNNI_SIZE == 0,
+      "The VNNI packed KV cache should have an even block_size");
+  TORCH_CHECK(
+      key_cache.size(2) * VNNI_SIZE == head_size &&
+          key_cache.size(4) == VNNI_SIZE &&
+          value_cache.sizes() ==
+              at::IntArrayRef(
+                  {key_cache.size(0),
+                   key_cache.size(1),
+                   block_size / VNNI_SIZE,
+                   head_size,
+                   VNNI_SIZE}),
+      "The VNNI packed KV cache should be [num_blocks, num_kv_heads, head_size / 2, block_size, 2] for the key and [num_blocks, num_kv_heads, block_size / 2, head_size, 2] for the value");
+}
+
+// The offset of the element d of the token t in a key page.
+inline int64_t key_index(int64_t t, int64_t d, int64_t block_size) {
+  return ((d / VNNI_SIZE) * block_size + t) * VNNI_SIZE + d % VNNI_SIZE;
+}
+
+// The offset of the element d of the token t in a value page.
+inline int64_t value_index(int64_t t, int64_t d, int64_t head_size) {
+  return ((t / VNNI_SIZE) * head_size + d) * VNNI_SIZE + t % VNNI_SIZE;
+}
+
+template <typename scalar_t>
+inline void store_token(
+    scalar_t* key_page,
+    scalar_t* value_page,
+    const scalar_t* key,
+    const scalar_t* value,
+    int64_t t,
+    int64_t block_size,
+    int64_t head_size) {
+  for (int64_t d = 0; d < head_size; d++) {
+    key_page[key_index(t, d, block_size)] = key[d];
+    value_page[value_index(t, d, head_size)] = value[d];
+  }
+}
+
+// Load the token t of a key page to buf [head_size].
+template <typename scalar_t>
+inline scalar_t* load_key_token(
+    const scalar_t* page,
+    scalar_t* buf,
+    int64_t t,
+    int64_t block_size,
+    int64_t head_size) {
+  for (int64_t d = 0; d < head_size; d++) {
+    buf[d] = page[key_index(t, d, block_size)];
+  }
+  return buf;
+}
+
+// Load the token t of a value page to buf [head_size].
+template <typename scalar_t>
+inline scalar_t* load_value_token(
+    const scalar_t* page,
+    scalar_t* buf,
+    int64_t t,
+    int64_t head_size) {
+  for (int64_t d = 0; d < head_size; d++) {
+    buf[d] = page[value_index(t, d, head_size)];
+  }
+  return buf;
+}
+
+// Unpack the first tokens of a key or value page to buf [tokens, head_size]
+// for the kernels reading the tokens by rows.
+template <typename scalar_t>
+inline scalar_t* unpack_page(
+    const scalar_t* page,
+    scalar_t* buf,
+    int64_t tokens,
+    int64_t block_size,
+    int64_t head_size,
+    bool is_key) {
+  for (int64_t t = 0; t < tokens; t++) {
+    if (is_key) {
+      load_key_token(page, buf + t * head_size, t, block_size, head_size);
+    } else {
+      load_value_token(page, buf + t * head_size, t, head_size);
+    }
+  }
+  return buf;
+}
+
+} // namespace kv_vnni
+
+template <typename cache_t>
+inline cache_t* get_cache_data_ptr(at::Tensor& cache) {
+  if constexpr (kv_quant::is_quantized_v<cache_t>) {
+    return reinterpret_cast<cache_t*>(cache.data_ptr<uint8_t>());
+  } else {
+    return cache.data_ptr<cache_t>();
+  }
+}
+
+// Get the tokens of a (block, head) page of the KV cache for the kernels
+// reading the cache as is. The quantized page is dequantized into buf, whose
+// token stride is head_size.
+template <typename scalar_t, typename cache_t>
+inline auto get_kv_page(
+    cache_t* page,
+    scalar_t* buf,
+    int64_t tokens,
+    int64_t head_size) {
+  if constexpr (kv_quant::is_quantized_v<cache_t>) {
+    kv_quant::dequantize_page<scalar_t, cache_t>(
+        reinterpret_cast<uint8_t*>(page), buf, tokens, head_size);
+    return buf;
+  } else {
+    return page;
+  }
+}
+
+// Get the tokens of a (block, head) page of the KV cache in scalar_t.
+template <typename scalar_t, typename cache_t>
+inline scalar_t* dequantize_kv_page(
+    cache_t* page,
+    scalar_t* buf,
+    int64_t tokens,
+    int64_t head_size,
+    float scale) {
+  if constexpr (kv_quant::is_quantized_v<cache_t>) {
+    kv_quant::dequantize_page<scalar_t, cache_t>(
+        reinterpret_cast<uint8_t*>(page), buf, tokens, head_size);
+    return buf;
+  } else {
+    return flexible_dequantize_cache<scalar_t, cache_t>(
+        page, buf, head_size * tokens, scale);
+  }
+}
+
+// Get the tokens of a (block, head) page in scalar_t by rows, the VNNI packed
+// page is unpacked into buf.
+template <typename scalar_t, typename cache_t>
+inline scalar_t* get_kv_page_rows(
+    cache_t* page,
+    scalar_t* buf,
+    int64_t tokens,
+    int64_t block_size,
+    int64_t head_size,
+    float scale,
+    bool is_packed,
+    bool is_key) {
+  if constexpr (std::is_same_v<scalar_t, cache_t>) {
+    if (is_packed) {
+      return kv_vnni::unpack_page(
+          page, buf, tokens, block_size, head_size, is_key);
+    }
+  }
+  return dequantize_kv_page<scalar_t, cache_t>(
+      page, buf, tokens, head_size, scale);
+}
+
+// 8 or 4 for the INT8/INT4 KV cache, 0 for the other caches.
+int64_t get_kv_cache_quant_bits(
+    const at::Tensor& key_cache,
+    int64_t head_size) {
+  if (key_cache.scalar_type() != at::ScalarType::Byte) {
+    return 0;
+  }
+  auto row_size = key_cache.size(3);
+  TORCH_CHECK(
+      row_size == head_size || row_size * 2 == head_size,
+      "The last dim of the INT8/INT4 KV cache should be head_size or head_size / 2");
+  TORCH_CHECK(
+      row_size >= static_cast<int64_t>(sizeof(kv_quant::PageParams)),
+      "head_size is too small for the INT8/INT4 KV cache");
+  return row_size == head_size ? 8 : 4;
+}
+
+// Call f(scalar_t(), quant_t()) with the data types of the INT8/INT4 KV cache.
+template <typename F>
+void dispatch_quantized_kv_cache(
+    at::ScalarType dtype,
+    int64_t quant_bits,
+    const F& f) {
+  auto dispatch_quant = [&](auto scalar) {
+    if (quant_bits == 8) {
+      f(scalar, kv_quant::Int8());
+    } else {
+      f(scalar, kv_quant::Int4());
+    }
+  };
+  if (dtype == at::ScalarType::Float) {
+    dispatch_quant(float());
+  } else if (dtype == at::ScalarType::BFloat16) {
+    dispatch_quant(at::BFloat16());
+  } else if (dtype == at::ScalarType::Half) {
+    dispatch_quant(at::Half());
+  } else {
+    TORCH_CHECK(false, "Unsupported data type for the INT8/INT4 KV cache");
+  }
+}
+
 inline c10::SymFloat calculate_scale(
     const at::Tensor& query,
     c10::optional<double> scale) {
@@ -559,10 +980,16 @@ inline void _mul_alibi_reduce_max_fusion_kernel(
     scalar_t& max,
     const int& token_start,
     const int& context_len,
-    const scalar_t& alibi_slope) {
+    const scalar_t& alibi_slope,
+    const int& sink_len = 0,
+    const int& evicted_len = 0) {
   for (auto i = 0; i < size; i++) {
     a[i] = a[i] * scale;
-    auto alibi_slopes_val = alibi_slope * (i + token_start + 1 - context_len);
+    // the positions after the sink tokens are shifted by the evicted tokens
+    auto position = i + token_start;
+    if (position >= sink_len)
+      position += evicted_len;
+    auto alibi_slopes_val = alibi_slope * (position + 1 - context_len);
     a[i] += alibi_slopes_val;
     max = std::max(max, a[i]);
   }
@@ -652,6 +1079,80 @@ at::Tensor deduce_prompt(at::Tensor& block_tables) {
   return prompt_block_nums;
 }
 
+// Max number of sequences computing a shared partition together, which bounds
+// the work of one parallel task.
+#define PREFIX_SHARING_MAX_GROUP_SIZE 8
+
+struct PrefixSharingGroups {
+  // Sequences of each group, the first one computes the shared partitions.
+  std::vector<std::vector<int>> members;
+  // Number of leading partitions whose K/V are the same for the group.
+  std::vector<int> shared_partition_nums;
+  // Group of each sequence.
+  std::vector<int> group_ids;
+};
+
+/**
+ * Groups the sequences sharing the leading physical blocks, such as the beams
+ * of a prompt or the requests with a common system prompt. Unlike
+ * deduce_prompt, the sequences of a group do not need to be adjacent.
+ *
+ * @param block_tables  Block tables tensor [num_seqs, max_num_blocks_per_seq].
+ * @param context_lens  Context lengths tensor [num_seqs].
+ * @return The groups and their number of full partitions within the shared
+ * blocks and the context of every member.
+ */
+PrefixSharingGroups deduce_prefix_sharing(
+    at::Tensor& block_tables,
+    at::Tensor& context_lens,
+    int64_t block_size,
+    int64_t partition_size,
+    int64_t max_group_size) {
+  int num_seqs = block_tables.size(0);
+  int max_num_blocks_per_seq = block_tables.size(1);
+  auto block_tables_ptr = block_tables.data_ptr<int>();
+  auto context_lens_ptr = context_lens.data_ptr<int>();
+  PrefixSharingGroups groups;
+  groups.group_ids.resize(num_seqs);
+  // group being filled for each first block
+  std::unordered_map<int, int> open_groups;
+  for (int i = 0; i < num_seqs; i++) {
+    auto first_block_id = block_tables_ptr[i * max_num_blocks_per_seq];
+    auto it = open_groups.find(first_block_id);
+    if (it == open_groups.end() ||
+        static_cast<int64_t>(groups.members[it->second].size()) >=
+            max_group_size) {
+      open_groups[first_block_id] = groups.members.size();
+      groups.members.emplace_back();
+    }
+    groups.group_ids[i] = open_groups[first_block_id];
+    groups.members[groups.group_ids[i]].emplace_back(i);
+  }
+  for (auto& group_members : groups.members) {
+    auto leader_blocks =
+        block_tables_ptr + group_members[0] * max_num_blocks_per_seq;
+    int shared_blocks = max_num_blocks_per_seq;
+    int shared_tokens = context_lens_ptr[group_members[0]];
+    for (size_t j = 1; j < group_members.size(); j++) {
+      auto member_blocks =
+          block_tables_ptr + group_members[j] * max_num_blocks_per_seq;
+      int curr_blocks = 0;
+      while (curr_blocks < shared_blocks &&
+             leader_blocks[curr_blocks] == member_blocks[curr_blocks]) {
+        curr_blocks++;
+      }
+      shared_blocks = curr_blocks;
+      shared_tokens =
+          std::min(shared_tokens, context_lens_ptr[group_members[j]]);
+    }
+    shared_tokens =
+        std::min<int64_t>(shared_tokens, shared_blocks * block_size);
+    groups.shared_partition_nums.emplace_back(
+        group_members.size() > 1 ? shared_tokens / partition_size : 0);
+  }
+  return groups;
+}
+
 /**
  * Performs scale-dot-product for the next token based on cached key-value
  * attention.
@@ -666,9 +1167,11 @@ at::Tensor deduce_prompt(at::Tensor& block_tables) {
  * @param out           Output tensor [num_seqs, num_heads, head_size].
  * @param query         Query tensor [num_seqs, num_heads, head_size].
  * @param key_cache     The pre-allocated buffer to store the key cache. The
- * shape should be [num_blocks, num_key_value_heads, block_size, head_size].
+ * shape should be [num_blocks, num_key_value_heads, block_size, head_size], or
+ * the VNNI packed layout of kv_vnni which is not reordered per block.
  * @param value_cache   The pre-allocated buffer to store the value cache. The
- * shape should be [num_blocks, num_key_value_heads, block_size, head_size].
+ * shape should be [num_blocks, num_key_value_heads, block_size, head_size], or
+ * the VNNI packed layout of kv_vnni.
  * @param scale         Scaling factor for attention weights. In general, it is:
  * float(1.0 / (head_size ** 0.5)).
  * @param block_tables  Block tables tensor [num_seqs, max_num_blocks_per_seq].
@@ -698,7 +1201,7 @@ void single_query_cached_kv_attention_vnni_kernel(
     const double v_scale,
     const double softcap) {
   // TODO: Support window_size
-  TORCH_CHECK(window_size > 0, "Sliding window unsupported");
+  TORCH_CHECK(window_size <= 0, "Sliding window unsupported");
   bool use_softcap = softcap == -1 ? false : true;
   auto scale_ = use_softcap ? 1.0 : scale;
   auto out_ptr = out.data_ptr<scalar_t>();
@@ -716,6 +1219,8 @@ void single_query_cached_kv_attention_vnni_kernel(
   auto num_kv_heads = key_cache.size(1);
   auto kv_head_group_size = num_heads / num_kv_heads;
   auto max_num_blocks_per_seq = block_tables.size(1);
+  // The pages of the VNNI packed cache are read by the BRGEMMs as is.
+  bool is_packed = kv_vnni::is_vnni_kv_cache(key_cache);
 
   constexpr bool is_reduced_type =
       at::vec::is_reduced_floating_point_v<scalar_t>;
@@ -853,6 +1358,21 @@ void single_query_cached_kv_attention_vnni_kernel(
       /*unroll_hint*/ 1,
       /*b_vnni*/ 1)));
 
+  auto get_k_block = [&](cache_t* k_cache_start, scalar_t* k_cache_reorder) {
+    if (is_packed) {
+      return k_cache_start;
+    }
+    k_xform(k_cache_start, k_cache_reorder);
+    return k_cache_reorder;
+  };
+  auto get_v_block = [&](cache_t* v_cache_start, scalar_t* v_cache_reorder) {
+    if (is_packed) {
+      return v_cache_start;
+    }
+    v_xform(v_cache_start, v_cache_reorder);
+    return v_cache_reorder;
+  };
+
 #pragma omp parallel for collapse(2) schedule(static, 1)
   for (auto head_id = 0; head_id < num_heads; head_id++) {
     for (auto batch_id = 0; batch_id < batch_size; batch_id++) {
@@ -878,10 +1398,9 @@ void single_query_cached_kv_attention_vnni_kernel(
             [seq_id_start * max_num_blocks_per_seq + seq_block_id];
         auto k_cache_start = key_cache_ptr + block_id * kv_block_strideN +
             kv_head_id * kv_block_strideH;
-        k_xform(k_cache_start, k_cache_reorder);
         qk_gemm_prompt(
             query_ptr_start,
-            k_cache_reorder,
+            get_k_block(k_cache_start, k_cache_reorder),
             attn_weights_ptr_start + seq_block_id * block_size,
             1);
       }
@@ -898,8 +1417,11 @@ void single_query_cached_kv_attention_vnni_kernel(
               block_tables_ptr[seq_id * max_num_blocks_per_seq + seq_block_id];
           auto k_cache_start = key_cache_ptr + block_id * kv_block_strideN +
               kv_head_id * kv_block_strideH;
-          k_xform(k_cache_start, k_cache_reorder);
-          qk_gemm_rest(q_ptr_start, k_cache_reorder, attn_w_pos, 1);
+          qk_gemm_rest(
+              q_ptr_start,
+              get_k_block(k_cache_start, k_cache_reorder),
+              attn_w_pos,
+              1);
         }
       }
       // for the rest tail
@@ -913,8 +1435,17 @@ void single_query_cached_kv_attention_vnni_kernel(
           auto block_id = block_tables_ptr
               [seq_id * max_num_blocks_per_seq + token_id / block_size];
           auto block_offset = token_id % block_size;
-          auto k_cache_start = key_cache_ptr + block_id * kv_block_strideN +
-              block_offset * kv_block_strideP + kv_head_id * kv_block_strideH;
+          auto k_cache_start = is_packed
+              ? kv_vnni::load_key_token(
+                    key_cache_ptr + block_id * kv_block_strideN +
+                        kv_head_id * kv_block_strideH,
+                    k_cache_reorder,
+                    block_offset,
+                    block_size,
+                    head_size)
+              : key_cache_ptr + block_id * kv_block_strideN +
+                  block_offset * kv_block_strideP +
+                  kv_head_id * kv_block_strideH;
           reduce_head<scalar_t, scalar_t>(
               q_ptr_start, k_cache_start, attn_w_pos, head_size);
         }
@@ -1034,10 +1565,9 @@ void single_query_cached_kv_attention_vnni_kernel(
             [seq_id_start * max_num_blocks_per_seq + seq_block_id];
         auto v_cache_start = value_cache_ptr + block_id * kv_block_strideN +
             kv_head_id * kv_block_strideH;
-        v_xform(v_cache_start, v_cache_reorder);
         av_gemm_prompt(
             attn_weights_start + seq_block_id * block_size,
-            v_cache_reorder,
+            get_v_block(v_cache_start, v_cache_reorder),
             fp32_attn_out_start,
             1);
       }
@@ -1055,8 +1585,11 @@ void single_query_cached_kv_attention_vnni_kernel(
               block_tables_ptr[seq_id * max_num_blocks_per_seq + seq_block_id];
           auto v_cache_start = value_cache_ptr + block_id * kv_block_strideN +
               kv_head_id * kv_block_strideH;
-          v_xform(v_cache_start, v_cache_reorder);
-          av_gemm_rest(attn_w, v_cache_reorder, attn_out_start, 1);
+          av_gemm_rest(
+              attn_w,
+              get_v_block(v_cache_start, v_cache_reorder),
+              attn_out_start,
+              1);
         }
         if (complete_token_length == context_len) {
           // write to the output after the last token is done
@@ -1078,8 +1611,16 @@ void single_query_cached_kv_attention_vnni_kernel(
           auto block_id = block_tables_ptr
               [seq_id * max_num_blocks_per_seq + token_id / block_size];
           auto block_offset = token_id % block_size;
-          auto v_cache_start = value_cache_ptr + block_id * kv_block_strideN +
-              block_offset * kv_block_strideP + kv_head_id * kv_block_strideH;
+          auto v_cache_start = is_packed
+              ? kv_vnni::load_value_token(
+                    value_cache_ptr + block_id * kv_block_strideN +
+                        kv_head_id * kv_block_strideH,
+                    v_cache_reorder,
+                    block_offset,
+                    head_size)
+              : value_cache_ptr + block_id * kv_block_strideN +
+                  block_offset * kv_block_strideP +
+                  kv_head_id * kv_block_strideH;
           mul_attenion_weights_and_value_of_head<float, scalar_t>(
               attn_w, v_cache_start, attn_out_start, head_size, token_id);
         }
@@ -1094,6 +1635,126 @@ void single_query_cached_kv_attention_vnni_kernel(
 
 } // single_query_cached_kv_attention_vnni_kernel
 
+/**
+ * Merges the partial results of the partitions of flash decoding into out.
+ *
+ * @param out           Output tensor [num_seqs * num_queries, num_heads,
+ * head_size].
+ * @param tmp_out       The partial outputs [num_seqs * num_queries, num_heads,
+ * max_num_partitions, head_size].
+ * @param max_logits    The max logits of the partitions.
+ * @param exp_sum       The exp sums of the partitions.
+ * @param context_lens_ptr Context lengths [num_seqs].
+ * @param num_queries   Number of the queries of each sequence.
+ * @param partition_size The number of tokens of every partition.
+ */
+template <typename scalar_t>
+void reduce_partitions(
+    at::Tensor& out,
+    at::Tensor& tmp_out,
+    at::Tensor& max_logits,
+    at::Tensor& exp_sum,
+    const int* context_lens_ptr,
+    int64_t num_queries,
+    int partition_size) {
+  auto num_seqs = out.size(0);
+  auto num_heads = out.size(1);
+  auto head_size = out.size(2);
+  auto max_num_partitions = tmp_out.size(2);
+  auto out_ptr = out.data_ptr<scalar_t>();
+  auto tmp_out_ptr = tmp_out.data_ptr<float>();
+  auto max_logits_ptr = max_logits.data_ptr<float>();
+  auto exp_sum_ptr = exp_sum.data_ptr<float>();
+  auto out_strideN = out.stride(0);
+  auto out_strideH = out.stride(1);
+  auto max_logits_strideN = max_logits.stride(0);
+  auto max_logits_strideH = max_logits.stride(1);
+  auto exp_sum_strideN = exp_sum.stride(0);
+  auto exp_sum_strideH = exp_sum.stride(1);
+  auto tmp_out_strideN = tmp_out.stride(0);
+  auto tmp_out_strideH = tmp_out.stride(1);
+  auto tmp_out_strideS = tmp_out.stride(2);
+
+#pragma omp parallel for collapse(2)
+  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
+    for (auto head_id = 0; head_id < num_heads; head_id++) {
+      auto global_max = -std::numeric_limits<float>::infinity();
+      auto global_exp_sum = 0.0;
+      auto context_len = context_lens_ptr[seq_id / num_queries];
+      auto partition_num = (context_len + partition_size - 1) / partition_size;
+      // calculate the global max and exp_sum for this head
+      for (auto partition_id = 0; partition_id < max_num_partitions;
+           partition_id++) {
+        if (partition_id >= partition_num)
+          break;
+        auto max_logit = max_logits_ptr
+            [seq_id * max_logits_strideN + head_id * max_logits_strideH +
+             partition_id];
+        global_max = std::max(global_max, max_logit);
+      }
+      // update the partition 0 result with the global max
+      auto partition0_out_start =
+          tmp_out_ptr + seq_id * tmp_out_strideN + head_id * tmp_out_strideH;
+      auto max_logit0 = max_logits_ptr
+          [seq_id * max_logits_strideN + head_id * max_logits_strideH];
+      float exp_val = expf(max_logit0 - global_max);
+      global_exp_sum +=
+          exp_sum_ptr[seq_id * exp_sum_strideN + head_id * exp_sum_strideH] *
+          exp_val;
+      at::vec::Vectorized<float> exp_val_vec0(exp_val);
+      at::vec::map<float>(
+          [&](auto a) { return a * exp_val_vec0; },
+          partition0_out_start,
+          partition0_out_start,
+          head_size);
+
+      // accumulate the partition 1 to partition n result into partition 0
+      if (partition_num > 1) {
+        for (auto partition_id = 1; partition_id < partition_num;
+             partition_id++) {
+          if (partition_id * partition_size >= context_len)
+            break;
+          auto tmp_out_start = tmp_out_ptr + seq_id * tmp_out_strideN +
+              head_id * tmp_out_strideH + partition_id * tmp_out_strideS;
+          auto max_logit = max_logits_ptr
+              [seq_id * max_logits_strideN + head_id * max_logits_strideH +
+               partition_id];
+          auto exp_sum = exp_sum_ptr
+              [seq_id * exp_sum_strideN + head_id * exp_sum_strideH +
+               partition_id];
+          exp_val = expf(max_logit - global_max);
+          global_exp_sum += exp_sum * exp_val;
+          at::vec::Vectorized<float> exp_val_vec(exp_val);
+          at::vec::map2<float>(
+              [&](auto a, auto b) { return a + exp_val_vec * b; },
+              partition0_out_start,
+              partition0_out_start,
+              tmp_out_start,
+              head_size);
+        }
+      }
+
+      // copy the partition 0 result into attn_outs
+      auto attn_out_start =
+          out_ptr + seq_id * out_strideN + head_id * out_strideH;
+      float inverse_global_sum = 1.0 / (global_exp_sum + 1e-8);
+      at::vec::Vectorized<float> inverse_global_sum_vec(inverse_global_sum);
+      // rescale the partition 0 result with global exp_sum
+      at::vec::map<float>(
+          [&](auto a) { return a * inverse_global_sum_vec; },
+          partition0_out_start,
+          partition0_out_start,
+          head_size);
+      // copy the partition 0 result into attn_outs
+      at::vec::map<scalar_t>(
+          [&](auto a) { return a; },
+          attn_out_start,
+          partition0_out_start,
+          head_size);
+    }
+  }
+}
+
 /**
  * Performs scale-dot-product for the next token based on cached key-value
  * attention.
@@ -1122,6 +1783,12 @@ void single_query_cached_kv_attention_vnni_kernel(
  * (num_heads).
  * @param k_scale       Scaling factor for key cache of data type fp8.
  * @param v_scale       Scaling factor for value cache of data type fp8.
+ * @param evicted_lens  Optional number of the tokens evicted from the middle
+ * of every sequence by evict_kv_blocks [num_seqs], which shifts the positions
+ * after the sink blocks for alibi and sliding window.
+ * @param num_sink_tokens The leading tokens which are always attended besides
+ * the sliding window.
+ * @param partition_size The number of tokens of every partition.
  */
 template <typename scalar_t, typename cache_t>
 void single_query_cached_kv_attention_fd_kernel(
@@ -1138,15 +1805,17 @@ void single_query_cached_kv_attention_fd_kernel(
     int64_t window_size,
     const double k_scale,
     const double v_scale,
-    const double softcap) {
+    const double softcap,
+    const c10::optional<at::Tensor>& evicted_lens,
+    int64_t num_sink_tokens,
+    int partition_size = PARTITION_SIZE) {
   bool use_softcap = softcap == -1 ? false : true;
   // TODO: Support both use_softcap and window_size
   TORCH_CHECK(!(window_size > 0 && use_softcap == true));
   auto scale_ = use_softcap ? 1.0 : scale;
-  auto out_ptr = out.data_ptr<scalar_t>();
   auto query_ptr = query.data_ptr<scalar_t>();
-  auto key_cache_ptr = key_cache.data_ptr<cache_t>();
-  auto value_cache_ptr = value_cache.data_ptr<cache_t>();
+  auto key_cache_ptr = get_cache_data_ptr<cache_t>(key_cache);
+  auto value_cache_ptr = get_cache_data_ptr<cache_t>(value_cache);
   auto block_tables_ptr = block_tables.data_ptr<int>();
   auto context_lens_ptr = context_lens.data_ptr<int>();
   auto alibi_slopes_ptr = alibi_slopes.has_value()
@@ -1163,14 +1832,11 @@ void single_query_cached_kv_attention_fd_kernel(
   auto kv_block_strideP = key_cache.stride(2);
   auto kv_block_strideH = key_cache.stride(1);
 
-  auto out_strideN = out.stride(0);
-  auto out_strideH = out.stride(1);
-
   auto q_strideN = query.stride(0);
   auto q_strideH = query.stride(1);
 
   auto max_num_partitions =
-      (max_context_len + PARTITION_SIZE - 1) / PARTITION_SIZE;
+      (max_context_len + partition_size - 1) / partition_size;
 
   auto max_logits = at::empty(
       {num_seqs, num_heads, max_num_partitions + 1},
@@ -1184,7 +1850,16 @@ void single_query_cached_kv_attention_fd_kernel(
       {num_seqs, num_heads, max_num_partitions, head_size},
       query.options().dtype(at::ScalarType::Float));
 
-  bool is_local = window_size > 0 && window_size < max_context_len;
+  // The evicted tokens are counted in the context for the positions, the
+  // sink blocks are kept at the head of the block tables.
+  auto evicted_lens_ptr = evicted_lens.has_value()
+      ? evicted_lens.value().data_ptr<int>()
+      : nullptr;
+  int sink_len = evicted_lens_ptr == nullptr
+      ? 0
+      : (num_sink_tokens + block_size - 1) / block_size * block_size;
+  bool is_local = window_size > 0 &&
+      (window_size < max_context_len || evicted_lens_ptr != nullptr);
   if (is_local) {
     max_logits = at::zeros(
         {num_seqs, num_heads, max_num_partitions + 1},
@@ -1216,11 +1891,41 @@ void single_query_cached_kv_attention_fd_kernel(
   auto thread_numbers = omp_get_max_threads();
   auto max_parallel_parts = thread_numbers * 4;
 
+  // The alibi bias and the sliding window depend on the context length, so
+  // the shared prefix is only computed once without them.
+  bool use_prefix_sharing = !is_local && alibi_slopes_ptr == nullptr &&
+      torch_ipex::tpp::env2int("PAGED_ATTENTION_PREFIX_SHARING", 1) != 0;
+  PrefixSharingGroups prefix_groups;
+  int max_group_size = 1;
+  if (use_prefix_sharing) {
+    prefix_groups = deduce_prefix_sharing(
+        block_tables,
+        context_lens,
+        block_size,
+        partition_size,
+        PREFIX_SHARING_MAX_GROUP_SIZE);
+    for (size_t i = 0; i < prefix_groups.members.size(); i++) {
+      if (prefix_groups.shared_partition_nums[i] > 0) {
+        max_group_size =
+            std::max<int>(max_group_size, prefix_groups.members[i].size());
+      }
+    }
+    use_prefix_sharing = max_group_size > 1;
+  }
+
   auto tmp_logits = at::empty(
-      {thread_numbers, kv_head_group_size, PARTITION_SIZE},
+      {thread_numbers, max_group_size * kv_head_group_size, partition_size},
       query.options().dtype(at::ScalarType::Float));
   auto logits_ptrs = tmp_logits.data_ptr<float>();
 
+  // The quantized pages are dequantized into the per thread buffers.
+  constexpr bool is_quantized_cache = kv_quant::is_quantized_v<cache_t>;
+  auto kv_page_bufs = at::empty(
+      {thread_numbers, is_quantized_cache ? block_size * head_size : 0},
+      query.options());
+  auto kv_page_buf_ptrs = kv_page_bufs.data_ptr<scalar_t>();
+  auto kv_token_stride = is_quantized_cache ? head_size : kv_block_strideP;
+
   if (alibi_slopes.has_value()) {
     auto alibi_slopes_size = alibi_slopes.value().size(0);
     TORCH_CHECK(
@@ -1234,31 +1939,45 @@ void single_query_cached_kv_attention_fd_kernel(
       for (auto head_group_start = 0; head_group_start < num_heads;
            head_group_start += kv_head_group_size) {
         auto omp_thread_id = omp_get_thread_num();
+        // The shared partitions of a prefix sharing group are computed by the
+        // first member for all the members, the K/V are loaded once.
+        const int* members = &seq_id;
+        int num_members = 1;
+        if (use_prefix_sharing) {
+          auto group_id = prefix_groups.group_ids[seq_id];
+          if (partition_id < prefix_groups.shared_partition_nums[group_id]) {
+            auto& group_members = prefix_groups.members[group_id];
+            if (group_members[0] != seq_id)
+              continue;
+            members = group_members.data();
+            num_members = group_members.size();
+          }
+        }
+        auto num_rows = num_members * kv_head_group_size;
         auto context_len = context_lens_ptr[seq_id];
-        auto partition_start = partition_id * PARTITION_SIZE;
+        auto partition_start = partition_id * partition_size;
         if (partition_start >= context_len)
           continue;
         auto partition_end =
-            std::min(partition_start + PARTITION_SIZE, context_len);
-        long sliding_window_start = is_local ? context_len - window_size : -1;
-        if (is_local && partition_end < sliding_window_start)
+            std::min(partition_start + partition_size, context_len);
+        int evicted_len =
+            evicted_lens_ptr == nullptr ? 0 : evicted_lens_ptr[seq_id];
+        auto to_position = [&](int token_id) {
+          return token_id < sink_len ? token_id : token_id + evicted_len;
+        };
+        long sliding_window_start =
+            is_local ? context_len + evicted_len - window_size : -1;
+        if (is_local && partition_start >= num_sink_tokens &&
+            to_position(partition_end) < sliding_window_start)
           continue;
         auto token_num = partition_end - partition_start;
         auto block_num = (token_num + block_size - 1) / block_size;
         auto logical_block_start = partition_start / block_size;
         auto logical_block_end = logical_block_start + block_num;
         auto kv_head_id = head_group_start / kv_head_group_size;
-        auto q_ptr_start =
-            query_ptr + seq_id * q_strideN + head_group_start * q_strideH;
-        auto max_logits_offset = seq_id * max_logits_strideN +
-            head_group_start * max_logits_strideH + partition_id;
-        auto exp_sum_offset = seq_id * exp_sum_strideN +
-            head_group_start * exp_sum_strideH + partition_id;
-        //{num_seqs, num_heads, max_num_partitions, head_size}
-        auto tmp_out_start = tmp_out_ptr + seq_id * tmp_out_strideN +
-            head_group_start * tmp_out_strideH + partition_id * tmp_out_strideS;
-        float* logits =
-            logits_ptrs + omp_thread_id * PARTITION_SIZE * kv_head_group_size;
+        float* logits = logits_ptrs + omp_thread_id * tmp_logits.stride(0);
+        scalar_t* kv_page_buf =
+            kv_page_buf_ptrs + omp_thread_id * kv_page_bufs.size(1);
         auto logits_position = 0;
         // 1)calculate the matmul(query, key) for this partition
         for (auto logical_block_id = logical_block_start;
@@ -1270,34 +1989,50 @@ void single_query_cached_kv_attention_fd_kernel(
               std::min(block_size, context_len - logical_block_id * block_size);
           auto token_start = logical_block_id * block_size;
           auto token_end = token_start + tokens_in_block;
+          auto k_page = get_kv_page<scalar_t, cache_t>(
+              key_cache_ptr + physical_block_id * kv_block_strideN +
+                  kv_head_id * kv_block_strideH,
+              kv_page_buf,
+              tokens_in_block,
+              head_size);
           for (auto token_id = token_start; token_id < token_end; token_id++) {
             auto block_offset = token_id - token_start;
-            auto k_cache_start = key_cache_ptr +
-                physical_block_id * kv_block_strideN +
-                block_offset * kv_block_strideP + kv_head_id * kv_block_strideH;
-            if (is_local && token_id < sliding_window_start) {
-              for (auto i = 0; i < kv_head_group_size; i++) {
-                logits[logits_position + i * PARTITION_SIZE] =
+            auto k_cache_start = k_page + block_offset * kv_token_stride;
+            if (is_local && token_id >= num_sink_tokens &&
+                to_position(token_id) < sliding_window_start) {
+              for (auto i = 0; i < num_rows; i++) {
+                logits[logits_position + i * partition_size] =
                     -std::numeric_limits<float>::infinity();
               }
             } else {
-              reduce_head(
-                  q_ptr_start,
-                  kv_head_group_size,
-                  k_cache_start,
-                  &(logits[logits_position]),
-                  PARTITION_SIZE,
-                  head_size);
+              for (auto m = 0; m < num_members; m++) {
+                reduce_head(
+                    query_ptr + members[m] * q_strideN +
+                        head_group_start * q_strideH,
+                    kv_head_group_size,
+                    k_cache_start,
+                    &(logits
+                          [m * kv_head_group_size * partition_size +
+                           logits_position]),
+                    partition_size,
+                    head_size);
+              }
             }
             logits_position++;
           }
         }
         // 2) calculate the max and exp_sum for this partition
-        for (int hi = 0; hi < kv_head_group_size; hi++) {
+        for (int row = 0; row < num_rows; row++) {
+          auto member_seq_id = members[row / kv_head_group_size];
+          auto hi = row % kv_head_group_size;
+          auto max_logits_offset = member_seq_id * max_logits_strideN +
+              head_group_start * max_logits_strideH + partition_id;
+          auto exp_sum_offset = member_seq_id * exp_sum_strideN +
+              head_group_start * exp_sum_strideH + partition_id;
           if (use_softcap) { // size : context_len
             softcap_kernel(
-                logits + hi * PARTITION_SIZE,
-                logits + hi * PARTITION_SIZE,
+                logits + row * partition_size,
+                logits + row * partition_size,
                 token_num,
                 softcap,
                 scale);
@@ -1305,20 +2040,22 @@ void single_query_cached_kv_attention_fd_kernel(
           auto partition_max = -std::numeric_limits<float>::infinity();
           if (alibi_slopes_ptr != nullptr) {
             _mul_alibi_reduce_max_fusion_kernel<float>(
-                logits + hi * PARTITION_SIZE,
+                logits + row * partition_size,
                 scale_,
                 token_num,
-                logits + hi * PARTITION_SIZE,
+                logits + row * partition_size,
                 partition_max,
                 partition_start,
-                context_len,
-                alibi_slopes_ptr[head_group_start + hi]);
+                context_len + evicted_len,
+                alibi_slopes_ptr[head_group_start + hi],
+                sink_len,
+                evicted_len);
           } else {
             _mul_reduce_max_fusion_kernel<float>(
-                logits + hi * PARTITION_SIZE,
+                logits + row * partition_size,
                 scale_,
                 token_num,
-                logits + hi * PARTITION_SIZE,
+                logits + row * partition_size,
                 partition_max);
           }
           max_logits_ptr[max_logits_offset + hi * max_logits_strideH] =
@@ -1327,9 +2064,9 @@ void single_query_cached_kv_attention_fd_kernel(
             partition_max = 0;
           }
           _exp_reduce_sum_fusion_kernel<float, float>(
-              logits + hi * PARTITION_SIZE,
+              logits + row * partition_size,
               token_num,
-              logits + hi * PARTITION_SIZE,
+              logits + row * partition_size,
               partition_max);
           exp_sum_ptr[exp_sum_offset + hi * exp_sum_strideH] = partition_max;
         }
@@ -1346,21 +2083,33 @@ void single_query_cached_kv_attention_fd_kernel(
               std::min(block_size, context_len - logical_block_id * block_size);
           auto token_start = logical_block_id * block_size;
           auto token_end = token_start + tokens_in_block;
+          auto v_page = get_kv_page<scalar_t, cache_t>(
+              value_cache_ptr + physical_block_id * kv_block_strideN +
+                  kv_head_id * kv_block_strideH,
+              kv_page_buf,
+              tokens_in_block,
+              head_size);
           for (auto token_id = token_start; token_id < token_end; token_id++) {
             auto block_offset = token_id - token_start;
-            auto v_cache_start = value_cache_ptr +
-                physical_block_id * kv_block_strideN +
-                block_offset * kv_block_strideP + kv_head_id * kv_block_strideH;
+            auto v_cache_start = v_page + block_offset * kv_token_stride;
             auto accumulated = logits_position > 0;
-            mul_attenion_weights_and_value_of_head(
-                &(logits[logits_position]),
-                PARTITION_SIZE,
-                v_cache_start,
-                tmp_out_start,
-                tmp_out_strideH,
-                kv_head_group_size,
-                head_size,
-                accumulated);
+            for (auto m = 0; m < num_members; m++) {
+              //{num_seqs, num_heads, max_num_partitions, head_size}
+              auto tmp_out_start = tmp_out_ptr + members[m] * tmp_out_strideN +
+                  head_group_start * tmp_out_strideH +
+                  partition_id * tmp_out_strideS;
+              mul_attenion_weights_and_value_of_head(
+                  &(logits
+                        [m * kv_head_group_size * partition_size +
+                         logits_position]),
+                  partition_size,
+                  v_cache_start,
+                  tmp_out_start,
+                  tmp_out_strideH,
+                  kv_head_group_size,
+                  head_size,
+                  accumulated);
+            }
             logits_position++;
           }
         }
@@ -1368,86 +2117,289 @@ void single_query_cached_kv_attention_fd_kernel(
     }
   }
 
-// calculate the final output
-#pragma omp parallel for collapse(2)
-  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
-    for (auto head_id = 0; head_id < num_heads; head_id++) {
-      auto global_max = -std::numeric_limits<float>::infinity();
-      auto global_exp_sum = 0.0;
-      auto context_len = context_lens_ptr[seq_id];
-      auto partition_num = (context_len + PARTITION_SIZE - 1) / PARTITION_SIZE;
-      // calculate the global max and exp_sum for this head
-      for (auto partition_id = 0; partition_id < max_num_partitions;
-           partition_id++) {
-        if (partition_id >= partition_num)
-          break;
-        auto max_logit = max_logits_ptr
-            [seq_id * max_logits_strideN + head_id * max_logits_strideH +
-             partition_id];
-        global_max = std::max(global_max, max_logit);
+  // calculate the final output
+  reduce_partitions<scalar_t>(
+      out,
+      tmp_out,
+      max_logits,
+      exp_sum,
+      context_lens_ptr,
+      /*num_queries*/ 1,
+      partition_size);
+} // single_query_cached_kv_attention_fd_kernel
+
+/**
+ * Performs scale-dot-product for num_queries query tokens of every sequence
+ * based on cached key-value attention, such as verifying the draft tokens of
+ * speculative decoding. The key/value of the query tokens should be cached as
+ * the last num_queries tokens of the context. The sequences are split into
+ * partitions like flash decoding, and every key/value token of a partition is
+ * loaded once for all the query tokens of the sequence.
+ *
+ * @param out           Output tensor [num_seqs * num_queries, num_heads,
+ * head_size].
+ * @param query         Query tensor [num_seqs * num_queries, num_heads,
+ * head_size].
+ * @param key_cache     The pre-allocated buffer to store the key cache. The
+ * shape should be [num_blocks, num_kv_heads, block_size, head_size].
+ * @param value_cache   The pre-allocated buffer to store the value cache. The
+ * shape should be [num_blocks, num_kv_heads, block_size, head_size].
+ * @param scale         Scaling factor for attention weights.
+ * @param block_tables  Block tables tensor [num_seqs, max_num_blocks_per_seq].
+ * @param context_lens  Context lengths tensor [num_seqs], including the query
+ * tokens.
+ * @param block_size    The block size which means the number of token in every
+ * block.
+ * @param max_context_len Maximum context length.
+ * @param num_queries   Number of the query tokens of every sequence.
+ * @param query_mask    Optional tensor [num_queries, num_queries], the query
+ * token i attends the query token j if query_mask[i][j] is true. It is causal
+ * by default, the ancestor mask of a token tree can be used for tree
+ * verification.
+ * @param softcap       The positive softcap value, -1 to disable.
+ */
+template <typename scalar_t, typename cache_t>
+void multi_query_cached_kv_attention_kernel(
+    at::Tensor& out,
+    at::Tensor& query,
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    const double scale,
+    at::Tensor& block_tables,
+    at::Tensor& context_lens,
+    int64_t block_size,
+    int64_t max_context_len,
+    int64_t num_queries,
+    const c10::optional<at::Tensor>& query_mask,
+    const double softcap) {
+  bool use_softcap = softcap == -1 ? false : true;
+  auto scale_ = use_softcap ? 1.0 : scale;
+  auto query_ptr = query.data_ptr<scalar_t>();
+  auto key_cache_ptr = get_cache_data_ptr<cache_t>(key_cache);
+  auto value_cache_ptr = get_cache_data_ptr<cache_t>(value_cache);
+  auto block_tables_ptr = block_tables.data_ptr<int>();
+  auto context_lens_ptr = context_lens.data_ptr<int>();
+  auto num_seqs = block_tables.size(0);
+  auto num_heads = query.size(1);
+  auto head_size = query.size(2);
+  auto num_kv_heads = key_cache.size(1);
+  auto kv_head_group_size = num_heads / num_kv_heads;
+  auto max_num_blocks_per_seq = block_tables.size(1);
+  // rows of the logits of one task: [num_queries, kv_head_group_size]
+  auto num_rows = num_queries * kv_head_group_size;
+
+  auto kv_block_strideN = key_cache.stride(0);
+  auto kv_block_strideP = key_cache.stride(2);
+  auto kv_block_strideH = key_cache.stride(1);
+  auto q_strideN = query.stride(0);
+  auto q_strideH = query.stride(1);
+
+  for (int64_t i = 0; i < num_seqs; i++) {
+    TORCH_CHECK(
+        context_lens_ptr[i] >= num_queries,
+        "context_lens should include the query tokens");
+  }
+  std::vector<uint8_t> attend(num_queries * num_queries);
+  if (query_mask.has_value()) {
+    auto mask = query_mask.value().to(at::kBool).contiguous();
+    TORCH_CHECK(
+        mask.dim() == 2 && mask.size(0) == num_queries &&
+            mask.size(1) == num_queries,
+        "query_mask should be [num_queries, num_queries]");
+    auto mask_ptr = mask.data_ptr<bool>();
+    for (int64_t i = 0; i < num_queries * num_queries; i++) {
+      attend[i] = mask_ptr[i];
+    }
+  } else {
+    for (int64_t i = 0; i < num_queries; i++) {
+      for (int64_t j = 0; j < num_queries; j++) {
+        attend[i * num_queries + j] = j <= i;
       }
-      // update the partition 0 result with the global max
-      auto partition0_out_start =
-          tmp_out_ptr + seq_id * tmp_out_strideN + head_id * tmp_out_strideH;
-      auto max_logit0 = max_logits_ptr
-          [seq_id * max_logits_strideN + head_id * max_logits_strideH];
-      float exp_val = expf(max_logit0 - global_max);
-      global_exp_sum +=
-          exp_sum_ptr[seq_id * exp_sum_strideN + head_id * exp_sum_strideH] *
-          exp_val;
-      at::vec::Vectorized<float> exp_val_vec0(exp_val);
-      at::vec::map<float>(
-          [&](auto a) { return a * exp_val_vec0; },
-          partition0_out_start,
-          partition0_out_start,
-          head_size);
+    }
+  }
 
-      // accumulate the partition 1 to partition n result into partition 0
-      if (partition_num > 1) {
-        for (auto partition_id = 1; partition_id < partition_num;
-             partition_id++) {
-          if (partition_id * PARTITION_SIZE >= context_len)
-            break;
-          auto tmp_out_start = tmp_out_ptr + seq_id * tmp_out_strideN +
-              head_id * tmp_out_strideH + partition_id * tmp_out_strideS;
-          auto max_logit = max_logits_ptr
-              [seq_id * max_logits_strideN + head_id * max_logits_strideH +
-               partition_id];
-          auto exp_sum = exp_sum_ptr
-              [seq_id * exp_sum_strideN + head_id * exp_sum_strideH +
-               partition_id];
-          exp_val = expf(max_logit - global_max);
-          global_exp_sum += exp_sum * exp_val;
-          at::vec::Vectorized<float> exp_val_vec(exp_val);
-          at::vec::map2<float>(
-              [&](auto a, auto b) { return a + exp_val_vec * b; },
-              partition0_out_start,
-              partition0_out_start,
-              tmp_out_start,
+  auto max_num_partitions =
+      (max_context_len + PARTITION_SIZE - 1) / PARTITION_SIZE;
+  auto max_logits = at::empty(
+      {num_seqs * num_queries, num_heads, max_num_partitions},
+      query.options().dtype(at::ScalarType::Float));
+  auto exp_sum = at::empty(
+      {num_seqs * num_queries, num_heads, max_num_partitions},
+      query.options().dtype(at::ScalarType::Float));
+  auto tmp_out = at::empty(
+      {num_seqs * num_queries, num_heads, max_num_partitions, head_size},
+      query.options().dtype(at::ScalarType::Float));
+  auto tmp_out_ptr = tmp_out.data_ptr<float>();
+  auto max_logits_ptr = max_logits.data_ptr<float>();
+  auto exp_sum_ptr = exp_sum.data_ptr<float>();
+  auto max_logits_strideN = max_logits.stride(0);
+  auto max_logits_strideH = max_logits.stride(1);
+  auto exp_sum_strideN = exp_sum.stride(0);
+  auto exp_sum_strideH = exp_sum.stride(1);
+  auto tmp_out_strideN = tmp_out.stride(0);
+  auto tmp_out_strideH = tmp_out.stride(1);
+  auto tmp_out_strideS = tmp_out.stride(2);
+
+  auto thread_numbers = omp_get_max_threads();
+  auto tmp_logits = at::empty(
+      {thread_numbers, num_rows, PARTITION_SIZE},
+      query.options().dtype(at::ScalarType::Float));
+  auto logits_ptrs = tmp_logits.data_ptr<float>();
+  constexpr bool is_quantized_cache = kv_quant::is_quantized_v<cache_t>;
+  auto kv_page_bufs = at::empty(
+      {thread_numbers, is_quantized_cache ? block_size * head_size : 0},
+      query.options());
+  auto kv_page_buf_ptrs = kv_page_bufs.data_ptr<scalar_t>();
+  auto kv_token_stride = is_quantized_cache ? head_size : kv_block_strideP;
+
+#pragma omp parallel for collapse(3) schedule(static, 1)
+  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
+    for (auto partition_id = 0; partition_id < max_num_partitions;
+         partition_id++) {
+      for (auto head_group_start = 0; head_group_start < num_heads;
+           head_group_start += kv_head_group_size) {
+        auto omp_thread_id = omp_get_thread_num();
+        auto context_len = context_lens_ptr[seq_id];
+        auto partition_start = partition_id * PARTITION_SIZE;
+        if (partition_start >= context_len)
+          continue;
+        auto partition_end =
+            std::min(partition_start + PARTITION_SIZE, context_len);
+        // position of the first query token
+        auto query_start = context_len - num_queries;
+        auto token_num = partition_end - partition_start;
+        auto block_num = (token_num + block_size - 1) / block_size;
+        auto logical_block_start = partition_start / block_size;
+        auto logical_block_end = logical_block_start + block_num;
+        auto kv_head_id = head_group_start / kv_head_group_size;
+        auto seq_query_ptr = query_ptr + seq_id * num_queries * q_strideN +
+            head_group_start * q_strideH;
+        float* logits = logits_ptrs + omp_thread_id * num_rows * PARTITION_SIZE;
+        scalar_t* kv_page_buf =
+            kv_page_buf_ptrs + omp_thread_id * kv_page_bufs.size(1);
+        auto logits_position = 0;
+        // 1) calculate the matmul(query, key) for this partition
+        for (auto logical_block_id = logical_block_start;
+             logical_block_id < logical_block_end;
+             logical_block_id++) {
+          auto physical_block_id = block_tables_ptr
+              [seq_id * max_num_blocks_per_seq + logical_block_id];
+          auto tokens_in_block =
+              std::min(block_size, context_len - logical_block_id * block_size);
+          auto token_start = logical_block_id * block_size;
+          auto token_end = token_start + tokens_in_block;
+          auto k_page = get_kv_page<scalar_t, cache_t>(
+              key_cache_ptr + physical_block_id * kv_block_strideN +
+                  kv_head_id * kv_block_strideH,
+              kv_page_buf,
+              tokens_in_block,
+              head_size);
+          for (auto token_id = token_start; token_id < token_end; token_id++) {
+            auto k_cache_start =
+                k_page + (token_id - token_start) * kv_token_stride;
+            for (auto qi = 0; qi < num_queries; qi++) {
+              reduce_head(
+                  seq_query_ptr + qi * q_strideN,
+                  kv_head_group_size,
+                  k_cache_start,
+                  &(logits[qi * kv_head_group_size * PARTITION_SIZE +
+                           logits_position]),
+                  PARTITION_SIZE,
+                  head_size);
+            }
+            logits_position++;
+          }
+        }
+        // 2) mask the query tokens, calculate the max and exp_sum for this
+        // partition
+        for (int row = 0; row < num_rows; row++) {
+          auto qi = row / kv_head_group_size;
+          auto hi = row % kv_head_group_size;
+          auto row_logits = logits + row * PARTITION_SIZE;
+          if (use_softcap) {
+            softcap_kernel(row_logits, row_logits, token_num, softcap, scale);
+          }
+          auto masked_start = std::max<int64_t>(partition_start, query_start);
+          for (auto token_id = masked_start; token_id < partition_end;
+               token_id++) {
+            if (!attend[qi * num_queries + token_id - query_start]) {
+              row_logits[token_id - partition_start] =
+                  -std::numeric_limits<float>::infinity();
+            }
+          }
+          auto partition_max = -std::numeric_limits<float>::infinity();
+          _mul_reduce_max_fusion_kernel<float>(
+              row_logits, scale_, token_num, row_logits, partition_max);
+          auto seq_query_id = seq_id * num_queries + qi;
+          max_logits_ptr
+              [seq_query_id * max_logits_strideN +
+               (head_group_start + hi) * max_logits_strideH + partition_id] =
+                  partition_max;
+          if (partition_max == -std::numeric_limits<float>::infinity()) {
+            partition_max = 0;
+          }
+          _exp_reduce_sum_fusion_kernel<float, float>(
+              row_logits, token_num, row_logits, partition_max);
+          exp_sum_ptr
+              [seq_query_id * exp_sum_strideN +
+               (head_group_start + hi) * exp_sum_strideH + partition_id] =
+                  partition_max;
+        }
+        // 3) calculate the matmul(exp(logits-partition_max), value) for this
+        // partition
+        logits_position = 0;
+        for (auto logical_block_id = logical_block_start;
+             logical_block_id < logical_block_end;
+             logical_block_id++) {
+          auto physical_block_id = block_tables_ptr
+              [seq_id * max_num_blocks_per_seq + logical_block_id];
+          auto tokens_in_block =
+              std::min(block_size, context_len - logical_block_id * block_size);
+          auto token_start = logical_block_id * block_size;
+          auto token_end = token_start + tokens_in_block;
+          auto v_page = get_kv_page<scalar_t, cache_t>(
+              value_cache_ptr + physical_block_id * kv_block_strideN +
+                  kv_head_id * kv_block_strideH,
+              kv_page_buf,
+              tokens_in_block,
               head_size);
+          for (auto token_id = token_start; token_id < token_end; token_id++) {
+            auto v_cache_start =
+                v_page + (token_id - token_start) * kv_token_stride;
+            auto accumulated = logits_position > 0;
+            for (auto qi = 0; qi < num_queries; qi++) {
+              auto tmp_out_start = tmp_out_ptr +
+                  (seq_id * num_queries + qi) * tmp_out_strideN +
+                  head_group_start * tmp_out_strideH +
+                  partition_id * tmp_out_strideS;
+              mul_attenion_weights_and_value_of_head(
+                  &(logits[qi * kv_head_group_size * PARTITION_SIZE +
+                           logits_position]),
+                  PARTITION_SIZE,
+                  v_cache_start,
+                  tmp_out_start,
+                  tmp_out_strideH,
+                  kv_head_group_size,
+                  head_size,
+                  accumulated);
+            }
+            logits_position++;
+          }
         }
       }
-
-      // copy the partition 0 result into attn_outs
-      auto attn_out_start =
-          out_ptr + seq_id * out_strideN + head_id * out_strideH;
-      float inverse_global_sum = 1.0 / (global_exp_sum + 1e-8);
-      at::vec::Vectorized<float> inverse_global_sum_vec(inverse_global_sum);
-      // rescale the partition 0 result with global exp_sum
-      at::vec::map<float>(
-          [&](auto a) { return a * inverse_global_sum_vec; },
-          partition0_out_start,
-          partition0_out_start,
-          head_size);
-      // copy the partition 0 result into attn_outs
-      at::vec::map<scalar_t>(
-          [&](auto a) { return a; },
-          attn_out_start,
-          partition0_out_start,
-          head_size);
     }
   }
-} // single_query_cached_kv_attention_fd_kernel
+
+  // calculate the final output
+  reduce_partitions<scalar_t>(
+      out,
+      tmp_out,
+      max_logits,
+      exp_sum,
+      context_lens_ptr,
+      num_queries,
+      PARTITION_SIZE);
+} // multi_query_cached_kv_attention_kernel
 
 /**
  * Reshapes and caches the key and value tensors based on the provided slot
@@ -1522,6 +2474,125 @@ void reshape_and_cache_kernel(
   }
 }
 
+/**
+ * Writes the key and value into the VNNI packed KV cache of kv_vnni.
+ */
+template <typename scalar_t>
+void reshape_and_cache_vnni_kernel(
+    at::Tensor& key,
+    at::Tensor& value,
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& slot_mapping) {
+  auto num_tokens = key.size(0);
+  auto head_num = key.size(1);
+  auto head_size = key.size(2);
+  auto block_size = kv_vnni::get_block_size(key_cache);
+  auto key_cache_ptr = key_cache.data_ptr<scalar_t>();
+  auto value_cache_ptr = value_cache.data_ptr<scalar_t>();
+  auto key_ptr = key.data_ptr<scalar_t>();
+  auto value_ptr = value.data_ptr<scalar_t>();
+  auto slot_mapping_ptr = slot_mapping.data_ptr<int>();
+  auto cache_strideN = key_cache.stride(0);
+  auto cache_strideH = key_cache.stride(1);
+#pragma omp parallel for collapse(2)
+  for (auto ti = 0; ti < num_tokens; ti++) {
+    for (auto hi = 0; hi < head_num; hi++) {
+      auto physical_block_id = slot_mapping_ptr[ti] / block_size;
+      auto block_offset = slot_mapping_ptr[ti] % block_size;
+      auto page_offset =
+          physical_block_id * cache_strideN + hi * cache_strideH;
+      kv_vnni::store_token(
+          key_cache_ptr + page_offset,
+          value_cache_ptr + page_offset,
+          key_ptr + ti * key.stride(0) + hi * key.stride(1),
+          value_ptr + ti * value.stride(0) + hi * value.stride(1),
+          block_offset,
+          block_size,
+          head_size);
+    }
+  }
+}
+
+/**
+ * Quantizes the key and value into the INT8/INT4 KV cache. The params of a
+ * (block, head) page are shared by its tokens, so the tokens are grouped by
+ * the physical blocks of slot_mapping and each page is quantized by one
+ * thread.
+ *
+ * @tparam SRC_T The data type of the input tensors.
+ * @tparam QT The quantized type of the cache, kv_quant::Int8 or Int4.
+ */
+template <typename SRC_T, typename QT>
+void reshape_and_cache_quantized_kernel(
+    at::Tensor& key,
+    at::Tensor& value,
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& slot_mapping) {
+  auto num_tokens = key.size(0);
+  auto head_num = key.size(1);
+  auto head_size = key.size(2);
+  auto block_size = key_cache.size(2) - 1;
+  auto key_cache_ptr = key_cache.data_ptr<uint8_t>();
+  auto key_ptr = key.data_ptr<SRC_T>();
+  auto value_cache_ptr = value_cache.data_ptr<uint8_t>();
+  auto value_ptr = value.data_ptr<SRC_T>();
+  auto slot_mapping_ptr = slot_mapping.data_ptr<int>();
+  auto cache_strideN = key_cache.stride(0);
+  auto cache_strideH = key_cache.stride(1);
+  auto key_state_strideN = key.stride(0);
+  auto key_state_strideH = key.stride(1);
+  auto value_state_strideN = value.stride(0);
+  auto value_state_strideH = value.stride(1);
+
+  // Group the tokens by the physical blocks, the padding slots are skipped.
+  std::vector<int64_t> token_ids;
+  for (int64_t ti = 0; ti < num_tokens; ti++) {
+    if (slot_mapping_ptr[ti] >= 0) {
+      token_ids.emplace_back(ti);
+    }
+  }
+  std::stable_sort(
+      token_ids.begin(), token_ids.end(), [&](int64_t a, int64_t b) {
+        return slot_mapping_ptr[a] < slot_mapping_ptr[b];
+      });
+  std::vector<int64_t> group_starts;
+  for (size_t i = 0; i < token_ids.size(); i++) {
+    if (i == 0 ||
+        slot_mapping_ptr[token_ids[i]] / block_size !=
+            slot_mapping_ptr[token_ids[i - 1]] / block_size) {
+      group_starts.emplace_back(i);
+    }
+  }
+  group_starts.emplace_back(token_ids.size());
+  int64_t num_groups = group_starts.size() - 1;
+
+#pragma omp parallel for collapse(2)
+  for (int64_t gi = 0; gi < num_groups; gi++) {
+    for (int64_t hi = 0; hi < head_num; hi++) {
+      std::vector<const SRC_T*> key_srcs, value_srcs;
+      std::vector<int64_t> block_offsets;
+      for (auto i = group_starts[gi]; i < group_starts[gi + 1]; i++) {
+        auto ti = token_ids[i];
+        block_offsets.emplace_back(slot_mapping_ptr[ti] % block_size);
+        key_srcs.emplace_back(
+            key_ptr + ti * key_state_strideN + hi * key_state_strideH);
+        value_srcs.emplace_back(
+            value_ptr + ti * value_state_strideN + hi * value_state_strideH);
+      }
+      auto physical_block_id =
+          slot_mapping_ptr[token_ids[group_starts[gi]]] / block_size;
+      auto cache_offset =
+          physical_block_id * cache_strideN + hi * cache_strideH;
+      kv_quant::quantize_into_page<SRC_T, QT>(
+          key_cache_ptr + cache_offset, key_srcs, block_offsets, head_size);
+      kv_quant::quantize_into_page<SRC_T, QT>(
+          value_cache_ptr + cache_offset, value_srcs, block_offsets, head_size);
+    }
+  }
+}
+
 /**
  * Performs scale-dot-product for the chunked prefill case.
  * In this case, we assume the current key/value already been cached.
@@ -1587,7 +2658,12 @@ void flash_attn_varlen_kernel(
   auto kv_head_group_size = num_heads / num_kv_heads;
   auto max_num_blocks_per_seq = block_table.size(1);
   auto batch_size = cu_seqlens_q.size(0) - 1;
-  auto block_size = key_cache.size(2);
+  // The VNNI packed pages are unpacked for the GEMMs of the rows.
+  bool is_packed = kv_vnni::is_vnni_kv_cache(key_cache);
+  // The first row of a quantized page holds its params.
+  auto block_size = is_packed
+      ? kv_vnni::get_block_size(key_cache)
+      : key_cache.size(2) - (kv_quant::is_quantized_v<cache_t> ? 1 : 0);
 
   auto qSplitSize = q_split_size > max_seqlen_q ? max_seqlen_q : q_split_size;
   auto kvSplitSize = block_size > max_seqlens_k ? max_seqlens_k : block_size;
@@ -1638,8 +2714,8 @@ void flash_attn_varlen_kernel(
 
   auto out_ptr = out.data_ptr<scalar_t>();
   auto query_ptr = query.data_ptr<scalar_t>();
-  auto key_ptr = key_cache.data_ptr<cache_t>();
-  auto value_ptr = value_cache.data_ptr<cache_t>();
+  auto key_ptr = get_cache_data_ptr<cache_t>(key_cache);
+  auto value_ptr = get_cache_data_ptr<cache_t>(value_cache);
   auto cu_seqlens_q_ptr = cu_seqlens_q.data_ptr<int>();
   auto cu_seqlens_k_ptr = cu_seqlens_k.data_ptr<int>();
   auto block_table_ptr = block_table.data_ptr<int>();
@@ -1706,12 +2782,15 @@ void flash_attn_varlen_kernel(
             continue;
           }
 
-          scalar_t* key_start_ptr =
-              flexible_dequantize_cache<scalar_t, cache_t>(
-                  key_page_data,
-                  &k_cache_buf_ptrs[ompIdx * head_size * kvSplitSize],
-                  head_size * kvBlockSize,
-                  k_scale);
+          scalar_t* key_start_ptr = get_kv_page_rows<scalar_t, cache_t>(
+              key_page_data,
+              &k_cache_buf_ptrs[ompIdx * head_size * kvSplitSize],
+              kvBlockSize,
+              block_size,
+              head_size,
+              k_scale,
+              is_packed,
+              /*is_key*/ true);
           // Calculate the scale * query * key
           // query block[qBlockSize, head_size], key block: [kvBlockSize,
           // head_size]
@@ -1802,11 +2881,15 @@ void flash_attn_varlen_kernel(
             }
           }
 
-          scalar_t* v_start_ptr = flexible_dequantize_cache<scalar_t, cache_t>(
+          scalar_t* v_start_ptr = get_kv_page_rows<scalar_t, cache_t>(
               value_page_data,
               &v_cache_buf_ptrs[ompIdx * head_size * kvSplitSize],
-              head_size * kvBlockSize,
-              v_scale);
+              kvBlockSize,
+              block_size,
+              head_size,
+              v_scale,
+              is_packed,
+              /*is_key*/ false);
 
           // Calculate the sum of attn_weight * value
 
@@ -1843,6 +2926,195 @@ void flash_attn_varlen_kernel(
   }
 }
 
+namespace single_query_autotune {
+
+struct KernelConfig {
+  int32_t kernel;
+  int partition_size;
+};
+
+// The partition sizes of flash decoding to try, they should be multiples of
+// the block size.
+constexpr int FD_PARTITION_SIZES[] = {64, 128, 256};
+constexpr int WARMUP_RUNS = 1;
+constexpr int TIMED_RUNS = 3;
+
+inline int64_t next_power_of_2(int64_t value) {
+  int64_t power = 1;
+  while (power < value) {
+    power <<= 1;
+  }
+  return power;
+}
+
+std::string get_cpu_model() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.rfind("model name", 0) != 0) {
+      continue;
+    }
+    auto colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    auto model = line.substr(colon + 1);
+    model.erase(0, model.find_first_not_of(" \t"));
+    // The tab is the field separator of the cache file.
+    std::replace(model.begin(), model.end(), '\t', ' ');
+    return model;
+  }
+  return "unknown";
+}
+
+/*
+ * TuningCache keeps the kernel decisions of the shape buckets. It is loaded
+ * from the file of PAGED_ATTENTION_AUTOTUNE_CACHE (default
+ * $HOME/.cache/ipex_paged_attention_autotune.txt) on first use, and every new
+ * decision is appended to the file as a line of
+ * "cpu_model\tbucket\tkernel\tpartition_size". Only the lines of the current
+ * CPU model are used. The decisions are kept in memory only if the file is
+ * not writable.
+ */
+class TuningCache {
+ public:
+  static TuningCache& get_instance() {
+    static TuningCache cache;
+    return cache;
+  }
+
+  bool lookup(const std::string& bucket, KernelConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = configs_.find(bucket);
+    if (it == configs_.end()) {
+      return false;
+    }
+    config = it->second;
+    return true;
+  }
+
+  void insert(const std::string& bucket, const KernelConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!configs_.emplace(bucket, config).second || path_.empty()) {
+      return;
+    }
+    std::ofstream file(path_, std::ios::app);
+    if (file) {
+      file << cpu_model_ << '\t' << bucket << '\t' << config.kernel << '\t'
+           << config.partition_size << '\n';
+    }
+  }
+
+ private:
+  TuningCache() : cpu_model_(get_cpu_model()) {
+    const char* path = std::getenv("PAGED_ATTENTION_AUTOTUNE_CACHE");
+    const char* home = std::getenv("HOME");
+    if (path != nullptr && path[0] != '\0') {
+      path_ = path;
+    } else if (home != nullptr) {
+      path_ = std::string(home) + "/.cache/ipex_paged_attention_autotune.txt";
+    }
+    std::ifstream file(path_);
+    std::string line;
+    while (std::getline(file, line)) {
+      std::vector<std::string> fields;
+      std::stringstream ss(line);
+      std::string field;
+      while (std::getline(ss, field, '\t')) {
+        fields.emplace_back(field);
+      }
+      if (fields.size() != 4 || fields[0] != cpu_model_) {
+        continue;
+      }
+      KernelConfig config{std::atoi(fields[2].c_str()),
+                          std::atoi(fields[3].c_str())};
+      if ((config.kernel == FLASH_DECODING || config.kernel == VNNI) &&
+          config.partition_size > 0) {
+        configs_[fields[1]] = config;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::string cpu_model_;
+  std::string path_;
+  std::unordered_map<std::string, KernelConfig> configs_;
+};
+
+// The shape bucket of a call, the batch and the context length are rounded up
+// to powers of 2 so that the decoding steps of a request share the decision.
+std::string get_bucket(
+    const at::Tensor& query,
+    const at::Tensor& key_cache,
+    int64_t beam_size,
+    int64_t block_size,
+    int64_t max_context_len,
+    bool use_alibi,
+    int64_t window_size,
+    bool use_softcap) {
+  std::stringstream ss;
+  ss << query.scalar_type() << "/" << key_cache.scalar_type()
+     << " seqs=" << next_power_of_2(query.size(0)) << " beam=" << beam_size
+     << " heads=" << query.size(1) << "/" << key_cache.size(1)
+     << " head_size=" << query.size(2) << " block_size=" << block_size
+     << " context=" << next_power_of_2(max_context_len)
+     << " alibi=" << use_alibi << " window=" << (window_size > 0)
+     << " softcap=" << use_softcap << " threads=" << omp_get_max_threads();
+  return ss.str();
+}
+
+std::vector<KernelConfig> get_candidates(int64_t block_size, bool allow_vnni) {
+  std::vector<KernelConfig> candidates;
+  for (auto partition_size : FD_PARTITION_SIZES) {
+    if (partition_size % block_size == 0) {
+      candidates.push_back({FLASH_DECODING, partition_size});
+    }
+  }
+  if (candidates.empty()) {
+    candidates.push_back({FLASH_DECODING, PARTITION_SIZE});
+  }
+  if (allow_vnni) {
+    candidates.push_back({VNNI, PARTITION_SIZE});
+  }
+  return candidates;
+}
+
+// Returns the cached decision of the bucket, or times the candidates with
+// run_kernel on the current inputs and caches the fastest one.
+template <typename F>
+KernelConfig select_kernel(
+    const std::string& bucket,
+    const std::vector<KernelConfig>& candidates,
+    const F& run_kernel) {
+  auto& cache = TuningCache::get_instance();
+  KernelConfig best = candidates[0];
+  if (cache.lookup(bucket, best)) {
+    return best;
+  }
+  auto best_time = std::numeric_limits<double>::infinity();
+  for (auto& candidate : candidates) {
+    for (auto i = 0; i < WARMUP_RUNS; i++) {
+      run_kernel(candidate);
+    }
+    auto min_time = std::numeric_limits<double>::infinity();
+    for (auto i = 0; i < TIMED_RUNS; i++) {
+      auto start = std::chrono::steady_clock::now();
+      run_kernel(candidate);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      min_time = std::min(min_time, elapsed.count());
+    }
+    if (min_time < best_time) {
+      best_time = min_time;
+      best = candidate;
+    }
+  }
+  cache.insert(bucket, best);
+  return best;
+}
+
+} // namespace single_query_autotune
+
 void single_query_cached_kv_attention_kernel_impl(
     at::Tensor& out, // [num_seqs, num_heads, head_size]
     at::Tensor& query, // [num_seqs, num_heads, head_size]
@@ -1858,161 +3130,386 @@ void single_query_cached_kv_attention_kernel_impl(
     int64_t window_size,
     const double k_scale,
     const double v_scale,
-    const double softcap) {
+    const double softcap,
+    const c10::optional<at::Tensor>& evicted_lens, // [num_seqs]
+    int64_t num_sink_tokens) {
   RECORD_FUNCTION(
       "ipex::single_query_cached_kv_attention_kernel_impl",
       c10::ArrayRef<c10::IValue>({}));
+  if (evicted_lens.has_value()) {
+    TORCH_CHECK(
+        evicted_lens.value().scalar_type() == at::ScalarType::Int &&
+            evicted_lens.value().numel() == query.size(0),
+        "evicted_lens should be an int tensor of [num_seqs]");
+  }
+
+  if (kv_vnni::is_vnni_kv_cache(key_cache)) {
+    kv_vnni::check_kv_cache(key_cache, value_cache, query.size(2));
+    TORCH_CHECK(
+        kv_vnni::get_block_size(key_cache) == block_size,
+        "The block size of the VNNI packed KV cache does not match block_size");
+    TORCH_CHECK(
+        out.scalar_type() == at::ScalarType::BFloat16,
+        "The VNNI packed KV cache only supports BFloat16 query");
+    TORCH_CHECK(
+        !evicted_lens.has_value() && num_sink_tokens == 0,
+        "The VNNI packed KV cache does not support the KV block eviction");
+    // The packed pages are only read by the VNNI kernel.
+    single_query_cached_kv_attention_vnni_kernel<at::BFloat16, at::BFloat16>(
+        out,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        alibi_slopes,
+        window_size,
+        k_scale,
+        v_scale,
+        softcap);
+    return;
+  }
+
+  auto quant_bits = get_kv_cache_quant_bits(key_cache, query.size(2));
+  if (quant_bits > 0) {
+    TORCH_CHECK(
+        key_cache.size(2) == block_size + 1,
+        "The INT8/INT4 KV cache should have block_size + 1 rows per page");
+    // The quantized pages are dequantized block by block in flash decoding.
+    dispatch_quantized_kv_cache(
+        out.scalar_type(), quant_bits, [&](auto scalar, auto quant) {
+          single_query_cached_kv_attention_fd_kernel<
+              decltype(scalar),
+              decltype(quant)>(
+              out,
+              query,
+              key_cache,
+              value_cache,
+              scale,
+              block_tables,
+              context_lens,
+              block_size,
+              max_context_len,
+              alibi_slopes,
+              window_size,
+              k_scale,
+              v_scale,
+              softcap,
+              evicted_lens,
+              num_sink_tokens);
+        });
+    return;
+  }
+
+  // dispatch kernel
+  auto run_kernel = [&](const single_query_autotune::KernelConfig& config) {
+    if (config.kernel == VNNI) {
+      if (key_cache.scalar_type() == at::ScalarType::BFloat16 &&
+          out.scalar_type() == at::ScalarType::BFloat16) {
+        single_query_cached_kv_attention_vnni_kernel<
+            at::BFloat16,
+            at::BFloat16>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap);
+      } else if (out.scalar_type() == at::ScalarType::Float) {
+        single_query_cached_kv_attention_vnni_kernel<float, float>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap);
+      } else if (out.scalar_type() == at::ScalarType::Half) {
+        single_query_cached_kv_attention_vnni_kernel<at::Half, at::Half>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap);
+      } else {
+        TORCH_CHECK(
+            false,
+            "Unsupported data type for single_query_cached_kv_attention_vnni_kernel");
+      }
+    } else {
+      if (key_cache.scalar_type() == at::ScalarType::Float8_e5m2 &&
+          out.scalar_type() == at::ScalarType::BFloat16) {
+        single_query_cached_kv_attention_fd_kernel<
+            at::BFloat16,
+            at::Float8_e5m2>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap,
+            evicted_lens,
+            num_sink_tokens,
+            config.partition_size);
+      } else if (out.scalar_type() == at::ScalarType::Float) {
+        single_query_cached_kv_attention_fd_kernel<float, float>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap,
+            evicted_lens,
+            num_sink_tokens,
+            config.partition_size);
+      } else if (out.scalar_type() == at::ScalarType::BFloat16) {
+        single_query_cached_kv_attention_fd_kernel<at::BFloat16, at::BFloat16>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap,
+            evicted_lens,
+            num_sink_tokens,
+            config.partition_size);
+      } else if (out.scalar_type() == at::ScalarType::Half) {
+        single_query_cached_kv_attention_fd_kernel<at::Half, at::Half>(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            k_scale,
+            v_scale,
+            softcap,
+            evicted_lens,
+            num_sink_tokens,
+            config.partition_size);
+      } else {
+        TORCH_CHECK(
+            false,
+            "Unsupported data type for single_query_cached_kv_attention_fd_kernel");
+      }
+    }
+  };
 
-  // heuristic to choose kernel
-  int32_t single_query_kernel_name = FLASH_DECODING;
+  single_query_autotune::KernelConfig config{FLASH_DECODING, PARTITION_SIZE};
   const int32_t forced_single_query_kernel =
       torch_ipex::tpp::env2int("PAGED_ATTENTION_SINGLE_QUERY_KERNEL", -1);
-  if (forced_single_query_kernel != -1) {
-    single_query_kernel_name = forced_single_query_kernel;
+  if (evicted_lens.has_value() || num_sink_tokens > 0) {
+    // The remapped positions and the sink tokens are only handled by flash
+    // decoding.
+    config.kernel = FLASH_DECODING;
+  } else if (forced_single_query_kernel != -1) {
+    config.kernel = forced_single_query_kernel;
   } else {
     auto num_seqs = query.size(0);
     auto num_heads = query.size(1);
     auto head_size = query.size(2);
-    auto num_kv_heads = key_cache.size(1);
-    auto kv_head_group_size = num_heads / num_kv_heads;
     int beam_size = deduce_beam_size(block_tables);
     int batch_size = num_seqs / beam_size;
     auto thread_numbers = omp_get_max_threads();
-    // heuristic to use vnni layout or not
-    bool disable_flash_decoding = num_heads * batch_size > thread_numbers * 2;
-    bool use_vnni = disable_flash_decoding && beam_size >= 4 &&
-        head_size % 2 == 0 && block_size % 2 == 0 && window_size <= 0 &&
-        key_cache.scalar_type() != at::ScalarType::Float8_e5m2;
-    single_query_kernel_name = use_vnni ? VNNI : single_query_kernel_name;
-  }
-
-  // dispatch kernel
-  if (single_query_kernel_name == VNNI) {
-    if (key_cache.scalar_type() == at::ScalarType::BFloat16 &&
-        out.scalar_type() == at::ScalarType::BFloat16) {
-      single_query_cached_kv_attention_vnni_kernel<at::BFloat16, at::BFloat16>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else if (out.scalar_type() == at::ScalarType::Float) {
-      single_query_cached_kv_attention_vnni_kernel<float, float>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else if (out.scalar_type() == at::ScalarType::Half) {
-      single_query_cached_kv_attention_vnni_kernel<at::Half, at::Half>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
+    bool allow_vnni = head_size % 2 == 0 && block_size % 2 == 0 &&
+        window_size <= 0 &&
+        key_cache.scalar_type() == out.scalar_type() &&
+        (out.scalar_type() == at::ScalarType::BFloat16 ||
+         out.scalar_type() == at::ScalarType::Float ||
+         out.scalar_type() == at::ScalarType::Half);
+    if (torch_ipex::tpp::env2int("PAGED_ATTENTION_AUTOTUNE", 0) != 0) {
+      // time the kernels and partition sizes on first use of the bucket
+      config = single_query_autotune::select_kernel(
+          single_query_autotune::get_bucket(
+              query,
+              key_cache,
+              beam_size,
+              block_size,
+              max_context_len,
+              alibi_slopes.has_value(),
+              window_size,
+              softcap != -1),
+          single_query_autotune::get_candidates(block_size, allow_vnni),
+          run_kernel);
     } else {
-      TORCH_CHECK(
-          false,
-          "Unsupported data type for single_query_cached_kv_attention_vnni_kernel");
+      // heuristic to use vnni layout or not
+      bool disable_flash_decoding =
+          num_heads * batch_size > thread_numbers * 2;
+      bool use_vnni = disable_flash_decoding && beam_size >= 4 && allow_vnni;
+      config.kernel = use_vnni ? VNNI : FLASH_DECODING;
     }
+  }
+  run_kernel(config);
+}
+
+void multi_query_cached_kv_attention_kernel_impl(
+    at::Tensor& out, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& query, // [num_seqs * num_queries, num_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    int64_t num_queries,
+    const c10::optional<at::Tensor>& query_mask, // [num_queries, num_queries]
+    const double k_scale,
+    const double v_scale,
+    const double softcap) {
+  TORCH_CHECK(
+      query.size(0) == block_tables.size(0) * num_queries,
+      "query should have num_queries tokens for each sequence");
+  TORCH_CHECK(
+      query.scalar_type() == out.scalar_type(),
+      "query and out should have the same data type");
+  TORCH_CHECK(
+      !kv_vnni::is_vnni_kv_cache(key_cache),
+      "multi_query_cached_kv_attention does not support the VNNI packed KV cache");
+  RECORD_FUNCTION(
+      "ipex::multi_query_cached_kv_attention_kernel_impl",
+      c10::ArrayRef<c10::IValue>({}));
+  auto quant_bits = get_kv_cache_quant_bits(key_cache, query.size(2));
+  if (quant_bits > 0) {
+    TORCH_CHECK(
+        key_cache.size(2) == block_size + 1,
+        "The INT8/INT4 KV cache should have block_size + 1 rows per page");
+    dispatch_quantized_kv_cache(
+        out.scalar_type(), quant_bits, [&](auto scalar, auto quant) {
+          multi_query_cached_kv_attention_kernel<
+              decltype(scalar),
+              decltype(quant)>(
+              out,
+              query,
+              key_cache,
+              value_cache,
+              scale,
+              block_tables,
+              context_lens,
+              block_size,
+              max_context_len,
+              num_queries,
+              query_mask,
+              softcap);
+        });
+  } else if (
+      key_cache.scalar_type() == at::ScalarType::Float8_e5m2 &&
+      out.scalar_type() == at::ScalarType::BFloat16) {
+    multi_query_cached_kv_attention_kernel<at::BFloat16, at::Float8_e5m2>(
+        out,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        num_queries,
+        query_mask,
+        softcap);
+  } else if (out.scalar_type() == at::ScalarType::Float) {
+    multi_query_cached_kv_attention_kernel<float, float>(
+        out,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        num_queries,
+        query_mask,
+        softcap);
+  } else if (out.scalar_type() == at::ScalarType::BFloat16) {
+    multi_query_cached_kv_attention_kernel<at::BFloat16, at::BFloat16>(
+        out,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        num_queries,
+        query_mask,
+        softcap);
+  } else if (out.scalar_type() == at::ScalarType::Half) {
+    multi_query_cached_kv_attention_kernel<at::Half, at::Half>(
+        out,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        num_queries,
+        query_mask,
+        softcap);
   } else {
-    if (key_cache.scalar_type() == at::ScalarType::Float8_e5m2 &&
-        out.scalar_type() == at::ScalarType::BFloat16) {
-      single_query_cached_kv_attention_fd_kernel<at::BFloat16, at::Float8_e5m2>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else if (out.scalar_type() == at::ScalarType::Float) {
-      single_query_cached_kv_attention_fd_kernel<float, float>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else if (out.scalar_type() == at::ScalarType::BFloat16) {
-      single_query_cached_kv_attention_fd_kernel<at::BFloat16, at::BFloat16>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else if (out.scalar_type() == at::ScalarType::Half) {
-      single_query_cached_kv_attention_fd_kernel<at::Half, at::Half>(
-          out,
-          query,
-          key_cache,
-          value_cache,
-          scale,
-          block_tables,
-          context_lens,
-          block_size,
-          max_context_len,
-          alibi_slopes,
-          window_size,
-          k_scale,
-          v_scale,
-          softcap);
-    } else {
-      TORCH_CHECK(
-          false,
-          "Unsupported data type for single_query_cached_kv_attention_fd_kernel");
-    }
+    TORCH_CHECK(
+        false,
+        "Unsupported data type for ipex::multi_query_cached_kv_attention");
   }
 }
 
@@ -2036,11 +3533,41 @@ void reshape_and_cache_cpu_kernel_impl(
       slot_mapping.is_contiguous(), "slot_mapping should be contiguous");
   TORCH_CHECK(
       kv_cache_dtype == "fp8" || kv_cache_dtype == "fp8_e5m2" ||
-          kv_cache_dtype == "auto",
+          kv_cache_dtype == "int8" || kv_cache_dtype == "int4" ||
+          kv_cache_dtype == "vnni" || kv_cache_dtype == "auto",
       "not supported kv_cahce_dtype");
+  TORCH_CHECK(
+      (kv_cache_dtype == "vnni") == kv_vnni::is_vnni_kv_cache(key_cache),
+      "The VNNI packed KV cache should be written with kv_cache_dtype vnni");
   RECORD_FUNCTION(
       "ipex::reshape_and_cache_cpu_kernel_impl",
       c10::ArrayRef<c10::IValue>({}));
+  if (kv_cache_dtype == "vnni") {
+    kv_vnni::check_kv_cache(key_cache, value_cache, key.size(2));
+    TORCH_CHECK(
+        key.scalar_type() == at::ScalarType::BFloat16,
+        "The VNNI packed KV cache only supports BFloat16 key and value");
+    reshape_and_cache_vnni_kernel<at::BFloat16>(
+        key, value, key_cache, value_cache, slot_mapping);
+    return;
+  }
+  if (kv_cache_dtype == "int8" || kv_cache_dtype == "int4") {
+    int64_t quant_bits = kv_cache_dtype == "int8" ? 8 : 4;
+    TORCH_CHECK(
+        key_cache.scalar_type() == at::ScalarType::Byte,
+        "The INT8/INT4 KV cache should be uint8");
+    TORCH_CHECK(
+        get_kv_cache_quant_bits(key_cache, key.size(2)) == quant_bits,
+        "The last dim of the KV cache does not match kv_cache_dtype");
+    dispatch_quantized_kv_cache(
+        key.scalar_type(), quant_bits, [&](auto scalar, auto quant) {
+          reshape_and_cache_quantized_kernel<
+              decltype(scalar),
+              decltype(quant)>(
+              key, value, key_cache, value_cache, slot_mapping);
+        });
+    return;
+  }
   if (key_cache.scalar_type() == at::ScalarType::Float8_e5m2 &&
       key.scalar_type() == at::ScalarType::Float) {
     reshape_and_cache_kernel<at::Float8_e5m2, float>(
@@ -2064,6 +3591,517 @@ void reshape_and_cache_cpu_kernel_impl(
   }
 }
 
+/**
+ * Evicts the KV blocks which are entirely out of the sliding window from the
+ * block tables, except the blocks of the first num_sink_tokens tokens
+ * (attention sinks). The remaining blocks of every sequence are moved forward
+ * in place and the vacated tail of the block table is set to -1. The context
+ * lengths are reduced by the evicted tokens, which are accumulated to
+ * evicted_lens for the attention to recover the positions.
+ *
+ * @param block_tables  Block tables tensor [num_seqs, max_num_blocks_per_seq].
+ * @param context_lens  Context lengths tensor [num_seqs].
+ * @param evicted_lens  The number of evicted tokens of every sequence
+ * [num_seqs].
+ * @param block_size    The block size which means the number of token in every
+ * block.
+ * @param num_sink_tokens The leading tokens which are always kept.
+ * @param window_size   The size of the sliding window.
+ * @return The evicted block ids of all the sequences. A block shared by several
+ * sequences is returned for each of them.
+ */
+at::Tensor evict_kv_blocks_kernel_impl(
+    at::Tensor& block_tables,
+    at::Tensor& context_lens,
+    at::Tensor& evicted_lens,
+    int64_t block_size,
+    int64_t num_sink_tokens,
+    int64_t window_size) {
+  TORCH_CHECK(window_size > 0, "window_size should be positive");
+  TORCH_CHECK(num_sink_tokens >= 0, "num_sink_tokens should not be negative");
+  TORCH_CHECK(
+      block_tables.scalar_type() == at::ScalarType::Int &&
+          context_lens.scalar_type() == at::ScalarType::Int &&
+          evicted_lens.scalar_type() == at::ScalarType::Int,
+      "block_tables, context_lens and evicted_lens should be int tensors");
+  TORCH_CHECK(
+      block_tables.is_contiguous() && context_lens.is_contiguous() &&
+          evicted_lens.is_contiguous(),
+      "block_tables, context_lens and evicted_lens should be contiguous");
+  TORCH_CHECK(
+      context_lens.numel() == block_tables.size(0) &&
+          evicted_lens.numel() == block_tables.size(0),
+      "context_lens and evicted_lens should have num_seqs elements");
+  RECORD_FUNCTION(
+      "ipex::evict_kv_blocks_kernel_impl", c10::ArrayRef<c10::IValue>({}));
+  auto num_seqs = block_tables.size(0);
+  auto max_num_blocks_per_seq = block_tables.size(1);
+  auto block_tables_ptr = block_tables.data_ptr<int>();
+  auto context_lens_ptr = context_lens.data_ptr<int>();
+  auto evicted_lens_ptr = evicted_lens.data_ptr<int>();
+  auto num_sink_blocks = (num_sink_tokens + block_size - 1) / block_size;
+  // offsets of the evicted blocks of every sequence in the result
+  std::vector<int64_t> evicted_offsets(num_seqs + 1, 0);
+  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
+    auto out_of_window_blocks =
+        std::max<int64_t>(context_lens_ptr[seq_id] - window_size, 0) /
+        block_size;
+    evicted_offsets[seq_id + 1] = evicted_offsets[seq_id] +
+        std::max<int64_t>(out_of_window_blocks - num_sink_blocks, 0);
+  }
+  auto evicted_blocks =
+      at::empty({evicted_offsets[num_seqs]}, block_tables.options());
+  auto evicted_blocks_ptr = evicted_blocks.data_ptr<int>();
+#pragma omp parallel for
+  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
+    auto num_evicted_blocks =
+        evicted_offsets[seq_id + 1] - evicted_offsets[seq_id];
+    if (num_evicted_blocks == 0)
+      continue;
+    auto block_table = block_tables_ptr + seq_id * max_num_blocks_per_seq;
+    auto num_blocks = (context_lens_ptr[seq_id] + block_size - 1) / block_size;
+    auto evicted_start = block_table + num_sink_blocks;
+    auto evicted_end = evicted_start + num_evicted_blocks;
+    std::copy(
+        evicted_start, evicted_end, evicted_blocks_ptr + evicted_offsets[seq_id]);
+    std::copy(evicted_end, block_table + num_blocks, evicted_start);
+    std::fill(
+        block_table + num_blocks - num_evicted_blocks,
+        block_table + num_blocks,
+        -1);
+    context_lens_ptr[seq_id] -= num_evicted_blocks * block_size;
+    evicted_lens_ptr[seq_id] += num_evicted_blocks * block_size;
+  }
+  return evicted_blocks;
+}
+
+inline void check_block_mapping(const at::Tensor& block_mapping) {
+  TORCH_CHECK(
+      block_mapping.dim() == 2 && block_mapping.size(1) == 2 &&
+          block_mapping.scalar_type() == at::ScalarType::Long,
+      "block_mapping should be a long tensor of [num_pairs, 2]");
+}
+
+/**
+ * Copies the blocks block_mapping[i][0] of src_caches[c] to the blocks
+ * block_mapping[i][1] of dst_caches[c] for all the caches in parallel. A block
+ * is copied as raw bytes, so it works for every cache dtype and layout,
+ * including the params rows of the INT8/INT4 caches. The pairs are copied in
+ * parallel, so a destination block should not appear in two pairs.
+ */
+void copy_kv_blocks(
+    const std::vector<at::Tensor>& src_caches,
+    const std::vector<at::Tensor>& dst_caches,
+    const at::Tensor& block_mapping) {
+  TORCH_CHECK(
+      src_caches.size() == dst_caches.size(),
+      "The source and destination should have the same number of caches");
+  check_block_mapping(block_mapping);
+  auto num_caches = static_cast<int64_t>(src_caches.size());
+  auto num_pairs = block_mapping.size(0);
+  if (num_caches == 0 || num_pairs == 0) {
+    return;
+  }
+  std::vector<uint8_t*> src_ptrs(num_caches);
+  std::vector<uint8_t*> dst_ptrs(num_caches);
+  std::vector<int64_t> block_bytes(num_caches);
+  // The layers may have different numbers of blocks, the block ids are
+  // checked against the smallest one.
+  auto num_src_blocks = src_caches[0].size(0);
+  auto num_dst_blocks = dst_caches[0].size(0);
+  for (int64_t c = 0; c < num_caches; c++) {
+    auto& src = src_caches[c];
+    auto& dst = dst_caches[c];
+    TORCH_CHECK(
+        src.is_contiguous() && dst.is_contiguous(),
+        "The KV caches should be contiguous");
+    TORCH_CHECK(
+        src.scalar_type() == dst.scalar_type() &&
+            src.sizes().slice(1) == dst.sizes().slice(1),
+        "The source and destination caches should have the same dtype and block shape");
+    src_ptrs[c] = static_cast<uint8_t*>(src.data_ptr());
+    dst_ptrs[c] = static_cast<uint8_t*>(dst.data_ptr());
+    block_bytes[c] = src.stride(0) * src.element_size();
+    num_src_blocks = std::min(num_src_blocks, src.size(0));
+    num_dst_blocks = std::min(num_dst_blocks, dst.size(0));
+  }
+  auto mapping = block_mapping.contiguous();
+  auto mapping_ptr = mapping.data_ptr<int64_t>();
+  std::unordered_set<int64_t> dst_blocks;
+  for (int64_t i = 0; i < num_pairs; i++) {
+    TORCH_CHECK(
+        mapping_ptr[i * 2] >= 0 && mapping_ptr[i * 2] < num_src_blocks &&
+            mapping_ptr[i * 2 + 1] >= 0 &&
+            mapping_ptr[i * 2 + 1] < num_dst_blocks,
+        "block_mapping is out of the range of the caches");
+    TORCH_CHECK(
+        dst_blocks.insert(mapping_ptr[i * 2 + 1]).second,
+        "A destination block should not appear twice in block_mapping");
+  }
+  // Every thread copies whole blocks of one cache.
+#pragma omp parallel for collapse(2)
+  for (int64_t c = 0; c < num_caches; c++) {
+    for (int64_t i = 0; i < num_pairs; i++) {
+      std::memcpy(
+          dst_ptrs[c] + mapping_ptr[i * 2 + 1] * block_bytes[c],
+          src_ptrs[c] + mapping_ptr[i * 2] * block_bytes[c],
+          block_bytes[c]);
+    }
+  }
+}
+
+/**
+ * Copies the KV blocks in the caches of all the layers, such as the copy on
+ * write of the blocks shared by the forked beams.
+ *
+ * @param key_caches    The key caches of the layers.
+ * @param value_caches  The value caches of the layers.
+ * @param block_mapping The (source, destination) block ids [num_pairs, 2]. A
+ * destination block should be unique and not the source of another pair.
+ */
+void copy_blocks_kernel_impl(
+    const std::vector<at::Tensor>& key_caches,
+    const std::vector<at::Tensor>& value_caches,
+    const at::Tensor& block_mapping) {
+  TORCH_CHECK(
+      key_caches.size() == value_caches.size(),
+      "key_caches and value_caches should have the same number of layers");
+  RECORD_FUNCTION(
+      "ipex::copy_blocks_kernel_impl", c10::ArrayRef<c10::IValue>({}));
+  check_block_mapping(block_mapping);
+  auto mapping = block_mapping.contiguous();
+  auto mapping_ptr = mapping.data_ptr<int64_t>();
+  std::unordered_set<int64_t> dst_blocks;
+  for (int64_t i = 0; i < mapping.size(0); i++) {
+    dst_blocks.insert(mapping_ptr[i * 2 + 1]);
+  }
+  for (int64_t i = 0; i < mapping.size(0); i++) {
+    TORCH_CHECK(
+        dst_blocks.count(mapping_ptr[i * 2]) == 0,
+        "A destination block of block_mapping should not be a source block");
+  }
+  std::vector<at::Tensor> caches(key_caches);
+  caches.insert(caches.end(), value_caches.begin(), value_caches.end());
+  copy_kv_blocks(caches, caches, mapping);
+}
+
+/**
+ * Copies the KV blocks between two sets of caches, such as swapping the blocks
+ * of the preempted sequences out to or in from the caches in another memory
+ * tier.
+ *
+ * @param src_caches    The source caches, e.g. the key and value caches of all
+ * the layers.
+ * @param dst_caches    The destination caches in the same order.
+ * @param block_mapping The (source, destination) block ids [num_pairs, 2]. A
+ * destination block should be unique.
+ */
+void swap_blocks_kernel_impl(
+    const std::vector<at::Tensor>& src_caches,
+    const std::vector<at::Tensor>& dst_caches,
+    const at::Tensor& block_mapping) {
+  RECORD_FUNCTION(
+      "ipex::swap_blocks_kernel_impl", c10::ArrayRef<c10::IValue>({}));
+  copy_kv_blocks(src_caches, dst_caches, block_mapping);
+}
+
+/**
+ * Applies the rotary position embedding to a head like
+ * rotary_position_embedding, the elements after rotary_ndims are copied.
+ *
+ * @param offset 1 for the GPT-J style (rotate every two), or rotary_ndims / 2
+ * for the GPT-NeoX style (rotate half).
+ */
+template <typename scalar_t>
+inline void apply_rope_to_head(
+    scalar_t* in,
+    scalar_t* out,
+    float* sin_start,
+    float* cos_start,
+    int64_t head_size,
+    int64_t rotary_ndims,
+    int64_t offset) {
+  if (offset != 1) {
+    torch_ipex::cpu::kernel::apply_rope_along_head_kernel<scalar_t>(
+        in, out, cos_start, sin_start, rotary_ndims, offset);
+  } else {
+    for (auto h = 0; h < rotary_ndims; h += 2) {
+      float x = in[h];
+      float y = in[h + 1];
+      float sin = sin_start[h / 2];
+      float cos = cos_start[h / 2];
+      out[h] = x * cos - y * sin;
+      out[h + 1] = y * cos + x * sin;
+    }
+  }
+  if (rotary_ndims < head_size) {
+    torch_ipex::cpu::kernel::move_ker<scalar_t, scalar_t>(
+        out + rotary_ndims, in + rotary_ndims, head_size - rotary_ndims);
+  }
+}
+
+/**
+ * Applies the rotary position embedding to the query and key of the decoding
+ * tokens in one pass. The rotated query goes to query_rot, while the rotated
+ * key and the value are written to their cache slots directly, without the
+ * intermediate key/value tensors of rotary_position_embedding and
+ * reshape_and_cache.
+ *
+ * @param query     Query tensor [num_seqs, num_heads, head_size].
+ * @param key       Key tensor [num_seqs, num_kv_heads, head_size].
+ * @param value     Value tensor [num_seqs, num_kv_heads, head_size].
+ * @param query_rot The rotated query [num_seqs, num_heads, head_size].
+ * @param rope_emb_pos The sin/cos table [max_position, rotary_ndims] like
+ * rotary_position_embedding.
+ * @param positions The position of the token of every sequence [num_seqs].
+ * @param block_size The number of tokens of a page of the KV cache.
+ *
+ * @tparam cache_t The data type of the KV cache, scalar_t, Float8_e5m2 or
+ * kv_quant::Int8/Int4.
+ */
+template <typename scalar_t, typename cache_t>
+void rope_and_cache_kernel(
+    at::Tensor& query,
+    at::Tensor& key,
+    at::Tensor& value,
+    at::Tensor& query_rot,
+    at::Tensor& key_cache,
+    at::Tensor& value_cache,
+    at::Tensor& slot_mapping,
+    at::Tensor& rope_emb_pos,
+    at::Tensor& positions,
+    int64_t rotary_offset,
+    int64_t rotary_ndims,
+    int64_t block_size,
+    const double k_scale,
+    const double v_scale) {
+  auto num_seqs = query.size(0);
+  auto num_heads = query.size(1);
+  auto head_size = query.size(2);
+  auto num_kv_heads = key.size(1);
+  auto query_ptr = query.data_ptr<scalar_t>();
+  auto key_ptr = key.data_ptr<scalar_t>();
+  auto value_ptr = value.data_ptr<scalar_t>();
+  auto query_rot_ptr = query_rot.data_ptr<scalar_t>();
+  auto key_cache_ptr = get_cache_data_ptr<cache_t>(key_cache);
+  auto value_cache_ptr = get_cache_data_ptr<cache_t>(value_cache);
+  auto slot_mapping_ptr = slot_mapping.data_ptr<int>();
+  auto emb_pos_ptr = rope_emb_pos.data_ptr<float>();
+  auto positions_ptr = positions.data_ptr<long>();
+  auto HR = rope_emb_pos.size(1);
+  auto cache_strideN = key_cache.stride(0);
+  auto cache_strideP = key_cache.stride(2);
+  auto cache_strideH = key_cache.stride(1);
+  // The key is rotated into the cache directly if no conversion is needed.
+  // Otherwise it is converted from a per thread buffer for the fp8 cache, or
+  // quantized by the pages after the rotation for the INT8/INT4 cache.
+  constexpr bool is_same_type = std::is_same_v<scalar_t, cache_t>;
+  constexpr bool is_quantized_cache = kv_quant::is_quantized_v<cache_t>;
+  auto key_rot = is_quantized_cache
+      ? at::empty({num_seqs, num_kv_heads, head_size}, key.options())
+      : at::empty(
+            {omp_get_max_threads(), is_same_type ? 0 : head_size},
+            key.options());
+  auto key_rot_ptr = key_rot.data_ptr<scalar_t>();
+#pragma omp parallel for collapse(2)
+  for (auto seq_id = 0; seq_id < num_seqs; seq_id++) {
+    for (auto head_id = 0; head_id < num_heads; head_id++) {
+      auto p = positions_ptr[seq_id];
+      auto sin_start = emb_pos_ptr + p * HR;
+      auto cos_start = emb_pos_ptr + p * HR + HR / 2;
+      apply_rope_to_head(
+          query_ptr + seq_id * query.stride(0) + head_id * query.stride(1),
+          query_rot_ptr + (seq_id * num_heads + head_id) * head_size,
+          sin_start,
+          cos_start,
+          head_size,
+          rotary_ndims,
+          rotary_offset);
+      if (head_id >= num_kv_heads)
+        continue;
+      auto key_start =
+          key_ptr + seq_id * key.stride(0) + head_id * key.stride(1);
+      if constexpr (is_quantized_cache) {
+        apply_rope_to_head(
+            key_start,
+            key_rot_ptr + (seq_id * num_kv_heads + head_id) * head_size,
+            sin_start,
+            cos_start,
+            head_size,
+            rotary_ndims,
+            rotary_offset);
+      } else {
+        auto physical_block_id = slot_mapping_ptr[seq_id] / block_size;
+        auto block_offset = slot_mapping_ptr[seq_id] % block_size;
+        auto cache_offset = physical_block_id * cache_strideN +
+            block_offset * cache_strideP + head_id * cache_strideH;
+        if constexpr (is_same_type) {
+          apply_rope_to_head(
+              key_start,
+              key_cache_ptr + cache_offset,
+              sin_start,
+              cos_start,
+              head_size,
+              rotary_ndims,
+              rotary_offset);
+        } else {
+          auto key_buf = key_rot_ptr + omp_get_thread_num() * head_size;
+          apply_rope_to_head(
+              key_start,
+              key_buf,
+              sin_start,
+              cos_start,
+              head_size,
+              rotary_ndims,
+              rotary_offset);
+          fp8::scaled_convert<cache_t, scalar_t>(
+              key_buf, key_cache_ptr + cache_offset, head_size, k_scale);
+        }
+        fp8::scaled_convert<cache_t, scalar_t>(
+            value_ptr + seq_id * value.stride(0) + head_id * value.stride(1),
+            value_cache_ptr + cache_offset,
+            head_size,
+            v_scale);
+      }
+    }
+  }
+  if constexpr (is_quantized_cache) {
+    reshape_and_cache_quantized_kernel<scalar_t, cache_t>(
+        key_rot, value, key_cache, value_cache, slot_mapping);
+  }
+}
+
+/**
+ * Fuses rotary_position_embedding, reshape_and_cache and
+ * single_query_cached_kv_attention for a decoding step, the q/k/v of the new
+ * token are read once and the attention reads the rotated query from a small
+ * buffer.
+ */
+void single_query_cached_kv_attention_with_rope_kernel_impl(
+    at::Tensor& out, // [num_seqs, num_heads, head_size]
+    at::Tensor& query, // [num_seqs, num_heads, head_size]
+    at::Tensor& key, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& value, // [num_seqs, num_kv_heads, head_size]
+    at::Tensor& key_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& value_cache, // [num_blocks, num_heads, block_size, head_size]
+    at::Tensor& slot_mapping, // [num_seqs]
+    at::Tensor& rope_emb_pos, // [max_position, rotary_ndims]
+    at::Tensor& positions, // [num_seqs]
+    int64_t rotary_offset,
+    int64_t rotary_ndims,
+    at::Tensor& head_mapping, // [num_heads]
+    const double scale,
+    at::Tensor& block_tables, // [num_seqs, max_num_blocks_per_seq]
+    at::Tensor& context_lens, // [num_seqs]
+    int64_t block_size,
+    int64_t max_context_len,
+    const c10::optional<at::Tensor>& alibi_slopes,
+    int64_t window_size,
+    const std::string& kv_cache_dtype,
+    const double k_scale,
+    const double v_scale,
+    const double softcap) {
+  TORCH_CHECK(
+      query.scalar_type() == key.scalar_type() &&
+          key.scalar_type() == value.scalar_type(),
+      "query, key and value should have the same data type");
+  TORCH_CHECK(
+      key.size(0) == query.size(0) && value.size(0) == query.size(0),
+      "query, key and value should have one token for every sequence");
+  TORCH_CHECK(
+      query.stride(2) == 1 && key.stride(2) == 1 && value.stride(2) == 1,
+      "The last dim of query, key and value should be contiguous");
+  TORCH_CHECK(
+      positions.scalar_type() == at::ScalarType::Long &&
+          positions.numel() == query.size(0),
+      "positions should be a long tensor of [num_seqs]");
+  TORCH_CHECK(
+      rope_emb_pos.scalar_type() == at::ScalarType::Float &&
+          rotary_ndims <= rope_emb_pos.size(1) &&
+          rotary_ndims <= query.size(2),
+      "rope_emb_pos should be a float tensor of [max_position, rotary_ndims]");
+  TORCH_CHECK(
+      slot_mapping.is_contiguous(), "slot_mapping should be contiguous");
+  TORCH_CHECK(
+      !kv_vnni::is_vnni_kv_cache(key_cache),
+      "single_query_cached_kv_attention_with_rope does not support the VNNI packed KV cache");
+  RECORD_FUNCTION(
+      "ipex::single_query_cached_kv_attention_with_rope_kernel_impl",
+      c10::ArrayRef<c10::IValue>({}));
+  auto query_rot = at::empty(query.sizes(), query.options());
+  auto rope_and_cache = [&](auto scalar, auto cache) {
+    rope_and_cache_kernel<decltype(scalar), decltype(cache)>(
+        query,
+        key,
+        value,
+        query_rot,
+        key_cache,
+        value_cache,
+        slot_mapping,
+        rope_emb_pos,
+        positions,
+        rotary_offset,
+        rotary_ndims,
+        block_size,
+        k_scale,
+        v_scale);
+  };
+  // Check the cache before it is written
+  int64_t quant_bits = 0;
+  if (kv_cache_dtype == "int8" || kv_cache_dtype == "int4") {
+    quant_bits = kv_cache_dtype == "int8" ? 8 : 4;
+    TORCH_CHECK(
+        get_kv_cache_quant_bits(key_cache, key.size(2)) == quant_bits,
+        "The last dim of the KV cache does not match kv_cache_dtype");
+  }
+  // The INT8/INT4 cache has a row of the quantization params per page
+  TORCH_CHECK(
+      key_cache.size(2) == (quant_bits > 0 ? block_size + 1 : block_size),
+      "The pages of the KV cache do not match block_size");
+  if (quant_bits > 0) {
+    dispatch_quantized_kv_cache(query.scalar_type(), quant_bits, rope_and_cache);
+  } else if (
+      key_cache.scalar_type() == at::ScalarType::Float8_e5m2 &&
+      query.scalar_type() == at::ScalarType::BFloat16) {
+    // The attention only reads the fp8 cache with the BFloat16 query
+    rope_and_cache(at::BFloat16(), at::Float8_e5m2());
+  } else if (
+      key_cache.scalar_type() == at::ScalarType::Float &&
+      query.scalar_type() == at::ScalarType::Float) {
+    rope_and_cache(float(), float());
+  } else if (
+      key_cache.scalar_type() == at::ScalarType::BFloat16 &&
+      query.scalar_type() == at::ScalarType::BFloat16) {
+    rope_and_cache(at::BFloat16(), at::BFloat16());
+  } else if (
+      key_cache.scalar_type() == at::ScalarType::Half &&
+      query.scalar_type() == at::ScalarType::Half) {
+    rope_and_cache(at::Half(), at::Half());
+  } else {
+    TORCH_CHECK(
+        false,
+        "Unsupported data type for ipex::single_query_cached_kv_attention_with_rope");
+  }
+  single_query_cached_kv_attention_kernel_impl(
+      out,
+      query_rot,
+      key_cache,
+      value_cache,
+      head_mapping,
+      scale,
+      block_tables,
+      context_lens,
+      block_size,
+      max_context_len,
+      alibi_slopes,
+      window_size,
+      k_scale,
+      v_scale,
+      softcap,
+      /*evicted_lens*/ c10::nullopt,
+      /*num_sink_tokens*/ 0);
+}
+
 void flash_attn_varlen_cpu_kernel_impl(
     at::Tensor& out,
     at::Tensor& query,
@@ -2094,11 +4132,50 @@ void flash_attn_varlen_cpu_kernel_impl(
       "query and out should have the same data type");
   TORCH_CHECK(
       kv_cache_dtype == "fp8" || kv_cache_dtype == "fp8_e5m2" ||
-          kv_cache_dtype == "auto",
+          kv_cache_dtype == "int8" || kv_cache_dtype == "int4" ||
+          kv_cache_dtype == "vnni" || kv_cache_dtype == "auto",
       "not supported kv_cahce_dtype");
   RECORD_FUNCTION(
       "ipex::flash_attn_varlen_cpu_kernel_impl",
       c10::ArrayRef<c10::IValue>({}));
+  if (kv_vnni::is_vnni_kv_cache(key)) {
+    kv_vnni::check_kv_cache(key, value, query.size(2));
+    TORCH_CHECK(
+        query.scalar_type() == at::ScalarType::BFloat16,
+        "The VNNI packed KV cache only supports BFloat16 query");
+  }
+  auto quant_bits = get_kv_cache_quant_bits(key, query.size(2));
+  if (quant_bits > 0) {
+    dispatch_quantized_kv_cache(
+        query.scalar_type(), quant_bits, [&](auto scalar, auto quant) {
+          using scalar_t = decltype(scalar);
+          using quant_t = decltype(quant);
+          auto kernel = max_seqlen_q >= 768
+              ? flash_attn_varlen_kernel<scalar_t, quant_t, 128>
+              : max_seqlen_q >= 192
+              ? flash_attn_varlen_kernel<scalar_t, quant_t, 64>
+              : flash_attn_varlen_kernel<scalar_t, quant_t, 32>;
+          kernel(
+              out,
+              query,
+              key,
+              value,
+              cu_seqlens_q,
+              cu_seqlens_kv,
+              max_seqlen_q,
+              max_seqlen_kv,
+              softmax_scale,
+              is_causal,
+              block_table,
+              alibi_slopes,
+              window_size_left,
+              window_size_right,
+              k_scale,
+              v_scale,
+              softcap);
+        });
+    return;
+  }
   if (key.scalar_type() == at::ScalarType::Float8_e5m2 &&
       query.scalar_type() == at::ScalarType::Float) {
     if (max_seqlen_q >= 768) {
@@ -2418,6 +4495,17 @@ IPEX_REGISTER_DISPATCH(
 IPEX_REGISTER_DISPATCH(
     flash_attn_var_len_kernel_stub,
     &flash_attn_varlen_cpu_kernel_impl);
+IPEX_REGISTER_DISPATCH(
+    multi_query_cached_kv_attention_kernel_stub,
+    &multi_query_cached_kv_attention_kernel_impl);
+IPEX_REGISTER_DISPATCH(
+    evict_kv_blocks_kernel_stub,
+    &evict_kv_blocks_kernel_impl);
+IPEX_REGISTER_DISPATCH(
+    single_query_cached_kv_attention_with_rope_kernel_stub,
+    &single_query_cached_kv_attention_with_rope_kernel_impl);
+IPEX_REGISTER_DISPATCH(copy_blocks_kernel_stub, &copy_blocks_kernel_impl);
+IPEX_REGISTER_DISPATCH(swap_blocks_kernel_stub, &swap_blocks_kernel_impl);
 
 } // namespace cpu
 } // namespace torch_ipex
\ No newline at end of file
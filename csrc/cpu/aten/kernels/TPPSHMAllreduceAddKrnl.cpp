@@ -4,8 +4,10 @@
 #include <torch/all.h>
 #include <torch/csrc/distributed/c10d/comm.hpp>
 #include <iostream>
+#include <unordered_map>
 #include "tpp/utils.h"
 #include "tpp/xsmm_functors.h"
+#include "vec/vec.h"
 
 namespace torch_ipex {
 namespace cpu {
@@ -45,6 +47,69 @@ TppOps<at::Half> getOps<at::Half>() {
   TppOps<at::Half> ops_hf;
   return ops_hf;
 }
+
+// Ops of the low precision allreduce, the blocks are moved through the shared
+// memory in the wire type W and accumulated in float. The last block of the
+// tensor may be partial, so encode takes its len, decode and accumulate always
+// work on a full block of the shared memory.
+template <typename W>
+struct WireOps {
+  // Whether each block has a float scale next to the wire data.
+  static constexpr bool has_scale = false;
+  TppOps<W> ops = getOps<W>();
+
+  void encode(float* src, W* dst, float* scale, long len) {
+    if (len == BS) {
+      ops.dcvt_tpp(src, dst);
+    } else {
+      for (long i = 0; i < len; i++) {
+        dst[i] = static_cast<W>(src[i]);
+      }
+    }
+  }
+  void decode(W* src, float scale, float* dst) {
+    ops.ucvt_tpp(src, dst);
+  }
+  // acc += src
+  void accumulate(W* src, float scale, float* acc) {
+    ops.add_tpp(acc, src, acc);
+  }
+};
+
+// FP8 has a per-block scale that maps the max abs value of the block to the
+// max value of e5m2, so that the small blocks do not underflow.
+template <>
+struct WireOps<at::Float8_e5m2> {
+  static constexpr bool has_scale = true;
+  static constexpr float FP8_E5M2_MAX = 57344.0f;
+
+  void encode(float* src, at::Float8_e5m2* dst, float* scale, long len) {
+    float amax = 0;
+    for (long i = 0; i < len; i++) {
+      amax = std::max(amax, std::abs(src[i]));
+    }
+    *scale = amax > 0 ? amax / FP8_E5M2_MAX : 1.0f;
+    float inv_scale = 1.0f / *scale;
+    float scaled[BS];
+    for (long i = 0; i < len; i++) {
+      scaled[i] = src[i] * inv_scale;
+    }
+    torch_ipex::cpu::kernel::cvt_fp32_e5m2_rne_intrinsic(scaled, dst, len);
+  }
+  void decode(at::Float8_e5m2* src, float scale, float* dst) {
+    torch_ipex::cpu::kernel::cvt_e5m2_fp32_intrinsic(src, dst, BS);
+    for (long i = 0; i < BS; i++) {
+      dst[i] *= scale;
+    }
+  }
+  void accumulate(at::Float8_e5m2* src, float scale, float* acc) {
+    float tmp[BS];
+    torch_ipex::cpu::kernel::cvt_e5m2_fp32_intrinsic(src, tmp, BS);
+    for (long i = 0; i < BS; i++) {
+      acc[i] += tmp[i] * scale;
+    }
+  }
+};
 } // namespace shm_tpp
 
 class SHMBuffer {
@@ -53,6 +118,11 @@ class SHMBuffer {
   static int BARID;
   static const int MAX_RANKS = 64;
   static const int DIRECT_THRESHOLD = 32 * 1024;
+  // The pipelined allreduce splits the tensor into about PIPELINE_CHUNKS
+  // chunks, each rank reduces at least PIPELINE_MIN_BLOCKS_PER_RANK blocks of
+  // each chunk.
+  static const int PIPELINE_CHUNKS = 4;
+  static const int PIPELINE_MIN_BLOCKS_PER_RANK = 4;
   c10::intrusive_ptr<c10d::ProcessGroup> pg;
   int rank;
   int size;
@@ -64,30 +134,42 @@ class SHMBuffer {
   void* bar_data;
   volatile int* bar1;
   volatile int* bar2;
+  // Selects bar1 or bar2 by its parity, per instance like the flags
+  uint32_t barrier_count = 0;
+  // Use the pipelined allreduce for the large tensors.
+  bool use_pipeline;
 
-  SHMBuffer(size_t bufsz_, c10::intrusive_ptr<c10d::ProcessGroup> pg) : pg(pg) {
+  // key_offset separates the shared memory of the process groups on the same
+  // host, such as the nodes simulated by local processes.
+  SHMBuffer(
+      size_t bufsz_,
+      c10::intrusive_ptr<c10d::ProcessGroup> pg,
+      int key_offset = 0)
+      : pg(pg) {
     bufsz = ((bufsz_ + 4095) / 4096) * 4096 * 2;
     rank = pg->getRank();
     size = pg->getSize();
+    int shm_key = SHMID + key_offset;
+    int bar_key = BARID + key_offset;
     /* each process creates its own shared memory */
-    shmid[rank] = shmget(SHMID + rank, bufsz, IPC_CREAT | 0666);
+    shmid[rank] = shmget(shm_key + rank, bufsz, IPC_CREAT | 0666);
     AT_ASSERT(
         shmid[rank] >= 0,
         "shmid cannot create shared memory of size %lu\n",
         bufsz);
     if (rank == 0) {
-      barid = shmget(BARID, 4096, IPC_CREAT | 0666);
+      barid = shmget(bar_key, 4096, IPC_CREAT | 0666);
       AT_ASSERT(barid >= 0, "barid cannot create shared memory");
     }
     pg->barrier()->wait();
     /* each process attaches itself with other processes */
     for (int i = 0; i < size; i++) {
       if (i != rank)
-        shmid[i] = shmget(SHMID + i, bufsz, 0666);
+        shmid[i] = shmget(shm_key + i, bufsz, 0666);
       AT_ASSERT(shmid[i] >= 0, "shmid cannot get shared memory\n");
     }
     if (rank != 0) {
-      barid = shmget(BARID, 4096, IPC_CREAT | 0666);
+      barid = shmget(bar_key, 4096, IPC_CREAT | 0666);
       AT_ASSERT(barid >= 0, "barid cannot create shared memory\n");
     }
     for (int i = 0; i < size; i++) {
@@ -101,6 +183,7 @@ class SHMBuffer {
     *bar1 = 0;
     bar2 = bar1 + 128;
     *bar2 = 0;
+    use_pipeline = torch_ipex::tpp::env2int("TPP_SHM_ALLREDUCE_PIPELINE", 1);
     pg->barrier()->wait();
     shmctl(shmid[rank], IPC_RMID, NULL);
     shmctl(barid, IPC_RMID, NULL);
@@ -119,9 +202,12 @@ class SHMBuffer {
 
   static SHMBuffer* getInst(
       size_t sz,
-      c10::intrusive_ptr<c10d::ProcessGroup> pg) {
-    static size_t buf_sz = 0;
-    static SHMBuffer* inst = nullptr;
+      c10::intrusive_ptr<c10d::ProcessGroup> pg,
+      int key_offset = 0) {
+    // One buffer for each key offset
+    static std::unordered_map<int, std::pair<size_t, SHMBuffer*>> insts;
+    auto& buf_sz = insts[key_offset].first;
+    auto& inst = insts[key_offset].second;
 
     // TODO: check for same pg as well
     if (buf_sz < sz) {
@@ -129,7 +215,7 @@ class SHMBuffer {
         delete inst;
         inst = nullptr;
       }
-      inst = new SHMBuffer(sz, pg);
+      inst = new SHMBuffer(sz, pg, key_offset);
       AT_ASSERT(inst != nullptr, "Unable to create shm buffer\n");
       buf_sz = sz;
     }
@@ -137,8 +223,7 @@ class SHMBuffer {
   }
 
   void barrier() {
-    static uint32_t count = 0;
-    if (count % 2) {
+    if (barrier_count % 2) {
       __sync_fetch_and_add(bar1, 1);
       while ((*bar1 % size) != 0)
         ;
@@ -147,7 +232,7 @@ class SHMBuffer {
       while ((*bar2 % size) != 0)
         ;
     }
-    count++;
+    barrier_count++;
   }
 
   at::Tensor getTensor(at::Tensor t) {
@@ -158,12 +243,25 @@ class SHMBuffer {
     return t_new;
   }
 
+  // When cross_pg is defined, the reduced slice of this rank is allreduced
+  // across the nodes before the slices are gathered.
   template <typename T>
-  void allreduce_impl(at::Tensor t) {
+  void allreduce_impl(
+      at::Tensor t,
+      c10::intrusive_ptr<c10d::ProcessGroup> cross_pg) {
     auto numel = t.numel();
     auto nBytes = numel * t.element_size();
-    AT_ASSERT((size_t)nBytes <= bufsz / 2, "Too large allreduce size");
     long nBlk = (numel + BS - 1) / BS;
+    // The tensor from getTensor is already in the shared memory
+    if (use_pipeline && numel > DIRECT_THRESHOLD &&
+        t.data_ptr() != shm_data[rank]) {
+      long chunk_blocks = get_pipeline_chunk_blocks<T>(nBlk);
+      if (nBlk > chunk_blocks) {
+        allreduce_pipelined_impl<T>(t, cross_pg, chunk_blocks);
+        return;
+      }
+    }
+    AT_ASSERT((size_t)nBytes <= bufsz / 2, "Too large allreduce size");
     long max_threads = omp_get_max_threads();
     int nThreads = std::min(nBlk, max_threads);
     T* ptr = (T*)t.data_ptr();
@@ -192,7 +290,7 @@ class SHMBuffer {
 
     barrier();
 
-    if (numel <= DIRECT_THRESHOLD) {
+    if (numel <= DIRECT_THRESHOLD && !cross_pg.defined()) {
       auto dst = (T*)scratch_data[rank];
       auto lsrc = (T*)shm_data[rank];
 #pragma omp parallel for
@@ -238,6 +336,13 @@ class SHMBuffer {
         }
         dcvt_tpp(ldst, dst + i);
       }
+      // The ranks with the same local rank own the same slice on all nodes.
+      long cross_numel = std::min<long>(slice_end, numel) - slice_start;
+      if (cross_pg.defined() && cross_numel > 0) {
+        std::vector<at::Tensor> cross_vec = {
+            torch::from_blob(dst + slice_start, {cross_numel}, t.options())};
+        cross_pg->allreduce(cross_vec)->wait();
+      }
       barrier();
       if (true) {
         for (int r = 0; r < size; r++) {
@@ -266,14 +371,256 @@ class SHMBuffer {
     }
   }
 
-  void allreduce(at::Tensor t) {
+  // Blocks of each chunk of the pipelined allreduce. Multiple of the ranks
+  // so that the slices are even, and up to the size of one buffer.
+  template <typename T>
+  long get_pipeline_chunk_blocks(long nBlk) {
+    long max_chunk_blocks = (bufsz / 4) / (BS * sizeof(T));
+    long chunk_blocks = (nBlk + PIPELINE_CHUNKS - 1) / PIPELINE_CHUNKS;
+    chunk_blocks =
+        std::max(chunk_blocks, (long)size * PIPELINE_MIN_BLOCKS_PER_RANK);
+    chunk_blocks = (chunk_blocks + size - 1) / size * size;
+    return std::min(chunk_blocks, max_chunk_blocks);
+  }
+
+  // Double buffered allreduce. Both halves of the shared memory are split
+  // into 2 buffers. In step k, the threads of each rank copy chunk k+1 into
+  // one buffer, reduce the slice of chunk k of this rank from the other
+  // buffer, and gather the reduced chunk k-1, all together. So that only one
+  // barrier is needed for each chunk and the copy overlaps with the reduce.
+  template <typename T>
+  void allreduce_pipelined_impl(
+      at::Tensor t,
+      c10::intrusive_ptr<c10d::ProcessGroup> cross_pg,
+      long chunk_blocks) {
+    long numel = t.numel();
+    long chunk_numel = chunk_blocks * BS;
+    long nChunks = (numel + chunk_numel - 1) / chunk_numel;
+    T* ptr = (T*)t.data_ptr();
+    auto ops = shm_tpp::getOps<T>();
+    auto& cpy_tpp = ops.cpy_tpp;
+    auto& ucvt_tpp = ops.ucvt_tpp;
+    auto& dcvt_tpp = ops.dcvt_tpp;
+    auto& add_tpp = ops.add_tpp;
+
+    auto get_data = [&](int r, long chunk) {
+      return (T*)((char*)shm_data[r] + (chunk & 1) * (bufsz / 4));
+    };
+    auto get_scratch = [&](int r, long chunk) {
+      return (T*)((char*)scratch_data[r] + (chunk & 1) * (bufsz / 4));
+    };
+    auto get_chunk_numel = [&](long chunk) {
+      if (chunk < 0 || chunk >= nChunks)
+        return 0L;
+      return std::min(chunk_numel, numel - chunk * chunk_numel);
+    };
+    // Copy one block, the last block of the chunk may be partial.
+    auto copy_block = [&](T* src, T* dst, long offset, long len) {
+      if (offset + BS <= len) {
+        cpy_tpp(src + offset, dst + offset);
+      } else {
+        for (long i = offset; i < len; i++) {
+          dst[i] = src[i];
+        }
+      }
+    };
+
+    for (long k = -1; k <= nChunks; k++) {
+      // Step -1 only copies chunk 0, step nChunks only gathers the last.
+      long copy_numel = get_chunk_numel(k + 1);
+      long reduce_numel = get_chunk_numel(k);
+      long gather_numel = get_chunk_numel(k - 1);
+      long copy_blocks = (copy_numel + BS - 1) / BS;
+      long reduce_all_blocks = (reduce_numel + BS - 1) / BS;
+      long reduce_start = reduce_all_blocks * rank / size;
+      long reduce_blocks = reduce_all_blocks * (rank + 1) / size - reduce_start;
+      long gather_blocks = (gather_numel + BS - 1) / BS;
+      T* copy_src = ptr + (k + 1) * chunk_numel;
+      T* copy_dst = get_data(rank, k + 1);
+      T* gather_dst = ptr + (k - 1) * chunk_numel;
+
+#pragma omp parallel for
+      for (long item = 0; item < copy_blocks + reduce_blocks + gather_blocks;
+           item++) {
+        if (item < copy_blocks) {
+          copy_block(copy_src, copy_dst, item * BS, copy_numel);
+        } else if (item < copy_blocks + reduce_blocks) {
+          long i = (reduce_start + item - copy_blocks) * BS;
+          float ldst[BS];
+          ucvt_tpp(get_data(rank, k) + i, ldst);
+          for (int r = 1; r < size; r++) {
+            int r1 = (r + rank) % size;
+            add_tpp(ldst, get_data(r1, k) + i, ldst);
+          }
+          dcvt_tpp(ldst, get_scratch(rank, k) + i);
+        } else {
+          long b = item - copy_blocks - reduce_blocks;
+          // The rank whose slice of chunk k-1 contains block b
+          int owner = std::min<long>(
+              ((b + 1) * size - 1) / gather_blocks, size - 1);
+          copy_block(
+              get_scratch(owner, k - 1), gather_dst, b * BS, gather_numel);
+        }
+      }
+      long cross_numel =
+          std::min(reduce_blocks * BS, reduce_numel - reduce_start * BS);
+      if (cross_pg.defined() && cross_numel > 0) {
+        std::vector<at::Tensor> cross_vec = {torch::from_blob(
+            get_scratch(rank, k) + reduce_start * BS,
+            {cross_numel},
+            t.options())};
+        cross_pg->allreduce(cross_vec)->wait();
+      }
+      if (k < nChunks) {
+        barrier();
+      }
+    }
+  }
+
+  // Allreduce with the data moved through the shared memory in the wire type
+  // W, which is narrower than T, and accumulated in float. The wire data of
+  // each rank is followed by the per-block scales when W has scales. Small
+  // tensors are reduced by all the ranks in the same rank order, so that the
+  // results are identical. Large tensors are reduced slice by slice, the
+  // reduced slices are encoded into the scratch buffer again to be gathered.
+  template <typename T, typename W>
+  void allreduce_wire_impl(at::Tensor t) {
+    long numel = t.numel();
+    long nBlk = (numel + BS - 1) / BS;
+    long wire_bytes = (nBlk * BS * sizeof(W) + 63) / 64 * 64;
+    AT_ASSERT(
+        (size_t)(wire_bytes + nBlk * sizeof(float)) <= bufsz / 2,
+        "Too large allreduce size");
+    T* ptr = (T*)t.data_ptr();
+    auto ops = shm_tpp::getOps<T>();
+    auto& ucvt_tpp = ops.ucvt_tpp;
+    auto& dcvt_tpp = ops.dcvt_tpp;
+    shm_tpp::WireOps<W> wire_ops;
+
+    auto get_wire = [&](void* base) { return (W*)base; };
+    auto get_scales = [&](void* base) {
+      return (float*)((char*)base + wire_bytes);
+    };
+    auto get_scale = [&](void* base, long b) {
+      return shm_tpp::WireOps<W>::has_scale ? get_scales(base)[b] : 1.0f;
+    };
+    auto to_float = [&](T* src, float* dst, long len) {
+      if (len == BS) {
+        ucvt_tpp(src, dst);
+      } else {
+        for (long i = 0; i < len; i++) {
+          dst[i] = static_cast<float>(src[i]);
+        }
+      }
+    };
+    auto from_float = [&](float* src, T* dst, long len) {
+      if (len == BS) {
+        dcvt_tpp(src, dst);
+      } else {
+        for (long i = 0; i < len; i++) {
+          dst[i] = static_cast<T>(src[i]);
+        }
+      }
+    };
+
+#pragma omp parallel for
+    for (long b = 0; b < nBlk; b++) {
+      long len = std::min<long>(BS, numel - b * BS);
+      float lsrc[BS];
+      to_float(ptr + b * BS, lsrc, len);
+      wire_ops.encode(
+          lsrc,
+          get_wire(shm_data[rank]) + b * BS,
+          get_scales(shm_data[rank]) + b,
+          len);
+    }
+    barrier();
+
+    if (numel <= DIRECT_THRESHOLD) {
+#pragma omp parallel for
+      for (long b = 0; b < nBlk; b++) {
+        long len = std::min<long>(BS, numel - b * BS);
+        float ldst[BS];
+        wire_ops.decode(
+            get_wire(shm_data[0]) + b * BS, get_scale(shm_data[0], b), ldst);
+        for (int r = 1; r < size; r++) {
+          wire_ops.accumulate(
+              get_wire(shm_data[r]) + b * BS, get_scale(shm_data[r], b), ldst);
+        }
+        from_float(ldst, ptr + b * BS, len);
+      }
+      barrier();
+    } else {
+      long slice_start = nBlk * rank / size;
+      long slice_end = nBlk * (rank + 1) / size;
+#pragma omp parallel for
+      for (long b = slice_start; b < slice_end; b++) {
+        long len = std::min<long>(BS, numel - b * BS);
+        float ldst[BS];
+        wire_ops.decode(
+            get_wire(shm_data[rank]) + b * BS,
+            get_scale(shm_data[rank], b),
+            ldst);
+        for (int r = 1; r < size; r++) {
+          int r1 = (r + rank) % size;
+          wire_ops.accumulate(
+              get_wire(shm_data[r1]) + b * BS,
+              get_scale(shm_data[r1], b),
+              ldst);
+        }
+        wire_ops.encode(
+            ldst,
+            get_wire(scratch_data[rank]) + b * BS,
+            get_scales(scratch_data[rank]) + b,
+            len);
+      }
+      barrier();
+#pragma omp parallel for
+      for (long b = 0; b < nBlk; b++) {
+        long len = std::min<long>(BS, numel - b * BS);
+        // The rank whose slice contains block b
+        int owner = std::min<long>(((b + 1) * size - 1) / nBlk, size - 1);
+        float ldst[BS];
+        wire_ops.decode(
+            get_wire(scratch_data[owner]) + b * BS,
+            get_scale(scratch_data[owner], b),
+            ldst);
+        from_float(ldst, ptr + b * BS, len);
+      }
+    }
+  }
+
+  // wire_dtype is one of "auto", "bf16", "fp16", "fp8" and "fp8_e5m2". The
+  // 16 bits wire types only apply to float tensors.
+  void allreduce_low_precision(at::Tensor t, const std::string& wire_dtype) {
+    auto dt = t.dtype();
+    bool is_fp8 = wire_dtype == "fp8" || wire_dtype == "fp8_e5m2";
+    if (dt == at::kFloat && wire_dtype == "bf16") {
+      allreduce_wire_impl<float, at::BFloat16>(t);
+    } else if (dt == at::kFloat && wire_dtype == "fp16") {
+      allreduce_wire_impl<float, at::Half>(t);
+    } else if (dt == at::kFloat && is_fp8) {
+      allreduce_wire_impl<float, at::Float8_e5m2>(t);
+    } else if (dt == at::kBFloat16 && is_fp8) {
+      allreduce_wire_impl<at::BFloat16, at::Float8_e5m2>(t);
+    } else if (dt == at::kHalf && is_fp8) {
+      allreduce_wire_impl<at::Half, at::Float8_e5m2>(t);
+    } else {
+      allreduce(t);
+    }
+  }
+
+  void allreduce(
+      at::Tensor t,
+      c10::intrusive_ptr<c10d::ProcessGroup> cross_pg =
+          c10::intrusive_ptr<c10d::ProcessGroup>()) {
     auto dt = t.dtype();
     if (dt == at::kFloat) {
-      allreduce_impl<float>(t);
+      allreduce_impl<float>(t, cross_pg);
     } else if (dt == at::kBFloat16) {
-      allreduce_impl<at::BFloat16>(t);
+      allreduce_impl<at::BFloat16>(t, cross_pg);
     } else if (dt == at::kHalf) {
-      allreduce_impl<at::Half>(t);
+      allreduce_impl<at::Half>(t, cross_pg);
     } else {
       AT_ASSERT(0, "Unsupported dtype in allreduce\n");
     }
@@ -285,16 +632,23 @@ int SHMBuffer::BARID = 10000 + master_port;
 
 static const long TPP_SHM_BUF_SIZE =
     torch_ipex::tpp::env2int("TPP_SHM_BUF_SIZE", 64 * 1024 * 1024);
-// Using master port to distinguist multiple distributed instances for setting
-// up shared memory
-void tpp_allreduce_impl(
+
+void shm_allreduce_in_chunks(
+    SHMBuffer* shm_inst,
     at::Tensor t_in,
-    c10::intrusive_ptr<c10d::ProcessGroup> process_group) {
-  auto shm_inst = SHMBuffer::getInst(TPP_SHM_BUF_SIZE, process_group);
+    c10::intrusive_ptr<c10d::ProcessGroup> cross_pg,
+    const std::string& wire_dtype = "auto") {
   long max_elem = TPP_SHM_BUF_SIZE / t_in.element_size();
   long numel = t_in.numel();
+  auto allreduce_chunk = [&](at::Tensor t) {
+    if (wire_dtype == "auto") {
+      shm_inst->allreduce(t, cross_pg);
+    } else {
+      shm_inst->allreduce_low_precision(t, wire_dtype);
+    }
+  };
   if (numel <= max_elem) {
-    shm_inst->allreduce(t_in);
+    allreduce_chunk(t_in);
   } else {
     t_in = t_in.view({-1});
     for (int64_t i = 0; i < numel; i += max_elem) {
@@ -303,23 +657,59 @@ void tpp_allreduce_impl(
       if (end > numel)
         end = numel;
       auto t = t_in.slice(0, start, end, 1);
-      shm_inst->allreduce(t);
+      allreduce_chunk(t);
     }
   }
 }
+
+// Using master port to distinguist multiple distributed instances for setting
+// up shared memory
+void tpp_allreduce_impl(
+    at::Tensor t_in,
+    c10::intrusive_ptr<c10d::ProcessGroup> process_group,
+    const std::string& wire_dtype) {
+  auto shm_inst = SHMBuffer::getInst(TPP_SHM_BUF_SIZE, process_group);
+  shm_allreduce_in_chunks(
+      shm_inst, t_in, c10::intrusive_ptr<c10d::ProcessGroup>(), wire_dtype);
+}
+
+void tpp_hierarchical_allreduce_impl(
+    at::Tensor t_in,
+    c10::intrusive_ptr<c10d::ProcessGroup> local_process_group,
+    c10::intrusive_ptr<c10d::ProcessGroup> cross_process_group) {
+  // The rank in cross_process_group is the node id. Give each node its own
+  // shared memory keys, so that the nodes can be simulated on one host.
+  int key_offset = (cross_process_group->getRank() + 1) * SHMBuffer::MAX_RANKS;
+  auto shm_inst = SHMBuffer::getInst(
+      TPP_SHM_BUF_SIZE, local_process_group, key_offset);
+  shm_allreduce_in_chunks(shm_inst, t_in, cross_process_group);
+}
 #undef BS
 #else
 void tpp_allreduce_impl(
     at::Tensor t_in,
-    c10::intrusive_ptr<c10d::ProcessGroup> process_group) {
+    c10::intrusive_ptr<c10d::ProcessGroup> process_group,
+    const std::string& wire_dtype) {
   std::vector<at::Tensor> temp_vec = {t_in};
   process_group->allreduce(temp_vec)->wait();
 }
+
+void tpp_hierarchical_allreduce_impl(
+    at::Tensor t_in,
+    c10::intrusive_ptr<c10d::ProcessGroup> local_process_group,
+    c10::intrusive_ptr<c10d::ProcessGroup> cross_process_group) {
+  std::vector<at::Tensor> temp_vec = {t_in};
+  local_process_group->allreduce(temp_vec)->wait();
+  cross_process_group->allreduce(temp_vec)->wait();
+}
 #endif
 
 } // namespace
 
 IPEX_REGISTER_DISPATCH(tpp_allreduce_kernel_stub, &tpp_allreduce_impl);
+IPEX_REGISTER_DISPATCH(
+    tpp_hierarchical_allreduce_kernel_stub,
+    &tpp_hierarchical_allreduce_impl);
 
 } // namespace cpu
 } // namespace torch_ipex
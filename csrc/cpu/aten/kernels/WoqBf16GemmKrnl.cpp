@@ -52,7 +52,8 @@ at::Tensor woq_gemm_bf16(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   const int64_t k_splits = 0;
   quant_block_k = std::max(0L, quant_block_k);
   // int8_idx is only valid with zp_list when lowp_mode == LOWP_MODE_INT8
@@ -116,7 +117,8 @@ at::Tensor woq_gemm_bf16(
                   nullptr, // scales_a_ptr
                   nullptr, // zps_a_ptr
                   c10::nullopt, // compensation
-                  g_idx);
+                  g_idx,
+                  x_perm);
             },
             [](auto tuple) { failing_fallback(); });
     return y;
@@ -133,7 +135,8 @@ at::Tensor woq_gemm_bf16(
         others_list,
         quant_w_mode,
         quant_block_k,
-        g_idx);
+        g_idx,
+        x_perm);
   }
 }
 
@@ -150,7 +153,8 @@ at::Tensor woq_gemm_bf16(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   return woq_gemm_ref_impl(
       x,
       qw,
@@ -163,7 +167,8 @@ at::Tensor woq_gemm_bf16(
       others_list,
       quant_w_mode,
       quant_block_k,
-      g_idx);
+      g_idx,
+      x_perm);
 }
 
 #endif // defined(CPU_CAPABILITY_AVX512_FP16) && defined(COMPILER_PREREQ_MET)
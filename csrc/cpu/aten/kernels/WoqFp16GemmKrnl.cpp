@@ -52,7 +52,8 @@ at::Tensor woq_gemm_fp16(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   const int64_t k_splits = 0;
   quant_block_k = std::max(0L, quant_block_k);
   // int8_idx is only valid with zp_list when lowp_mode == LOWP_MODE_INT8
@@ -118,7 +119,8 @@ at::Tensor woq_gemm_fp16(
                     nullptr, // scales_a_ptr
                     nullptr, // zps_a_ptr
                     c10::nullopt, // compensation
-                    g_idx);
+                    g_idx,
+                    x_perm);
 #else
                 qlinear_woq_affine_impl<
                     act_type,
@@ -143,7 +145,8 @@ at::Tensor woq_gemm_fp16(
                     nullptr, // scales_a_ptr
                     nullptr, // zps_a_ptr
                     c10::nullopt, // compensation
-                    g_idx);
+                    g_idx,
+                    x_perm);
 #endif
               };
               try_compute_in_half();
@@ -163,7 +166,8 @@ at::Tensor woq_gemm_fp16(
         others_list,
         quant_w_mode,
         quant_block_k,
-        g_idx);
+        g_idx,
+        x_perm);
   }
 }
 
@@ -180,7 +184,8 @@ at::Tensor woq_gemm_fp16(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   return woq_gemm_ref_impl(
       x,
       qw,
@@ -193,7 +198,8 @@ at::Tensor woq_gemm_fp16(
       others_list,
       quant_w_mode,
       quant_block_k,
-      g_idx);
+      g_idx,
+      x_perm);
 }
 
 #endif // defined(CPU_CAPABILITY_AVX512_FP16) && defined(COMPILER_PREREQ_MET)
@@ -52,7 +52,8 @@ at::Tensor woq_gemm_fp32(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   TORCH_CHECK(x.scalar_type() == at::kFloat, "Input must be in float format");
   const int64_t k_splits = 0;
   quant_block_k = std::max(0L, quant_block_k);
@@ -104,7 +105,8 @@ at::Tensor woq_gemm_fp32(
               nullptr, // scales_a_ptr
               nullptr, // zps_a_ptr
               c10::nullopt, // compensation
-              g_idx);
+              g_idx,
+              x_perm);
         },
         [](auto quant_w_mode_) { failing_fallback(); });
     return y;
@@ -121,7 +123,8 @@ at::Tensor woq_gemm_fp32(
         others_list,
         quant_w_mode,
         quant_block_k,
-        g_idx);
+        g_idx,
+        x_perm);
   }
 }
 
@@ -138,7 +141,8 @@ at::Tensor woq_gemm_fp32(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   return woq_gemm_ref_impl(
       x,
       qw,
@@ -151,7 +155,8 @@ at::Tensor woq_gemm_fp32(
       others_list,
       quant_w_mode,
       quant_block_k,
-      g_idx);
+      g_idx,
+      x_perm);
 }
 
 #endif // defined(CPU_CAPABILITY_AVX512_FP16) && defined(COMPILER_PREREQ_MET)
@@ -51,6 +51,10 @@ IPEX_DEFINE_DISPATCH(woq_int8_gemm_pre_m_k_block_kernel_stub);
  * @param quant_block_k block size for quantization
  * @param compensation a tensor for quantization compensation, for
  * LOWP_MODE_INT8 only. Used when activation is asymmetric quantized.
+ * @param g_idx group index of each input channel for GPTQ with act-order
+ * @param x_perm input channel permutation of the packed weight, which is
+ * shuffled by g_idx for GPTQ with act-order, i.e., the k-th input channel of
+ * the packed weight is the x_perm[k]-th channel of `x`.
  * @return at::Tensor output in same dtype as `x`, 2D plain format [M,N]
  */
 at::Tensor qlinear_woq_affine(
@@ -67,7 +71,8 @@ at::Tensor qlinear_woq_affine(
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
     const c10::optional<at::Tensor>& compensation = c10::nullopt,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   auto K = x.size(-1);
   auto M = x.numel() / K;
   auto act_dtype = x.scalar_type();
@@ -87,7 +92,8 @@ at::Tensor qlinear_woq_affine(
         others_list,
         quant_w_mode,
         quant_block_k,
-        g_idx);
+        g_idx,
+        x_perm);
   } else if (
       (lowp_mode == LOWP_MODE_NONE && act_dtype == at::kBFloat16) ||
       lowp_mode == LOWP_MODE_BF16 && M >= SMALL_BATCH_THRESHOLD) {
@@ -103,12 +109,17 @@ at::Tensor qlinear_woq_affine(
         others_list,
         quant_w_mode,
         quant_block_k,
-        g_idx);
+        g_idx,
+        x_perm);
   } else if (lowp_mode == LOWP_MODE_INT8) {
+    // The activation is quantized into a new buffer anyway, and the per-K-block
+    // qparams are defined on the shuffled channels, so it is gathered before
+    // it is quantized instead of in the int8 GEMM
+    auto x_int8 = x_perm.has_value() ? x.index_select(-1, x_perm.value()) : x;
 #define CALL_INT8_KERNEL(kernel) \
   kernel(                        \
       kCPU,                      \
-      x,                         \
+      x_int8,                    \
       qw,                        \
       scales_list,               \
       zp_list,                   \
@@ -157,7 +168,8 @@ at::Tensor qlinear_woq_affine(
       others_list,
       quant_w_mode,
       quant_block_k,
-      g_idx);
+      g_idx,
+      x_perm);
 }
 
 } // namespace
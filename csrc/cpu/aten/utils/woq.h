@@ -3,15 +3,20 @@
 #ifdef USE_LIBXSMM
 #include <aten/Linear.h>
 #include <dyndisp/DispatchStub.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <sstream>
 #include <unordered_map>
 #include "csrc/cpu/tpp/kernels/TPPGEMMKrnl.h"
 #include "csrc/cpu/tpp/woq/tla.h"
 #include "utils.h"
+#include "woq_autotune.h"
 #include "woq_defines.h"
 #include "woq_dynamic_quant.h"
 #include "woq_utils.h"
@@ -2353,6 +2358,51 @@ class NoDequantGemmTPP {
   long ldc;
 };
 
+// Gather a [rows, cols] panel of x through the input channel permutation
+// perm, i.e. out[r][i] = x[r][perm[i]]. The 16-bit elements are gathered as
+// 32-bit words, which reads 2 bytes past the element. So if `x_tail` is set,
+// i.e. the last row ends the tensor, it is gathered element-wise.
+template <typename T>
+inline void gather_x_panel(
+    const T* x,
+    const int32_t* perm,
+    T* out,
+    long rows,
+    long cols,
+    long ldx,
+    long ldo,
+    bool x_tail) {
+  long r = 0;
+#if defined(CPU_CAPABILITY_AVX512)
+  if constexpr (sizeof(T) == 4 || sizeof(T) == 2) {
+    long vec_rows = sizeof(T) == 2 && x_tail ? rows - 1 : rows;
+    for (; r < vec_rows; r++) {
+      const T* x_row = x + r * ldx;
+      T* out_row = out + r * ldo;
+      long i = 0;
+      for (; i + 16 <= cols; i += 16) {
+        auto vidx = _mm512_loadu_si512(perm + i);
+        auto v = _mm512_i32gather_epi32(vidx, x_row, sizeof(T));
+        if constexpr (sizeof(T) == 4) {
+          _mm512_storeu_si512(out_row + i, v);
+        } else {
+          _mm256_storeu_si256(
+              (__m256i*)(out_row + i), _mm512_cvtepi32_epi16(v));
+        }
+      }
+      for (; i < cols; i++) {
+        out_row[i] = x_row[perm[i]];
+      }
+    }
+  }
+#endif
+  for (; r < rows; r++) {
+    for (long i = 0; i < cols; i++) {
+      out[r * ldo + i] = x[r * ldx + perm[i]];
+    }
+  }
+}
+
 static int IPEX_KCB_BLOCK_SIZE = env2int("IPEX_KCB_BLOCK_SIZE", 64);
 #define DEQUANT_UPFRONT_THRESHOLD 1024
 #define PARALLEL_M_THRESHOLD 128
@@ -2360,6 +2410,8 @@ static int IPEX_KCB_BLOCK_SIZE = env2int("IPEX_KCB_BLOCK_SIZE", 64);
 // Compared to qlinear_woq_affine_impl,
 // this function dequantize weight upfront before gemm to improve the
 // performance for the first token.
+// If x_perm is given, x is gathered through it in the pass converting x to
+// TComp, since the GEMM below takes the whole activation.
 template <
     typename T,
     typename TComp,
@@ -2380,7 +2432,8 @@ void qlinear_woq_affine_dequant_upfront_impl(
     const TensorList& others_list,
     int64_t quant_block_k,
     const at::Tensor& zps = at::Tensor(), // dtype is TComp
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
   const bool asym_quant_w = is_asymmetric_quant_w(quant_w_mode);
   auto x_sizes = x.sizes();
   auto w_sizes = qw_packed.sizes();
@@ -2585,23 +2638,56 @@ void qlinear_woq_affine_dequant_upfront_impl(
             // op ourselves
             auto maybe_cvt_x_and_compute = [&](at::Tensor& y,
                                                int fuse_type = 0) {
-              if constexpr (!std::is_same<T, TComp>()) {
+              if (!std::is_same<T, TComp>() || x_perm.has_value()) {
                 auto x_comp = at::empty(
                     x_reshaped.sizes(),
                     x_reshaped.options().dtype(
                         c10::CppTypeToScalarType<TComp>::value));
                 auto cvt_x_tpp = ConvertTPP<T, TComp>(block_m, Kb, K, K);
                 auto cvt_x_rem_tpp = ConvertTPP<T, TComp>(rem, Kb, K, K);
+                auto cvt_x_perm_tpp = ConvertTPP<T, TComp>(block_m, Kb, Kb, K);
+                auto cvt_x_perm_rem_tpp = ConvertTPP<T, TComp>(rem, Kb, Kb, K);
                 auto cvt_loop = torch_ipex::tpp::ThreadedLoop<2>(
                     {{0, M, block_m}, {Kc}}, "AB");
                 auto in_ptr = GetVLAPtr<T>(x, {Kc, Kb});
                 auto out_ptr = GetVLAPtr<TComp>(x_comp, {Kc, Kb});
+                auto perm_ptr =
+                    GetVLAPtr<int32_t>(x_perm.value_or(at::Tensor()), {Kb});
                 cvt_loop([&](int* ind) {
                   int m = ind[0], kc = ind[1];
-                  if (m + block_m <= M) {
-                    cvt_x_tpp(in_ptr[m][kc], out_ptr[m][kc]);
+                  bool is_rem = m + block_m > M;
+                  if (!x_perm.has_value()) {
+                    if (!is_rem) {
+                      cvt_x_tpp(in_ptr[m][kc], out_ptr[m][kc]);
+                    } else {
+                      cvt_x_rem_tpp(in_ptr[m][kc], out_ptr[m][kc]);
+                    }
+                  } else if constexpr (std::is_same<T, TComp>()) {
+                    gather_x_panel<T>(
+                        in_ptr[m][0],
+                        perm_ptr[kc],
+                        out_ptr[m][kc],
+                        is_rem ? rem : block_m,
+                        Kb,
+                        K,
+                        K,
+                        m + block_m >= M);
                   } else {
-                    cvt_x_rem_tpp(in_ptr[m][kc], out_ptr[m][kc]);
+                    alignas(64) T x_buf[block_m][Kb];
+                    gather_x_panel<T>(
+                        in_ptr[m][0],
+                        perm_ptr[kc],
+                        x_buf[0],
+                        is_rem ? rem : block_m,
+                        Kb,
+                        K,
+                        Kb,
+                        m + block_m >= M);
+                    if (!is_rem) {
+                      cvt_x_perm_tpp(x_buf[0], out_ptr[m][kc]);
+                    } else {
+                      cvt_x_perm_rem_tpp(x_buf[0], out_ptr[m][kc]);
+                    }
                   }
                 });
                 tpp_linear_with_post_op(x_comp, y, fuse_type);
@@ -2745,6 +2831,9 @@ void qlinear_woq_affine_dequant_upfront_impl(
 // If T == TComp (we can save intermediate output buffer and schedule M/N/K
 // loops together)
 //   T -> GEMM -> T -> bias/PostOp -> Tout
+// If x_perm is given, input channels of x are shuffled by x_perm. Each
+// thread gathers the row block of x it computes into a private A panel once,
+// and reuses the panel for all of its N blocks.
 template <
     typename T,
     typename TComp,
@@ -2769,7 +2858,9 @@ void qlinear_woq_affine_impl(
     float* scales_a_ptr = nullptr,
     int32_t* zps_a_ptr = nullptr,
     const c10::optional<at::Tensor>& compensation = c10::nullopt,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt,
+    const WoqGemmConfig* config = nullptr) {
   const bool is_4bit_flag = is_4bit(qw_type);
   constexpr bool asym_quant_w = is_asymmetric_quant_w(quant_w_mode);
   bool no_dequant_weight = compensation.has_value();
@@ -2819,12 +2910,16 @@ void qlinear_woq_affine_impl(
           others_list,
           quant_block_k,
           zps,
-          g_idx);
+          g_idx,
+          x_perm);
       return;
     }
   } else {
     TLA_ASSERT(
         !g_idx.has_value(), "WOQ: g_idx is not supported for int8 computation");
+    TLA_ASSERT(
+        !x_perm.has_value(),
+        "WOQ: x_perm is not supported for int8 computation");
   }
 
   // select BLOCK_M according to M
@@ -2847,12 +2942,167 @@ void qlinear_woq_affine_impl(
   if (k_splits <= 0 || M >= 32 || BLOCK_M_rem) {
     k_splits = 1;
   }
+  auto Kcb = Kc;
+  if (M < PARALLEL_M_THRESHOLD) {
+    Kcb = 1;
+  } else if (
+      is_4bit_flag || !std::is_same<T, TComp>() ||
+      std::is_same<TComp, uint8_t>()) {
+    Kcb = 1;
+  } else if (M >= PARALLEL_M_THRESHOLD) {
+    Kcb = IPEX_KCB_BLOCK_SIZE;
+  }
+
+  // Candidates of the autotuner. K is accumulated in place on the output
+  // without y buffer, so it is not parallelized in that case. The A panels
+  // gathered through x_perm are reused across N blocks only if M is the
+  // outermost loop.
+  bool can_split_k = M < 32 && !BLOCK_M_rem && !no_dequant_weight;
+  auto get_loop_schemes = [&](int splits) -> std::vector<std::string> {
+    if (std::is_same<T, TComp>() && std::is_same<Tout, TGemmOut>() &&
+        splits == 1) {
+      return {"ACb", "aCb"};
+    }
+    if (x_perm.has_value()) {
+      return {"CAB", "cAB"};
+    }
+    return {"ABc", "ABC", "ACB", "CAB", "aBC"};
+  };
+  auto is_valid_config = [&](const WoqGemmConfig& cfg) {
+    auto loop_schemes = get_loop_schemes(cfg.k_splits);
+    return (cfg.k_splits == 1 ||
+            (can_split_k && cfg.k_splits > 1 && Kc % cfg.k_splits == 0)) &&
+        (cfg.kcb == Kcb || (Kcb > 1 && cfg.kcb >= 1 && cfg.kcb < Kcb)) &&
+        std::find(loop_schemes.begin(), loop_schemes.end(), cfg.loop_scheme) !=
+        loop_schemes.end();
+  };
+  if (config == nullptr && WoqGemmAutotuner::is_enabled()) {
+    auto& autotuner = WoqGemmAutotuner::get_instance();
+    std::ostringstream key_ss;
+    // The configs tuned on another machine or thread count are not reused
+    // from the cache file.
+    key_ss << CPUCapabilityToString(get_cpu_capability()) << ",T"
+           << omp_get_max_threads() << "," << x.scalar_type() << ","
+           << c10::CppTypeToScalarType<TComp>::value
+           << "," << c10::CppTypeToScalarType<TGemmOut>::value << ","
+           << y.scalar_type() << ",qa" << quant_a_mode << ",qw" << quant_w_mode
+           << ",dt" << qw_type << ",N" << Nc << "x" << Nb << ",K" << Kc << "x"
+           << Kb << ",qbk" << quant_block_k << ",gidx" << g_idx.has_value()
+           << ",perm" << x_perm.has_value() << ",nodq" << no_dequant_weight
+           << ",M" << get_woq_gemm_m_bucket(M);
+    auto key = key_ss.str();
+    WoqGemmConfig best_config;
+    if (!autotuner.lookup(key, best_config) ||
+        !is_valid_config(best_config)) {
+      std::vector<int> k_splits_list = {1};
+      if (can_split_k) {
+        for (int splits : {2, 4}) {
+          if (Kc % splits == 0) {
+            k_splits_list.emplace_back(splits);
+          }
+        }
+      }
+      std::vector<long> kcb_list = {Kcb};
+      if (Kcb > 1) {
+        for (long kcb : {Kcb / 2, Kcb / 4}) {
+          if (kcb >= 1) {
+            kcb_list.emplace_back(kcb);
+          }
+        }
+      }
+      // Benchmark on a scratch output, in case y is aliased with the inputs
+      auto y_tune = at::empty_like(y);
+      double best_time = std::numeric_limits<double>::max();
+      for (auto splits : k_splits_list) {
+        for (auto kcb : kcb_list) {
+          for (auto& loop_scheme : get_loop_schemes(splits)) {
+            WoqGemmConfig candidate = {loop_scheme, splits, kcb};
+            double time = std::numeric_limits<double>::max();
+            // The first run is warm up
+            for (int i = 0; i <= WOQ_GEMM_AUTOTUNE_ITERS; i++) {
+              auto start = std::chrono::steady_clock::now();
+              qlinear_woq_affine_impl<
+                  T,
+                  TComp,
+                  TGemmOut,
+                  Tout,
+                  TScale,
+                  TZero,
+                  quant_a_mode,
+                  quant_w_mode>(
+                  x,
+                  qw_packed,
+                  scales,
+                  b,
+                  y_tune,
+                  qw_type,
+                  k_splits,
+                  fusion_type,
+                  others_list,
+                  quant_block_k,
+                  zps,
+                  scales_a_ptr,
+                  zps_a_ptr,
+                  compensation,
+                  g_idx,
+                  x_perm,
+                  &candidate);
+              std::chrono::duration<double> elapsed =
+                  std::chrono::steady_clock::now() - start;
+              if (i > 0) {
+                time = std::min(time, elapsed.count());
+              }
+            }
+            if (time < best_time) {
+              best_time = time;
+              best_config = candidate;
+            }
+          }
+        }
+      }
+      autotuner.insert(key, best_config);
+    }
+    qlinear_woq_affine_impl<
+        T,
+        TComp,
+        TGemmOut,
+        Tout,
+        TScale,
+        TZero,
+        quant_a_mode,
+        quant_w_mode>(
+        x,
+        qw_packed,
+        scales,
+        b,
+        y,
+        qw_type,
+        k_splits,
+        fusion_type,
+        others_list,
+        quant_block_k,
+        zps,
+        scales_a_ptr,
+        zps_a_ptr,
+        compensation,
+        g_idx,
+        x_perm,
+        &best_config);
+    return;
+  }
+  if (config != nullptr) {
+    TLA_ASSERT(is_valid_config(*config), "WOQ: invalid GEMM config");
+    k_splits = config->k_splits;
+    Kcb = config->kcb;
+  }
   TLA_ASSERT(Kc % k_splits == 0, "Kc must be a multiple of k_splits");
   TLA_ASSERT(
       !(std::is_same<T, uint8_t>()) || (std::is_same<T, TComp>()),
       "T must be TComp if T is uint8_t");
 
-  bool no_x_buf = std::is_same<T, TComp>() || std::is_same<T, int8_t>();
+  bool no_x_buf =
+      (std::is_same<T, TComp>() || std::is_same<T, int8_t>()) &&
+      !x_perm.has_value();
   bool no_y_buf = std::is_same<T, TComp>() && std::is_same<Tout, TGemmOut>() &&
       k_splits == 1;
 
@@ -2860,16 +3110,6 @@ void qlinear_woq_affine_impl(
   auto ldy = N;
   auto ldc = (no_y_buf || k_splits > 1) ? ldy : Nb;
   auto str_a = no_x_buf == true ? Kb : BLOCK_M * Kb;
-  auto Kcb = Kc;
-  if (M < PARALLEL_M_THRESHOLD) {
-    Kcb = 1;
-  } else if (
-      is_4bit_flag || !std::is_same<T, TComp>() ||
-      std::is_same<TComp, uint8_t>()) {
-    Kcb = 1;
-  } else if (M >= PARALLEL_M_THRESHOLD) {
-    Kcb = IPEX_KCB_BLOCK_SIZE;
-  }
   auto px = GetVLAPtr<T>(x, {Kc, Kb});
   auto pw = GetVLAPtr<uint8_t>(
       (uint8_t*)qw_packed.data_ptr(),
@@ -2898,6 +3138,20 @@ void qlinear_woq_affine_impl(
       : /*[Nc, Kc, Nb]*/
       GetVLAPtr<int32_t>(nullptr, {1, 1});
   auto g_idx_ptr = g_idx.has_value() ? g_idx.value().data_ptr<int>() : nullptr;
+  // With x_perm, A panels are gathered per thread into x_panel
+  // [num_threads, Kc, BLOCK_M, Kb]. x_panel_m records the row block held by
+  // each thread, so the panel is only gathered again when M moves on.
+  auto x_perm_ptr =
+      x_perm.has_value() ? x_perm.value().data_ptr<int32_t>() : nullptr;
+  TComp* x_panel = nullptr;
+  std::vector<long> x_panel_m;
+  if (x_perm.has_value()) {
+    auto num_threads = omp_get_max_threads();
+    x_panel = (TComp*)std::aligned_alloc(
+        64, num_threads * BLOCK_M * K * sizeof(TComp));
+    x_panel_m.resize(num_threads, -1);
+  }
+  auto px_panel = GetVLAPtr<TComp>(x_panel, {Kc, BLOCK_M, Kb});
 
   auto copy_bias_out_tpp = CpyBiasTPP<TGemmOut>(BLOCK_M, Nb, ldy);
   auto copy_bias_buf_tpp = CpyBiasTPP<TGemmOut>(BLOCK_M, Nb, Nb);
@@ -3082,6 +3336,58 @@ void qlinear_woq_affine_impl(
                 ? nullptr
                 : std::make_shared<ConvertTPP<T, TComp>>(
                       BLOCK_M_rem, Kb, K, Kb);
+            auto pcvt_x_panel_tpp =
+                !x_perm.has_value() || std::is_same<T, TComp>()
+                ? nullptr
+                : std::make_shared<ConvertTPP<T, TComp>>(BLOCK_M, Kb, Kb, Kb);
+            auto pcvt_x_panel_rem_tpp =
+                !x_perm.has_value() || std::is_same<T, TComp>()
+                ? nullptr
+                : std::make_shared<ConvertTPP<T, TComp>>(
+                      BLOCK_M_rem, Kb, Kb, Kb);
+            // Returns the A panel of (m, kc) through x_perm, gathering the
+            // row block m into the panel of this thread on first use.
+            auto get_x_panel = [&](int m, int kc) -> TComp* {
+              int my_id = omp_get_thread_num();
+              if constexpr (!std::is_same<TComp, uint8_t>()) {
+                if (x_panel_m[my_id] != m) {
+                  bool is_rem = (m + BLOCK_M > M);
+                  long block_m = is_rem ? BLOCK_M_rem : BLOCK_M;
+                  for (int k = 0; k < Kc; k++) {
+                    if constexpr (std::is_same<T, TComp>()) {
+                      gather_x_panel<T>(
+                          px[m][0],
+                          x_perm_ptr + k * Kb,
+                          px_panel[my_id][k][0],
+                          block_m,
+                          Kb,
+                          K,
+                          Kb,
+                          m + block_m >= M);
+                    } else {
+                      alignas(64) T x_buf[BLOCK_M][Kb];
+                      gather_x_panel<T>(
+                          px[m][0],
+                          x_perm_ptr + k * Kb,
+                          x_buf[0],
+                          block_m,
+                          Kb,
+                          K,
+                          Kb,
+                          m + block_m >= M);
+                      if (!is_rem) {
+                        (*pcvt_x_panel_tpp)(x_buf[0], px_panel[my_id][k][0]);
+                      } else {
+                        (*pcvt_x_panel_rem_tpp)(
+                            x_buf[0], px_panel[my_id][k][0]);
+                      }
+                    }
+                  }
+                  x_panel_m[my_id] = m;
+                }
+              }
+              return px_panel[my_id][kc][0];
+            };
             auto cvt_y_tpp = ConvertTPP<TGemmOut, Tout>(BLOCK_M, Nb, Nb, ldy);
             auto cvt_y_rem_tpp =
                 ConvertTPP<TGemmOut, Tout>(BLOCK_M_rem, Nb, Nb, ldy);
@@ -3102,7 +3408,10 @@ void qlinear_woq_affine_impl(
 
             // TODO(jgong5): parallelize over M on large BS
             if (no_y_buf) {
-              auto loop_scheme = M >= PARALLEL_M_THRESHOLD ? "ACb" : "aCb";
+              std::string loop_scheme = config != nullptr
+                  ? config->loop_scheme
+                  : M >= PARALLEL_M_THRESHOLD ? "ACb"
+                                              : "aCb";
               auto gemm_loop = ThreadedLoop<3>(
                   {{0, M, BLOCK_M, false}, {0, Kc, Kcb, false}, {Nc}},
                   loop_scheme);
@@ -3174,7 +3483,9 @@ void qlinear_woq_affine_impl(
                           zero_out_tpp(y_ptr);
                         }
                       }
-                      TComp* x_ptr = (TComp*)px[m][kc];
+                      TComp* x_ptr = x_perm.has_value()
+                          ? get_x_panel(m, kc)
+                          : (TComp*)px[m][kc];
                       if (kc < Kc - 1) {
                         if constexpr (no_dequant_w) {
                           RUN_NO_DEQUANT_GEMM_TPP(
@@ -3202,7 +3513,9 @@ void qlinear_woq_affine_impl(
                           zero_out_rem_tpp(y_ptr);
                         }
                       }
-                      TComp* x_ptr = (TComp*)px[m][kc];
+                      TComp* x_ptr = x_perm.has_value()
+                          ? get_x_panel(m, kc)
+                          : (TComp*)px[m][kc];
                       if (kc < Kc - 1) {
                         if constexpr (no_dequant_w) {
                           RUN_NO_DEQUANT_GEMM_TPP(
@@ -3268,8 +3581,11 @@ void qlinear_woq_affine_impl(
                   getenv("IPEX_WOQ_GEMM_LOOP_SCHEME")
                   ? getenv("IPEX_WOQ_GEMM_LOOP_SCHEME")
                   : "CAB";
-              auto loop_scheme =
-                  M >= PARALLEL_M_THRESHOLD ? SCHEME_LARGE_M : "ABc";
+              std::string loop_scheme = config != nullptr
+                  ? config->loop_scheme
+                  : M >= PARALLEL_M_THRESHOLD ? SCHEME_LARGE_M
+                  : x_perm.has_value()        ? "cAB"
+                                              : "ABc";
               auto gemm_loop = ThreadedLoop<3>(
                   {{Nc}, {0, Kc, Kc / k_splits, true}, {0, M, BLOCK_M, false}},
                   loop_scheme);
@@ -3367,7 +3683,9 @@ void qlinear_woq_affine_impl(
                       }
                       if (!is_rem) {
                         alignas(64) TComp x_buf[count][BLOCK_M][Kb];
-                        if (!no_x_buf) {
+                        if (x_perm.has_value()) {
+                          x_ptr = get_x_panel(m, kc);
+                        } else if (!no_x_buf) {
                           for (int cnt = 0; cnt < count; cnt++) {
                             (*pcvt_x_tpp)(px[m][kc + cnt], x_buf[cnt][0]);
                           }
@@ -3405,7 +3723,9 @@ void qlinear_woq_affine_impl(
                         }
                       } else {
                         alignas(64) TComp x_buf[count][BLOCK_M][Kb];
-                        if (!no_x_buf) {
+                        if (x_perm.has_value()) {
+                          x_ptr = get_x_panel(m, kc);
+                        } else if (!no_x_buf) {
                           for (int cnt = 0; cnt < count; cnt++) {
                             (*pcvt_x_rem_tpp)(px[m][kc + cnt], x_buf[cnt][0]);
                           }
@@ -3506,6 +3826,7 @@ void qlinear_woq_affine_impl(
             }
           },
           [](auto tuple) { failing_fallback(); });
+  std::free(x_panel);
 }
 
 static at::Tensor woq_gemm_ref_impl(
@@ -3520,7 +3841,25 @@ static at::Tensor woq_gemm_ref_impl(
     const TensorList& others_list,
     int64_t quant_w_mode = 0,
     int64_t quant_block_k = 0,
-    const c10::optional<at::Tensor>& g_idx = c10::nullopt) {
+    const c10::optional<at::Tensor>& g_idx = c10::nullopt,
+    const c10::optional<at::Tensor>& x_perm = c10::nullopt) {
+  if (x_perm.has_value()) {
+    // Input channels of the weight are shuffled by x_perm. As a reference,
+    // simply gather the whole x up front.
+    return woq_gemm_ref_impl(
+        x.index_select(-1, x_perm.value()),
+        qw,
+        scales_list,
+        zp_list,
+        bias_list,
+        qw_type,
+        compute_dtype,
+        fusion_type,
+        others_list,
+        quant_w_mode,
+        quant_block_k,
+        g_idx);
+  }
   constexpr size_t fp32_idx = 0, fp16_idx = 1, bf16_idx = 2, int8_idx = 3;
   auto biases = bias_list.empty()
       ? TensorList({at::Tensor(), at::Tensor(), at::Tensor()})
@@ -0,0 +1,66 @@
+#include "woq_autotune.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace torch_ipex {
+namespace cpu {
+
+WoqGemmAutotuner::WoqGemmAutotuner() {
+  const char* cache_path = std::getenv("IPEX_WOQ_GEMM_AUTOTUNE_CACHE");
+  if (cache_path == nullptr) {
+    return;
+  }
+  this->cache_path_ = cache_path;
+  // Each line is "<key> <loop_scheme> <k_splits> <kcb>", the later lines
+  // override the earlier ones.
+  std::ifstream file(this->cache_path_);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream ss(line);
+    std::string key;
+    WoqGemmConfig config;
+    if (ss >> key >> config.loop_scheme >> config.k_splits >> config.kcb) {
+      this->configs_[key] = config;
+    }
+  }
+}
+
+WoqGemmAutotuner& WoqGemmAutotuner::get_instance() {
+  static WoqGemmAutotuner autotuner;
+  return autotuner;
+}
+
+bool WoqGemmAutotuner::is_enabled() {
+  static bool enabled = [] {
+    const char* env = std::getenv("IPEX_WOQ_GEMM_AUTOTUNE");
+    return env != nullptr && std::atoi(env) > 0;
+  }();
+  return enabled;
+}
+
+bool WoqGemmAutotuner::lookup(const std::string& key, WoqGemmConfig& config) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  auto it = this->configs_.find(key);
+  if (it == this->configs_.end()) {
+    return false;
+  }
+  config = it->second;
+  return true;
+}
+
+void WoqGemmAutotuner::insert(
+    const std::string& key,
+    const WoqGemmConfig& config) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  this->configs_[key] = config;
+  if (!this->cache_path_.empty()) {
+    std::ofstream file(this->cache_path_, std::ios::app);
+    file << key << " " << config.loop_scheme << " " << config.k_splits << " "
+         << config.kcb << "\n";
+  }
+}
+
+} // namespace cpu
+} // namespace torch_ipex
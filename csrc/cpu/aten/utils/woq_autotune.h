@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace torch_ipex {
+namespace cpu {
+
+// Number of the timed runs of each candidate config
+constexpr int WOQ_GEMM_AUTOTUNE_ITERS = 3;
+
+// Loop scheme, K splits and K blocks per brgemm call of the WOQ GEMM
+struct WoqGemmConfig {
+  std::string loop_scheme;
+  int k_splits;
+  long kcb;
+};
+
+// M of the WOQ GEMM is bucketed by the power of 2 for the autotuner, except
+// the small M which decides if K can be split.
+inline long get_woq_gemm_m_bucket(long M) {
+  if (M < 32) {
+    return M;
+  }
+  long bucket = 32;
+  while (bucket * 2 <= M) {
+    bucket *= 2;
+  }
+  return bucket;
+}
+
+/*WoqGemmAutotuner caches the fastest WoqGemmConfig of each WOQ GEMM problem,
+ * which is benchmarked by qlinear_woq_affine_impl on the first encounter. The
+ * problem key includes the ISA level and the OpenMP thread count.
+ * It is enabled by IPEX_WOQ_GEMM_AUTOTUNE=1. If IPEX_WOQ_GEMM_AUTOTUNE_CACHE
+ * is set, the configs are loaded from and appended to that file.*/
+class WoqGemmAutotuner {
+ public:
+  static WoqGemmAutotuner& get_instance();
+  static bool is_enabled();
+
+  bool lookup(const std::string& key, WoqGemmConfig& config);
+  void insert(const std::string& key, const WoqGemmConfig& config);
+
+ private:
+  WoqGemmAutotuner();
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, WoqGemmConfig> configs_;
+  std::string cache_path_;
+
+  WoqGemmAutotuner(const WoqGemmAutotuner& autotuner) = delete;
+  WoqGemmAutotuner& operator=(const WoqGemmAutotuner& autotuner) = delete;
+};
+
+} // namespace cpu
+} // namespace torch_ipex
@@ -50,6 +50,9 @@
 #define PLAIN_WEIGHT_FORMAT 0
 #define GPTQ_WEIGHT_FORMAT 1
 #define AWQ_WEIGHT_FORMAT 2
+// Weight already packed by a WOQ linear op context, e.g., loaded from the
+// packed weight cache, it is used as is
+#define PACKED_WEIGHT_FORMAT 3
 
 constexpr bool is_asymmetric_quant_a(const int quant_a_mode) {
   return quant_a_mode <= QUANT_A_PER_M_K_BLOCK;
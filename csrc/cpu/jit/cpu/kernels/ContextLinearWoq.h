@@ -31,6 +31,12 @@ struct ContextLinearWoq final {
   // Compensation = Σ(k)(W[k][n] - ZP[n]) for each block.
   c10::optional<at::Tensor> cached_compensation_ = c10::nullopt;
   bool handle_g_idx_in_kernel_ = false;
+  // For GPTQ with act-order, input channels of the weight are shuffled by
+  // g_idx at pack time. The k-th input channel of the packed weight is the
+  // input_channel_perm_[k]-th channel of input. The floating point GEMM
+  // gathers it per A panel, while lowp-mode INT8 gathers the input before
+  // quantizing it.
+  c10::optional<at::Tensor> input_channel_perm_ = c10::nullopt;
 
   ContextLinearWoq() = delete;
 
@@ -1,6 +1,7 @@
 #ifdef USE_LIBXSMM
 #include "LinearWoqPacked.h"
 #include <ideep.hpp>
+#include "WoqWeightCache.h"
 #include "aten/Linear.h"
 #include "aten/WeightPack.h"
 #include "aten/utils/woq_utils.h"
@@ -201,6 +202,50 @@ c10::intrusive_ptr<WoqLinearOpContext> createWoqLinearPrePackOpContextInt4(
       weight_format);
 }
 
+c10::intrusive_ptr<WoqLinearOpContext>
+createWoqLinearPrePackOpContextFromPacked(
+    at::Tensor&& weight,
+    int64_t weight_dtype,
+    std::vector<int64_t>&& weight_shape,
+    at::Tensor&& scales,
+    c10::optional<at::Tensor>&& zero_points,
+    c10::optional<at::Tensor>&& bias,
+    c10::optional<at::Tensor>&& g_idx,
+    c10::optional<at::Tensor>&& compensation,
+    c10::optional<int64_t> batch_size,
+    int64_t group_size,
+    int64_t lowp_mode,
+    int64_t act_quant_mode,
+    bool cache_weight_for_large_batch) {
+  RECORD_FUNCTION(
+      "ipex_prepack::createWoqLinearPrePackOpContextFromPacked",
+      c10::ArrayRef<c10::IValue>({}));
+  bool need_compensation =
+      weight_dtype == WOQ_DTYPE_INT8 && lowp_mode == LOWP_MODE_INT8;
+  TORCH_CHECK(
+      !need_compensation ||
+          (compensation.has_value() && compensation.value().defined()),
+      "IPEX WOQ: compensation is required for INT8 weight and lowp_mode INT8");
+  auto op_context = IpexWoqLinearOpContext::create_context(
+      std::move(weight),
+      weight_dtype,
+      std::move(weight_shape),
+      std::move(scales),
+      std::move(zero_points),
+      std::move(bias),
+      std::move(g_idx),
+      batch_size,
+      group_size,
+      lowp_mode,
+      act_quant_mode,
+      cache_weight_for_large_batch,
+      PACKED_WEIGHT_FORMAT);
+  if (need_compensation) {
+    op_context->get_context().cached_compensation_ = std::move(compensation);
+  }
+  return op_context;
+}
+
 static const std::map<c10::string_view, int64_t> WOQ_DTYPE_MAP = {
     {"int8", WOQ_DTYPE_INT8},
     {"int4", WOQ_DTYPE_INT4},
@@ -283,6 +328,27 @@ at::Tensor woq_linear_run(
   return op_context->run(input);
 }
 
+// Permutation of input channels made by woq_shuffle_tensor_by_group_idx, i.e.,
+// the k-th channel of the shuffled tensor is the perm[k]-th channel of the
+// original one.
+static at::Tensor _get_input_channel_perm(
+    const at::Tensor& g_idx,
+    int64_t group_size) {
+  auto g_idx_long = g_idx.to(c10::kLong).contiguous();
+  auto g_idx_data = g_idx_long.data_ptr<int64_t>();
+  int64_t K = g_idx_long.numel();
+  auto num_groups = (K + group_size - 1) / group_size;
+  std::vector<int64_t> counts_per_group(num_groups, 0);
+  auto perm = at::empty({K}, c10::kInt);
+  auto perm_data = perm.data_ptr<int32_t>();
+  for (int64_t j = 0; j < K; ++j) {
+    auto g = g_idx_data[j];
+    perm_data[g * group_size + counts_per_group[g]] = j;
+    ++counts_per_group[g];
+  }
+  return perm;
+}
+
 ContextLinearWoq create(
     at::Tensor& weight,
     int64_t weight_dtype,
@@ -305,7 +371,11 @@ ContextLinearWoq create(
   // GPTQ with act-order
   bool handle_g_idx_in_kernel = lowp_mode != LOWP_MODE_INT8 && group_size > 0 &&
       group_size * scales.size(1) != K;
-  if (is_4bit && group_size > 0 && g_idx.has_value() &&
+  if (weight_format == PACKED_WEIGHT_FORMAT) {
+    // Weight is already shuffled by g_idx and packed
+    packed_weight = weight;
+  } else if (
+      is_4bit && group_size > 0 && g_idx.has_value() &&
       !handle_g_idx_in_kernel) {
     TORCH_CHECK(
         K == g_idx.value().numel(),
@@ -391,7 +461,17 @@ ContextLinearWoq create(
         cache_weight_for_large_batch,
         handle_g_idx_in_kernel);
   }
-  if (weight_dtype == WOQ_DTYPE_INT8 && lowp_mode == LOWP_MODE_INT8) {
+  // GPTQ with act-order
+  // Weight is shuffled along ic, so input channels of x are gathered through
+  // the permutation by the GEMM, one A panel per thread and row block
+  if (is_4bit && group_size > 0 && context_ptr->g_idx_.has_value() &&
+      !handle_g_idx_in_kernel) {
+    context_ptr->input_channel_perm_ = c10::make_optional(
+        _get_input_channel_perm(context_ptr->g_idx_.value(), group_size));
+  }
+  // Compensation of the packed weight is restored by the caller
+  if (weight_dtype == WOQ_DTYPE_INT8 && lowp_mode == LOWP_MODE_INT8 &&
+      weight_format != PACKED_WEIGHT_FORMAT) {
     auto padded_weight = weight;
     if (oc_is_padded) {
       padded_weight = at::pad(weight, {0, 0, 0, padded_N - N}, "constant", 0);
@@ -404,43 +484,51 @@ ContextLinearWoq create(
   return std::move(*context_ptr);
 }
 
-static at::Tensor _shuffle_input_channels_if_needed(
-    ContextLinearWoq& context,
-    const at::Tensor& input) {
-  // GPTQ with act-order
-  // Shuffle input channels to align with weight
-  if (context.is_4bit_ && context.group_size_ > 0 &&
-      context.g_idx_.has_value() && !context.handle_g_idx_in_kernel_) {
-    auto& g_idx = context.g_idx_.value();
-    auto K = input.size(-1);
-    std::vector<int64_t> input_shape = {input.numel() / K, K};
-    return woq_shuffle_tensor_by_group_idx</* is_4bit */ false>(
-        input, input_shape, g_idx, context.group_size_);
+IPEX_DEFINE_DISPATCH(woq_dequant_int4_to_int8_packed_stub);
+// Bytes of the dequantized weight for large batch, 0 if not supported
+static int64_t _get_dequantized_weight_bytes(const ContextLinearWoq& context) {
+  if (context.lowp_mode_ == 2) {
+    // Requres g_idx disabled, and N/K divisible by block size
+    auto N = context.weight_shape_[0];
+    auto K = context.weight_shape_[1];
+    bool supported = !context.g_idx_.has_value() && K % 64 == 0 &&
+        (N % 100 == 0 || N % 64 == 0);
+    return supported ? N * K * sizeof(at::BFloat16) : 0;
+  } else if (context.lowp_mode_ == 3) {
+    // You don't have to cache extra INT8 weight for lowp-mode INT8
+    // Because you compute with INT8 weight directly
+    if (context.at_weight_.dim() != 4 ||
+        context.weight_dtype_ == WOQ_DTYPE_INT8)
+      return 0;
+    auto w_sizes = context.at_weight_.sizes();
+    auto Nc = w_sizes[0];
+    auto Kc = w_sizes[1];
+    auto Kb = w_sizes[2];
+    auto Nb = w_sizes[3] * 2;
+    // INT8 weight and INT32 compensation
+    return Nc * Kc * Kb * Nb + Nc * Kc * Nb * sizeof(int32_t);
   }
-  return input;
+  return 0;
 }
 
-IPEX_DEFINE_DISPATCH(woq_dequant_int4_to_int8_packed_stub);
-// Dequantize WOQ Linear weight and cache it in context
+// Dequantize WOQ Linear weight for large batch
 // Lowp_mode != 3:
 //     Unpack weight to plain format, dequantize it, then repack it to
 //     blocked format for BF16 computation.
 // Lowp_mode == 3:
 //     Dequantize weight to INT8 and compute compensation.
-static void _dequant_weight_and_cache_in_context(ContextLinearWoq& context) {
+static WoqDequantizedWeight _dequant_weight(ContextLinearWoq& context) {
+  if (_get_dequantized_weight_bytes(context) == 0) {
+    return WoqDequantizedWeight();
+  }
   int64_t quant_w_mode = context.group_size_ > 0
       ? (context.zero_points_list_[0].defined() ? QUANT_W_PER_K_BLOCK
                                                 : QUANT_W_PER_K_BLOCK_SYM)
       : (context.zero_points_list_[0].defined() ? QUANT_W_PER_CHANNEL
                                                 : QUANT_W_PER_CHANNEL_SYM);
   if (context.lowp_mode_ == 2) {
-    // Requres g_idx disabled, and N/K divisible by block size
     auto N = context.weight_shape_[0];
     auto K = context.weight_shape_[1];
-    bool supported = !context.g_idx_.has_value() && K % 64 == 0 &&
-        (N % 100 == 0 || N % 64 == 0);
-    if (!supported)
-      return;
     auto unpacked_weight = unpack(context, context.at_weight_);
     auto block_weight = [&](const at::Tensor& weight, int64_t Nb, int64_t Kb) {
       return weight.reshape({N / Nb, Nb, K / Kb, Kb / 2, 2})
@@ -475,15 +563,8 @@ static void _dequant_weight_and_cache_in_context(ContextLinearWoq& context) {
     auto new_weight = N % 100 == 0
         ? block_weight(dequant_weight, 100, 64).to(c10::kBFloat16)
         : block_weight(dequant_weight, 64, 64).to(c10::kBFloat16);
-    context.cached_weight_ =
-        c10::make_optional<at::Tensor>(std::move(new_weight));
-  } else if (context.lowp_mode_ == 3) {
-    if (context.at_weight_.dim() != 4)
-      return;
-    // You don't have to cache extra INT8 weight for lowp-mode INT8
-    // Because you compute with INT8 weight directly
-    if (context.weight_dtype_ == WOQ_DTYPE_INT8)
-      return;
+    return {std::move(new_weight), at::Tensor()};
+  } else {
     auto w_sizes = context.at_weight_.sizes();
     auto Nc = w_sizes[0];
     auto Kc = w_sizes[1];
@@ -499,39 +580,78 @@ static void _dequant_weight_and_cache_in_context(ContextLinearWoq& context) {
         context.group_size_,
         quant_w_mode,
         compensation);
+    return {std::move(new_weight), std::move(compensation)};
+  }
+}
 
-    context.cached_weight_ =
-        c10::make_optional<at::Tensor>(std::move(new_weight));
-    context.cached_compensation_ =
-        c10::make_optional<at::Tensor>(std::move(compensation));
+// Dequantize WOQ Linear weight and cache it in context
+static void _dequant_weight_and_cache_in_context(ContextLinearWoq& context) {
+  auto dequantized_weight = _dequant_weight(context);
+  if (!dequantized_weight.weight.defined()) {
+    return;
+  }
+  context.cached_weight_ =
+      c10::make_optional<at::Tensor>(std::move(dequantized_weight.weight));
+  if (dequantized_weight.compensation.defined()) {
+    context.cached_compensation_ = c10::make_optional<at::Tensor>(
+        std::move(dequantized_weight.compensation));
   }
 }
 
-at::Tensor run(ContextLinearWoq& context, const at::Tensor& input) {
+// Get the dequantized weight for large batch from the shared WoqWeightCache
+// if it is enabled, otherwise from the context if cache_weight_for_large_batch
+// is set. The weight is undefined if it is not available.
+static WoqDequantizedWeight _get_dequantized_weight(
+    ContextLinearWoq& context,
+    int64_t M) {
+  auto& weight_cache = WoqWeightCache::get_instance();
+  if (weight_cache.get_capacity() > 0) {
+    auto num_bytes = _get_dequantized_weight_bytes(context);
+    if (M < SMALL_BATCH_THRESHOLD || num_bytes == 0) {
+      return WoqDequantizedWeight();
+    }
+    return weight_cache.get(context.at_weight_, num_bytes, [&]() {
+      return _dequant_weight(context);
+    });
+  }
   if (context.cache_weight_for_large_batch_ &&
       !context.cached_weight_.has_value()) {
     _dequant_weight_and_cache_in_context(context);
   }
+  if (M < SMALL_BATCH_THRESHOLD || !context.cached_weight_.has_value() ||
+      !context.cached_weight_.value().defined()) {
+    return WoqDequantizedWeight();
+  }
+  auto compensation =
+      context.lowp_mode_ == 3 && context.cached_compensation_.has_value()
+      ? context.cached_compensation_.value()
+      : at::Tensor();
+  return {context.cached_weight_.value(), compensation};
+}
+
+at::Tensor run(ContextLinearWoq& context, const at::Tensor& input) {
   auto M = input.numel() > 0 ? input.numel() / input.size(-1) : 0;
+  auto dequantized_weight = _get_dequantized_weight(context, M);
   bool fast_path_lowp_mode_3 = false;
-  if (M >= SMALL_BATCH_THRESHOLD && context.cached_weight_.has_value() &&
-      context.cached_weight_.value().defined()) {
+  if (dequantized_weight.weight.defined()) {
     if (context.lowp_mode_ == 2) {
       auto input_reshaped = input.dim() == 2 ? input.unsqueeze(0) : input;
       auto out = tpp_linear_bias_forward_cpu(
           input_reshaped.to(c10::kBFloat16).contiguous(),
-          context.cached_weight_.value(),
+          dequantized_weight.weight,
           context.bias_list_[2],
           c10::nullopt);
       return input.dim() == 2 ? out.squeeze(0) : out;
     } else if (
-        context.lowp_mode_ == 3 && context.cached_compensation_.has_value() &&
-        context.cached_compensation_.value().defined()) {
+        context.lowp_mode_ == 3 && dequantized_weight.compensation.defined()) {
       fast_path_lowp_mode_3 = true;
     }
   }
-  bool use_cached_compensation = fast_path_lowp_mode_3 ||
-      (context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3);
+  auto compensation = fast_path_lowp_mode_3
+      ? c10::make_optional(dequantized_weight.compensation)
+      : context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3
+      ? context.cached_compensation_
+      : c10::nullopt;
   // TPP kernel packs weight to 4d (Nc, Kc, block_k, block_n)
   auto w_k = context.weight_shape_[1];
   TORCH_CHECK(
@@ -542,12 +662,9 @@ at::Tensor run(ContextLinearWoq& context, const at::Tensor& input) {
       w_k,
       " respectively.");
   auto input_ = input.contiguous();
-  // handle GPTQ with act-order
-  input_ = _shuffle_input_channels_if_needed(context, input_);
   auto res = woq_linear_kernel(
       input_,
-      fast_path_lowp_mode_3 ? context.cached_weight_.value()
-                            : context.at_weight_,
+      fast_path_lowp_mode_3 ? dequantized_weight.weight : context.at_weight_,
       context.weight_dtype_,
       context.scales_list_,
       context.zero_points_list_,
@@ -555,8 +672,9 @@ at::Tensor run(ContextLinearWoq& context, const at::Tensor& input) {
       context.group_size_,
       context.lowp_mode_,
       context.act_quant_mode_,
-      use_cached_compensation ? context.cached_compensation_ : c10::nullopt,
-      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt);
+      compensation,
+      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt,
+      context.input_channel_perm_);
   if (res.size(-1) != context.weight_shape_[0]) {
     int64_t N = context.weight_shape_[0];
     return at::narrow(res, /*dim*/ -1, /*start*/ 0, /*end*/ N);
@@ -571,28 +689,24 @@ at::Tensor run_unary(
     const c10::string_view& post_op,
     const torch::List<c10::optional<at::Scalar>>& scalars,
     const c10::optional<c10::string_view>& algorithm) {
-  if (context.cache_weight_for_large_batch_ &&
-      !context.cached_weight_.has_value()) {
-    _dequant_weight_and_cache_in_context(context);
-  }
   auto M = input.numel() > 0 ? input.numel() / input.size(-1) : 0;
+  auto dequantized_weight = _get_dequantized_weight(context, M);
   bool fast_path_lowp_mode_3 = false;
-  if (M >= SMALL_BATCH_THRESHOLD && context.cached_weight_.has_value() &&
-      context.cached_weight_.value().defined()) {
+  if (dequantized_weight.weight.defined()) {
     if (context.lowp_mode_ == 2) {
       auto input_reshaped = input.dim() == 2 ? input.unsqueeze(0) : input;
       if (post_op == "gelu") {
         if (algorithm == "none") {
           auto out = tpp_linear_gelu_forward_cpu(
               input_reshaped.to(c10::kBFloat16).contiguous(),
-              context.cached_weight_.value(),
+              dequantized_weight.weight,
               context.bias_list_[2],
               c10::nullopt);
           return input.dim() == 2 ? out.squeeze(0) : out;
         } else if (algorithm == "tanh") {
           auto out = tpp_linear_gelu_tanh_forward_cpu(
               input_reshaped.to(c10::kBFloat16).contiguous(),
-              context.cached_weight_.value(),
+              dequantized_weight.weight,
               context.bias_list_[2],
               c10::nullopt);
           return input.dim() == 2 ? out.squeeze(0) : out;
@@ -600,26 +714,28 @@ at::Tensor run_unary(
       } else if (post_op == "silu") {
         auto out = tpp_linear_silu_forward_cpu(
             input_reshaped.to(c10::kBFloat16).contiguous(),
-            context.cached_weight_.value(),
+            dequantized_weight.weight,
             context.bias_list_[2],
             c10::nullopt);
         return input.dim() == 2 ? out.squeeze(0) : out;
       } else if (post_op == "relu") {
         auto out = tpp_linear_relu_forward_cpu(
             input_reshaped.to(c10::kBFloat16).contiguous(),
-            context.cached_weight_.value(),
+            dequantized_weight.weight,
             context.bias_list_[2],
             c10::nullopt);
         return input.dim() == 2 ? out.squeeze(0) : out;
       }
     } else if (
-        context.lowp_mode_ == 3 && context.cached_compensation_.has_value() &&
-        context.cached_compensation_.value().defined()) {
+        context.lowp_mode_ == 3 && dequantized_weight.compensation.defined()) {
       fast_path_lowp_mode_3 = true;
     }
   }
-  bool use_cached_compensation = fast_path_lowp_mode_3 ||
-      (context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3);
+  auto compensation = fast_path_lowp_mode_3
+      ? c10::make_optional(dequantized_weight.compensation)
+      : context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3
+      ? context.cached_compensation_
+      : c10::nullopt;
   // TPP kernel packs weight to 4d (Nc, Kc, block_k, block_n)
   auto w_k = context.weight_shape_[1];
   TORCH_CHECK(
@@ -630,12 +746,9 @@ at::Tensor run_unary(
       w_k,
       " respectively.");
   auto input_ = input.contiguous();
-  // handle GPTQ with act-order
-  input_ = _shuffle_input_channels_if_needed(context, input_);
   auto res = woq_linear_unary_kernel(
       input_,
-      fast_path_lowp_mode_3 ? context.cached_weight_.value()
-                            : context.at_weight_,
+      fast_path_lowp_mode_3 ? dequantized_weight.weight : context.at_weight_,
       context.weight_dtype_,
       context.scales_list_,
       context.zero_points_list_,
@@ -646,8 +759,9 @@ at::Tensor run_unary(
       context.group_size_,
       context.lowp_mode_,
       context.act_quant_mode_,
-      use_cached_compensation ? context.cached_compensation_ : c10::nullopt,
-      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt);
+      compensation,
+      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt,
+      context.input_channel_perm_);
   if (res.size(-1) != context.weight_shape_[0]) {
     int64_t N = context.weight_shape_[0];
     return at::narrow(res, /*dim*/ -1, /*start*/ 0, /*end*/ N);
@@ -662,20 +776,16 @@ at::Tensor run_binary(
     const c10::string_view& post_op,
     const std::vector<at::Tensor>& others) {
   auto M = input.numel() > 0 ? input.numel() / input.size(-1) : 0;
-  if (context.cache_weight_for_large_batch_ &&
-      !context.cached_weight_.has_value()) {
-    _dequant_weight_and_cache_in_context(context);
-  }
+  auto dequantized_weight = _get_dequantized_weight(context, M);
   bool fast_path_lowp_mode_3 = false;
-  if (M >= SMALL_BATCH_THRESHOLD && context.cached_weight_.has_value() &&
-      context.cached_weight_.value().defined()) {
+  if (dequantized_weight.weight.defined()) {
     if (context.lowp_mode_ == 2) {
       auto input_reshaped = input.dim() == 2 ? input.unsqueeze(0) : input;
       if (post_op == "add") {
         auto out = tpp_linear_add_forward_cpu(
             input_reshaped.to(c10::kBFloat16).contiguous(),
             others[0],
-            context.cached_weight_.value(),
+            dequantized_weight.weight,
             context.bias_list_[2],
             1.0,
             c10::nullopt);
@@ -685,7 +795,7 @@ at::Tensor run_binary(
             input_reshaped.to(c10::kBFloat16),
             others[0],
             others[1],
-            context.cached_weight_.value(),
+            dequantized_weight.weight,
             context.bias_list_[2],
             1.0,
             c10::nullopt);
@@ -694,19 +804,21 @@ at::Tensor run_binary(
         auto out = tpp_linear_mul_forward_cpu(
             input_reshaped.to(c10::kBFloat16),
             others[0],
-            context.cached_weight_.value(),
+            dequantized_weight.weight,
             context.bias_list_[2],
             c10::nullopt);
         return input.dim() == 2 ? out.squeeze(0) : out;
       }
     } else if (
-        context.lowp_mode_ == 3 && context.cached_compensation_.has_value() &&
-        context.cached_compensation_.value().defined()) {
+        context.lowp_mode_ == 3 && dequantized_weight.compensation.defined()) {
       fast_path_lowp_mode_3 = true;
     }
   }
-  bool use_cached_compensation = fast_path_lowp_mode_3 ||
-      (context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3);
+  auto compensation = fast_path_lowp_mode_3
+      ? c10::make_optional(dequantized_weight.compensation)
+      : context.weight_dtype_ == WOQ_DTYPE_INT8 && context.lowp_mode_ == 3
+      ? context.cached_compensation_
+      : c10::nullopt;
   // TPP kernel packs weight to 4d (Nc, Kc, block_k, block_n)
   auto w_k = context.weight_shape_[1];
   TORCH_CHECK(
@@ -717,12 +829,9 @@ at::Tensor run_binary(
       w_k,
       " respectively.");
   auto input_ = input.contiguous();
-  // handle GPTQ with act-order
-  input_ = _shuffle_input_channels_if_needed(context, input_);
   auto res = woq_linear_binary_kernel(
       input_,
-      fast_path_lowp_mode_3 ? context.cached_weight_.value()
-                            : context.at_weight_,
+      fast_path_lowp_mode_3 ? dequantized_weight.weight : context.at_weight_,
       context.weight_dtype_,
       context.scales_list_,
       context.zero_points_list_,
@@ -732,8 +841,9 @@ at::Tensor run_binary(
       post_op,
       others,
       context.act_quant_mode_,
-      use_cached_compensation ? context.cached_compensation_ : c10::nullopt,
-      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt);
+      compensation,
+      context.handle_g_idx_in_kernel_ ? context.g_idx_ : c10::nullopt,
+      context.input_channel_perm_);
   if (res.size(-1) != context.weight_shape_[0]) {
     int64_t N = context.weight_shape_[0];
     return at::narrow(res, /*dim*/ -1, /*start*/ 0, /*end*/ N);
@@ -957,4 +1067,4 @@ at::Tensor woq_shuffle_weight_back_by_group_idx(
 } // namespace detail
 } // namespace cpu
 } // namespace torch_ipex
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -37,6 +37,25 @@ c10::intrusive_ptr<WoqLinearOpContext> createWoqLinearPrePackOpContextInt4(
     bool cache_weight_for_large_batch = false,
     int64_t weight_format = 0 /*plain format*/);
 
+// Create the context from the weight packed by another context, which skips
+// packing the weight. The compensation is required by INT8 weight with
+// lowp_mode INT8.
+c10::intrusive_ptr<WoqLinearOpContext>
+createWoqLinearPrePackOpContextFromPacked(
+    at::Tensor&& weight,
+    int64_t weight_dtype,
+    std::vector<int64_t>&& weight_shape,
+    at::Tensor&& scales,
+    c10::optional<at::Tensor>&& zero_points,
+    c10::optional<at::Tensor>&& bias,
+    c10::optional<at::Tensor>&& g_idx,
+    c10::optional<at::Tensor>&& compensation,
+    c10::optional<int64_t> batch_size,
+    int64_t group_size,
+    int64_t lowp_mode,
+    int64_t act_quant_mode,
+    bool cache_weight_for_large_batch = false);
+
 std::tuple<
     at::Tensor,
     std::vector<at::Tensor>,
@@ -115,4 +134,4 @@ at::Tensor woq_shuffle_weight_back_by_group_idx(
 } // namespace detail
 } // namespace cpu
 } // namespace torch_ipex
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "LinearMKLPacked.h"
 #include "LinearPacked.h"
 #include "LinearWoqPacked.h"
+#include "WoqWeightCache.h"
 
 namespace torch_ipex {
 namespace cpu {
@@ -504,6 +505,8 @@ at::Tensor IpexWoqLinearOpContext::pack(const at::Tensor& tensor) {
 void IpexWoqLinearOpContext::load_from_ctx(
     c10::intrusive_ptr<WoqLinearOpContext> other) {
   load_from_ctx_template(this, other);
+  detail::woq_linear::WoqWeightCache::get_instance().invalidate(
+      op_context_.at_weight_);
 }
 #endif
 } // namespace cpu
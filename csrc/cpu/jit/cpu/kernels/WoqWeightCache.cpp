@@ -0,0 +1,133 @@
+#include "WoqWeightCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace torch_ipex {
+namespace cpu {
+namespace detail {
+namespace woq_linear {
+
+WoqWeightCache::WoqWeightCache() {
+  const char* size_mb = std::getenv("IPEX_WOQ_WEIGHT_CACHE_SIZE_MB");
+  this->capacity_ =
+      size_mb == nullptr ? 0 : std::max<int64_t>(std::atoll(size_mb), 0) << 20;
+}
+
+WoqWeightCache& WoqWeightCache::get_instance() {
+  static WoqWeightCache cache;
+  return cache;
+}
+
+int64_t WoqWeightCache::get_capacity() const {
+  return this->capacity_;
+}
+
+void WoqWeightCache::release(Entry& entry) {
+  this->used_bytes_ -= entry.num_bytes;
+  entry.num_bytes = 0;
+  entry.dequantized_weight = WoqDequantizedWeight();
+}
+
+bool WoqWeightCache::reserve(Entry& entry, int64_t num_bytes) {
+  if (num_bytes > this->capacity_) {
+    return false;
+  }
+  // Drop the weights of the destroyed op contexts.
+  for (auto it = this->entries_.begin(); it != this->entries_.end();) {
+    if (it->second.owner.expired()) {
+      release(it->second);
+      it = this->entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  while (this->used_bytes_ + num_bytes > this->capacity_) {
+    Entry* victim = nullptr;
+    for (auto& it : this->entries_) {
+      auto& candidate = it.second;
+      if (candidate.num_bytes == 0) {
+        continue;
+      }
+      if (victim == nullptr || candidate.num_uses < victim->num_uses ||
+          (candidate.num_uses == victim->num_uses &&
+           candidate.last_use < victim->last_use)) {
+        victim = &candidate;
+      }
+    }
+    if (victim == nullptr || victim->num_uses >= entry.num_uses) {
+      return false;
+    }
+    release(*victim);
+    this->stats_.evictions++;
+  }
+  this->used_bytes_ += num_bytes;
+  entry.num_bytes = num_bytes;
+  return true;
+}
+
+WoqDequantizedWeight WoqWeightCache::get(
+    const at::Tensor& packed_weight,
+    int64_t num_bytes,
+    const std::function<WoqDequantizedWeight()>& dequant_fn) {
+  auto key = packed_weight.unsafeGetTensorImpl();
+  int64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto it = this->entries_.find(key);
+    if (it == this->entries_.end()) {
+      it = this->entries_.emplace(key, Entry(packed_weight)).first;
+    }
+    auto& entry = it->second;
+    entry.num_uses++;
+    entry.last_use = ++this->clock_;
+    if (entry.num_bytes > 0 && entry.dequantized_weight.weight.defined()) {
+      this->stats_.hits++;
+      return entry.dequantized_weight;
+    }
+    this->stats_.misses++;
+    if (entry.num_bytes == 0) {
+      if (!reserve(entry, num_bytes)) {
+        this->stats_.refusals++;
+        return WoqDequantizedWeight();
+      }
+      this->stats_.admissions++;
+    }
+    generation = entry.generation;
+  }
+  // Dequantize without the lock, the reservation may be evicted by other
+  // threads meanwhile, then the weight is used once without caching.
+  auto dequantized_weight = dequant_fn();
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  auto it = this->entries_.find(key);
+  if (it != this->entries_.end() && it->second.generation == generation &&
+      it->second.num_bytes > 0) {
+    if (dequantized_weight.weight.defined()) {
+      it->second.dequantized_weight = dequantized_weight;
+    } else {
+      release(it->second);
+    }
+  }
+  return dequantized_weight;
+}
+
+void WoqWeightCache::invalidate(const at::Tensor& packed_weight) {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  auto it = this->entries_.find(packed_weight.unsafeGetTensorImpl());
+  if (it != this->entries_.end()) {
+    release(it->second);
+    it->second.generation++;
+  }
+}
+
+WoqWeightCacheStats WoqWeightCache::get_stats() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  auto stats = this->stats_;
+  stats.used_bytes = this->used_bytes_;
+  return stats;
+}
+
+} // namespace woq_linear
+} // namespace detail
+} // namespace cpu
+} // namespace torch_ipex
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <ATen/Tensor.h>
+#include <c10/util/intrusive_ptr.h>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+namespace torch_ipex {
+namespace cpu {
+namespace detail {
+namespace woq_linear {
+
+// Dequantized weight of a WOQ linear for the large batch, and its
+// compensation for lowp_mode INT8
+struct WoqDequantizedWeight {
+  at::Tensor weight;
+  at::Tensor compensation;
+};
+
+// Counters of WoqWeightCache since the process starts
+struct WoqWeightCacheStats {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  // Misses whose weights are admitted to the cache
+  int64_t admissions = 0;
+  // Misses whose weights are not admitted, as they are larger than the budget
+  // or not used more often than the weights they would evict
+  int64_t refusals = 0;
+  int64_t evictions = 0;
+  int64_t used_bytes = 0;
+};
+
+/*WoqWeightCache is a process-wide cache of the dequantized weights shared by
+ * all the WOQ linear op contexts, bounded by IPEX_WOQ_WEIGHT_CACHE_SIZE_MB.
+ * Weights are keyed by their packed weight, evicted by the least use count
+ * and then the least recent use. A weight is only admitted if it is used more
+ * often than the weights it evicts, so the hot layers stay cached when all
+ * the layers are visited in turn and do not fit in the budget.*/
+class WoqWeightCache {
+ public:
+  static WoqWeightCache& get_instance();
+
+  // Budget in bytes, the cache is disabled if it is 0.
+  int64_t get_capacity() const;
+
+  // Get the dequantized weight of packed_weight, which is num_bytes large.
+  // On miss, it is created by dequant_fn if it can be admitted, otherwise
+  // an empty WoqDequantizedWeight is returned.
+  WoqDequantizedWeight get(
+      const at::Tensor& packed_weight,
+      int64_t num_bytes,
+      const std::function<WoqDequantizedWeight()>& dequant_fn);
+
+  // Drop the dequantized weight of packed_weight, which is updated in place,
+  // e.g., by load_from_ctx.
+  void invalidate(const at::Tensor& packed_weight);
+
+  WoqWeightCacheStats get_stats();
+
+ private:
+  struct Entry {
+    // Keeps the TensorImpl address of the packed weight from being reused.
+    c10::weak_intrusive_ptr<c10::TensorImpl, c10::UndefinedTensorImpl> owner;
+    // Bumped by invalidate, so a weight dequantized before it is not cached.
+    int64_t generation = 0;
+    WoqDequantizedWeight dequantized_weight;
+    // Bytes reserved for the dequantized weight, 0 if it is not cached.
+    int64_t num_bytes = 0;
+    int64_t num_uses = 0;
+    int64_t last_use = 0;
+
+    explicit Entry(const at::Tensor& packed_weight)
+        : owner(packed_weight.getIntrusivePtr()) {}
+  };
+
+  WoqWeightCache();
+  void release(Entry& entry);
+  bool reserve(Entry& entry, int64_t num_bytes);
+
+  int64_t capacity_;
+  int64_t used_bytes_ = 0;
+  int64_t clock_ = 0;
+  WoqWeightCacheStats stats_;
+  std::mutex mutex_;
+  std::unordered_map<c10::TensorImpl*, Entry> entries_;
+
+  WoqWeightCache(const WoqWeightCache& cache) = delete;
+  WoqWeightCache& operator=(const WoqWeightCache& cache) = delete;
+};
+
+} // namespace woq_linear
+} // namespace detail
+} // namespace cpu
+} // namespace torch_ipex
@@ -93,6 +93,16 @@ std::vector<int32_t> get_process_available_cores() {
   return torch_ipex::runtime::available_cpu_cores;
 }
 
+std::vector<std::vector<int32_t>> partition_process_available_cores(
+    int32_t num_instances,
+    bool include_smt_siblings) {
+  return partition_cpu_cores(
+      CPUTopology::get_cpu_topology(),
+      get_process_available_cores(),
+      num_instances,
+      include_smt_siblings);
+}
+
 // Init the available cores when process starts up
 std::vector<int32_t> init_process_available_cores() {
   std::vector<int32_t> available_cpu_cores_internal;
@@ -221,6 +231,7 @@ void _pin_cpu_cores(const torch_ipex::runtime::CPUPool& cpu_pool) {
         "Didn't preload IOMP before using the runtime API");
   }
 
+  bool numa_arena_enabled = cpu_pool.is_numa_arena_enabled();
   // Create the OMP thread pool and bind to cores of cpu_pools one by one
   omp_set_num_threads(cpu_core_list.size());
 #pragma omp parallel num_threads(cpu_core_list.size())
@@ -233,6 +244,11 @@ void _pin_cpu_cores(const torch_ipex::runtime::CPUPool& cpu_pool) {
     kmp_set_affinity_mask_proc_ext(phy_core_id, &mask);
     kmp_set_affinity_ext(&mask);
     kmp_destroy_affinity_mask_ext(&mask);
+    // set the NumaArena of the NUMA node where the thread is pinned
+    int32_t numa_node =
+        numa_arena_enabled ? get_numa_node_of_core(phy_core_id) : -1;
+    set_current_numa_arena(
+        numa_node >= 0 ? NumaArena::get_numa_arena(numa_node) : nullptr);
   }
   // Cache the cpu_core_list for query.
   current_cpu_core_list = cpu_core_list;
@@ -251,6 +267,7 @@ CPUPool get_cpu_pool_from_mask_affinity() {
   int max_number_threads = omp_get_max_threads();
   // init the vector<mask>
   std::vector<kmp_affinity_mask_t> threads_mask(max_number_threads);
+  std::vector<NumaArena*> thread_numa_arenas(max_number_threads);
 #pragma omp parallel
   {
     int thread_id = omp_get_thread_num();
@@ -258,8 +275,9 @@ CPUPool get_cpu_pool_from_mask_affinity() {
     kmp_create_affinity_mask_ext(&mask);
     kmp_get_affinity_ext(&mask);
     threads_mask[thread_id] = mask;
+    thread_numa_arenas[thread_id] = get_current_numa_arena();
   }
-  return CPUPool(std::move(threads_mask));
+  return CPUPool(std::move(threads_mask), std::move(thread_numa_arenas));
 }
 
 void set_mask_affinity_from_cpu_pool(const CPUPool& cpu_pool) {
@@ -269,6 +287,8 @@ void set_mask_affinity_from_cpu_pool(const CPUPool& cpu_pool) {
   }
   std::vector<kmp_affinity_mask_t> threads_mask =
       cpu_pool.get_cpu_affinity_mask();
+  const std::vector<NumaArena*>& thread_numa_arenas =
+      cpu_pool.get_thread_numa_arenas();
   omp_set_num_threads(threads_mask.size());
 #pragma omp parallel num_threads(threads_mask.size())
   {
@@ -276,15 +296,22 @@ void set_mask_affinity_from_cpu_pool(const CPUPool& cpu_pool) {
     int thread_id = omp_get_thread_num();
     kmp_affinity_mask_t mask = threads_mask[thread_id];
     kmp_set_affinity_ext(&mask);
+    // restore the NumaArena of this thread
+    set_current_numa_arena(
+        thread_id < thread_numa_arenas.size() ? thread_numa_arenas[thread_id]
+                                              : nullptr);
   }
 }
 
 CPUPool::CPUPool(const std::vector<int32_t>& cpu_core_list) {
   this->cpu_core_list = filter_cores_by_thread_affinity(cpu_core_list);
   this->cpu_core_list_initialized_ = true;
+  this->numa_nodes = get_numa_nodes_of_cores(this->cpu_core_list);
 }
 
-CPUPool::CPUPool(std::vector<kmp_affinity_mask_t>&& cpu_core_mask) {
+CPUPool::CPUPool(
+    std::vector<kmp_affinity_mask_t>&& cpu_core_mask,
+    std::vector<NumaArena*>&& thread_numa_arenas) {
   // Notice: We shouldn't load iomp symbol in sub_thread, otherwise race
   // condition happens.
   if (!is_runtime_ext_enabled()) {
@@ -293,6 +320,7 @@ CPUPool::CPUPool(std::vector<kmp_affinity_mask_t>&& cpu_core_mask) {
   }
   this->cpu_affinity_mask = cpu_core_mask;
   this->cpu_affinity_mask_initialized_ = true;
+  this->thread_numa_arenas = std::move(thread_numa_arenas);
 }
 
 CPUPool::CPUPool(CPUPool&& source_cpu_pool) {
@@ -305,11 +333,14 @@ CPUPool::CPUPool(CPUPool&& source_cpu_pool) {
     this->cpu_core_list = std::move(
         const_cast<std::vector<int32_t>&>(source_cpu_pool.get_cpu_core_list()));
     this->cpu_core_list_initialized_ = true;
+    this->numa_nodes = std::move(source_cpu_pool.numa_nodes);
+    this->numa_arena_enabled_ = source_cpu_pool.numa_arena_enabled_;
   } else {
     this->cpu_affinity_mask =
         std::move(const_cast<std::vector<kmp_affinity_mask_t>&>(
             source_cpu_pool.get_cpu_affinity_mask()));
     this->cpu_affinity_mask_initialized_ = true;
+    this->thread_numa_arenas = std::move(source_cpu_pool.thread_numa_arenas);
   }
 }
 
@@ -329,6 +360,30 @@ const std::vector<kmp_affinity_mask_t>& CPUPool::get_cpu_affinity_mask() const {
   return this->cpu_affinity_mask;
 }
 
+const std::vector<NumaArena*>& CPUPool::get_thread_numa_arenas() const {
+  return this->thread_numa_arenas;
+}
+
+const std::vector<int32_t>& CPUPool::get_numa_nodes() const {
+  return this->numa_nodes;
+}
+
+void CPUPool::enable_numa_arena() {
+  if (!this->cpu_core_list_initialized_) {
+    throw std::runtime_error(
+        "Fail to enable_numa_arena. Current CPUPool object didn't express as cpu_core_list format.");
+  }
+  if (this->numa_nodes.empty()) {
+    throw std::runtime_error(
+        "Fail to enable_numa_arena. Can't get the NUMA information of the cores in CPUPool.");
+  }
+  this->numa_arena_enabled_ = true;
+}
+
+bool CPUPool::is_numa_arena_enabled() const {
+  return this->numa_arena_enabled_;
+}
+
 bool CPUPool::is_cpu_core_list_initialized() const {
   return this->cpu_core_list_initialized_;
 }
@@ -7,6 +7,8 @@
 
 #include <Macros.h>
 #include <torch/csrc/jit/api/module.h>
+#include "CPUTopology.h"
+#include "NumaArena.h"
 
 namespace torch_ipex {
 namespace runtime {
@@ -22,13 +24,23 @@ typedef int (*kmp_get_affinity_max_proc_p)();
 class IPEX_API CPUPool {
  public:
   explicit CPUPool(const std::vector<int32_t>& cpu_core_list);
-  explicit CPUPool(std::vector<kmp_affinity_mask_t>&& cpu_core_mask);
+  // thread_numa_arenas is the NumaArena used by each thread of the mask.
+  explicit CPUPool(
+      std::vector<kmp_affinity_mask_t>&& cpu_core_mask,
+      std::vector<NumaArena*>&& thread_numa_arenas = {});
   CPUPool(CPUPool&& source_cpu_pool);
 
   const std::vector<int32_t>& get_cpu_core_list() const;
   const std::vector<kmp_affinity_mask_t>& get_cpu_affinity_mask() const;
+  const std::vector<NumaArena*>& get_thread_numa_arenas() const;
   bool is_cpu_core_list_initialized() const;
   bool is_cpu_affinity_mask_initialized() const;
+  // NUMA nodes of the cores in cpu_core_list, empty if not available.
+  const std::vector<int32_t>& get_numa_nodes() const;
+  // When enabled, the threads pinned to this CPUPool allocate the activations
+  // from the NumaArena of the NUMA node where its core located.
+  void enable_numa_arena();
+  bool is_numa_arena_enabled() const;
   ~CPUPool();
 
  private:
@@ -39,6 +51,10 @@ class IPEX_API CPUPool {
   bool cpu_core_list_initialized_{false};
   std::vector<kmp_affinity_mask_t> cpu_affinity_mask;
   bool cpu_affinity_mask_initialized_{false};
+  std::vector<NumaArena*> thread_numa_arenas;
+
+  std::vector<int32_t> numa_nodes;
+  bool numa_arena_enabled_{false};
 
   // Put deleted function into private.
   CPUPool() = delete;
@@ -51,6 +67,11 @@ class IPEX_API CPUPool {
 
 IPEX_API std::vector<int32_t> init_process_available_cores();
 IPEX_API std::vector<int32_t> get_process_available_cores();
+// Partition the cores available for current process into num_instances core
+// lists with the CPU topology, see partition_cpu_cores.
+IPEX_API std::vector<std::vector<int32_t>> partition_process_available_cores(
+    int32_t num_instances,
+    bool include_smt_siblings = false);
 IPEX_API std::vector<int32_t> filter_cores_by_thread_affinity(
     const std::vector<int32_t>& cpu_core_list);
 bool do_load_iomp_symbol();
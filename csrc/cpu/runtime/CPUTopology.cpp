@@ -0,0 +1,350 @@
+#include "CPUTopology.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+namespace torch_ipex {
+namespace runtime {
+
+namespace {
+// Max number of cache index directories to look for the L3 cache.
+constexpr int32_t MAX_CACHE_INDEX = 16;
+
+bool read_first_line(const std::string& path, std::string& line) {
+  std::ifstream file(path);
+  return static_cast<bool>(std::getline(file, line));
+}
+
+int32_t read_int(const std::string& path, int32_t default_value) {
+  std::string line;
+  if (!read_first_line(path, line) || line.empty()) {
+    return default_value;
+  }
+  return std::stoi(line);
+}
+
+// Smallest cpu id of the cpu list file, or default_value if not available.
+int32_t read_first_cpu(const std::string& path, int32_t default_value) {
+  std::string line;
+  if (!read_first_line(path, line)) {
+    return default_value;
+  }
+  auto cpus = parse_cpu_list(line);
+  return cpus.empty() ? default_value
+                      : *std::min_element(cpus.begin(), cpus.end());
+}
+
+std::unordered_map<int32_t, int32_t> read_cpu_to_numa_node(
+    const std::string& node_root) {
+  std::unordered_map<int32_t, int32_t> cpu_to_node;
+#ifndef _WIN32
+  DIR* dir = opendir(node_root.c_str());
+  if (dir == nullptr) {
+    return cpu_to_node;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name.rfind("node", 0) != 0 || name.size() <= 4 ||
+        !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+      continue;
+    }
+    int32_t node = std::stoi(name.substr(4));
+    std::string cpu_list;
+    if (!read_first_line(node_root + "/" + name + "/cpulist", cpu_list)) {
+      continue;
+    }
+    for (auto cpu : parse_cpu_list(cpu_list)) {
+      cpu_to_node[cpu] = node;
+    }
+  }
+  closedir(dir);
+#endif
+  return cpu_to_node;
+}
+
+// Split units into num_parts contiguous parts, the first
+// (size % num_parts) parts get one more unit.
+template <typename T>
+std::vector<std::vector<T>> split_evenly(
+    const std::vector<T>& units,
+    int32_t num_parts) {
+  std::vector<std::vector<T>> parts(num_parts);
+  int32_t base = units.size() / num_parts;
+  int32_t remainder = units.size() % num_parts;
+  int32_t offset = 0;
+  for (int32_t i = 0; i < num_parts; i++) {
+    int32_t part_size = base + (i < remainder ? 1 : 0);
+    parts[i].assign(
+        units.begin() + offset, units.begin() + offset + part_size);
+    offset += part_size;
+  }
+  return parts;
+}
+} // namespace
+
+std::vector<int32_t> parse_cpu_list(const std::string& cpu_list) {
+  std::vector<int32_t> cpus;
+  std::stringstream ss(cpu_list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    range.erase(
+        std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+    if (range.empty()) {
+      continue;
+    }
+    auto dash = range.find('-');
+    int32_t start = std::stoi(range.substr(0, dash));
+    int32_t end =
+        dash == std::string::npos ? start : std::stoi(range.substr(dash + 1));
+    for (int32_t cpu = start; cpu <= end; cpu++) {
+      cpus.emplace_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+CPUTopology::CPUTopology(const std::string& sysfs_root) {
+  std::string online;
+  if (!read_first_line(sysfs_root + "/cpu/online", online)) {
+    // Topology is not available, such as on Windows.
+    return;
+  }
+  auto cpu_to_numa_node = read_cpu_to_numa_node(sysfs_root + "/node");
+  std::set<int32_t> sockets, numa_nodes, l3_domains;
+  for (auto cpu : parse_cpu_list(online)) {
+    std::string cpu_root = sysfs_root + "/cpu/cpu" + std::to_string(cpu);
+    CPUCoreInfo core_info;
+    core_info.cpu_id = cpu;
+    core_info.socket_id =
+        read_int(cpu_root + "/topology/physical_package_id", 0);
+    auto numa_node = cpu_to_numa_node.find(cpu);
+    core_info.numa_node_id =
+        numa_node == cpu_to_numa_node.end() ? -1 : numa_node->second;
+    core_info.physical_core_id =
+        read_first_cpu(cpu_root + "/topology/thread_siblings_list", cpu);
+    core_info.is_smt_sibling = core_info.physical_core_id != cpu;
+    core_info.l3_domain_id = -1;
+    for (int32_t index = 0; index < MAX_CACHE_INDEX; index++) {
+      std::string cache_root =
+          cpu_root + "/cache/index" + std::to_string(index);
+      int32_t level = read_int(cache_root + "/level", -1);
+      if (level == 3) {
+        core_info.l3_domain_id =
+            read_first_cpu(cache_root + "/shared_cpu_list", -1);
+        break;
+      }
+    }
+
+    sockets.insert(core_info.socket_id);
+    if (core_info.numa_node_id >= 0) {
+      numa_nodes.insert(core_info.numa_node_id);
+    }
+    if (core_info.l3_domain_id >= 0) {
+      l3_domains.insert(core_info.l3_domain_id);
+    }
+    this->cores.emplace_back(core_info);
+  }
+  std::sort(
+      this->cores.begin(),
+      this->cores.end(),
+      [](const CPUCoreInfo& a, const CPUCoreInfo& b) {
+        return a.cpu_id < b.cpu_id;
+      });
+  this->num_sockets = sockets.size();
+  this->num_numa_nodes = numa_nodes.size();
+  this->num_l3_domains = l3_domains.size();
+}
+
+const CPUTopology& CPUTopology::get_cpu_topology() {
+  static CPUTopology cpu_topology;
+  return cpu_topology;
+}
+
+const std::vector<CPUCoreInfo>& CPUTopology::get_cores() const {
+  return this->cores;
+}
+
+const CPUCoreInfo* CPUTopology::get_core(int32_t cpu_id) const {
+  auto it = std::lower_bound(
+      this->cores.begin(),
+      this->cores.end(),
+      cpu_id,
+      [](const CPUCoreInfo& core, int32_t id) { return core.cpu_id < id; });
+  if (it == this->cores.end() || it->cpu_id != cpu_id) {
+    return nullptr;
+  }
+  return &(*it);
+}
+
+int32_t CPUTopology::get_num_sockets() const {
+  return this->num_sockets;
+}
+
+int32_t CPUTopology::get_num_numa_nodes() const {
+  return this->num_numa_nodes;
+}
+
+int32_t CPUTopology::get_num_l3_domains() const {
+  return this->num_l3_domains;
+}
+
+int32_t get_numa_node_of_core(int32_t core_id) {
+  const CPUCoreInfo* core_info =
+      CPUTopology::get_cpu_topology().get_core(core_id);
+  return core_info == nullptr ? -1 : core_info->numa_node_id;
+}
+
+std::vector<int32_t> get_numa_nodes_of_cores(
+    const std::vector<int32_t>& cpu_core_list) {
+  std::vector<int32_t> numa_nodes;
+  for (auto core : cpu_core_list) {
+    int32_t numa_node = get_numa_node_of_core(core);
+    if (numa_node < 0) {
+      // NUMA information is not complete.
+      return {};
+    }
+    if (std::find(numa_nodes.begin(), numa_nodes.end(), numa_node) ==
+        numa_nodes.end()) {
+      numa_nodes.emplace_back(numa_node);
+    }
+  }
+  std::sort(numa_nodes.begin(), numa_nodes.end());
+  return numa_nodes;
+}
+
+std::vector<std::vector<int32_t>> partition_cpu_cores(
+    const CPUTopology& cpu_topology,
+    const std::vector<int32_t>& available_cores,
+    int32_t num_instances,
+    bool include_smt_siblings) {
+  if (num_instances < 1) {
+    throw std::runtime_error(
+        "Fail to partition cpu cores. num_instances should be positive.");
+  }
+  // Step1: Group the physical cores by (socket, NUMA node, L3 domain). The
+  // unit of partition is a physical core with its usable SMT siblings, so
+  // that the siblings always stay in the same instance.
+  typedef std::vector<int32_t> PhysicalCore;
+  std::map<std::tuple<int32_t, int32_t, int32_t>, std::map<int32_t, PhysicalCore>>
+      domains;
+  for (auto core : available_cores) {
+    const CPUCoreInfo* core_info = cpu_topology.get_core(core);
+    if (core_info == nullptr) {
+      continue;
+    }
+    if (core_info->is_smt_sibling && !include_smt_siblings) {
+      continue;
+    }
+    auto domain_key = std::make_tuple(
+        core_info->socket_id,
+        core_info->numa_node_id,
+        core_info->l3_domain_id);
+    domains[domain_key][core_info->physical_core_id].emplace_back(core);
+  }
+  std::vector<std::vector<PhysicalCore>> domain_units;
+  int64_t total_units = 0;
+  for (auto& domain : domains) {
+    std::vector<PhysicalCore> units;
+    for (auto& physical_core : domain.second) {
+      units.emplace_back(physical_core.second);
+    }
+    total_units += units.size();
+    domain_units.emplace_back(std::move(units));
+  }
+  if (num_instances > total_units) {
+    throw std::runtime_error(
+        "Fail to partition cpu cores. num_instances " +
+        std::to_string(num_instances) + " is larger than the number of " +
+        std::to_string(total_units) + " available physical cores.");
+  }
+
+  // Step2: Assign the units to instances.
+  int32_t num_domains = domain_units.size();
+  std::vector<std::vector<PhysicalCore>> instance_units;
+  if (num_instances < num_domains) {
+    // Each instance takes whole adjacent domains, balanced by core count.
+    instance_units.resize(num_instances);
+    int32_t instance = 0;
+    int64_t accumulated_units = 0;
+    for (int32_t d = 0; d < num_domains; d++) {
+      auto& units = domain_units[d];
+      instance_units[instance].insert(
+          instance_units[instance].end(), units.begin(), units.end());
+      accumulated_units += units.size();
+      int32_t domains_left = num_domains - d - 1;
+      int32_t instances_left = num_instances - instance - 1;
+      if (instances_left > 0 &&
+          (accumulated_units * num_instances >=
+               (instance + 1) * total_units ||
+           domains_left == instances_left)) {
+        instance++;
+      }
+    }
+  } else {
+    // Each domain hosts instances proportional to its core count, with the
+    // largest remainder method, and at least one instance.
+    std::vector<int32_t> domain_instances(num_domains);
+    std::vector<double> remainders(num_domains);
+    int32_t assigned_instances = 0;
+    for (int32_t d = 0; d < num_domains; d++) {
+      int32_t domain_size = domain_units[d].size();
+      double quota = double(num_instances) * domain_size / total_units;
+      domain_instances[d] =
+          std::max(1, std::min(domain_size, int32_t(std::floor(quota))));
+      remainders[d] = quota - domain_instances[d];
+      assigned_instances += domain_instances[d];
+    }
+    while (assigned_instances != num_instances) {
+      int32_t selected = -1;
+      for (int32_t d = 0; d < num_domains; d++) {
+        bool candidate = assigned_instances < num_instances
+            ? domain_instances[d] < domain_units[d].size()
+            : domain_instances[d] > 1;
+        if (!candidate) {
+          continue;
+        }
+        if (selected < 0 ||
+            (assigned_instances < num_instances
+                 ? remainders[d] > remainders[selected]
+                 : remainders[d] < remainders[selected])) {
+          selected = d;
+        }
+      }
+      int32_t delta = assigned_instances < num_instances ? 1 : -1;
+      domain_instances[selected] += delta;
+      remainders[selected] -= delta;
+      assigned_instances += delta;
+    }
+    for (int32_t d = 0; d < num_domains; d++) {
+      for (auto& part : split_evenly(domain_units[d], domain_instances[d])) {
+        instance_units.emplace_back(std::move(part));
+      }
+    }
+  }
+
+  // Step3: Flatten the units into core lists.
+  std::vector<std::vector<int32_t>> partitions;
+  for (auto& units : instance_units) {
+    std::vector<int32_t> cpu_core_list;
+    for (auto& unit : units) {
+      cpu_core_list.insert(cpu_core_list.end(), unit.begin(), unit.end());
+    }
+    std::sort(cpu_core_list.begin(), cpu_core_list.end());
+    partitions.emplace_back(std::move(cpu_core_list));
+  }
+  return partitions;
+}
+
+} // namespace runtime
+} // namespace torch_ipex
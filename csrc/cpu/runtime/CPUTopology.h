@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Macros.h>
+
+namespace torch_ipex {
+namespace runtime {
+
+/*CPUCoreInfo is the topology information of one logical core*/
+struct CPUCoreInfo {
+  int32_t cpu_id;
+  int32_t socket_id;
+  // -1 when NUMA information is not available.
+  int32_t numa_node_id;
+  // The smallest logical core id of the physical core.
+  int32_t physical_core_id;
+  // The smallest logical core id sharing the L3 cache, -1 if not available.
+  int32_t l3_domain_id;
+  // Whether it is not the first hardware thread of its physical core.
+  bool is_smt_sibling;
+};
+
+/*CPUTopology discovers the sockets, NUMA nodes, physical cores with SMT
+ * siblings and L3 cache domains of the online cores from sysfs*/
+class IPEX_API CPUTopology {
+ public:
+  // sysfs_root is the path of /sys/devices/system, it can be changed for test.
+  explicit CPUTopology(const std::string& sysfs_root = "/sys/devices/system");
+
+  // The topology of current machine, discovered once per process.
+  static const CPUTopology& get_cpu_topology();
+
+  // Logical cores in ascending order of cpu_id.
+  const std::vector<CPUCoreInfo>& get_cores() const;
+  // nullptr if the core is not online.
+  const CPUCoreInfo* get_core(int32_t cpu_id) const;
+  int32_t get_num_sockets() const;
+  int32_t get_num_numa_nodes() const;
+  int32_t get_num_l3_domains() const;
+
+ private:
+  std::vector<CPUCoreInfo> cores;
+  int32_t num_sockets{0};
+  int32_t num_numa_nodes{0};
+  int32_t num_l3_domains{0};
+};
+
+// Parse the cpu list format of sysfs, such as "0-3,8,10-11".
+IPEX_API std::vector<int32_t> parse_cpu_list(const std::string& cpu_list);
+
+// Get the NUMA node id of the logical core, -1 if it is not available.
+IPEX_API int32_t get_numa_node_of_core(int32_t core_id);
+
+// Get the NUMA node ids where cpu_core_list located, in ascending order.
+// Return empty vector when the NUMA information is not available.
+IPEX_API std::vector<int32_t> get_numa_nodes_of_cores(
+    const std::vector<int32_t>& cpu_core_list);
+
+// Partition the available_cores into num_instances balanced core lists. The
+// cores are grouped by (NUMA node, L3 domain), an instance never crosses a
+// group unless there are fewer instances than groups, in which case each
+// instance takes whole adjacent groups. SMT siblings are excluded by default.
+IPEX_API std::vector<std::vector<int32_t>> partition_cpu_cores(
+    const CPUTopology& cpu_topology,
+    const std::vector<int32_t>& available_cores,
+    int32_t num_instances,
+    bool include_smt_siblings = false);
+
+} // namespace runtime
+} // namespace torch_ipex
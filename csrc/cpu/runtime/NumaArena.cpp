@@ -0,0 +1,214 @@
+#include "NumaArena.h"
+
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace torch_ipex {
+namespace runtime {
+
+namespace {
+// Refer to linux/mempolicy.h, not depend on libnuma.
+constexpr int MPOL_PREFERRED_MODE = 1;
+constexpr size_t MAX_NUMA_NODES = 1024;
+
+thread_local NumaArena* current_numa_arena = nullptr;
+
+// Round up the allocation size to one of 4 size classes between 2 powers of
+// 2, the memory waste of each allocation is less than 25%.
+size_t get_size_class(size_t nbytes) {
+  size_t power = NUMA_ARENA_MIN_ALLOCATION_SIZE;
+  while (power * 2 <= nbytes) {
+    power *= 2;
+  }
+  size_t step = power / 4;
+  return (nbytes + step - 1) / step * step;
+}
+
+void* allocate_on_numa_node(size_t size, int32_t numa_node) {
+#ifdef _WIN32
+  return nullptr;
+#else
+  void* ptr =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    return nullptr;
+  }
+  // Prefer the numa_node for the pages touched later. If mbind fails, such as
+  // in the container without permission, the memory is still usable with the
+  // default memory policy.
+  constexpr size_t bits_per_mask = 8 * sizeof(unsigned long);
+  unsigned long node_mask[MAX_NUMA_NODES / bits_per_mask] = {0};
+  node_mask[numa_node / bits_per_mask] |= 1UL << (numa_node % bits_per_mask);
+  syscall(
+      SYS_mbind,
+      ptr,
+      size,
+      MPOL_PREFERRED_MODE,
+      node_mask,
+      MAX_NUMA_NODES + 1,
+      0);
+  return ptr;
+#endif
+}
+
+void free_on_numa_node(void* ptr, size_t size) {
+#ifndef _WIN32
+  munmap(ptr, size);
+#endif
+}
+
+/*Dispatch the CPU allocations to the NumaArena of current thread*/
+class NumaArenaAllocator final : public c10::Allocator {
+ public:
+  explicit NumaArenaAllocator(c10::Allocator* default_allocator)
+      : default_allocator_(default_allocator) {}
+
+  c10::DataPtr allocate(size_t nbytes) override {
+    NumaArena* numa_arena = current_numa_arena;
+    if (numa_arena != nullptr && nbytes >= NUMA_ARENA_MIN_ALLOCATION_SIZE) {
+      return numa_arena->allocate(nbytes);
+    }
+    return default_allocator_->allocate(nbytes);
+  }
+
+  void copy_data(void* dest, const void* src, std::size_t count)
+      const override {
+    default_copy_data(dest, src, count);
+  }
+
+ private:
+  c10::Allocator* default_allocator_;
+};
+
+void install_numa_arena_allocator() {
+  static std::once_flag install_flag;
+  std::call_once(install_flag, []() {
+    static NumaArenaAllocator numa_arena_allocator(c10::GetCPUAllocator());
+    c10::SetCPUAllocator(&numa_arena_allocator, /* priority */ 1);
+  });
+}
+} // namespace
+
+NumaArena::NumaArena(int32_t numa_node) : numa_node_(numa_node) {
+  size_t max_cached_mb = NUMA_ARENA_DEFAULT_MAX_CACHED_MB;
+  if (auto env = std::getenv("IPEX_NUMA_ARENA_MAX_CACHED_MB")) {
+    max_cached_mb = std::stoul(env);
+  }
+  this->max_cached_bytes_ = max_cached_mb * 1024 * 1024;
+}
+
+NumaArena* NumaArena::get_numa_arena(int32_t numa_node) {
+  if (numa_node < 0 || numa_node >= MAX_NUMA_NODES) {
+    throw std::runtime_error("Fail to get NumaArena. Invalid NUMA node id.");
+  }
+  // The arenas are never destroyed, since the tensors allocated from them may
+  // be freed at any time of the process.
+  static std::mutex arenas_mutex;
+  static std::unordered_map<int32_t, NumaArena*> arenas;
+  std::lock_guard<std::mutex> lock(arenas_mutex);
+  auto it = arenas.find(numa_node);
+  if (it == arenas.end()) {
+    it = arenas.emplace(numa_node, new NumaArena(numa_node)).first;
+  }
+  return it->second;
+}
+
+c10::DataPtr NumaArena::allocate(size_t nbytes) {
+  size_t size = get_size_class(nbytes);
+  Block* block = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    auto& blocks = this->free_blocks_[size];
+    if (!blocks.empty()) {
+      block = blocks.back();
+      blocks.pop_back();
+      this->cached_bytes_ -= size;
+    }
+    this->allocated_bytes_ += size;
+  }
+  if (block == nullptr) {
+    void* ptr = allocate_on_numa_node(size, this->numa_node_);
+    if (ptr == nullptr) {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->allocated_bytes_ -= size;
+      }
+      throw std::runtime_error(
+          "Fail to allocate " + std::to_string(size) + " bytes on NUMA node " +
+          std::to_string(this->numa_node_) + ".");
+    }
+    block = new Block{ptr, size, this};
+  }
+  return {block->ptr, block, &NumaArena::delete_block, c10::DeviceType::CPU};
+}
+
+void NumaArena::delete_block(void* ctx) {
+  Block* block = static_cast<Block*>(ctx);
+  block->arena->release_block(block);
+}
+
+void NumaArena::release_block(Block* block) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->allocated_bytes_ -= block->size;
+    if (this->cached_bytes_ + block->size <= this->max_cached_bytes_) {
+      this->free_blocks_[block->size].emplace_back(block);
+      this->cached_bytes_ += block->size;
+      return;
+    }
+  }
+  // Exceed the cache limit, return the block to the OS.
+  free_on_numa_node(block->ptr, block->size);
+  delete block;
+}
+
+int32_t NumaArena::get_numa_node() const {
+  return this->numa_node_;
+}
+
+size_t NumaArena::get_allocated_bytes() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  return this->allocated_bytes_;
+}
+
+size_t NumaArena::get_cached_bytes() {
+  std::lock_guard<std::mutex> lock(this->mutex_);
+  return this->cached_bytes_;
+}
+
+void NumaArena::empty_cache() {
+  std::unordered_map<size_t, std::vector<Block*>> free_blocks;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    free_blocks.swap(this->free_blocks_);
+    this->cached_bytes_ = 0;
+  }
+  for (auto& size_blocks : free_blocks) {
+    for (auto block : size_blocks.second) {
+      free_on_numa_node(block->ptr, block->size);
+      delete block;
+    }
+  }
+}
+
+void set_current_numa_arena(NumaArena* numa_arena) {
+  if (numa_arena != nullptr) {
+    install_numa_arena_allocator();
+  }
+  current_numa_arena = numa_arena;
+}
+
+NumaArena* get_current_numa_arena() {
+  return current_numa_arena;
+}
+
+} // namespace runtime
+} // namespace torch_ipex
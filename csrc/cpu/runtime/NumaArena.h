@@ -0,0 +1,69 @@
+#pragma once
+
+#include <c10/core/Allocator.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <Macros.h>
+
+namespace torch_ipex {
+namespace runtime {
+
+// Allocations smaller than it are served by the default CPU allocator.
+constexpr size_t NUMA_ARENA_MIN_ALLOCATION_SIZE = 16 * 1024;
+// Default upper bound of the bytes cached by each NumaArena, can be changed
+// by env IPEX_NUMA_ARENA_MAX_CACHED_MB.
+constexpr size_t NUMA_ARENA_DEFAULT_MAX_CACHED_MB = 4096;
+
+/*NumaArena is a caching, size-classed allocator whose memory is bound to one
+ * NUMA node. There is one NumaArena per NUMA node for the whole process, it is
+ * shared by all the CPUPools on this node, so that tensors allocated inside a
+ * CPUPool keep valid after the CPUPool is destroyed.*/
+class IPEX_API NumaArena {
+ public:
+  // Get the process wide NumaArena of numa_node.
+  static NumaArena* get_numa_arena(int32_t numa_node);
+
+  c10::DataPtr allocate(size_t nbytes);
+  int32_t get_numa_node() const;
+  // Bytes of the blocks in use.
+  size_t get_allocated_bytes();
+  // Bytes of the freed blocks kept for reuse.
+  size_t get_cached_bytes();
+  // Return all the cached blocks to the OS.
+  void empty_cache();
+
+ private:
+  struct Block {
+    void* ptr;
+    size_t size;
+    NumaArena* arena;
+  };
+
+  explicit NumaArena(int32_t numa_node);
+  static void delete_block(void* ctx);
+  void release_block(Block* block);
+
+  int32_t numa_node_;
+  size_t max_cached_bytes_;
+  std::mutex mutex_;
+  // Freed blocks indexed by the size class.
+  std::unordered_map<size_t, std::vector<Block*>> free_blocks_;
+  size_t allocated_bytes_{0};
+  size_t cached_bytes_{0};
+
+  NumaArena() = delete;
+  NumaArena(const NumaArena& numa_arena) = delete;
+  NumaArena& operator=(const NumaArena& numa_arena) = delete;
+};
+
+// The NumaArena used by the allocations of current thread, nullptr means the
+// default CPU allocator. The NUMA arena CPU allocator is installed into c10
+// at the first time a not nullptr NumaArena is set.
+IPEX_API void set_current_numa_arena(NumaArena* numa_arena);
+IPEX_API NumaArena* get_current_numa_arena();
+
+} // namespace runtime
+} // namespace torch_ipex
@@ -12,64 +12,95 @@
 #include <Macros.h>
 #include <torch/csrc/jit/api/module.h>
 #include "TaskExecutor.h"
+#include "TaskSlot.h"
 
 namespace torch_ipex {
 namespace runtime {
 
 // refer to http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2008/n2709.html
 /*Task is used to handle input of general C++ functions*/
+/*The arguments, result and completion state of each submission are kept in a
+ * reusable record of TaskSlotPool, and TaskFuture waits on the atomic state of
+ * the record. So there is no heap allocation and no lock on the completion
+ * path.*/
 template <class F, class... Args>
 class IPEX_API Task {
  public:
-  explicit Task(F&& f, std::shared_ptr<TaskExecutor> task_executor);
+  typedef decltype(std::declval<F>()(std::declval<Args>()...)) return_type;
+
+  // All the submissions of this Task are dispatched in the priority class.
+  explicit Task(
+      F&& f,
+      std::shared_ptr<TaskExecutor> task_executor,
+      TaskPriority priority = TASK_PRIORITY_NORMAL);
   Task(const Task& task) = delete;
   Task(Task&& task) = delete;
   Task& operator=(const Task& task) = delete;
   Task& operator=(Task&& task) = delete;
   ~Task();
-  auto operator()(Args&&... args)
-      -> std::future<decltype(F()(std::forward<Args>(args)...))>;
+  // Returns a TaskFuture backed by the pooled record instead of the
+  // std::future<return_type> of the earlier versions. TaskFuture has the same
+  // get(), wait() and valid(), but no wait_for(), wait_until() or share().
+  auto operator()(Args&&... args) -> TaskFuture<return_type>;
+  // Submit with a deadline, it is dispatched before the queued tasks of the
+  // same priority class with later or without deadline.
+  auto run_with_deadline(TaskDeadline deadline, Args&&... args)
+      -> TaskFuture<return_type>;
 
  private:
-  F f;
+  TaskSlotPool<F, return_type, Args...>* task_slot_pool;
   std::shared_ptr<TaskExecutor> task_executor;
+  TaskPriority priority;
 };
 
 template <class F, class... Args>
-Task<F, Args...>::Task(F&& f, std::shared_ptr<TaskExecutor> task_executor) {
-  this->f = f;
+Task<F, Args...>::Task(
+    F&& f,
+    std::shared_ptr<TaskExecutor> task_executor,
+    TaskPriority priority) {
+  this->task_slot_pool = new TaskSlotPool<F, return_type, Args...>(f);
   this->task_executor = task_executor;
+  this->priority = priority;
 }
 
 template <class F, class... Args>
-Task<F, Args...>::~Task() {}
+Task<F, Args...>::~Task() {
+  // The pool is deleted after the in-flight records are released.
+  this->task_slot_pool->drop_ref();
+}
 
 template <class F, class... Args>
 auto Task<F, Args...>::operator()(Args&&... args)
-    -> std::future<decltype(F()(std::forward<Args>(args)...))> {
-  typedef decltype(F()(std::forward<Args>(args)...)) return_type;
-  auto task = std::make_shared<std::packaged_task<return_type()>>(
-      [&, this]() -> return_type {
-        return this->f(std::forward<Args>(args)...);
-      });
-  std::future<return_type> res = task->get_future();
+    -> TaskFuture<return_type> {
+  return this->run_with_deadline(
+      NO_TASK_DEADLINE, std::forward<Args>(args)...);
+}
+
+template <class F, class... Args>
+auto Task<F, Args...>::run_with_deadline(
+    TaskDeadline deadline,
+    Args&&... args) -> TaskFuture<return_type> {
+  typedef TaskSlotPool<F, return_type, Args...> PoolType;
+  auto slot = this->task_slot_pool->acquire(std::forward<Args>(args)...);
   auto grad_mode = at::GradMode::is_enabled();
-  {
-    std::unique_lock<std::mutex> lock(this->task_executor->get_mutex());
-    // submit task to a stopping the pool is not allowed
-    if (this->task_executor->is_stop())
-      throw std::runtime_error("Task submit on stopped ThreadPool");
-    this->task_executor->get_tasks().emplace([task, grad_mode]() {
-      // set the thread local status, such as the grad mode before execuating
-      // the status
-      at::GradMode::set_enabled(grad_mode);
-      // execuate the task
-      (*task)();
-    });
+  try {
+    // Only capture the record pointer, so that the std::function keeps the
+    // lambda in its local storage.
+    this->task_executor->submit(
+        [slot, grad_mode]() {
+          // set the thread local status, such as the grad mode before
+          // execuating the status
+          at::GradMode::set_enabled(grad_mode);
+          // execuate the task
+          PoolType::run(slot);
+        },
+        this->priority,
+        deadline);
+  } catch (...) {
+    this->task_slot_pool->cancel(slot);
+    throw;
   }
-
-  this->task_executor->get_condition().notify_one();
-  return res;
+  return TaskFuture<return_type>(slot);
 }
 
 } // namespace runtime
@@ -1,8 +1,36 @@
 #include "TaskExecutor.h"
 
+#include <algorithm>
+#include <tuple>
+
 namespace torch_ipex {
 namespace runtime {
 
+namespace {
+// Split cpu_core_list into num_partitions contiguous sub lists. The first
+// (size % num_partitions) sub lists get one more core.
+std::vector<std::vector<int32_t>> split_cpu_core_list(
+    const std::vector<int32_t>& cpu_core_list,
+    int32_t num_partitions) {
+  std::vector<std::vector<int32_t>> partitions(num_partitions);
+  int32_t base = cpu_core_list.size() / num_partitions;
+  int32_t remainder = cpu_core_list.size() % num_partitions;
+  int32_t offset = 0;
+  for (int32_t i = 0; i < num_partitions; i++) {
+    int32_t partition_size = base + (i < remainder ? 1 : 0);
+    partitions[i].assign(
+        cpu_core_list.begin() + offset,
+        cpu_core_list.begin() + offset + partition_size);
+    offset += partition_size;
+  }
+  return partitions;
+}
+
+// Priority class of the task running on current worker thread. The threads
+// not running a task never yield.
+thread_local TaskPriority running_task_priority = TASK_PRIORITY_HIGH;
+} // namespace
+
 TaskExecutor::TaskExecutor(const torch_ipex::runtime::CPUPool& cpu_pool) {
   // Notice: We shouldn't load iomp symbol in sub_thread, otherwise race
   // condition happens.
@@ -12,25 +40,188 @@ TaskExecutor::TaskExecutor(const torch_ipex::runtime::CPUPool& cpu_pool) {
         "before using the runtime API.");
   }
   this->stop = false;
+  this->telemetry = std::make_unique<TaskExecutorTelemetry>(
+      std::vector<std::vector<int32_t>>({cpu_pool.get_cpu_core_list()}));
 
-  this->worker = std::make_shared<std::thread>([&, this] {
+  this->workers.emplace_back(std::make_shared<std::thread>([&, this] {
     _pin_cpu_cores(cpu_pool);
     while (true) {
-      std::function<void()> task;
+      QueuedTask queued_task;
+      TaskPriority priority;
       {
         std::unique_lock<std::mutex> lock(this->worker_mutex);
-        this->worker_condition.wait(
-            lock, [this] { return this->stop || !this->tasks.empty(); });
+        this->worker_condition.wait(lock, [this] {
+          return this->stop || !this->tasks.empty() ||
+              !this->scheduled_tasks.empty();
+        });
 
-        if (this->stop && this->tasks.empty())
+        if (this->stop && this->tasks.empty() &&
+            this->scheduled_tasks.empty())
           return;
 
-        task = std::move(this->tasks.front());
-        this->tasks.pop();
+        // The tasks pushed into get_tasks() directly are normal priority
+        // without deadline.
+        while (!this->tasks.empty()) {
+          this->telemetry->on_submit();
+          this->push_scheduled_task(
+              {std::move(this->tasks.front()), TaskExecutorTelemetry::now_ns()},
+              TASK_PRIORITY_NORMAL,
+              NO_TASK_DEADLINE);
+          this->queued_tasks[TASK_PRIORITY_NORMAL].fetch_add(1);
+          this->tasks.pop();
+        }
+        priority = this->pop_scheduled_task(queued_task);
       }
-      task();
+      this->run_task(0, queued_task, priority);
     }
-  });
+  }));
+}
+
+TaskExecutor::TaskExecutor(
+    const torch_ipex::runtime::CPUPool& cpu_pool,
+    int32_t num_workers) {
+  // Notice: We shouldn't load iomp symbol in sub_thread, otherwise race
+  // condition happens.
+  if (!is_runtime_ext_enabled()) {
+    throw std::runtime_error(
+        "Fail to init TaskExecutor. Didn't preload IOMP "
+        "before using the runtime API.");
+  }
+  const std::vector<int32_t>& cpu_core_list = cpu_pool.get_cpu_core_list();
+  if (num_workers < 1 || num_workers > cpu_core_list.size()) {
+    throw std::runtime_error(
+        "Fail to init TaskExecutor. num_workers should be in the range of "
+        "[1, number of cores in CPUPool].");
+  }
+  this->stop = false;
+  this->work_stealing_ = true;
+
+  this->worker_queues.resize(num_workers);
+  for (auto& queues : this->worker_queues) {
+    for (auto& queue : queues) {
+      queue =
+          std::make_unique<TaskQueue<QueuedTask>>(WORK_STEALING_QUEUE_CAPACITY);
+    }
+  }
+  // Each worker copies its own sub partition, so cpu_pool is not required
+  // to outlive the TaskExecutor.
+  std::vector<std::vector<int32_t>> partitions =
+      split_cpu_core_list(cpu_core_list, num_workers);
+  this->telemetry = std::make_unique<TaskExecutorTelemetry>(
+      std::vector<std::vector<int32_t>>(partitions));
+  bool numa_arena_enabled = cpu_pool.is_numa_arena_enabled();
+  for (int32_t i = 0; i < num_workers; i++) {
+    this->workers.emplace_back(std::make_shared<std::thread>(
+        [this,
+         i,
+         numa_arena_enabled,
+         sub_core_list = std::move(partitions[i])] {
+          torch_ipex::runtime::CPUPool sub_cpu_pool(sub_core_list);
+          if (numa_arena_enabled) {
+            sub_cpu_pool.enable_numa_arena();
+          }
+          _pin_cpu_cores(sub_cpu_pool);
+          this->work_stealing_worker_loop(i);
+        }));
+  }
+}
+
+bool TaskExecutor::schedule_after(
+    const ScheduledTask& a,
+    const ScheduledTask& b) {
+  return std::tie(a.priority, a.deadline, a.sequence) >
+      std::tie(b.priority, b.deadline, b.sequence);
+}
+
+bool TaskExecutor::try_get_task(
+    int32_t worker_id,
+    QueuedTask& queued_task,
+    TaskPriority& task_priority) {
+  int32_t num_workers = this->worker_queues.size();
+  for (int32_t priority = 0; priority < NUM_TASK_PRIORITIES; priority++) {
+    if (this->queued_tasks[priority].load() == 0) {
+      continue;
+    }
+    // The tasks with deadline go first in this priority class. Then pop from
+    // the own queue, and steal from the other workers.
+    if (this->num_deadline_tasks.load() > 0) {
+      std::unique_lock<std::mutex> lock(this->worker_mutex);
+      if (!this->scheduled_tasks.empty() &&
+          this->scheduled_tasks.front().priority <= priority) {
+        this->num_deadline_tasks.fetch_sub(1);
+        task_priority = this->pop_scheduled_task(queued_task);
+        return true;
+      }
+    }
+    for (int32_t i = 0; i < num_workers; i++) {
+      if (this->worker_queues[(worker_id + i) % num_workers][priority]->pop(
+              queued_task)) {
+        this->queued_tasks[priority].fetch_sub(1);
+        task_priority = static_cast<TaskPriority>(priority);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void TaskExecutor::work_stealing_worker_loop(int32_t worker_id) {
+  while (true) {
+    QueuedTask queued_task;
+    TaskPriority priority;
+    if (this->try_get_task(worker_id, queued_task, priority)) {
+      this->pending_tasks.fetch_sub(1);
+      this->run_task(worker_id, queued_task, priority);
+      continue;
+    }
+    // No task to run or steal, park the worker until new task is submitted.
+    std::unique_lock<std::mutex> lock(this->worker_mutex);
+    this->sleeping_workers.fetch_add(1);
+    this->worker_condition.wait(lock, [this] {
+      return this->stop || this->pending_tasks.load() > 0;
+    });
+    this->sleeping_workers.fetch_sub(1);
+    if (this->stop && this->pending_tasks.load() == 0)
+      return;
+  }
+}
+
+void TaskExecutor::push_scheduled_task(
+    QueuedTask&& queued_task,
+    TaskPriority priority,
+    TaskDeadline deadline) {
+  this->scheduled_tasks.push_back(
+      {priority, deadline, this->next_sequence++, std::move(queued_task)});
+  std::push_heap(
+      this->scheduled_tasks.begin(),
+      this->scheduled_tasks.end(),
+      schedule_after);
+}
+
+TaskPriority TaskExecutor::pop_scheduled_task(QueuedTask& queued_task) {
+  std::pop_heap(
+      this->scheduled_tasks.begin(),
+      this->scheduled_tasks.end(),
+      schedule_after);
+  ScheduledTask& scheduled_task = this->scheduled_tasks.back();
+  TaskPriority priority = scheduled_task.priority;
+  queued_task = std::move(scheduled_task.queued_task);
+  this->scheduled_tasks.pop_back();
+  this->queued_tasks[priority].fetch_sub(1);
+  return priority;
+}
+
+void TaskExecutor::run_task(
+    int32_t worker_id,
+    QueuedTask& queued_task,
+    TaskPriority priority) {
+  int64_t start_time = TaskExecutorTelemetry::now_ns();
+  this->telemetry->on_start(start_time - queued_task.enqueue_time);
+  running_task_priority = priority;
+  queued_task.task();
+  running_task_priority = TASK_PRIORITY_HIGH;
+  this->telemetry->on_finish(
+      worker_id, TaskExecutorTelemetry::now_ns() - start_time);
 }
 
 std::mutex& TaskExecutor::get_mutex() {
@@ -46,9 +237,111 @@ bool TaskExecutor::is_stop() {
 }
 
 std::queue<std::function<void()>>& TaskExecutor::get_tasks() {
+  if (this->work_stealing_) {
+    throw std::runtime_error(
+        "Fail to get_tasks. Work stealing TaskExecutor doesn't have a "
+        "shared task queue, please use submit instead.");
+  }
   return this->tasks;
 }
 
+void TaskExecutor::submit(std::function<void()>&& task) {
+  this->submit(std::move(task), TASK_PRIORITY_NORMAL, NO_TASK_DEADLINE);
+}
+
+void TaskExecutor::submit(
+    std::function<void()>&& task,
+    TaskPriority priority,
+    TaskDeadline deadline) {
+  if (priority < 0 || priority >= NUM_TASK_PRIORITIES) {
+    throw std::runtime_error("Fail to submit task with invalid priority.");
+  }
+  if (!this->work_stealing_) {
+    {
+      std::unique_lock<std::mutex> lock(this->worker_mutex);
+      // submit task to a stopping the pool is not allowed
+      if (this->stop)
+        throw std::runtime_error("Task submit on stopped ThreadPool");
+      this->telemetry->on_submit();
+      this->push_scheduled_task(
+          {std::move(task), TaskExecutorTelemetry::now_ns()},
+          priority,
+          deadline);
+      this->queued_tasks[priority].fetch_add(1);
+    }
+    this->worker_condition.notify_one();
+    return;
+  }
+
+  // Count the task before checking stop, so that the workers will not exit
+  // before this task is drained.
+  this->pending_tasks.fetch_add(1);
+  if (this->stop) {
+    this->pending_tasks.fetch_sub(1);
+    throw std::runtime_error("Task submit on stopped ThreadPool");
+  }
+  this->telemetry->on_submit();
+  QueuedTask queued_task{std::move(task), TaskExecutorTelemetry::now_ns()};
+  if (deadline != NO_TASK_DEADLINE) {
+    // The tasks with deadline are ordered in the shared heap.
+    std::unique_lock<std::mutex> lock(this->worker_mutex);
+    this->push_scheduled_task(std::move(queued_task), priority, deadline);
+    this->num_deadline_tasks.fetch_add(1);
+    this->queued_tasks[priority].fetch_add(1);
+  } else {
+    // Count before push, so that the workers never skip a queued task.
+    this->queued_tasks[priority].fetch_add(1);
+    // Round robin the start queue, so requests fan out across sub
+    // partitions. Fall back to the next queue when one is full.
+    int32_t num_workers = this->worker_queues.size();
+    size_t start = this->next_queue_id.fetch_add(1, std::memory_order_relaxed);
+    bool submitted = false;
+    while (!submitted) {
+      for (int32_t i = 0; i < num_workers && !submitted; i++) {
+        submitted = this->worker_queues[(start + i) % num_workers][priority]
+                        ->push(std::move(queued_task));
+      }
+      if (!submitted) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  // Only take the mutex when there is a parked worker to wake up.
+  if (this->sleeping_workers.load() > 0) {
+    { std::unique_lock<std::mutex> lock(this->worker_mutex); }
+    this->worker_condition.notify_one();
+  }
+}
+
+bool TaskExecutor::should_yield() const {
+  if (this->work_stealing_ && this->sleeping_workers.load() > 0) {
+    // The idle worker will take the waiting task.
+    return false;
+  }
+  for (int32_t priority = 0; priority < running_task_priority; priority++) {
+    if (this->queued_tasks[priority].load() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TaskExecutorStats TaskExecutor::get_stats() const {
+  return this->telemetry->get_stats();
+}
+
+void TaskExecutor::reset_stats() {
+  this->telemetry->reset();
+}
+
+bool TaskExecutor::is_work_stealing() const {
+  return this->work_stealing_;
+}
+
+int32_t TaskExecutor::get_num_workers() const {
+  return this->workers.size();
+}
+
 void TaskExecutor::stop_executor() {
   bool should_wait_worker_join = false;
   {
@@ -60,7 +353,9 @@ void TaskExecutor::stop_executor() {
   }
   if (should_wait_worker_join) {
     this->worker_condition.notify_all();
-    this->worker->join();
+    for (auto& worker : this->workers) {
+      worker->join();
+    }
   }
   return;
 }
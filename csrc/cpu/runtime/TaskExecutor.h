@@ -1,7 +1,9 @@
 #pragma once
 
 #include <omp.h>
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <future>
@@ -18,26 +20,123 @@
 #include <torch/csrc/autograd/profiler.h>
 #include <torch/csrc/jit/api/module.h>
 #include "CPUPool.h"
+#include "TaskExecutorTelemetry.h"
+#include "TaskQueue.h"
 
 namespace torch_ipex {
 namespace runtime {
 
+// Capacity of the per worker lock-free TaskQueue in work stealing mode.
+constexpr size_t WORK_STEALING_QUEUE_CAPACITY = 1024;
+
+// A queued task of higher priority class is always dispatched before the
+// queued tasks of lower priority classes. Inside one class, the tasks with
+// deadline are dispatched in earliest deadline first order, then the tasks
+// without deadline in FIFO order.
+enum TaskPriority : int32_t {
+  TASK_PRIORITY_HIGH = 0,
+  TASK_PRIORITY_NORMAL = 1,
+  TASK_PRIORITY_LOW = 2,
+};
+constexpr int32_t NUM_TASK_PRIORITIES = 3;
+
+typedef std::chrono::steady_clock::time_point TaskDeadline;
+// The deadline of the tasks without deadline.
+constexpr TaskDeadline NO_TASK_DEADLINE = TaskDeadline::max();
+
 class IPEX_API TaskExecutor {
  public:
+  // Single worker mode: one worker thread pinned to all cores of cpu_pool
+  // drains a FIFO queue.
   explicit TaskExecutor(const torch_ipex::runtime::CPUPool& cpu_pool);
+  // Work stealing mode: cpu_pool is split into num_workers sub partitions
+  // of contiguous cores. Each worker thread is pinned to one sub partition
+  // and owns a lock-free TaskQueue. Idle workers steal from the others.
+  explicit TaskExecutor(
+      const torch_ipex::runtime::CPUPool& cpu_pool,
+      int32_t num_workers);
   std::mutex& get_mutex();
   std::condition_variable& get_condition();
   bool is_stop();
   std::queue<std::function<void()>>& get_tasks();
+  // Submit task to the executor, works for both of the executor modes.
+  void submit(std::function<void()>&& task);
+  void submit(
+      std::function<void()>&& task,
+      TaskPriority priority,
+      TaskDeadline deadline = NO_TASK_DEADLINE);
+  // Called inside a running task to preempt at task boundary: true if a task
+  // of higher priority class than the running one is waiting and no worker
+  // is idle to take it. The running task may submit the rest of its work as
+  // a new task and return.
+  bool should_yield() const;
+  // Read the telemetry without stopping the executor.
+  TaskExecutorStats get_stats() const;
+  void reset_stats();
+  bool is_work_stealing() const;
+  int32_t get_num_workers() const;
   void stop_executor();
   ~TaskExecutor();
 
  private:
+  struct QueuedTask {
+    std::function<void()> task;
+    // TaskExecutorTelemetry::now_ns() when submitted.
+    int64_t enqueue_time{0};
+  };
+
+  struct ScheduledTask {
+    TaskPriority priority;
+    TaskDeadline deadline;
+    // Keep FIFO order of the tasks with the same priority and deadline.
+    uint64_t sequence;
+    QueuedTask queued_task;
+  };
+
+  // Compare function of the heap, true if a is dispatched after b.
+  static bool schedule_after(const ScheduledTask& a, const ScheduledTask& b);
+  void work_stealing_worker_loop(int32_t worker_id);
+  bool try_get_task(
+      int32_t worker_id,
+      QueuedTask& queued_task,
+      TaskPriority& task_priority);
+  // Should be called with worker_mutex held.
+  void push_scheduled_task(
+      QueuedTask&& queued_task,
+      TaskPriority priority,
+      TaskDeadline deadline);
+  // Should be called with worker_mutex held.
+  TaskPriority pop_scheduled_task(QueuedTask& queued_task);
+  void run_task(
+      int32_t worker_id,
+      QueuedTask& queued_task,
+      TaskPriority priority);
+
   std::queue<std::function<void()>> tasks;
-  std::shared_ptr<std::thread> worker;
+  // Min heap of the ScheduledTasks guarded by worker_mutex. It holds all the
+  // tasks in single worker mode, and the tasks with deadline in work stealing
+  // mode.
+  std::vector<ScheduledTask> scheduled_tasks;
+  uint64_t next_sequence{0};
+  // Number of queued tasks of each priority class.
+  std::array<std::atomic<int64_t>, NUM_TASK_PRIORITIES> queued_tasks{};
+  std::vector<std::shared_ptr<std::thread>> workers;
+
+  // Work stealing mode
+  bool work_stealing_{false};
+  // One lock-free TaskQueue per priority class of each worker.
+  std::vector<
+      std::array<std::unique_ptr<TaskQueue<QueuedTask>>, NUM_TASK_PRIORITIES>>
+      worker_queues;
+  std::atomic<int64_t> num_deadline_tasks{0};
+  std::atomic<size_t> next_queue_id{0};
+  std::atomic<int64_t> pending_tasks{0};
+  std::atomic<int32_t> sleeping_workers{0};
+
+  std::unique_ptr<TaskExecutorTelemetry> telemetry;
 
   // Synchronization
-  bool stop;
+  std::atomic<bool> stop;
   std::mutex worker_mutex;
   std::condition_variable worker_condition;
 
@@ -0,0 +1,193 @@
+#include "TaskExecutorTelemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace torch_ipex {
+namespace runtime {
+
+namespace {
+void update_max(std::atomic<int64_t>& max_value, int64_t value) {
+  int64_t current = max_value.load(std::memory_order_relaxed);
+  while (value > current &&
+         !max_value.compare_exchange_weak(
+             current, value, std::memory_order_relaxed)) {
+  }
+}
+
+int32_t get_leading_bit(uint64_t value) {
+  int32_t bit = 0;
+  while (value >>= 1) {
+    bit++;
+  }
+  return bit;
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto& bucket : this->buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+int32_t LatencyHistogram::get_bucket_index(uint64_t value) {
+  if (value < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+    return value;
+  }
+  int32_t leading_bit = get_leading_bit(value);
+  int32_t shift = leading_bit - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+  return (shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS +
+      (value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKETS;
+}
+
+int64_t LatencyHistogram::get_bucket_value(int32_t index) {
+  if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+    return index;
+  }
+  int32_t shift = index / LATENCY_HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t lower = uint64_t(
+                       LATENCY_HISTOGRAM_SUB_BUCKETS +
+                       index % LATENCY_HISTOGRAM_SUB_BUCKETS)
+      << shift;
+  return lower + (uint64_t(1) << shift) / 2;
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+  value_ns = std::max<int64_t>(value_ns, 0);
+  this->buckets_[get_bucket_index(value_ns)].fetch_add(
+      1, std::memory_order_relaxed);
+  this->count_.fetch_add(1, std::memory_order_relaxed);
+  this->sum_.fetch_add(value_ns, std::memory_order_relaxed);
+  update_max(this->max_, value_ns);
+}
+
+int64_t LatencyHistogram::get_count() const {
+  return this->count_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::get_mean() const {
+  int64_t count = get_count();
+  return count == 0
+      ? 0
+      : double(this->sum_.load(std::memory_order_relaxed)) / count;
+}
+
+int64_t LatencyHistogram::get_max() const {
+  return this->max_.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::get_percentile(double percentile) const {
+  // Sum the buckets instead of using count_, which may be updated after the
+  // buckets by the concurrent recording.
+  int64_t count = 0;
+  for (auto& bucket : this->buckets_) {
+    count += bucket.load(std::memory_order_relaxed);
+  }
+  if (count == 0) {
+    return 0;
+  }
+  int64_t target = std::max<int64_t>(
+      1, std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100 * count));
+  int64_t accumulated = 0;
+  for (int32_t i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; i++) {
+    accumulated += this->buckets_[i].load(std::memory_order_relaxed);
+    if (accumulated >= target) {
+      return std::min(get_bucket_value(i), get_max());
+    }
+  }
+  return get_max();
+}
+
+void LatencyHistogram::reset() {
+  for (auto& bucket : this->buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  this->count_.store(0, std::memory_order_relaxed);
+  this->sum_.store(0, std::memory_order_relaxed);
+  this->max_.store(0, std::memory_order_relaxed);
+}
+
+TaskExecutorTelemetry::TaskExecutorTelemetry(
+    std::vector<std::vector<int32_t>>&& worker_cores)
+    : start_time_(now_ns()),
+      worker_cores_(std::move(worker_cores)),
+      worker_busy_time_(
+          new std::atomic<int64_t>[this->worker_cores_.size()]) {
+  for (size_t i = 0; i < this->worker_cores_.size(); i++) {
+    this->worker_busy_time_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t TaskExecutorTelemetry::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void TaskExecutorTelemetry::on_submit() {
+  this->num_submitted_tasks_.fetch_add(1, std::memory_order_relaxed);
+  int64_t queue_length =
+      this->queue_length_.fetch_add(1, std::memory_order_relaxed) + 1;
+  update_max(this->queue_length_high_water_mark_, queue_length);
+}
+
+void TaskExecutorTelemetry::on_start(int64_t wait_time_ns) {
+  this->queue_length_.fetch_sub(1, std::memory_order_relaxed);
+  this->wait_time_.record(wait_time_ns);
+}
+
+void TaskExecutorTelemetry::on_finish(int32_t worker_id, int64_t exec_time_ns) {
+  this->exec_time_.record(exec_time_ns);
+  this->worker_busy_time_[worker_id].fetch_add(
+      exec_time_ns, std::memory_order_relaxed);
+  this->num_completed_tasks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+TaskExecutorStats TaskExecutorTelemetry::get_stats() const {
+  TaskExecutorStats stats;
+  stats.num_submitted_tasks =
+      this->num_submitted_tasks_.load(std::memory_order_relaxed);
+  stats.num_completed_tasks =
+      this->num_completed_tasks_.load(std::memory_order_relaxed);
+  stats.queue_length = this->queue_length_.load(std::memory_order_relaxed);
+  stats.queue_length_high_water_mark =
+      this->queue_length_high_water_mark_.load(std::memory_order_relaxed);
+  stats.wait_time_mean = this->wait_time_.get_mean();
+  stats.wait_time_p50 = this->wait_time_.get_percentile(50);
+  stats.wait_time_p99 = this->wait_time_.get_percentile(99);
+  stats.wait_time_max = this->wait_time_.get_max();
+  stats.exec_time_mean = this->exec_time_.get_mean();
+  stats.exec_time_p50 = this->exec_time_.get_percentile(50);
+  stats.exec_time_p99 = this->exec_time_.get_percentile(99);
+  stats.exec_time_max = this->exec_time_.get_max();
+  stats.elapsed_time =
+      now_ns() - this->start_time_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < this->worker_cores_.size(); i++) {
+    int64_t busy_time =
+        this->worker_busy_time_[i].load(std::memory_order_relaxed);
+    stats.worker_utilization.emplace_back(
+        stats.elapsed_time > 0
+            ? std::min(1.0, double(busy_time) / stats.elapsed_time)
+            : 0);
+  }
+  stats.worker_cores = this->worker_cores_;
+  return stats;
+}
+
+void TaskExecutorTelemetry::reset() {
+  this->num_submitted_tasks_.store(0, std::memory_order_relaxed);
+  this->num_completed_tasks_.store(0, std::memory_order_relaxed);
+  this->queue_length_high_water_mark_.store(
+      this->queue_length_.load(std::memory_order_relaxed),
+      std::memory_order_relaxed);
+  this->wait_time_.reset();
+  this->exec_time_.reset();
+  for (size_t i = 0; i < this->worker_cores_.size(); i++) {
+    this->worker_busy_time_[i].store(0, std::memory_order_relaxed);
+  }
+  this->start_time_.store(now_ns(), std::memory_order_relaxed);
+}
+
+} // namespace runtime
+} // namespace torch_ipex
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Macros.h>
+
+namespace torch_ipex {
+namespace runtime {
+
+// Each power of 2 range of the LatencyHistogram is split into
+// 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS linear buckets, so the relative error
+// of the recorded values is less than 1/16.
+constexpr int32_t LATENCY_HISTOGRAM_SUB_BUCKET_BITS = 4;
+constexpr int32_t LATENCY_HISTOGRAM_SUB_BUCKETS =
+    1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+constexpr int32_t LATENCY_HISTOGRAM_NUM_BUCKETS =
+    (64 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) *
+    LATENCY_HISTOGRAM_SUB_BUCKETS;
+
+/*LatencyHistogram is a HDR style log-linear histogram of the nanoseconds
+ * latencies. Recording is lock-free and it can be read while recording.*/
+class IPEX_API LatencyHistogram {
+ public:
+  LatencyHistogram();
+  void record(int64_t value_ns);
+  int64_t get_count() const;
+  double get_mean() const;
+  int64_t get_max() const;
+  // Approximate value of the percentile in [0, 100].
+  int64_t get_percentile(double percentile) const;
+  void reset();
+
+ private:
+  static int32_t get_bucket_index(uint64_t value);
+  // Middle value of the bucket.
+  static int64_t get_bucket_value(int32_t index);
+
+  std::array<std::atomic<int64_t>, LATENCY_HISTOGRAM_NUM_BUCKETS> buckets_;
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> sum_{0};
+  std::atomic<int64_t> max_{0};
+};
+
+/*Snapshot of the TaskExecutorTelemetry, the latencies are in nanoseconds*/
+struct TaskExecutorStats {
+  int64_t num_submitted_tasks;
+  int64_t num_completed_tasks;
+  int64_t queue_length;
+  int64_t queue_length_high_water_mark;
+  // Latency from submit to start of the tasks.
+  double wait_time_mean;
+  int64_t wait_time_p50;
+  int64_t wait_time_p99;
+  int64_t wait_time_max;
+  // Latency from start to finish of the tasks.
+  double exec_time_mean;
+  int64_t exec_time_p50;
+  int64_t exec_time_p99;
+  int64_t exec_time_max;
+  // Nanoseconds since created or last reset.
+  int64_t elapsed_time;
+  // Busy ratio of each worker in elapsed_time, the cores of worker i are
+  // worker_cores[i].
+  std::vector<double> worker_utilization;
+  std::vector<std::vector<int32_t>> worker_cores;
+};
+
+/*TaskExecutorTelemetry is the lock-free counters and latency histograms of a
+ * TaskExecutor, updated by the submitting threads and the workers.*/
+class IPEX_API TaskExecutorTelemetry {
+ public:
+  explicit TaskExecutorTelemetry(
+      std::vector<std::vector<int32_t>>&& worker_cores);
+
+  // Monotonic clock of the telemetry.
+  static int64_t now_ns();
+
+  void on_submit();
+  void on_start(int64_t wait_time_ns);
+  void on_finish(int32_t worker_id, int64_t exec_time_ns);
+
+  TaskExecutorStats get_stats() const;
+  // Reset the counters and histograms except the current queue length.
+  void reset();
+
+ private:
+  std::atomic<int64_t> num_submitted_tasks_{0};
+  std::atomic<int64_t> num_completed_tasks_{0};
+  std::atomic<int64_t> queue_length_{0};
+  std::atomic<int64_t> queue_length_high_water_mark_{0};
+  LatencyHistogram wait_time_;
+  LatencyHistogram exec_time_;
+  std::atomic<int64_t> start_time_;
+  std::vector<std::vector<int32_t>> worker_cores_;
+  std::unique_ptr<std::atomic<int64_t>[]> worker_busy_time_;
+
+  TaskExecutorTelemetry(const TaskExecutorTelemetry& telemetry) = delete;
+  TaskExecutorTelemetry& operator=(const TaskExecutorTelemetry& telemetry) =
+      delete;
+};
+
+} // namespace runtime
+} // namespace torch_ipex
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace torch_ipex {
+namespace runtime {
+
+// Bounded lock-free multi-producer/multi-consumer ring buffer, refer to
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Each worker of a work stealing TaskExecutor owns one TaskQueue. Tasks are
+// pushed by the submitting threads (not by the worker itself), so a classic
+// single-owner Chase-Lev deque doesn't fit. The owner worker pops from its
+// own queue and idle workers steal from the others with the same operation.
+template <typename T>
+class TaskQueue {
+ public:
+  explicit TaskQueue(size_t capacity)
+      : buffer_(new Cell[capacity]), buffer_mask_(capacity - 1) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+      throw std::runtime_error(
+          "Fail to init TaskQueue. The capacity must be a power of 2.");
+    }
+    for (size_t i = 0; i < capacity; i++) {
+      buffer_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  // Return false when the queue is full.
+  bool push(T&& data) {
+    Cell* cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &buffer_[pos & buffer_mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (dif == 0) {
+        if (enqueue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(data);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Return false when the queue is empty.
+  bool pop(T& data) {
+    Cell* cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &buffer_[pos & buffer_mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (dif == 0) {
+        if (dequeue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (dif < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    data = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + buffer_mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued elements, only used for scheduling hints.
+  size_t size_approx() const {
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  // Keep producer and consumer positions on different cache lines to avoid
+  // false sharing between submitting threads and workers.
+  static constexpr size_t kCacheLineSize = 64;
+  std::unique_ptr<Cell[]> buffer_;
+  const size_t buffer_mask_;
+  alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos_;
+  alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos_;
+
+  TaskQueue(const TaskQueue& task_queue) = delete;
+  TaskQueue& operator=(const TaskQueue& task_queue) = delete;
+};
+
+} // namespace runtime
+} // namespace torch_ipex
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifndef _WIN32
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace torch_ipex {
+namespace runtime {
+
+// Number of reusable task records of each Task. When all of them are in
+// use, the extra records are allocated on heap.
+constexpr int32_t TASK_SLOT_POOL_SIZE = 256;
+// Number of polls before TaskFuture::wait sleeps on the futex.
+constexpr int32_t TASK_FUTURE_SPIN_COUNT = 4096;
+
+enum TaskSlotState : uint32_t {
+  TASK_SLOT_FREE = 0,
+  TASK_SLOT_PENDING = 1,
+  // Pending and the owner of the TaskFuture sleeps on the futex.
+  TASK_SLOT_PENDING_WITH_WAITER = 2,
+  TASK_SLOT_READY = 3,
+  // The TaskFuture is destroyed before the task finished.
+  TASK_SLOT_ABANDONED = 4,
+};
+
+namespace detail {
+inline void futex_wait(std::atomic<uint32_t>* addr, uint32_t expected) {
+#ifdef _WIN32
+  std::this_thread::yield();
+#else
+  syscall(
+      SYS_futex,
+      reinterpret_cast<uint32_t*>(addr),
+      FUTEX_WAIT_PRIVATE,
+      expected,
+      nullptr,
+      nullptr,
+      0);
+#endif
+}
+
+inline void futex_wake_all(std::atomic<uint32_t>* addr) {
+#ifndef _WIN32
+  syscall(
+      SYS_futex,
+      reinterpret_cast<uint32_t*>(addr),
+      FUTEX_WAKE_PRIVATE,
+      INT32_MAX,
+      nullptr,
+      nullptr,
+      0);
+#endif
+}
+
+// Result storage of the task without heap allocation, supports value,
+// reference and void return types.
+template <class R>
+class TaskResult {
+ public:
+  template <class Fn>
+  void emplace(Fn&& fn) {
+    new (&storage_) R(fn());
+    has_value_ = true;
+  }
+  R take() {
+    R value = std::move(*reinterpret_cast<R*>(&storage_));
+    reset();
+    return value;
+  }
+  void reset() {
+    if (has_value_) {
+      reinterpret_cast<R*>(&storage_)->~R();
+      has_value_ = false;
+    }
+  }
+
+ private:
+  typename std::aligned_storage<sizeof(R), alignof(R)>::type storage_;
+  bool has_value_{false};
+};
+
+template <class R>
+class TaskResult<R&> {
+ public:
+  template <class Fn>
+  void emplace(Fn&& fn) {
+    value_ = &fn();
+  }
+  R& take() {
+    return *value_;
+  }
+  void reset() {
+    value_ = nullptr;
+  }
+
+ private:
+  R* value_{nullptr};
+};
+
+template <>
+class TaskResult<void> {
+ public:
+  template <class Fn>
+  void emplace(Fn&& fn) {
+    fn();
+  }
+  void take() {}
+  void reset() {}
+};
+} // namespace detail
+
+/*TaskSlotBase is the type erased part of a task record shared with the
+ * TaskFuture. The completion is signaled by the atomic state, the waiter only
+ * sleeps on the futex when the task is not ready after spinning.*/
+template <class R>
+struct TaskSlotBase {
+  std::atomic<uint32_t> state{TASK_SLOT_FREE};
+  detail::TaskResult<R> result;
+  std::exception_ptr exception;
+  // Return the slot to the pool which it belongs to.
+  void (*release_fn)(TaskSlotBase<R>* slot){nullptr};
+
+  // Called by the worker after the result or exception is set.
+  void complete() {
+    uint32_t current_state = this->state.load(std::memory_order_acquire);
+    while (true) {
+      if (current_state == TASK_SLOT_ABANDONED) {
+        // Nobody will get the result.
+        this->result.reset();
+        this->exception = nullptr;
+        this->release_fn(this);
+        return;
+      }
+      if (this->state.compare_exchange_weak(
+              current_state, TASK_SLOT_READY, std::memory_order_acq_rel)) {
+        if (current_state == TASK_SLOT_PENDING_WITH_WAITER) {
+          detail::futex_wake_all(&this->state);
+        }
+        return;
+      }
+    }
+  }
+};
+
+/*TaskFuture is the allocation free replacement of std::future returned by
+ * Task. It is move only and get() can be invoked once.*/
+template <class R>
+class TaskFuture {
+ public:
+  TaskFuture() = default;
+  explicit TaskFuture(TaskSlotBase<R>* slot) : slot_(slot) {}
+  TaskFuture(TaskFuture&& other) noexcept : slot_(other.slot_) {
+    other.slot_ = nullptr;
+  }
+  TaskFuture& operator=(TaskFuture&& other) noexcept {
+    if (this != &other) {
+      abandon();
+      this->slot_ = other.slot_;
+      other.slot_ = nullptr;
+    }
+    return *this;
+  }
+  TaskFuture(const TaskFuture& other) = delete;
+  TaskFuture& operator=(const TaskFuture& other) = delete;
+  ~TaskFuture() {
+    abandon();
+  }
+
+  bool valid() const {
+    return this->slot_ != nullptr;
+  }
+
+  bool is_ready() const {
+    check_valid();
+    return this->slot_->state.load(std::memory_order_acquire) ==
+        TASK_SLOT_READY;
+  }
+
+  void wait() const {
+    check_valid();
+    auto& state = this->slot_->state;
+    for (int32_t i = 0; i < TASK_FUTURE_SPIN_COUNT; i++) {
+      if (state.load(std::memory_order_acquire) == TASK_SLOT_READY) {
+        return;
+      }
+    }
+    uint32_t current_state = TASK_SLOT_PENDING;
+    // Tell the worker to wake up this thread when the task is completed.
+    state.compare_exchange_strong(
+        current_state,
+        TASK_SLOT_PENDING_WITH_WAITER,
+        std::memory_order_acq_rel);
+    while (state.load(std::memory_order_acquire) != TASK_SLOT_READY) {
+      detail::futex_wait(&state, TASK_SLOT_PENDING_WITH_WAITER);
+    }
+  }
+
+  R get() {
+    wait();
+    TaskSlotBase<R>* slot = this->slot_;
+    this->slot_ = nullptr;
+    if (slot->exception) {
+      std::exception_ptr exception = std::move(slot->exception);
+      slot->exception = nullptr;
+      slot->result.reset();
+      slot->release_fn(slot);
+      std::rethrow_exception(exception);
+    }
+    if constexpr (std::is_void<R>::value) {
+      slot->release_fn(slot);
+    } else {
+      R value = slot->result.take();
+      slot->release_fn(slot);
+      return value;
+    }
+  }
+
+ private:
+  void check_valid() const {
+    if (this->slot_ == nullptr) {
+      throw std::runtime_error("Fail to wait on an invalid TaskFuture.");
+    }
+  }
+
+  void abandon() {
+    if (this->slot_ == nullptr) {
+      return;
+    }
+    TaskSlotBase<R>* slot = this->slot_;
+    this->slot_ = nullptr;
+    uint32_t current_state = slot->state.load(std::memory_order_acquire);
+    while (current_state != TASK_SLOT_READY) {
+      // Leave the slot to the worker, it will be released after completed.
+      if (slot->state.compare_exchange_weak(
+              current_state,
+              TASK_SLOT_ABANDONED,
+              std::memory_order_acq_rel)) {
+        return;
+      }
+    }
+    slot->result.reset();
+    slot->exception = nullptr;
+    slot->release_fn(slot);
+  }
+
+  TaskSlotBase<R>* slot_{nullptr};
+};
+
+/*TaskSlotPool is a fixed ring of reusable task records of one Task. Each
+ * record keeps the arguments and the result of one submission, so submitting
+ * a Task doesn't allocate on heap. The pool is reference counted by the Task
+ * and its in-flight records, so it outlives the Task when needed.*/
+template <class F, class R, class... Args>
+class TaskSlotPool {
+ public:
+  using ArgsTuple = std::tuple<Args...>;
+
+  struct Slot : public TaskSlotBase<R> {
+    TaskSlotPool* pool{nullptr};
+    bool pooled{true};
+    typename std::aligned_storage<sizeof(ArgsTuple), alignof(ArgsTuple)>::type
+        args;
+
+    ArgsTuple& get_args() {
+      return *reinterpret_cast<ArgsTuple*>(&this->args);
+    }
+  };
+
+  // The creator owns the first reference.
+  explicit TaskSlotPool(const F& f) : f_(f) {
+    for (auto& slot : this->slots_) {
+      slot.pool = this;
+      slot.release_fn = &TaskSlotPool::release_slot;
+    }
+  }
+
+  // Take a free record and keep the arguments inside it.
+  Slot* acquire(Args&&... args) {
+    Slot* slot = nullptr;
+    uint32_t start = this->cursor_.fetch_add(1, std::memory_order_relaxed);
+    for (int32_t i = 0; i < TASK_SLOT_POOL_SIZE; i++) {
+      Slot& candidate = this->slots_[(start + i) % TASK_SLOT_POOL_SIZE];
+      uint32_t expected = TASK_SLOT_FREE;
+      if (candidate.state.compare_exchange_strong(
+              expected, TASK_SLOT_PENDING, std::memory_order_acquire)) {
+        slot = &candidate;
+        break;
+      }
+    }
+    if (slot == nullptr) {
+      // Too many in-flight tasks, fall back to the heap allocated record.
+      slot = new Slot();
+      slot->pool = this;
+      slot->pooled = false;
+      slot->release_fn = &TaskSlotPool::release_slot;
+      slot->state.store(TASK_SLOT_PENDING, std::memory_order_relaxed);
+    }
+    add_ref();
+    new (&slot->args) ArgsTuple(std::forward<Args>(args)...);
+    return slot;
+  }
+
+  // Return a record which is acquired but not submitted.
+  void cancel(Slot* slot) {
+    slot->get_args().~ArgsTuple();
+    release_slot(slot);
+  }
+
+  // Execute the task of the record and signal the TaskFuture.
+  static void run(Slot* slot) {
+    TaskSlotPool* pool = slot->pool;
+    try {
+      slot->result.emplace([pool, slot]() -> R {
+        return pool->invoke(slot, std::index_sequence_for<Args...>{});
+      });
+    } catch (...) {
+      slot->exception = std::current_exception();
+    }
+    slot->get_args().~ArgsTuple();
+    slot->complete();
+  }
+
+  void add_ref() {
+    this->ref_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void drop_ref() {
+    if (this->ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+ private:
+  template <size_t... I>
+  R invoke(Slot* slot, std::index_sequence<I...>) {
+    return this->f_(std::forward<Args>(std::get<I>(slot->get_args()))...);
+  }
+
+  static void release_slot(TaskSlotBase<R>* base) {
+    Slot* slot = static_cast<Slot*>(base);
+    TaskSlotPool* pool = slot->pool;
+    if (slot->pooled) {
+      slot->state.store(TASK_SLOT_FREE, std::memory_order_release);
+    } else {
+      delete slot;
+    }
+    pool->drop_ref();
+  }
+
+  F f_;
+  Slot slots_[TASK_SLOT_POOL_SIZE];
+  std::atomic<uint32_t> cursor_{0};
+  std::atomic<int64_t> ref_count_{1};
+
+  TaskSlotPool(const TaskSlotPool& pool) = delete;
+  TaskSlotPool& operator=(const TaskSlotPool& pool) = delete;
+};
+
+} // namespace runtime
+} // namespace torch_ipex
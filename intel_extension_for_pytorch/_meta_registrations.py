@@ -154,10 +154,86 @@ def meta_single_query_cached_kv_attention(
     k_scale,
     v_scale,
     softcap,
+    evicted_lens,
+    num_sink_tokens,
 ):
     return output
 
 
+@register_meta("multi_query_cached_kv_attention")
+def meta_multi_query_cached_kv_attention(
+    output,
+    query,
+    key_cache,
+    value_cache,
+    scale,
+    block_tables,
+    context_lens,
+    block_size,
+    max_context_len,
+    num_queries,
+    query_mask,
+    k_scale,
+    v_scale,
+    softcap,
+):
+    return output
+
+
+@register_meta("single_query_cached_kv_attention_with_rope")
+def meta_single_query_cached_kv_attention_with_rope(
+    output,
+    query,
+    key,
+    value,
+    key_cache,
+    value_cache,
+    slot_mapping,
+    rope_emb_pos,
+    positions,
+    rotary_offset,
+    rotary_ndims,
+    head_mapping,
+    scale,
+    block_tables,
+    context_lens,
+    block_size,
+    max_context_len,
+    alibi_slopes,
+    window_size,
+    kv_cache_dtype,
+    k_scale,
+    v_scale,
+    softcap,
+):
+    return output
+
+
+@register_meta("evict_kv_blocks")
+def meta_evict_kv_blocks(
+    block_tables,
+    context_lens,
+    evicted_lens,
+    block_size,
+    num_sink_tokens,
+    window_size,
+):
+    # The number of evicted blocks depends on the context lengths
+    ctx = torch._custom_ops.get_ctx()
+    num_evicted_blocks = ctx.new_dynamic_size()
+    return block_tables.new_empty((num_evicted_blocks,))
+
+
+@register_meta("copy_blocks")
+def meta_copy_blocks(key_caches, value_caches, block_mapping):
+    return None
+
+
+@register_meta("swap_blocks")
+def meta_swap_blocks(src_caches, dst_caches, block_mapping):
+    return None
+
+
 @register_meta("flash_attn_varlen_func")
 def meta_flash_attn_varlen_func(
     output,
@@ -702,6 +778,11 @@ def meta_masked_multihead_self_attention(
     return (attn_output, attn_weights, key_cache_out, value_cache_out, beam_idx_out)
 
 
+@torch.library.register_fake("torch_ipex::compact_indirect_access_kv_cache")
+def meta_compact_indirect_access_kv_cache(key_cache, value_cache, beam_idx, offset):
+    return None
+
+
 @torch.library.register_fake("torch_ipex::prepare_4d_causal_attention_mask")
 def meta_prepare_4d_causal_attention_mask(
     attention_mask,
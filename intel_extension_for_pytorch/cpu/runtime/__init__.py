@@ -1,5 +1,5 @@
 from .task import Task
-from .cpupool import pin, CPUPool, is_runtime_ext_enabled
+from .cpupool import pin, CPUPool, get_cpu_pools, is_runtime_ext_enabled
 from .multi_stream import (
     MultiStreamModule,
     get_default_num_streams,
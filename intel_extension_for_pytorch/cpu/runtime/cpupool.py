@@ -12,13 +12,20 @@ class CPUPool(object):
         core_ids (list): A list of CPU cores' ids used for intra-op parallelism.
         node_id (int): A numa node id with all CPU cores on the numa node.
             ``node_id`` doesn't work if ``core_ids`` is set.
+        use_numa_arena (bool): Whether the threads running on this CPU pool
+            allocate tensors from a caching memory arena bound to the numa
+            node of their cores. It takes effect with
+            ``intel_extension_for_pytorch.cpu.runtime.pin`` and
+            ``intel_extension_for_pytorch.cpu.runtime.Task``. Default is False.
 
     Returns:
         intel_extension_for_pytorch.cpu.runtime.CPUPool: Generated
         intel_extension_for_pytorch.cpu.runtime.CPUPool object.
     """
 
-    def __init__(self, core_ids: list = None, node_id: int = None):
+    def __init__(
+        self, core_ids: list = None, node_id: int = None, use_numa_arena=False
+    ):
         if not ipex._C._has_cpu():
             return
         if core_ids is not None:
@@ -48,6 +55,38 @@ class CPUPool(object):
         # The actual core ids inside CPUPool may be updated in creation of ipex._C.CPUPool.
         # Since ipex._C.CPUPool will filter out core ids which not available for current process.
         self.core_ids = self.cpu_pool.get_core_list()
+        self.numa_nodes = self.cpu_pool.get_numa_nodes()
+        if use_numa_arena:
+            self.cpu_pool.enable_numa_arena()
+
+
+def get_cpu_pools(num_instances: int, use_logical_cores=False, use_numa_arena=False):
+    r"""
+    Partition the CPU cores available for current process into balanced CPU
+    pools for multi-instance serving. The partition follows the CPU topology:
+    each CPU pool stays inside one NUMA node and one L3 cache domain when
+    there are enough instances, otherwise it takes whole adjacent domains.
+
+    Args:
+        num_instances (int): Number of CPU pools to create.
+        use_logical_cores (bool): Whether to put the SMT siblings into the
+            CPU pools of their physical cores. Default is False, which means
+            only one logical core of each physical core is used.
+        use_numa_arena (bool): ``use_numa_arena`` of the created CPU pools.
+            Default is False.
+
+    Returns:
+        list: List of ``num_instances``
+        intel_extension_for_pytorch.cpu.runtime.CPUPool objects.
+    """
+
+    core_lists = ipex._C.partition_process_available_cores(
+        num_instances, use_logical_cores
+    )
+    return [
+        CPUPool(core_ids=core_list, use_numa_arena=use_numa_arena)
+        for core_list in core_lists
+    ]
 
 
 class pin(object):
@@ -13,19 +13,53 @@ class Task(object):
         cpu_pool (intel_extension_for_pytorch.cpu.runtime.CPUPool): An
             intel_extension_for_pytorch.cpu.runtime.CPUPool object, contains
             all CPU cores used to run Task asynchronously.
+        num_workers (int): Number of worker threads of the Task. Default is 1,
+            a single worker uses all CPU cores of ``cpu_pool`` and runs the
+            submitted requests one by one. When it is larger than 1, the
+            ``cpu_pool`` is split into ``num_workers`` sub pools of contiguous
+            cores, each pinned to one worker, and idle workers steal requests
+            from the busy ones. So that small batch requests can run
+            concurrently.
+        max_batch_size (int): Opt-in dynamic batching. When it is larger than
+            1, the concurrent calls of the Task are coalesced into one batched
+            forward of up to ``max_batch_size`` samples along dim 0, and the
+            results are split back to each call. Only calls whose positional
+            inputs are all tensors with the same dtype and non-batch sizes are
+            batched together. The output is split back when it is a tensor or
+            a (named) tuple/list of tensors batched along dim 0. Otherwise,
+            such as a dict, the calls run one by one and no longer get
+            batched. Default is 1, batching disabled.
+        batch_timeout_us (int): The longest time in microseconds a batch waits
+            for more calls after its first call arrives. Default is 1000.
 
     Returns:
         intel_extension_for_pytorch.cpu.runtime.Task: Generated
         intel_extension_for_pytorch.cpu.runtime.Task object.
     """
 
-    def __init__(self, module, cpu_pool: CPUPool):
+    def __init__(
+        self,
+        module,
+        cpu_pool: CPUPool,
+        num_workers: int = 1,
+        max_batch_size: int = 1,
+        batch_timeout_us: int = 1000,
+    ):
         self.cpu_pool = cpu_pool
         assert type(self.cpu_pool) is CPUPool
+        assert (
+            num_workers >= 1 and num_workers <= len(self.cpu_pool.core_ids)
+        ), "num_workers must be in the range of [1, number of cores in cpu_pool]"
         if isinstance(module, torch.jit.ScriptModule):
-            self._task = ipex._C.TaskModule(module._c, self.cpu_pool.cpu_pool, True)
+            self._task = ipex._C.TaskModule(
+                module._c, self.cpu_pool.cpu_pool, True, num_workers=num_workers
+            )
         else:
-            self._task = ipex._C.TaskModule(module, self.cpu_pool.cpu_pool)
+            self._task = ipex._C.TaskModule(
+                module, self.cpu_pool.cpu_pool, num_workers=num_workers
+            )
+        if max_batch_size > 1:
+            self._task.enable_batching(max_batch_size, batch_timeout_us)
 
     def __call__(self, *args, **kwargs):
         # async execution
@@ -34,3 +68,26 @@ class Task(object):
     def run_sync(self, *args, **kwargs):
         # sync execution
         return self._task.run_sync(*args, **kwargs)
+
+    def get_stats(self):
+        r"""
+        Get the telemetry of the Task without stopping it.
+
+        Returns:
+            dict: The number of submitted and completed requests, the current
+            queue length and its high-water mark, the mean/p50/p99/max of the
+            time from submit to start (``wait_time_*``) and from start to
+            finish (``exec_time_*``) of the requests in nanoseconds, and the
+            busy ratio of each worker (``worker_utilization``) with the cores
+            of each worker (``worker_cores``) since created or last reset.
+        """
+
+        return self._task.get_stats()
+
+    def reset_stats(self):
+        r"""
+        Reset the telemetry of the Task, such as at the start of a
+        monitoring window.
+        """
+
+        self._task.reset_stats()
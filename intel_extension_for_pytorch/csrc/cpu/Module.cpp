@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "jit/auto_opt_config.h"
+#include "jit/cpu/kernels/WoqWeightCache.h"
 #include "utils/fpmath_mode.h"
 #include "utils/isa_utils.h"
 #include "utils/module_version.h"
@@ -81,6 +82,19 @@ void InitIpexModuleBindings(py::module m) {
     return get_highest_binary_support_isa_level();
   });
 
+  m.def("_get_woq_weight_cache_stats", []() {
+    using namespace torch_ipex::cpu::detail::woq_linear;
+    auto stats = WoqWeightCache::get_instance().get_stats();
+    auto py_dict = py::dict();
+    py_dict["hits"] = stats.hits;
+    py_dict["misses"] = stats.misses;
+    py_dict["admissions"] = stats.admissions;
+    py_dict["refusals"] = stats.refusals;
+    py_dict["evictions"] = stats.evictions;
+    py_dict["used_bytes"] = stats.used_bytes;
+    return py_dict;
+  });
+
   m.def("mkldnn_set_verbose", &torch_ipex::utils::onednn_set_verbose);
   m.def("onednn_has_bf16_support", []() {
     return torch_ipex::utils::onednn_has_bf16_type_support();
@@ -192,24 +206,50 @@ void InitIpexModuleBindings(py::module m) {
         return std::make_shared<torch_ipex::runtime::CPUPool>(
             py::cast<std::vector<int32_t>>(core_list));
       }))
-      .def("get_core_list", [](torch_ipex::runtime::CPUPool& self) {
-        return self.get_cpu_core_list();
-      });
+      .def(
+          "get_core_list",
+          [](torch_ipex::runtime::CPUPool& self) {
+            return self.get_cpu_core_list();
+          })
+      .def(
+          "get_numa_nodes",
+          [](torch_ipex::runtime::CPUPool& self) {
+            return self.get_numa_nodes();
+          })
+      .def(
+          "enable_numa_arena",
+          &torch_ipex::runtime::CPUPool::enable_numa_arena)
+      .def(
+          "is_numa_arena_enabled",
+          &torch_ipex::runtime::CPUPool::is_numa_arena_enabled);
 
   py::class_<
       torch_ipex::runtime::TaskModule,
       std::shared_ptr<torch_ipex::runtime::TaskModule>>(m, "TaskModule")
-      .def(py::init([](const py::object& module,
-                       std::shared_ptr<torch_ipex::runtime::CPUPool> cpu_pool) {
-        return std::make_shared<torch_ipex::runtime::TaskModule>(
-            module, (*cpu_pool));
-      }))
-      .def(py::init([](const torch::jit::Module& module,
-                       std::shared_ptr<torch_ipex::runtime::CPUPool> cpu_pool,
-                       bool traced_module) {
-        return std::make_shared<torch_ipex::runtime::TaskModule>(
-            module, (*cpu_pool), traced_module);
-      }))
+      // Register the script module constructor firstly, otherwise the bool
+      // traced_module would be accepted as num_workers of the py::object one.
+      .def(
+          py::init([](const torch::jit::Module& module,
+                      std::shared_ptr<torch_ipex::runtime::CPUPool> cpu_pool,
+                      bool traced_module,
+                      int32_t num_workers) {
+            return std::make_shared<torch_ipex::runtime::TaskModule>(
+                module, (*cpu_pool), traced_module, num_workers);
+          }),
+          py::arg("module"),
+          py::arg("cpu_pool"),
+          py::arg("traced_module"),
+          py::arg("num_workers") = 1)
+      .def(
+          py::init([](const py::object& module,
+                      std::shared_ptr<torch_ipex::runtime::CPUPool> cpu_pool,
+                      int32_t num_workers) {
+            return std::make_shared<torch_ipex::runtime::TaskModule>(
+                module, (*cpu_pool), num_workers);
+          }),
+          py::arg("module"),
+          py::arg("cpu_pool"),
+          py::arg("num_workers") = 1)
       .def(
           "run_sync",
           [](torch_ipex::runtime::TaskModule& self,
@@ -227,11 +267,65 @@ void InitIpexModuleBindings(py::module m) {
             // Depending on this being ScriptModule of nn.Module we will release
             // the GIL or not further down in the stack
             return self.run_async(std::move(args), std::move(kwargs));
-          });
+          })
+      .def(
+          "enable_batching",
+          &torch_ipex::runtime::TaskModule::enable_batching,
+          py::arg("max_batch_size"),
+          py::arg("batch_timeout_us"))
+      .def(
+          "is_batching_enabled",
+          &torch_ipex::runtime::TaskModule::is_batching_enabled)
+      .def(
+          "get_stats",
+          [](const torch_ipex::runtime::TaskModule& self) {
+            // Latencies are in nanoseconds.
+            auto stats = self.get_stats();
+            py::dict res;
+            res["num_submitted_tasks"] = stats.num_submitted_tasks;
+            res["num_completed_tasks"] = stats.num_completed_tasks;
+            res["queue_length"] = stats.queue_length;
+            res["queue_length_high_water_mark"] =
+                stats.queue_length_high_water_mark;
+            res["wait_time_mean"] = stats.wait_time_mean;
+            res["wait_time_p50"] = stats.wait_time_p50;
+            res["wait_time_p99"] = stats.wait_time_p99;
+            res["wait_time_max"] = stats.wait_time_max;
+            res["exec_time_mean"] = stats.exec_time_mean;
+            res["exec_time_p50"] = stats.exec_time_p50;
+            res["exec_time_p99"] = stats.exec_time_p99;
+            res["exec_time_max"] = stats.exec_time_max;
+            res["elapsed_time"] = stats.elapsed_time;
+            res["worker_utilization"] = stats.worker_utilization;
+            res["worker_cores"] = stats.worker_cores;
+            return res;
+          })
+      .def("reset_stats", &torch_ipex::runtime::TaskModule::reset_stats);
 
   m.def(
       "get_process_available_cores",
       &torch_ipex::runtime::get_process_available_cores);
+  m.def(
+      "partition_process_available_cores",
+      &torch_ipex::runtime::partition_process_available_cores,
+      py::arg("num_instances"),
+      py::arg("include_smt_siblings") = false);
+  m.def("get_cpu_topology", []() {
+    // Each logical core is returned as a dict of its topology information.
+    py::list cores;
+    for (auto& core :
+         torch_ipex::runtime::CPUTopology::get_cpu_topology().get_cores()) {
+      py::dict core_info;
+      core_info["cpu_id"] = core.cpu_id;
+      core_info["socket_id"] = core.socket_id;
+      core_info["numa_node_id"] = core.numa_node_id;
+      core_info["physical_core_id"] = core.physical_core_id;
+      core_info["l3_domain_id"] = core.l3_domain_id;
+      core_info["is_smt_sibling"] = core.is_smt_sibling;
+      cores.append(core_info);
+    }
+    return cores;
+  });
   m.def("is_runtime_ext_enabled", &torch_ipex::runtime::is_runtime_ext_enabled);
   m.def("init_runtime_ext", &torch_ipex::runtime::init_runtime_ext);
   m.def(
@@ -273,6 +367,17 @@ void InitIpexModuleBindings(py::module m) {
   m.def("tpp_fused_lamb", &torch_ipex::tpp::fused_lamb);
   m.def("tpp_fused_lamb_v2", &torch_ipex::tpp::fused_lamb_v2);
 
+  // tpp-for-allreduce
+  m.def(
+      "tpp_shm_allreduce",
+      &torch_ipex::cpu::tpp_shmallreduce_forward,
+      py::arg("t_in"),
+      py::arg("process_group"),
+      py::arg("wire_dtype") = "auto");
+  m.def(
+      "tpp_shm_hierarchical_allreduce",
+      &torch_ipex::cpu::tpp_shm_hierarchical_allreduce_forward);
+
   // Module version
   m.def("_get_mkl_version", []() {
     return torch_ipex::utils::get_mkl_version();
@@ -1,5 +1,7 @@
 #include "TaskModule.h"
 
+#include <torch/csrc/autograd/python_variable.h>
+
 namespace torch_ipex {
 namespace runtime {
 
@@ -21,20 +23,197 @@ py::object FutureTensor::get() {
   }
 }
 
+namespace {
+std::shared_ptr<TaskExecutor> create_task_executor(
+    const torch_ipex::runtime::CPUPool& cpu_pool,
+    int32_t num_workers) {
+  if (num_workers > 1) {
+    return std::make_shared<TaskExecutor>(cpu_pool, num_workers);
+  }
+  return std::make_shared<TaskExecutor>(cpu_pool);
+}
+
+// Return the shared size of dim 0 of the inputs, or -1 if the inputs can't be
+// concatenated along dim 0.
+int64_t get_batch_size(const std::vector<at::Tensor>& inputs) {
+  int64_t batch_size = -1;
+  for (auto& input : inputs) {
+    if (!input.defined() || input.dim() == 0) {
+      return -1;
+    }
+    if (batch_size == -1) {
+      batch_size = input.size(0);
+    } else if (input.size(0) != batch_size) {
+      return -1;
+    }
+  }
+  return batch_size;
+}
+
+// Requests can join the same batch only when each input has the same dtype
+// and the same sizes except dim 0.
+bool is_same_batch_signature(
+    const std::vector<at::Tensor>& inputs,
+    const std::vector<at::Tensor>& other_inputs) {
+  if (inputs.size() != other_inputs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (inputs[i].scalar_type() != other_inputs[i].scalar_type() ||
+        inputs[i].sizes().slice(1) != other_inputs[i].sizes().slice(1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool is_splittable(const at::Tensor& output, int64_t batch_size) {
+  return output.dim() > 0 && output.size(0) == batch_size;
+}
+
+// Split the batched output along dim 0 by the batch size of each request.
+// Tensor and the nested tuple/list of tensors are supported, return false for
+// the other outputs.
+bool scatter_batched_output(
+    const c10::IValue& output,
+    const std::vector<int64_t>& batch_sizes,
+    int64_t batch_size,
+    std::vector<c10::IValue>& results) {
+  results.resize(batch_sizes.size());
+  if (output.isTensor()) {
+    if (!is_splittable(output.toTensor(), batch_size)) {
+      return false;
+    }
+    auto chunks = output.toTensor().split_with_sizes(batch_sizes, 0);
+    for (size_t i = 0; i < batch_sizes.size(); i++) {
+      results[i] = chunks[i];
+    }
+  } else if (output.isTuple()) {
+    std::vector<std::vector<c10::IValue>> scattered(batch_sizes.size());
+    for (auto& element : output.toTupleRef().elements()) {
+      std::vector<c10::IValue> element_results;
+      if (!scatter_batched_output(
+              element, batch_sizes, batch_size, element_results)) {
+        return false;
+      }
+      for (size_t i = 0; i < batch_sizes.size(); i++) {
+        scattered[i].emplace_back(std::move(element_results[i]));
+      }
+    }
+    for (size_t i = 0; i < batch_sizes.size(); i++) {
+      results[i] = c10::ivalue::Tuple::create(std::move(scattered[i]));
+    }
+  } else if (output.isList()) {
+    auto output_list = output.toList();
+    std::vector<c10::impl::GenericList> scattered(
+        batch_sizes.size(), c10::impl::GenericList(output_list.elementType()));
+    for (size_t j = 0; j < output_list.size(); j++) {
+      std::vector<c10::IValue> element_results;
+      if (!scatter_batched_output(
+              output_list.get(j), batch_sizes, batch_size, element_results)) {
+        return false;
+      }
+      for (size_t i = 0; i < batch_sizes.size(); i++) {
+        scattered[i].emplace_back(std::move(element_results[i]));
+      }
+    }
+    for (size_t i = 0; i < batch_sizes.size(); i++) {
+      results[i] = std::move(scattered[i]);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The same as scatter_batched_output for the output of the nn module, the
+// tuple, namedtuple and list keep their Python types. GIL should be held.
+bool scatter_batched_output(
+    const py::handle& output,
+    const std::vector<int64_t>& batch_sizes,
+    int64_t batch_size,
+    std::vector<py::object>& results) {
+  results.resize(batch_sizes.size());
+  if (THPVariable_Check(output.ptr())) {
+    auto output_tensor = THPVariable_Unpack(output.ptr());
+    if (!is_splittable(output_tensor, batch_size)) {
+      return false;
+    }
+    auto chunks = output_tensor.split_with_sizes(batch_sizes, 0);
+    for (size_t i = 0; i < batch_sizes.size(); i++) {
+      results[i] = torch::jit::toPyObject(c10::IValue(std::move(chunks[i])));
+    }
+    return true;
+  }
+  bool is_tuple = PyTuple_CheckExact(output.ptr());
+  bool is_namedtuple =
+      py::isinstance<py::tuple>(output) && py::hasattr(output, "_fields");
+  bool is_list = PyList_CheckExact(output.ptr());
+  if (!is_tuple && !is_namedtuple && !is_list) {
+    return false;
+  }
+  std::vector<std::vector<py::object>> scattered(batch_sizes.size());
+  for (auto element : output) {
+    std::vector<py::object> element_results;
+    if (!scatter_batched_output(
+            element, batch_sizes, batch_size, element_results)) {
+      return false;
+    }
+    for (size_t i = 0; i < batch_sizes.size(); i++) {
+      scattered[i].emplace_back(std::move(element_results[i]));
+    }
+  }
+  for (size_t i = 0; i < batch_sizes.size(); i++) {
+    if (is_list) {
+      py::list elements(scattered[i].size());
+      for (size_t j = 0; j < scattered[i].size(); j++) {
+        elements[j] = std::move(scattered[i][j]);
+      }
+      results[i] = std::move(elements);
+    } else {
+      py::tuple elements(scattered[i].size());
+      for (size_t j = 0; j < scattered[i].size(); j++) {
+        elements[j] = std::move(scattered[i][j]);
+      }
+      if (is_namedtuple) {
+        results[i] = output.get_type()(*elements);
+      } else {
+        results[i] = std::move(elements);
+      }
+    }
+  }
+  return true;
+}
+void set_exception(BatchRequest& request, std::exception_ptr exception) {
+  // Only one of the promises is waited on by the FutureTensor. The promise
+  // whose result has been set is skipped.
+  try {
+    request.promise.set_exception(exception);
+  } catch (const std::future_error&) {
+  }
+  try {
+    request.module_promise.set_exception(exception);
+  } catch (const std::future_error&) {
+  }
+}
+} // namespace
+
 TaskModule::TaskModule(
     const torch::jit::Module& script_module,
     const torch_ipex::runtime::CPUPool& cpu_pool,
-    bool traced_module)
+    bool traced_module,
+    int32_t num_workers)
     : script_module_(script_module) {
-  this->task_executor = std::make_shared<TaskExecutor>(cpu_pool);
+  this->task_executor = create_task_executor(cpu_pool, num_workers);
   this->script_module_initialized_ = true;
 }
 
 TaskModule::TaskModule(
     const py::object& module,
-    const torch_ipex::runtime::CPUPool& cpu_pool)
+    const torch_ipex::runtime::CPUPool& cpu_pool,
+    int32_t num_workers)
     : module_(module) {
-  this->task_executor = std::make_shared<TaskExecutor>(cpu_pool);
+  this->task_executor = create_task_executor(cpu_pool, num_workers);
   this->module_initialized_ = true;
 }
 
@@ -65,6 +244,25 @@ std::unique_ptr<FutureTensor> TaskModule::run_async(
           std::move(kwargs),
           script_module_._ivalue());
 
+      if (this->batching_enabled_ && this->batched_output_supported_) {
+        // stack[0] is the module itself.
+        std::vector<at::Tensor> inputs;
+        for (size_t i = 1; i < stack.size(); i++) {
+          if (!stack[i].isTensor()) {
+            inputs.clear();
+            break;
+          }
+          inputs.emplace_back(stack[i].toTensor());
+        }
+        if (!inputs.empty()) {
+          auto batched_result =
+              this->submit_batch_request(std::move(inputs), grad_mode);
+          if (batched_result) {
+            return batched_result;
+          }
+        }
+      }
+
       typedef std::function<c10::IValue(std::vector<at::IValue>)>
           SubmitFunctionType;
       typedef decltype(SubmitFunctionType()(stack)) return_type;
@@ -78,59 +276,272 @@ std::unique_ptr<FutureTensor> TaskModule::run_async(
       future_tensor_result->script_module_initialized_ = true;
       future_tensor_result->future_script_tensor = task->get_future();
 
-      {
-        std::unique_lock<std::mutex> lock(this->task_executor->get_mutex());
-        // submit task to a stopping the pool is not allowed
-        if (this->task_executor->is_stop())
-          throw std::runtime_error(
-              "submit TaskModule(py::object) on stopped ThreadPool");
-        this->task_executor->get_tasks().emplace([task, grad_mode]() {
-          // set the thread local status, such as the grad mode before
-          // execuating the status
-          at::GradMode::set_enabled(grad_mode);
-          // execuate the task
-          (*task)();
-        });
-      }
-      this->task_executor->get_condition().notify_one();
+      this->task_executor->submit([task, grad_mode]() {
+        // set the thread local status, such as the grad mode before
+        // execuating the status
+        at::GradMode::set_enabled(grad_mode);
+        // execuate the task
+        (*task)();
+      });
     }
   } else {
     CHECK(this->module_initialized_);
-    this->args = args;
-    this->kwargs = kwargs;
+
+    if (this->batching_enabled_ && this->batched_output_supported_ &&
+        kwargs.size() == 0 && args.size() > 0) {
+      std::vector<at::Tensor> inputs;
+      for (auto& arg : args) {
+        if (!THPVariable_Check(arg.ptr())) {
+          inputs.clear();
+          break;
+        }
+        inputs.emplace_back(THPVariable_Unpack(arg.ptr()));
+      }
+      if (!inputs.empty()) {
+        pybind11::gil_scoped_release no_gil_guard;
+        auto batched_result =
+            this->submit_batch_request(std::move(inputs), grad_mode);
+        if (batched_result) {
+          return batched_result;
+        }
+      }
+    }
 
     typedef std::function<py::object()> SubmitFunctionType;
     typedef decltype(SubmitFunctionType()()) return_type;
+    // The inputs are owned by each task rather than TaskModule, since several
+    // tasks may be in flight at the same time with work stealing TaskExecutor.
     auto task = std::make_shared<std::packaged_task<return_type()>>(
-        [&, this]() -> py::object {
+        [this,
+         task_args = std::move(args),
+         task_kwargs = std::move(kwargs)]() mutable -> py::object {
           {
             pybind11::gil_scoped_acquire gil_guard;
-            return this->module_(*(this->args), **(this->kwargs));
+            // Release the inputs while holding GIL.
+            py::args call_args = std::move(task_args);
+            py::kwargs call_kwargs = std::move(task_kwargs);
+            return this->module_(*call_args, **call_kwargs);
           }
         });
 
     future_tensor_result->module_initialized_ = true;
     future_tensor_result->future_tensor = task->get_future();
 
-    {
-      std::unique_lock<std::mutex> lock(this->task_executor->get_mutex());
-      // submit task to a stopping the pool is not allowed
-      if (this->task_executor->is_stop())
-        throw std::runtime_error(
-            "submit TaskModule(py::object) on stopped ThreadPool");
-      this->task_executor->get_tasks().emplace([task, grad_mode]() {
-        // set the thread local status, such as the grad mode before execuating
-        // the status
-        at::GradMode::set_enabled(grad_mode);
-        // execuate the task
-        (*task)();
-      });
+    this->task_executor->submit([task, grad_mode]() {
+      // set the thread local status, such as the grad mode before execuating
+      // the status
+      at::GradMode::set_enabled(grad_mode);
+      // execuate the task
+      (*task)();
+    });
+  }
+  return future_tensor_result;
+}
+
+void TaskModule::enable_batching(
+    int64_t max_batch_size,
+    int64_t batch_timeout_us) {
+  if (max_batch_size < 1 || batch_timeout_us < 0) {
+    throw std::runtime_error(
+        "Fail to enable batching of TaskModule. max_batch_size should be "
+        "positive and batch_timeout_us should be non-negative.");
+  }
+  std::lock_guard<std::mutex> lock(this->batch_mutex_);
+  this->max_batch_size_ = max_batch_size;
+  this->batch_timeout_ = std::chrono::microseconds(batch_timeout_us);
+  this->batched_output_supported_ = true;
+  this->batching_enabled_ = max_batch_size > 1;
+}
+
+bool TaskModule::is_batching_enabled() const {
+  return this->batching_enabled_;
+}
+
+TaskExecutorStats TaskModule::get_stats() const {
+  return this->task_executor->get_stats();
+}
+
+void TaskModule::reset_stats() {
+  this->task_executor->reset_stats();
+}
+
+std::unique_ptr<FutureTensor> TaskModule::submit_batch_request(
+    std::vector<at::Tensor>&& inputs,
+    bool grad_mode) {
+  int64_t batch_size = get_batch_size(inputs);
+  if (batch_size < 0) {
+    return nullptr;
+  }
+  // submit task to a stopping the pool is not allowed
+  if (this->task_executor->is_stop()) {
+    throw std::runtime_error("Task submit on stopped ThreadPool");
+  }
+
+  auto request = std::make_unique<BatchRequest>();
+  request->inputs = std::move(inputs);
+  request->batch_size = batch_size;
+  std::unique_ptr<FutureTensor> future_tensor_result =
+      std::make_unique<FutureTensor>();
+  if (this->script_module_initialized_) {
+    future_tensor_result->script_module_initialized_ = true;
+    future_tensor_result->future_script_tensor = request->promise.get_future();
+  } else {
+    future_tensor_result->module_initialized_ = true;
+    future_tensor_result->future_tensor = request->module_promise.get_future();
+  }
+
+  std::shared_ptr<Batch> new_batch;
+  {
+    std::lock_guard<std::mutex> lock(this->batch_mutex_);
+    if (this->open_batch_ &&
+        (this->open_batch_->grad_mode != grad_mode ||
+         this->open_batch_->batch_size + batch_size > this->max_batch_size_ ||
+         !is_same_batch_signature(
+             this->open_batch_->requests[0]->inputs, request->inputs))) {
+      // Dispatch the open batch early, the request starts a new batch.
+      this->open_batch_->sealed = true;
+      this->open_batch_->sealed_condition.notify_one();
+      this->open_batch_.reset();
+    }
+    if (!this->open_batch_) {
+      new_batch = std::make_shared<Batch>();
+      new_batch->grad_mode = grad_mode;
+      new_batch->deadline =
+          std::chrono::steady_clock::now() + this->batch_timeout_;
+      this->open_batch_ = new_batch;
+    }
+    this->open_batch_->batch_size += batch_size;
+    this->open_batch_->requests.emplace_back(std::move(request));
+    if (this->open_batch_->batch_size >= this->max_batch_size_) {
+      this->open_batch_->sealed = true;
+      this->open_batch_->sealed_condition.notify_one();
+      this->open_batch_.reset();
     }
-    this->task_executor->get_condition().notify_one();
+  }
+  // Each batch is driven by one task of the executor. The task waits for the
+  // batching window inside the executor, so no extra thread is needed.
+  if (new_batch) {
+    this->task_executor->submit(
+        [this, new_batch]() { this->run_batch(new_batch); });
   }
   return future_tensor_result;
 }
 
+void TaskModule::run_batch(std::shared_ptr<Batch> batch) {
+  {
+    std::unique_lock<std::mutex> lock(this->batch_mutex_);
+    batch->sealed_condition.wait_until(
+        lock, batch->deadline, [&batch] { return batch->sealed; });
+    batch->sealed = true;
+    if (this->open_batch_ == batch) {
+      this->open_batch_.reset();
+    }
+  }
+
+  auto& requests = batch->requests;
+  at::GradMode::set_enabled(batch->grad_mode);
+  if (requests.size() > 1) {
+    try {
+      if (this->run_batched_requests(requests)) {
+        return;
+      }
+    } catch (...) {
+      for (auto& request : requests) {
+        set_exception(*request, std::current_exception());
+      }
+      return;
+    }
+  }
+  // Run the requests one by one when the batched output can't be scattered,
+  // e.g. a dict.
+  for (auto& request : requests) {
+    try {
+      this->run_request(*request);
+    } catch (...) {
+      set_exception(*request, std::current_exception());
+    }
+  }
+}
+
+bool TaskModule::run_batched_requests(
+    std::vector<std::unique_ptr<BatchRequest>>& requests) {
+  std::vector<int64_t> batch_sizes;
+  int64_t batch_size = 0;
+  for (auto& request : requests) {
+    batch_sizes.emplace_back(request->batch_size);
+    batch_size += request->batch_size;
+  }
+  // The inputs of the requests are kept for the fallback.
+  std::vector<at::Tensor> inputs;
+  for (size_t i = 0; i < requests[0]->inputs.size(); i++) {
+    std::vector<at::Tensor> input_slices;
+    for (auto& request : requests) {
+      input_slices.emplace_back(request->inputs[i]);
+    }
+    inputs.emplace_back(at::cat(input_slices, 0));
+  }
+  if (this->script_module_initialized_) {
+    std::vector<c10::IValue> results;
+    if (!scatter_batched_output(
+            this->script_module_forward(std::move(inputs)),
+            batch_sizes,
+            batch_size,
+            results)) {
+      this->batched_output_supported_ = false;
+      return false;
+    }
+    for (size_t i = 0; i < requests.size(); i++) {
+      requests[i]->promise.set_value(std::move(results[i]));
+    }
+    return true;
+  }
+  pybind11::gil_scoped_acquire gil_guard;
+  std::vector<py::object> results;
+  if (!scatter_batched_output(
+          this->module_forward(std::move(inputs)),
+          batch_sizes,
+          batch_size,
+          results)) {
+    this->batched_output_supported_ = false;
+    return false;
+  }
+  for (size_t i = 0; i < requests.size(); i++) {
+    requests[i]->module_promise.set_value(std::move(results[i]));
+  }
+  return true;
+}
+
+void TaskModule::run_request(BatchRequest& request) {
+  if (this->script_module_initialized_) {
+    request.promise.set_value(
+        this->script_module_forward(std::move(request.inputs)));
+    return;
+  }
+  pybind11::gil_scoped_acquire gil_guard;
+  request.module_promise.set_value(
+      this->module_forward(std::move(request.inputs)));
+}
+
+c10::IValue TaskModule::script_module_forward(
+    std::vector<at::Tensor>&& inputs) {
+  auto& function = script_module_.get_method("forward").function();
+  std::vector<at::IValue> stack;
+  stack.reserve(inputs.size() + 1);
+  stack.emplace_back(script_module_._ivalue());
+  for (auto& input : inputs) {
+    stack.emplace_back(std::move(input));
+  }
+  return function(std::move(stack));
+}
+
+py::object TaskModule::module_forward(std::vector<at::Tensor>&& inputs) {
+  py::tuple call_args(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    call_args[i] = torch::jit::toPyObject(c10::IValue(std::move(inputs[i])));
+  }
+  return this->module_(*call_args);
+}
+
 py::object TaskModule::run_sync(py::args&& args, py::kwargs&& kwargs) {
   // sync API to run application inside task
   std::unique_ptr<FutureTensor> future_tensor_result =
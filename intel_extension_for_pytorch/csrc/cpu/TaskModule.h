@@ -1,10 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
@@ -28,16 +32,42 @@ struct FutureTensor {
   py::object get();
 };
 
+/*BatchRequest is one run_async call coalesced into a batched forward*/
+struct BatchRequest {
+  std::vector<at::Tensor> inputs;
+  int64_t batch_size;
+  // The result of the script module
+  std::promise<c10::IValue> promise;
+  // The result of the nn module, which keeps its Python type
+  std::promise<py::object> module_promise;
+};
+
+/*Batch collects the compatible BatchRequests within the batching window*/
+struct Batch {
+  std::vector<std::unique_ptr<BatchRequest>> requests;
+  int64_t batch_size{0};
+  // No more request is allowed to join when the batch is sealed.
+  bool sealed{false};
+  std::chrono::steady_clock::time_point deadline;
+  std::condition_variable sealed_condition;
+  bool grad_mode;
+};
+
 /*TaskModule is used to handle Python input of nn.module or script module*/
 class TaskModule {
  public:
+  // num_workers > 1 creates a work stealing TaskExecutor, which splits the
+  // cpu_pool into num_workers sub partitions. Otherwise a single worker
+  // TaskExecutor is used.
   explicit TaskModule(
       const torch::jit::Module& module,
       const torch_ipex::runtime::CPUPool& cpu_pool,
-      bool traced_module);
+      bool traced_module,
+      int32_t num_workers = 1);
   explicit TaskModule(
       const py::object& module,
-      const torch_ipex::runtime::CPUPool& cpu_pool);
+      const torch_ipex::runtime::CPUPool& cpu_pool,
+      int32_t num_workers = 1);
   TaskModule(const TaskModule& task_module) = delete;
   TaskModule(TaskModule&& task_module) = delete;
   TaskModule& operator=(const TaskModule& task_module) = delete;
@@ -47,7 +77,32 @@ class TaskModule {
   std::unique_ptr<FutureTensor> run_async(
       py::args&& args,
       py::kwargs&& kwargs); /*async execution in threadpool*/
+  // Opt in to coalesce the concurrent run_async calls into one batched
+  // forward. A batch is dispatched when it reaches max_batch_size samples
+  // along dim 0, or batch_timeout_us after its first request arrived.
+  void enable_batching(int64_t max_batch_size, int64_t batch_timeout_us);
+  bool is_batching_enabled() const;
+  // Telemetry of the TaskExecutor, see TaskExecutorStats.
+  TaskExecutorStats get_stats() const;
+  void reset_stats();
+
  private:
+  // Try to join the request into the open batch. Return nullptr when the
+  // inputs are not batchable, then the request is submitted individually.
+  std::unique_ptr<FutureTensor> submit_batch_request(
+      std::vector<at::Tensor>&& inputs,
+      bool grad_mode);
+  void run_batch(std::shared_ptr<Batch> batch);
+  // Run the concatenated inputs of the requests and scatter the output.
+  // Return false without setting any result if the output can't be
+  // scattered, then the requests should run one by one.
+  bool run_batched_requests(
+      std::vector<std::unique_ptr<BatchRequest>>& requests);
+  void run_request(BatchRequest& request);
+  c10::IValue script_module_forward(std::vector<at::Tensor>&& inputs);
+  // GIL should be held by the caller.
+  py::object module_forward(std::vector<at::Tensor>&& inputs);
+
   // Script module input
   torch::jit::Module script_module_;
   bool script_module_initialized_{false};
@@ -57,8 +112,16 @@ class TaskModule {
 
   // TaskExecutor
   std::shared_ptr<TaskExecutor> task_executor;
-  py::args args;
-  py::kwargs kwargs;
+
+  // Dynamic batching
+  std::atomic<bool> batching_enabled_{false};
+  // Cleared once the output of the module is found not splittable, then the
+  // requests are no longer batched.
+  std::atomic<bool> batched_output_supported_{true};
+  int64_t max_batch_size_{1};
+  std::chrono::microseconds batch_timeout_{0};
+  std::mutex batch_mutex_;
+  std::shared_ptr<Batch> open_batch_;
 };
 
 } // namespace runtime
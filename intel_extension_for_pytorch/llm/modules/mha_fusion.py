@@ -1,6 +1,6 @@
 import torch
 import torch.nn as nn
-from typing import Optional, Tuple
+from typing import List, Optional, Tuple
 from .utils import IPEXRuntimeCustomOps, IPEXCustomOpType
 
 
@@ -473,10 +473,34 @@ class PagedAttention:
         slot_mapping (torch.Tensor):  It stores the position to store the key/value in the pre-allocated buffers.
             The shape should be the number of sequences. For sequence ``i``, the ``slot_mapping[i] // block_number``
             can get the block index, and the ``slot_mapping % block_size`` can get the offset of this block.
-        kv_cache_dtype (str): The data type of the key and value cache.
+        kv_cache_dtype (str): The data type of the key and value cache, "auto", "fp8", "int8" or "int4".
+            The "int8" and "int4" caches are uint8 tensors with the shape from ``get_kv_cache_shape``,
+            the values are quantized with an asymmetric scale and zero point per (block, head), which
+            are stored in the first row of the block. The tokens of a block should be stored in order.
+            The "vnni" caches are bfloat16 tensors in the VNNI packed layout of the AMX/VNNI GEMMs, the key
+            block of a head is stored transposed as [head_size / 2, block_size, 2] and the value block as
+            [block_size / 2, head_size, 2], so ``single_query_cached_kv_attention`` and ``flash_attn_varlen_func``
+            read the blocks without repacking. The shapes are from ``get_kv_cache_shape``.
         k_scale (float): The scale used by the fp8 key cache.
         v_scale (float): The scale used by the fp8 value cache.
 
+    [class method]: get_kv_cache_shape
+
+    .. highlight:: python
+    .. code-block:: python
+
+        ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+            num_blocks,
+            num_heads,
+            block_size,
+            head_size,
+            kv_cache_dtype,
+            is_key
+        )
+
+    This operator returns the shape of the key or value cache buffer for the kv_cache_dtype. The key and
+    value caches only differ for the "vnni" layout, where ``is_key`` selects the transposed key layout.
+
     [class method]: reshape_and_cache_flash
     ipex.llm.modules.PagedAttention.reshape_and_cache_flash(key, value, key_cache, value_cache, slot_mapping, k_scale, v_scale)
     This operator is used to store the key/value token states into the pre-allcated kv_cache buffers of paged attention.
@@ -514,7 +538,10 @@ class PagedAttention:
             alibi_slopes,
             window_size,
             k_scale,
-            v_scale
+            v_scale,
+            softcap,
+            evicted_lens,
+            num_sink_tokens
         )
 
     This operator is used to be calculated the scale-dot-product based on the paged attention.
@@ -542,6 +569,190 @@ class PagedAttention:
         v_scale (float): The scale used by the fp8 value cache.
         alibi_slopes (torch.Tensor, optinal): which is the alibi slope with the shape of (num_heads).
         softcap (float): the positive softcap value to apply on the attention weights, default is -1.
+        evicted_lens (torch.Tensor, optional): The number of tokens evicted by ``evict_kv_blocks`` for every
+            sequence, with the shape of [num_seqs]. The positions of the tokens after the sink blocks are shifted
+            by it for the alibi and the sliding window, default is None.
+        num_sink_tokens (int): The number of leading tokens which are always attended besides the sliding
+            window, default is 0.
+
+    The kernel is chosen by a heuristic of the batch size and the number of cores. With the environment
+    variable ``PAGED_ATTENTION_AUTOTUNE=1``, the kernels and the partition sizes of flash decoding are
+    timed on the first call of every shape bucket instead, and the fastest one is used by the later calls.
+    The decisions are stored per CPU model in the file of ``PAGED_ATTENTION_AUTOTUNE_CACHE``
+    (``~/.cache/ipex_paged_attention_autotune.txt`` by default) and reused by the later processes.
+
+    [class method]: single_query_cached_kv_attention_with_rope
+
+    .. highlight:: python
+    .. code-block:: python
+
+        ipex.llm.modules.PagedAttention.single_query_cached_kv_attention_with_rope(
+            out,
+            query,
+            key,
+            value,
+            key_cache,
+            value_cache,
+            slot_mapping,
+            rope_emb_pos,
+            positions,
+            rotary_offset,
+            rotary_ndims,
+            head_mapping,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            kv_cache_dtype,
+            k_scale,
+            v_scale,
+            softcap
+        )
+
+    This operator fuses the rotary position embedding of the new token, ``reshape_and_cache`` and
+    ``single_query_cached_kv_attention`` for a decoding step. The query/key are rotated in one pass, the
+    rotated key and the value are written into their cache slots directly, and the attention is calculated
+    with the rotated query. The other args are the same as ``reshape_and_cache`` and
+    ``single_query_cached_kv_attention``.
+
+    Args:
+        key (torch.Tensor): The key tensor before RoPE. The shape should be [num_seqs, num_kv_heads, head_size].
+        value (torch.Tensor): The value tensor. The shape should be [num_seqs, num_kv_heads, head_size].
+        rope_emb_pos (torch.Tensor): The float sin/cos table of ``rotary_position_embedding`` with the shape of
+            [max_position, rotary_ndims], the sin of a position is followed by the cos.
+        positions (torch.Tensor): The position of the new token of every sequence, [num_seqs].
+        rotary_offset (int): 1 for the GPT-J style RoPE (rotate every two), or ``rotary_ndims // 2`` for the
+            GPT-NeoX/LLaMA style (rotate half).
+        rotary_ndims (int): The number of the rotated elements of every head.
+
+    [class method]: evict_kv_blocks
+
+    .. highlight:: python
+    .. code-block:: python
+
+        evicted_blocks = ipex.llm.modules.PagedAttention.evict_kv_blocks(
+            block_tables,
+            context_lens,
+            evicted_lens,
+            block_size,
+            num_sink_tokens,
+            window_size
+        )
+
+    This operator bounds the KV cache of the long sequences with the sliding window, optionally with the
+    attention sinks of StreamingLLM. The blocks entirely out of the last ``window_size`` tokens, except the
+    blocks of the first ``num_sink_tokens`` tokens, are removed from ``block_tables`` in place, the remaining
+    blocks are moved forward and the vacated entries are set to -1. ``context_lens`` is reduced and
+    ``evicted_lens`` is increased by the evicted tokens. The same ``evicted_lens``, ``window_size`` and
+    ``num_sink_tokens`` should be passed to ``single_query_cached_kv_attention`` to keep the alibi and the
+    sliding window in the original positions. The keys are cached after RoPE, so the new tokens should still
+    use their original positions for RoPE, and their slots should be computed from the compacted block tables.
+
+    Args:
+        block_tables (torch.Tensor): The int block tables with the shape of [num_seqs, max_num_blocks_per_seq].
+        context_lens (torch.Tensor): The int sequence length of every sequence in the cache, [num_seqs].
+        evicted_lens (torch.Tensor): The int number of the evicted tokens of every sequence, [num_seqs].
+            It should be zeros for a new sequence.
+        block_size (int): The block size which means the number of token in every block.
+        num_sink_tokens (int): The number of leading tokens which are always kept.
+        window_size (int): The size of the sliding window.
+
+    Returns:
+        The evicted block ids, which can be allocated again by the cache manager. A block shared by several
+        sequences, such as the beams, is returned for each of them.
+
+    [class method]: copy_blocks
+
+    .. highlight:: python
+    .. code-block:: python
+
+        ipex.llm.modules.PagedAttention.copy_blocks(
+            key_caches,
+            value_caches,
+            block_mapping
+        )
+
+    This operator copies whole blocks in the key and value caches of all the layers in one call, such as the
+    copy on write of the blocks shared by the forked beams. The blocks are copied as raw bytes, so the fp8,
+    "int8"/"int4" and "vnni" caches are supported, together with the params of the quantized blocks.
+
+    Args:
+        key_caches (List[torch.Tensor]): The key caches of the layers.
+        value_caches (List[torch.Tensor]): The value caches of the layers.
+        block_mapping (torch.Tensor): The (source, destination) block ids with the shape of [num_pairs, 2].
+            A destination block should not be the source block of another pair.
+
+    [class method]: swap_blocks
+
+    .. highlight:: python
+    .. code-block:: python
+
+        ipex.llm.modules.PagedAttention.swap_blocks(
+            src_caches,
+            dst_caches,
+            block_mapping
+        )
+
+    This operator copies whole blocks from one set of caches to another in one call, such as swapping the
+    blocks of the preempted sequences out to or in from the caches in another memory tier. ``src_caches[i]``
+    and ``dst_caches[i]`` should have the same dtype and block shape, while the number of blocks can differ.
+
+    Args:
+        src_caches (List[torch.Tensor]): The source caches, e.g. the key and value caches of all the layers.
+        dst_caches (List[torch.Tensor]): The destination caches in the same order.
+        block_mapping (torch.Tensor): The (source, destination) block ids with the shape of [num_pairs, 2].
+
+    [class method]: multi_query_cached_kv_attention
+
+    .. highlight:: python
+    .. code-block:: python
+
+        ipex.llm.modules.PagedAttention.multi_query_cached_kv_attention(
+            out,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            num_queries,
+            query_mask,
+            k_scale,
+            v_scale,
+            softcap
+        )
+
+    This operator calculates the scale-dot-product of num_queries query tokens of every sequence
+    in one pass, such as verifying the draft tokens of speculative decoding. The key/value of the
+    query tokens should be stored into the cache by reshape_and_cache before.
+
+    Args:
+        out (torch.Tensor): The output tensor with shape of [num_seqs * num_queries, num_heads, head_size].
+        query (torch.Tensor): The query tensor. The shape should be [num_seqs * num_queries, num_heads, head_size],
+            the query tokens of a sequence are adjacent.
+        key_cache (torch.Tensor): The pre-allocated buffer to store the key cache.
+            The shape should be [num_blocks,  num_heads, block_size, head_size].
+        value_cache(torch.Tensor): The pre-allocated buffer to store the value cache.
+            The shape should be [num_blocks, num_heads, block_size, head_size].
+        scale (float): The scale used by the scale-dot-product.
+        block_tables:(torch.Tensor): The mapping table used to mapping the logical sequence
+            to the physical sequence. The shape should be [num_seqs, max_num_blocks_per_seq].
+        context_lens (torch.Tensor): The sequence length for every sequence including the query tokens.
+            The size is [num_seqs].
+        block_size (int): The block size which means the number of token in every block.
+        max_context_len (int): The max sequence length.
+        num_queries (int): The number of the query tokens of every sequence.
+        query_mask (torch.Tensor, optional): The [num_queries, num_queries] mask among the query tokens,
+            the query token ``i`` attends the query token ``j`` if ``query_mask[i][j]`` is True.
+            It is causal by default, the ancestor mask of a draft token tree can be used for tree verification.
+        k_scale (float): The scale used by the fp8 key cache.
+        v_scale (float): The scale used by the fp8 value cache.
+        softcap (float): the positive softcap value to apply on the attention weights, default is -1.
 
     [class method]: flash_atten_varlen
 
@@ -662,6 +873,8 @@ class PagedAttention:
         k_scale: float = 1.0,
         v_scale: float = 1.0,
         softcap: float = -1.0,
+        evicted_lens: Optional[torch.Tensor] = None,
+        num_sink_tokens: int = 0,
     ):
         return cls.runtime_ops.get_module_from_device(
             output.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
@@ -681,6 +894,143 @@ class PagedAttention:
             k_scale,
             v_scale,
             softcap,
+            evicted_lens,
+            num_sink_tokens,
+        )
+
+    @classmethod
+    def single_query_cached_kv_attention_with_rope(
+        cls,
+        output: torch.Tensor,
+        query: torch.Tensor,
+        key: torch.Tensor,
+        value: torch.Tensor,
+        key_cache: torch.Tensor,
+        value_cache: torch.Tensor,
+        slot_mapping: torch.Tensor,
+        rope_emb_pos: torch.Tensor,
+        positions: torch.Tensor,
+        rotary_offset: int,
+        rotary_ndims: int,
+        head_mapping: torch.Tensor,
+        scale: float,
+        block_tables: torch.Tensor,
+        context_lens: torch.Tensor,
+        block_size: int,
+        max_context_len: int,
+        alibi_slopes: Optional[torch.Tensor] = None,
+        window_size: int = -1,
+        kv_cache_dtype: str = "auto",
+        k_scale: float = 1.0,
+        v_scale: float = 1.0,
+        softcap: float = -1.0,
+    ):
+        return cls.runtime_ops.get_module_from_device(
+            output.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
+        ).single_query_cached_kv_attention_with_rope(
+            output,
+            query,
+            key,
+            value,
+            key_cache,
+            value_cache,
+            slot_mapping,
+            rope_emb_pos,
+            positions,
+            rotary_offset,
+            rotary_ndims,
+            head_mapping,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            kv_cache_dtype,
+            k_scale,
+            v_scale,
+            softcap,
+        )
+
+    @classmethod
+    def evict_kv_blocks(
+        cls,
+        block_tables: torch.Tensor,
+        context_lens: torch.Tensor,
+        evicted_lens: torch.Tensor,
+        block_size: int,
+        num_sink_tokens: int,
+        window_size: int,
+    ):
+        return cls.runtime_ops.get_module_from_device(
+            block_tables.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
+        ).evict_kv_blocks(
+            block_tables,
+            context_lens,
+            evicted_lens,
+            block_size,
+            num_sink_tokens,
+            window_size,
+        )
+
+    @classmethod
+    def copy_blocks(
+        cls,
+        key_caches: List[torch.Tensor],
+        value_caches: List[torch.Tensor],
+        block_mapping: torch.Tensor,
+    ):
+        return cls.runtime_ops.get_module_from_device(
+            block_mapping.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
+        ).copy_blocks(key_caches, value_caches, block_mapping)
+
+    @classmethod
+    def swap_blocks(
+        cls,
+        src_caches: List[torch.Tensor],
+        dst_caches: List[torch.Tensor],
+        block_mapping: torch.Tensor,
+    ):
+        return cls.runtime_ops.get_module_from_device(
+            block_mapping.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
+        ).swap_blocks(src_caches, dst_caches, block_mapping)
+
+    @classmethod
+    def multi_query_cached_kv_attention(
+        cls,
+        output: torch.Tensor,
+        query: torch.Tensor,
+        key_cache: torch.Tensor,
+        value_cache: torch.Tensor,
+        scale: float,
+        block_tables: torch.Tensor,
+        context_lens: torch.Tensor,
+        block_size: int,
+        max_context_len: int,
+        num_queries: int,
+        query_mask: Optional[torch.Tensor] = None,
+        k_scale: float = 1.0,
+        v_scale: float = 1.0,
+        softcap: float = -1.0,
+    ):
+        return cls.runtime_ops.get_module_from_device(
+            output.device.type, IPEXCustomOpType.PAGED_ATTENTION, False
+        ).multi_query_cached_kv_attention(
+            output,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            num_queries,
+            query_mask,
+            k_scale,
+            v_scale,
+            softcap,
         )
 
     @classmethod
@@ -728,6 +1078,30 @@ class PagedAttention:
             softcap,
         )
 
+    @classmethod
+    def get_kv_cache_shape(
+        cls,
+        num_blocks: int,
+        num_heads: int,
+        block_size: int,
+        head_size: int,
+        kv_cache_dtype: str = "auto",
+        is_key: bool = True,
+    ):
+        if kv_cache_dtype == "vnni":
+            assert (
+                head_size % 2 == 0 and block_size % 2 == 0
+            ), "head_size and block_size should be even for the vnni kv cache"
+            if is_key:
+                return (num_blocks, num_heads, head_size // 2, block_size, 2)
+            return (num_blocks, num_heads, block_size // 2, head_size, 2)
+        if kv_cache_dtype == "int8":
+            return (num_blocks, num_heads, block_size + 1, head_size)
+        if kv_cache_dtype == "int4":
+            assert head_size % 2 == 0, "head_size should be even for the int4 kv cache"
+            return (num_blocks, num_heads, block_size + 1, head_size // 2)
+        return (num_blocks, num_heads, block_size, head_size)
+
 
 class IndirectAccessKVCacheAttention(nn.Module):
     r"""
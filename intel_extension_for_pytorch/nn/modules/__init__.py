@@ -10,4 +10,5 @@ from .weight_only_quantization import (
     WeightOnlyQuantizedLinear,
     IpexWoqLinearAllreduce,
     WoqWeightFormat,
+    WoqPackedWeightCache,
 )
@@ -1,3 +1,5 @@
+import os
+import tempfile
 import torch
 from torch import nn
 from typing import Optional
@@ -37,6 +39,222 @@ class WoqWeightFormat(IntEnum):
     AWQ_FORMAT = 2
 
 
+# Version of the file format of WoqPackedWeightCache
+WOQ_PACKED_WEIGHT_CACHE_VERSION = 2
+# Number of the elements of qweight sampled by the fingerprint
+_WOQ_FINGERPRINT_SAMPLES = 4096
+# The WoqPackedWeightCache in use
+_woq_packed_weight_cache = None
+
+
+def _get_current_isa_level():
+    from intel_extension_for_pytorch import _C
+
+    return _C._get_current_isa_level()
+
+
+def _woq_checksum(t, num_samples=None):
+    # Integer checksum of the bits of the elements, so it is exact and
+    # deterministic. The sampled elements are weighted by their positions.
+    t = t.detach()
+    if t.is_quantized:
+        t = t.int_repr()
+    t = t.contiguous().view(-1)
+    if t.is_floating_point():
+        t = t.view({2: torch.int16, 4: torch.int32, 8: torch.int64}[t.element_size()])
+    t = t.to(torch.int64)
+    if num_samples is None or t.numel() <= num_samples:
+        return int(t.sum())
+    t = t[:: t.numel() // num_samples][:num_samples]
+    return int((t * torch.arange(1, t.numel() + 1, dtype=torch.int64)).sum())
+
+
+def _woq_fingerprint(qweight, scales):
+    return [
+        _woq_checksum(qweight, _WOQ_FINGERPRINT_SAMPLES),
+        _woq_checksum(scales),
+    ]
+
+
+class WoqPackedWeightCache:
+    r"""
+    An on-disk cache of the packed weights of the WOQ linear modules, so that
+    the following processes skip packing the weights when creating the modules.
+
+    If ``path`` does not exist, the packed weight, scales, zero points, bias,
+    compensation and quantization recipe of every WOQ linear module created in
+    the context are recorded in creation order, and saved to ``path`` on exit.
+    Otherwise ``path`` is loaded with mmap, and the modules are created from the
+    recorded packed weights, which are used zero-copy from the page cache. The
+    model and the quantization recipe should be the same as the recording run.
+    Every entry keeps a fingerprint of the quantized weight and scales, so a
+    cache recorded from another checkpoint of the same model is rejected, as
+    well as a cache saved by another format version or ISA level, or a cache
+    whose entries are not all used by the model.
+
+    .. highlight:: python
+    .. code-block:: python
+
+        with ipex.nn.modules.WoqPackedWeightCache("llama_woq_int4.pt"):
+            model = ipex.llm.optimize(model, quantization_config=qconfig)
+
+    Args:
+        path (str): the file of the cache.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.entries = []
+        self.index = 0
+        self.loading = False
+
+    def __enter__(self):
+        global _woq_packed_weight_cache
+        assert _woq_packed_weight_cache is None, "WoqPackedWeightCache is in use"
+        self.loading = os.path.exists(self.path)
+        if self.loading:
+            cache = torch.load(self.path, mmap=True, weights_only=True)
+            assert cache["version"] == WOQ_PACKED_WEIGHT_CACHE_VERSION, (
+                f"WoqPackedWeightCache: {self.path} has format version "
+                f"{cache['version']}, expect {WOQ_PACKED_WEIGHT_CACHE_VERSION}"
+            )
+            isa = _get_current_isa_level()
+            assert cache["isa"] == isa, (
+                f"WoqPackedWeightCache: {self.path} is saved on ISA "
+                f"{cache['isa']}, but the current ISA is {isa}"
+            )
+            self.entries = cache["entries"]
+        self.index = 0
+        _woq_packed_weight_cache = self
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        global _woq_packed_weight_cache
+        _woq_packed_weight_cache = None
+        if exc_type is not None:
+            return
+        if self.loading:
+            assert self.index == len(self.entries), (
+                f"WoqPackedWeightCache: {self.path} has {len(self.entries)} "
+                f"entries, but the model only uses {self.index} of them"
+            )
+            return
+        # Save to a temporary file first, so a crash during the save does not
+        # leave a truncated cache for the following processes to load
+        fd, tmp_path = tempfile.mkstemp(
+            dir=os.path.dirname(os.path.abspath(self.path)), suffix=".tmp"
+        )
+        os.close(fd)
+        try:
+            torch.save(
+                {
+                    "version": WOQ_PACKED_WEIGHT_CACHE_VERSION,
+                    "isa": _get_current_isa_level(),
+                    "entries": self.entries,
+                },
+                tmp_path,
+            )
+            os.replace(tmp_path, self.path)
+        except BaseException:
+            os.remove(tmp_path)
+            raise
+
+    def prepack(
+        self,
+        prepack_fn,
+        qweight,
+        scales,
+        weight_dtype,
+        weight_shape,
+        group_size,
+        lowp_mode,
+        act_quant_mode,
+        cache_weight_for_large_batch,
+    ):
+        recipe = [
+            int(weight_dtype),
+            list(weight_shape),
+            group_size,
+            int(lowp_mode),
+            int(act_quant_mode),
+            bool(cache_weight_for_large_batch),
+        ]
+        fingerprint = _woq_fingerprint(qweight, scales)
+        if not self.loading:
+            op_context = prepack_fn()
+            compensation = None
+            if weight_dtype == WoqWeightDtype.INT8 and lowp_mode == WoqLowpMode.INT8:
+                compensation = op_context.get_cached_compensation()
+            self.entries.append(
+                {
+                    "recipe": recipe,
+                    "fingerprint": fingerprint,
+                    "weight": op_context.get_weight(),
+                    "weight_shape": op_context.get_weight_shape(),
+                    "scales": op_context.get_scales(),
+                    "zero_points": op_context.get_zero_points(),
+                    "bias": op_context.get_bias(),
+                    "g_idx": op_context.get_g_idx(),
+                    "compensation": compensation,
+                }
+            )
+            return op_context
+        assert (
+            self.index < len(self.entries)
+            and self.entries[self.index]["recipe"] == recipe
+        ), (
+            f"WoqPackedWeightCache: {self.path} does not match the model or "
+            "the quantization recipe"
+        )
+        entry = self.entries[self.index]
+        assert entry["fingerprint"] == fingerprint, (
+            f"WoqPackedWeightCache: {self.path} is recorded from other weights, "
+            f"WOQ linear module #{self.index} of the model does not match"
+        )
+        self.index += 1
+        return torch.ops.ipex_prepack.weight_only_qlinear_prepack_from_packed(
+            entry["weight"],
+            recipe[0],
+            entry["weight_shape"],
+            entry["scales"],
+            entry["zero_points"],
+            entry["bias"],
+            entry["g_idx"],
+            entry["compensation"],
+            None,  # batch size
+            group_size,
+            recipe[3],
+            recipe[4],
+            recipe[5],
+        )
+
+
+def _woq_prepack(
+    prepack_fn,
+    qweight,
+    scales,
+    weight_dtype,
+    weight_shape,
+    group_size,
+    lowp_mode,
+    act_quant_mode,
+    cache_weight_for_large_batch,
+):
+    if _woq_packed_weight_cache is None:
+        return prepack_fn()
+    return _woq_packed_weight_cache.prepack(
+        prepack_fn,
+        qweight,
+        scales,
+        weight_dtype,
+        weight_shape,
+        group_size,
+        lowp_mode,
+        act_quant_mode,
+        cache_weight_for_large_batch,
+    )
+
+
 class WeightOnlyQuantizedLinear(nn.Module):
     r"""
     A weight-only quantized (WOQ) linear module with floating point tensor as inputs and outputs.
@@ -384,18 +602,28 @@ class WeightOnlyQuantizedLinear(nn.Module):
 
         if bias is not None and torch.count_nonzero(bias) == 0:
             bias = None
-        qlinear._op_context = torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
+        qlinear._op_context = _woq_prepack(
+            lambda: torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
+                qweight,
+                scales,
+                zero_points,
+                bias,
+                g_idx,
+                None,
+                group_size,
+                int(lowp_mode),
+                act_quant_mode,
+                cache_weight_for_large_batch,
+                weight_format,
+            ),
             qweight,
             scales,
-            zero_points,
-            bias,
-            g_idx,
-            None,
+            WoqWeightDtype.INT4,
+            [out_features, in_features],
             group_size,
-            int(lowp_mode),
+            lowp_mode,
             act_quant_mode,
             cache_weight_for_large_batch,
-            weight_format,
         )
         qlinear.weight = qlinear._op_context.get_weight()
         qlinear.bias = bias is not None
@@ -489,8 +717,8 @@ class WeightOnlyQuantizedLinear(nn.Module):
             bias = None
         qlinear = cls(mod.in_features, mod.out_features, bias is not None, dtype=dtype)
         if is_from_int4_weight:
-            qlinear._op_context = (
-                torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
+            qlinear._op_context = _woq_prepack(
+                lambda: torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
                     qweight,
                     scales,
                     zero_points,
@@ -502,20 +730,38 @@ class WeightOnlyQuantizedLinear(nn.Module):
                     act_quant_mode,
                     cache_weight_for_large_batch,
                     weight_format,
-                )
+                ),
+                qweight,
+                scales,
+                dtype,
+                [mod.out_features, mod.in_features],
+                group_size,
+                lowp_mode,
+                act_quant_mode,
+                cache_weight_for_large_batch,
             )
         else:
-            qlinear._op_context = torch.ops.ipex_prepack.weight_only_qlinear_prepack(
+            qlinear._op_context = _woq_prepack(
+                lambda: torch.ops.ipex_prepack.weight_only_qlinear_prepack(
+                    qweight,
+                    dtype,
+                    [mod.out_features, mod.in_features],
+                    scales,
+                    zero_points,
+                    bias,
+                    g_idx,
+                    None,  # batch size
+                    group_size,
+                    int(lowp_mode),
+                    act_quant_mode,
+                    cache_weight_for_large_batch,
+                ),
                 qweight,
+                scales,
                 dtype,
                 [mod.out_features, mod.in_features],
-                scales,
-                zero_points,
-                bias,
-                g_idx,
-                None,  # batch size
                 group_size,
-                int(lowp_mode),
+                lowp_mode,
                 act_quant_mode,
                 cache_weight_for_large_batch,
             )
@@ -586,8 +832,8 @@ class IpexWoqLinearAllreduce(WeightOnlyQuantizedLinear):
                 qlinear.original_bias = nn.Parameter(bias)
             else:
                 qlinear.original_bias = bias
-            qlinear._op_context = (
-                torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
+            qlinear._op_context = _woq_prepack(
+                lambda: torch.ops.ipex_prepack.weight_only_qlinear_prepack_int4(
                     qweight,
                     scales,
                     zero_points,
@@ -599,18 +845,36 @@ class IpexWoqLinearAllreduce(WeightOnlyQuantizedLinear):
                     act_quant_mode,
                     cache_weight_for_large_batch,
                     weight_format,
-                )
+                ),
+                qweight,
+                scales,
+                dtype,
+                [mod.out_features, mod.in_features],
+                group_size,
+                lowp_mode,
+                act_quant_mode,
+                cache_weight_for_large_batch,
             )
         else:
-            qlinear._op_context = torch.ops.ipex_prepack.weight_only_qlinear_prepack(
+            qlinear._op_context = _woq_prepack(
+                lambda: torch.ops.ipex_prepack.weight_only_qlinear_prepack(
+                    qweight,
+                    dtype,
+                    [mod.out_features, mod.in_features],
+                    scales,
+                    zero_points,
+                    None,  # Set bias to None when prepacking. Please refer to the comment in __init__ of _IPEXLinearAllreduce
+                    g_idx,
+                    None,  # batch_size
+                    group_size,
+                    lowp_mode,
+                    act_quant_mode,
+                    cache_weight_for_large_batch,
+                ),
                 qweight,
+                scales,
                 dtype,
                 [mod.out_features, mod.in_features],
-                scales,
-                zero_points,
-                None,  # Set bias to None when prepacking. Please refer to the comment in __init__ of _IPEXLinearAllreduce
-                g_idx,
-                None,  # batch_size
                 group_size,
                 lowp_mode,
                 act_quant_mode,
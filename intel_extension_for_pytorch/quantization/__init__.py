@@ -6,12 +6,17 @@ from ._qconfig import (
     default_dynamic_qconfig_mapping,
     get_smooth_quant_qconfig_mapping,
     get_weight_only_quant_qconfig_mapping,
+    get_weight_only_quant_mixed_precision_qconfig_mapping,
     WoqLowpMode,
     WoqActQuantMode,
     QConfigWoq,
     WoqWeightDtype,
     WoqWeightQScheme,
 )
+from ._woq_mixed_precision import (
+    get_weight_only_quant_sensitivity,
+    get_weight_only_quant_plan_by_sensitivity,
+)
 from ._autotune import autotune
 from ._quantize_utils import (
     quantize_per_channel,
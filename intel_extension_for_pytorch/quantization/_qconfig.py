@@ -305,3 +305,47 @@ def get_weight_only_quant_qconfig_mapping(
         _weight_only_quant_qconfig
     )
     return weight_only_quant_qconfig_mapping
+
+
+def get_weight_only_quant_mixed_precision_qconfig_mapping(
+    layer_plan,
+    **kwargs,
+):
+    """
+    Configuration for weight-only quantization (WOQ) with a per-layer plan, so that
+    layers of a model are quantized in different formats, e.g., INT8 for the layers
+    sensitive to quantization and INT4 for the others.
+
+    Arguments:
+        layer_plan (dict): Maps the fully qualified name of a module to the WOQ
+            configuration of the linear layers in it, which is a dict of the keyword
+            arguments of `get_weight_only_quant_qconfig_mapping`. The linear layers
+            in the module are not quantized if the configuration is None.
+            A layer follows the configuration of its closest parent in the plan.
+            For fused MoE of LLM, which takes one format per decoder layer, the
+            experts of a layer given mixed configurations are quantized per plan
+            and run without the fused kernels. Their linear layers kept in float
+            by the plan are quantized in the most precise configuration of the
+            other experts of the layer instead, with a warning.
+        kwargs: Keyword arguments of `get_weight_only_quant_qconfig_mapping` for the
+            layers that are not in the plan.
+    """
+    qconfig_mapping = get_weight_only_quant_qconfig_mapping(**kwargs)
+    for module_name, config in layer_plan.items():
+        qconfig = (
+            None
+            if config is None
+            else get_weight_only_quant_qconfig_mapping(**config).global_qconfig
+        )
+        qconfig_mapping.set_module_name(module_name, qconfig)
+    return qconfig_mapping
+
+
+def _get_module_name_qconfig(module_name_qconfigs, module_name, default_qconfig):
+    # A module follows the qconfig of its closest parent in module_name_qconfigs
+    name = module_name
+    while name not in module_name_qconfigs:
+        if name == "":
+            return default_qconfig
+        name = name.rpartition(".")[0]
+    return module_name_qconfigs[name]
@@ -17,6 +17,7 @@ from intel_extension_for_pytorch.nn.utils._weight_prepack import (
     _pre_ipex_gemm,
 )
 from ._quantize_utils import auto_prepare, auto_convert, copy_prepared_model
+from ._qconfig import _get_module_name_qconfig
 from .. import nn
 from typing import Dict
 
@@ -66,7 +67,9 @@ def prepare(
             + "\n    prepared_model = ipex.quantization.prepare(model_fp32, qconfig_mapping, ...)",
             _type=WarningType.AmbiguousArgument,
         )
+    module_name_qconfigs = {}
     if isinstance(configure, QConfigMapping):
+        module_name_qconfigs = dict(configure.module_name_qconfigs)
         configure = configure.global_qconfig
     if not isinstance(configure.activation(), PlaceholderObserver):
         assert example_inputs is not None or example_kwarg_inputs is not None, (
@@ -114,7 +117,12 @@ def prepare(
         assert isinstance(
             example_kwarg_inputs, Dict
         ), "IPEX quantization.prepare: example_kwarg_inputs must be type of Dict."
-    return auto_prepare(prepare_model, configure, example_inputs, example_kwarg_inputs)
+    prepare_model = auto_prepare(
+        prepare_model, configure, example_inputs, example_kwarg_inputs
+    )
+    # Per-layer qconfigs, e.g., the mixed precision plan of weight only quantization
+    prepare_model.q_config_module_names = module_name_qconfigs
+    return prepare_model
 
 
 def _may_insert_deepspeed_modules(
@@ -457,6 +465,15 @@ def convert(model, inplace=False):
             module_mappings,
             qconfig_spec,
         )
+        module_name_qconfigs = getattr(convert_model, "q_config_module_names", {})
+        if module_name_qconfigs:
+            # A name key overrides the type keys, so only the modules of the
+            # quantizable types get one.
+            for name, mod in convert_model.named_modules():
+                if type(mod) in qconfig_spec:
+                    qconfig_spec[name] = _get_module_name_qconfig(
+                        module_name_qconfigs, name, convert_model.q_config
+                    )
         converted_model = torch.quantization.quantize_dynamic(
             convert_model,
             qconfig_spec=qconfig_spec,
@@ -0,0 +1,105 @@
+import copy
+import torch
+from ._qconfig import get_weight_only_quant_qconfig_mapping
+
+
+def get_weight_only_quant_sensitivity(model, calib_inputs, low_bit_config):
+    r"""
+    Measure the sensitivity of each linear layer of a model to weight-only
+    quantization (WOQ) on calibration inputs. The sensitivity of a layer is the
+    relative error of its output, i.e., ||y_q - y||^2 / ||y||^2, where y is the output
+    of the float layer and y_q is the output of the layer quantized with
+    `low_bit_config`, both of which take the float input of the layer.
+
+    Args:
+        model (torch.nn.Module): The float model.
+        calib_inputs (iterable): Calibration inputs of the model. Each of them is a
+            tuple of positional arguments or a dict of keyword arguments.
+        low_bit_config (dict): Keyword arguments of
+            `get_weight_only_quant_qconfig_mapping` to quantize the layers with.
+
+    Returns:
+        A dict mapping the fully qualified name of each linear layer to its
+        sensitivity.
+    """
+    from ..nn.modules import WeightOnlyQuantizedLinear
+
+    qconfig = get_weight_only_quant_qconfig_mapping(**low_bit_config).global_qconfig
+    quantized_layers = {}
+    errors = {}
+
+    def _get_hook(name):
+        def _hook(mod, inputs, output):
+            if name not in quantized_layers:
+                # Quantize a shallow copy to leave the qconfig of the model as is
+                mod_copy = copy.copy(mod)
+                mod_copy.qconfig = qconfig
+                quantized_layers[name] = WeightOnlyQuantizedLinear.from_float(mod_copy)
+            output_q = quantized_layers[name](inputs[0])
+            error, norm = errors.get(name, (0.0, 0.0))
+            errors[name] = (
+                error + (output_q.float() - output.float()).pow(2).sum().item(),
+                norm + output.float().pow(2).sum().item(),
+            )
+
+        return _hook
+
+    hooks = [
+        mod.register_forward_hook(_get_hook(name))
+        for name, mod in model.named_modules()
+        # Not the subclasses such as the out_proj of nn.MultiheadAttention
+        if type(mod) is torch.nn.Linear
+    ]
+    try:
+        with torch.no_grad():
+            for inputs in calib_inputs:
+                if isinstance(inputs, dict):
+                    model(**inputs)
+                else:
+                    model(*inputs)
+    finally:
+        for hook in hooks:
+            hook.remove()
+    return {
+        name: error / max(norm, torch.finfo(torch.float).tiny)
+        for name, (error, norm) in errors.items()
+    }
+
+
+def get_weight_only_quant_plan_by_sensitivity(
+    sensitivity,
+    low_bit_config,
+    high_bit_config,
+    sensitivity_budget,
+):
+    r"""
+    Make a per-layer plan of weight-only quantization (WOQ) from the sensitivity of
+    the layers. The least sensitive layers are quantized with `low_bit_config` as
+    long as the sum of their sensitivity is within `sensitivity_budget`, and the
+    other layers with `high_bit_config`. So the most layers are quantized to low bits
+    for the best throughput at the accuracy budget.
+
+    Args:
+        sensitivity (dict): Maps the fully qualified name of each linear layer to its
+            sensitivity, e.g., given by `get_weight_only_quant_sensitivity`.
+        low_bit_config (dict): Keyword arguments of
+            `get_weight_only_quant_qconfig_mapping` for the insensitive layers.
+        high_bit_config (dict): Keyword arguments of
+            `get_weight_only_quant_qconfig_mapping` for the sensitive layers. The
+            layers are not quantized if it is None.
+        sensitivity_budget (float): Maximum sum of the sensitivity of the layers
+            quantized with `low_bit_config`.
+
+    Returns:
+        A dict as the `layer_plan` of
+        `get_weight_only_quant_mixed_precision_qconfig_mapping`.
+    """
+    layer_plan = {}
+    low_bit_sensitivity = 0.0
+    for name, layer_sensitivity in sorted(sensitivity.items(), key=lambda x: x[1]):
+        if low_bit_sensitivity + layer_sensitivity <= sensitivity_budget:
+            low_bit_sensitivity += layer_sensitivity
+            layer_plan[name] = low_bit_config
+        else:
+            layer_plan[name] = high_bit_config
+    return layer_plan
@@ -15,10 +15,51 @@ def get_int_from_env(env_keys, default):
     return default
 
 
+# -1: not use SHM allreduce, 1: all the ranks are on one node,
+# 2: hierarchical SHM allreduce across multiple nodes.
 USE_SHM_ALLREDUCE = -1
+# (local process group, cross process group) of the hierarchical allreduce
+HIERARCHICAL_GROUPS = None
 
 
-def all_reduce_cpu(t: torch.Tensor, op=ReduceOp.SUM, group=None, async_op=False):
+def get_hierarchical_groups(world_size, local_size):
+    r"""
+    Create the process groups of the hierarchical allreduce once. The ranks
+    are assumed to be placed node by node, ``local_size`` ranks per node.
+    The local group is the ranks of this node, and the cross group is the
+    ranks with the same local rank on all the nodes.
+    """
+
+    global HIERARCHICAL_GROUPS
+    if HIERARCHICAL_GROUPS is None:
+        rank = dist.get_rank()
+        local_group = None
+        cross_group = None
+        # All the ranks have to create all the groups in the same order
+        for node in range(world_size // local_size):
+            group = dist.new_group(
+                list(range(node * local_size, (node + 1) * local_size))
+            )
+            if rank // local_size == node:
+                local_group = group
+        for local_rank in range(local_size):
+            group = dist.new_group(list(range(local_rank, world_size, local_size)))
+            if rank % local_size == local_rank:
+                cross_group = group
+        HIERARCHICAL_GROUPS = (local_group, cross_group)
+    return HIERARCHICAL_GROUPS
+
+
+def all_reduce_cpu(
+    t: torch.Tensor, op=ReduceOp.SUM, group=None, async_op=False, wire_dtype="auto"
+):
+    r"""
+    ``wire_dtype`` selects the data type moved through the shared memory of
+    the single node SHM allreduce, one of ``"auto"`` (the dtype of ``t``),
+    ``"bf16"``, ``"fp16"`` and ``"fp8"``. The sum is accumulated in float,
+    the low precision types trade accuracy for less memory traffic.
+    """
+
     pg = (
         torch.distributed.distributed_c10d._get_default_group()
         if group is None
@@ -27,8 +68,11 @@ def all_reduce_cpu(t: torch.Tensor, op=ReduceOp.SUM, group=None, async_op=False)
     global USE_SHM_ALLREDUCE
     if USE_SHM_ALLREDUCE == -1:
         word_size = torch.distributed.get_world_size(pg)
+        # IPEX_SHM_ALLREDUCE_LOCAL_SIZE overrides the number of ranks per
+        # node, such as to simulate multiple nodes with local processes.
         local_size = get_int_from_env(
             [
+                "IPEX_SHM_ALLREDUCE_LOCAL_SIZE",
                 "MPI_LOCALNRANKS",
                 "OMPI_COMM_WORLD_LOCAL_SIZE",
                 "MV2_COMM_WORLD_LOCAL_SIZE",
@@ -38,21 +82,32 @@ def all_reduce_cpu(t: torch.Tensor, op=ReduceOp.SUM, group=None, async_op=False)
         )
         if local_size >= 0 and local_size == word_size:
             USE_SHM_ALLREDUCE = 1
+        elif (
+            group is None
+            and local_size > 1
+            and local_size < word_size
+            and word_size % local_size == 0
+        ):
+            USE_SHM_ALLREDUCE = 2
+            get_hierarchical_groups(word_size, local_size)
         else:
             USE_SHM_ALLREDUCE = -1
 
     if (
-        USE_SHM_ALLREDUCE == 1
+        USE_SHM_ALLREDUCE > 0
         and async_op is False
         and op is ReduceOp.SUM
         and torch.distributed.is_available()
         and torch.distributed.is_initialized()
     ):
-
-        ipex._C.tpp_shm_allreduce(t, pg)
-        return t
-    else:
-        return dist.all_reduce(t, op, group, async_op)
+        if USE_SHM_ALLREDUCE == 1:
+            ipex._C.tpp_shm_allreduce(t, pg, wire_dtype)
+            return t
+        if group is None:
+            local_group, cross_group = HIERARCHICAL_GROUPS
+            ipex._C.tpp_shm_hierarchical_allreduce(t, local_group, cross_group)
+            return t
+    return dist.all_reduce(t, op, group, async_op)
 
 
 def all_gather_cpu(
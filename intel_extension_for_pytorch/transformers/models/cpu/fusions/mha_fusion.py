@@ -365,6 +365,15 @@ class _IPEXPagedAttentionCPU:
                 and value_cache.dtype == torch.float8_e5m2
             ):
                 raise TypeError("only float8_e5m2 supported")
+        elif kv_cache_dtype == "int8" or kv_cache_dtype == "int4":
+            if not (key_cache.dtype == torch.uint8 and value_cache.dtype == torch.uint8):
+                raise TypeError("only uint8 supported for the int8/int4 kv cache")
+        elif kv_cache_dtype == "vnni":
+            if not (
+                key_cache.dtype == torch.bfloat16
+                and value_cache.dtype == torch.bfloat16
+            ):
+                raise TypeError("only bfloat16 supported for the vnni kv cache")
         elif kv_cache_dtype != "auto":
             raise TypeError("unsupported kv_cache_dtype")
 
@@ -420,6 +429,8 @@ class _IPEXPagedAttentionCPU:
         k_scale=1.0,
         v_scale=1.0,
         softcap=-1.0,
+        evicted_lens=None,
+        num_sink_tokens=0,
     ):
         return torch.ops.torch_ipex.single_query_cached_kv_attention(
             output,
@@ -437,6 +448,127 @@ class _IPEXPagedAttentionCPU:
             k_scale,
             v_scale,
             softcap,
+            evicted_lens,
+            num_sink_tokens,
+        )
+
+    @classmethod
+    def multi_query_cached_kv_attention(
+        cls,
+        output,
+        query,
+        key_cache,
+        value_cache,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        num_queries,
+        query_mask=None,
+        k_scale=1.0,
+        v_scale=1.0,
+        softcap=-1.0,
+    ):
+        return torch.ops.torch_ipex.multi_query_cached_kv_attention(
+            output,
+            query,
+            key_cache,
+            value_cache,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            num_queries,
+            query_mask,
+            k_scale,
+            v_scale,
+            softcap,
+        )
+
+    @classmethod
+    def single_query_cached_kv_attention_with_rope(
+        cls,
+        output,
+        query,
+        key,
+        value,
+        key_cache,
+        value_cache,
+        slot_mapping,
+        rope_emb_pos,
+        positions,
+        rotary_offset,
+        rotary_ndims,
+        head_mapping,
+        scale,
+        block_tables,
+        context_lens,
+        block_size,
+        max_context_len,
+        alibi_slopes=None,
+        window_size=-1,
+        kv_cache_dtype="auto",
+        k_scale=1.0,
+        v_scale=1.0,
+        softcap=-1.0,
+    ):
+        return torch.ops.torch_ipex.single_query_cached_kv_attention_with_rope(
+            output,
+            query,
+            key,
+            value,
+            key_cache,
+            value_cache,
+            slot_mapping.int() if slot_mapping.dtype is torch.long else slot_mapping,
+            rope_emb_pos,
+            positions.long().contiguous(),
+            rotary_offset,
+            rotary_ndims,
+            head_mapping,
+            scale,
+            block_tables,
+            context_lens,
+            block_size,
+            max_context_len,
+            alibi_slopes,
+            window_size,
+            kv_cache_dtype,
+            k_scale,
+            v_scale,
+            softcap,
+        )
+
+    @classmethod
+    def evict_kv_blocks(
+        cls,
+        block_tables,
+        context_lens,
+        evicted_lens,
+        block_size,
+        num_sink_tokens,
+        window_size,
+    ):
+        return torch.ops.torch_ipex.evict_kv_blocks(
+            block_tables,
+            context_lens,
+            evicted_lens,
+            block_size,
+            num_sink_tokens,
+            window_size,
+        )
+
+    @classmethod
+    def copy_blocks(cls, key_caches, value_caches, block_mapping):
+        torch.ops.torch_ipex.copy_blocks(
+            key_caches, value_caches, block_mapping.view(-1, 2).long()
+        )
+
+    @classmethod
+    def swap_blocks(cls, src_caches, dst_caches, block_mapping):
+        torch.ops.torch_ipex.swap_blocks(
+            src_caches, dst_caches, block_mapping.view(-1, 2).long()
         )
 
     @classmethod
@@ -467,6 +599,12 @@ class _IPEXPagedAttentionCPU:
                 and v_cache.dtype == torch.float8_e5m2
             ):
                 raise TypeError("only float8_e5m2 supported")
+        elif kv_cache_dtype == "int8" or kv_cache_dtype == "int4":
+            if not (k_cache.dtype == torch.uint8 and v_cache.dtype == torch.uint8):
+                raise TypeError("only uint8 supported for the int8/int4 kv cache")
+        elif kv_cache_dtype == "vnni":
+            if not (k_cache.dtype == torch.bfloat16 and v_cache.dtype == torch.bfloat16):
+                raise TypeError("only bfloat16 supported for the vnni kv cache")
         elif kv_cache_dtype != "auto":
             raise TypeError("unsupported kv_cache_dtype")
         return torch.ops.torch_ipex.flash_attn_varlen_func(
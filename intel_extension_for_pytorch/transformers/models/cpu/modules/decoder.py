@@ -254,6 +254,16 @@ class _IPEXDecoderLayerCPU(nn.Module):
                 "DeepseekV3ForCausalLM",
                 "Qwen3MoeForCausalLM",
             ]:
+                if (
+                    self.use_fused_moe_woq
+                    and not self.deepseek_lowbit_load
+                    and hasattr(self, "qconfig")
+                    and self.qconfig is None
+                ):
+                    # A per-layer WOQ plan keeps the experts of this layer in
+                    # float, so they run on the fused MoE kernels without WOQ.
+                    self.use_fused_moe = True
+                    self.use_fused_moe_woq = False
                 if hasattr(self.mlp, "shared_experts") and self.unify_experts:
                     if (
                         hasattr(self, "deepseek_lowbit_load")
@@ -2,6 +2,7 @@ import torch
 from torch import nn
 from typing import Optional, Tuple, Union, List
 import math
+import os
 from ...reference.fusions.mha_fusion import (
     _IPEXRopeRef,
     _IPEXScaleDotProductRef,
@@ -3603,6 +3604,14 @@ class _IPEXAttentionRef(nn.Module):
             AssertionError(False, "Do not support the optimization of your model yet")
 
 
+# Compact the beam history of the indirect access kv cache every N decoding
+# steps, so that the attention reads the kv cache contiguously again with
+# large beams and long generations. 0 disables the compaction.
+KV_CACHE_COMPACTION_INTERVAL = int(
+    os.environ.get("IPEX_KV_CACHE_COMPACTION_INTERVAL", 0)
+)
+
+
 def _reorder_cache(
     self, past_key_values: Tuple[Tuple[torch.Tensor]], beam_idx: torch.Tensor
 ) -> Tuple[Tuple[torch.Tensor]]:
@@ -3644,7 +3653,15 @@ def _reorder_cache(
             cross_attention_layers = self.config.text_config.cross_attention_layers
         for layer_past in past_key_values:
             if idx not in cross_attention_layers:
-                layer_past[3][layer_past[0].size(-2) - 1] = beam_idx
+                offset = layer_past[0].size(-2)
+                layer_past[3][offset - 1] = beam_idx
+                if (
+                    KV_CACHE_COMPACTION_INTERVAL > 0
+                    and offset % KV_CACHE_COMPACTION_INTERVAL == 0
+                ):
+                    torch.ops.torch_ipex.compact_indirect_access_kv_cache(
+                        layer_past[1], layer_past[2], layer_past[3], offset
+                    )
             idx = idx + 1
         return past_key_values
     elif len(past_key_values[0]) == 8:
@@ -2229,6 +2229,18 @@ def DeepseekV2DecoderLayer_forward(
     return outputs
 
 
+def _get_woq_format(linear):
+    if getattr(linear, "_op_context", None) is None:
+        return None
+    return (
+        linear.dtype,
+        linear._group_size,
+        linear._lowp_mode,
+        linear._act_quant_mode,
+        linear._weight_qscheme,
+    )
+
+
 class _IPEXDecoderLayerRef(nn.Module):
     def __init__(self, module, config, distributed=False):
         super().__init__()
@@ -2531,6 +2543,29 @@ class _IPEXDecoderLayerRef(nn.Module):
                 del self.__dict__["_modules"]["self_attn"].o_proj
 
             self.deepseek_lowbit_load = False
+            if hasattr(module.mlp, "experts") and (
+                self.use_fused_moe or self.use_fused_moe_woq
+            ):
+                # The fused MoE kernels take one WOQ format for all the experts,
+                # so the experts quantized in mixed formats run with their own
+                # op contexts by deepseek_moe_woq. They are either already
+                # quantized, e.g., by a checkpoint, or marked by
+                # woq_mixed_experts to be quantized per plan later.
+                experts = list(module.mlp.experts)
+                if (
+                    getattr(module.mlp, "shared_experts", None) is not None
+                    and getattr(config, "n_shared_experts", None) == 1
+                ):
+                    experts.append(module.mlp.shared_experts)
+                woq_formats = {
+                    _get_woq_format(getattr(expert, proj))
+                    for expert in experts
+                    for proj in ["gate_proj", "up_proj", "down_proj"]
+                    if hasattr(expert, proj)
+                }
+                if len(woq_formats) > 1 or getattr(module, "woq_mixed_experts", False):
+                    self.use_fused_moe = False
+                    self.use_fused_moe_woq = False
             if hasattr(module.mlp, "experts"):  # DeepseekV2MoE
                 # shared_experts
                 if self.model_backbone == "Qwen3MoeForCausalLM":
@@ -2540,7 +2575,10 @@ class _IPEXDecoderLayerRef(nn.Module):
                     and config.n_shared_experts is not None
                 ):
                     self.unify_experts = False
-                    if config.n_shared_experts == 1:
+                    # Only the fused MoE kernels compute the shared expert
+                    if config.n_shared_experts == 1 and (
+                        self.use_fused_moe or self.use_fused_moe_woq
+                    ):
                         self.unify_experts = True
                         self.unify_shared_expert_id = config.n_routed_experts + 1
                     if self.unify_experts and (
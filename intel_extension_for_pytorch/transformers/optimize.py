@@ -14,6 +14,11 @@ from ..utils.weight_only_quantization import (
     _woq_enable_weight_cache_for_large_batch,
     _convert_woq_with_low_precision_checkpoint,
 )
+from ..quantization._qconfig import (
+    _get_module_name_qconfig,
+    WoqWeightDtype,
+    WoqLowpMode,
+)
 
 
 def convert_functions(m, target_m, new_function_name, new_function):
@@ -1616,6 +1621,107 @@ def get_dummy_input(_model, return_dict=False):
     return sample_inputs
 
 
+_WOQ_WEIGHT_BITS = {
+    WoqWeightDtype.INT8: 8,
+    WoqWeightDtype.FP8: 8,
+    WoqWeightDtype.INT4: 4,
+    WoqWeightDtype.NF4: 4,
+}
+
+
+def _get_woq_qconfig_format(qconfig):
+    if qconfig is None:
+        return None
+    return (
+        qconfig.weight_dtype,
+        qconfig.group_size,
+        qconfig.lowp_mode,
+        qconfig.act_quant_mode,
+        qconfig.weight_qscheme,
+    )
+
+
+def _resolve_fused_moe_woq_plan(model, quantization_config):
+    # The fused MoE kernels take one WOQ format for all the experts of a layer.
+    # If a per-layer plan gives them mixed formats, the layer is marked by
+    # woq_mixed_experts before the reference conversion fuses the expert
+    # weights. Its experts are then quantized per plan and run with their own
+    # op contexts by deepseek_moe_woq, which needs all the routed experts
+    # quantized. So the routed expert linears kept in float by the plan take
+    # the most precise format of the other ones, with a warning.
+    # Returns the qconfigs of the layers on the fused MoE kernels by index.
+    def get_qconfigs(names):
+        return {
+            name: _get_module_name_qconfig(
+                quantization_config.module_name_qconfigs,
+                name,
+                quantization_config.global_qconfig,
+            )
+            for name in names
+        }
+
+    fused_moe_qconfigs = {}
+    proj_names = ["gate_proj", "up_proj", "down_proj"]
+    for idx, layer in enumerate(model.model.layers):
+        if not hasattr(layer.mlp, "experts"):
+            continue
+        layer_name = f"model.layers.{idx}"
+        expert_qconfigs = get_qconfigs(
+            [
+                f"{layer_name}.mlp.experts.{expert_idx}.{proj}"
+                for expert_idx in range(len(layer.mlp.experts))
+                for proj in proj_names
+            ]
+        )
+        float_names = [
+            name for name, qconfig in expert_qconfigs.items() if qconfig is None
+        ]
+        if 0 < len(float_names) < len(expert_qconfigs):
+            qconfig = max(
+                (q for q in expert_qconfigs.values() if q is not None),
+                key=lambda qconfig: (
+                    _WOQ_WEIGHT_BITS[qconfig.weight_dtype],
+                    qconfig.lowp_mode != WoqLowpMode.INT8,
+                ),
+            )
+            logger.warning(
+                f"The WOQ plan keeps {float_names} in float, but the other "
+                + f"experts of {layer_name} are quantized. They are quantized "
+                + f"with {_get_woq_qconfig_format(qconfig)} instead.",
+                _type=WarningType.NotSupported,
+            )
+            for name in float_names:
+                quantization_config.set_module_name(name, qconfig)
+                expert_qconfigs[name] = qconfig
+        shared_qconfigs = {}
+        if getattr(layer.mlp, "shared_experts", None) is not None:
+            shared_qconfigs = get_qconfigs(
+                [f"{layer_name}.mlp.shared_experts.{proj}" for proj in proj_names]
+            )
+        # A single shared expert is unified into the fused MoE kernels
+        unify_shared = getattr(model.config, "n_shared_experts", None) == 1
+        qconfigs = list(expert_qconfigs.values())
+        if unify_shared:
+            qconfigs += list(shared_qconfigs.values())
+        if len({_get_woq_qconfig_format(qconfig) for qconfig in qconfigs}) == 1:
+            fused_moe_qconfigs[idx] = qconfigs[0]
+        else:
+            layer.woq_mixed_experts = True
+        if shared_qconfigs and not (unify_shared and idx in fused_moe_qconfigs):
+            # Otherwise the shared experts run on the linear fusions of the
+            # decoder layer, which follow the plan entries of the shared experts
+            for fusion_name, proj in [
+                ("shared_linear_silu_mul.linear_s", "gate_proj"),
+                ("shared_linear_silu_mul.linear_m", "up_proj"),
+                ("shared_linear_add_add.linear", "down_proj"),
+            ]:
+                fusion_name = f"{layer_name}.{fusion_name}"
+                qconfig = shared_qconfigs[f"{layer_name}.mlp.shared_experts.{proj}"]
+                if get_qconfigs([fusion_name])[fusion_name] is not qconfig:
+                    quantization_config.set_module_name(fusion_name, qconfig)
+    return fused_moe_qconfigs
+
+
 def ipex_quantization_flow(
     _model,
     dtype,
@@ -2294,6 +2400,23 @@ def optimize(
             )
             use_low_precision_checkpoint = True
 
+        # The fused MoE formats of the WOQ plan are resolved before the
+        # reference conversion, which fuses the expert weights
+        fused_moe_qconfigs = {}
+        if (
+            is_woq
+            and not use_low_precision_checkpoint
+            and _model.config.architectures[0]
+            in [
+                "DeepseekV2ForCausalLM",
+                "DeepseekV3ForCausalLM",
+                "Qwen3MoeForCausalLM",
+            ]
+        ):
+            fused_moe_qconfigs = _resolve_fused_moe_woq_plan(
+                _model, quantization_config
+            )
+
         # model reference conversion
         logger.debug("ipex.llm.optimize is converting model to reference model")
         _model = model_convert_reference(_model)
@@ -2405,13 +2528,8 @@ def optimize(
                     None,
                 )
                 # for fused moe
-                if _model.config.architectures[0] in [
-                    "DeepseekV2ForCausalLM",
-                    "DeepseekV3ForCausalLM",
-                    "Qwen3MoeForCausalLM",
-                ]:
-                    for layer in _model.model.layers:
-                        layer.qconfig = quantization_config.global_qconfig
+                for idx, qconfig in fused_moe_qconfigs.items():
+                    _model.model.layers[idx].qconfig = qconfig
 
         # model lowering conversion
         logger.debug("ipex.llm.optimize is lowering model")
@@ -91,6 +91,14 @@ def _woq_enable_weight_cache_for_large_batch(qconfig_mapping):
     qconfig_dict["cache_weight_for_large_batch"] = True
     if isinstance(qconfig_mapping, QConfigMapping):
         qconfig_mapping.set_global(QConfigWoq(**qconfig_dict))
+        # Per-layer qconfigs of the mixed precision plan
+        for module_name, module_qconfig in list(
+            qconfig_mapping.module_name_qconfigs.items()
+        ):
+            if module_qconfig is not None:
+                qconfig_dict = module_qconfig._asdict()
+                qconfig_dict["cache_weight_for_large_batch"] = True
+                qconfig_mapping.set_module_name(module_name, QConfigWoq(**qconfig_dict))
         return qconfig_mapping
     return QConfigWoq(**qconfig_dict)
 
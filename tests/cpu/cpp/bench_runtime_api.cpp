@@ -0,0 +1,114 @@
+#include <torch/torch.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <vector>
+#include "csrc/cpu/runtime/CPUPool.h"
+#include "csrc/cpu/runtime/Task.h"
+#include "csrc/cpu/runtime/TaskExecutor.h"
+
+// Microbenchmark of the submit-to-complete latency of the runtime Task API.
+// Usage: ipex_cpp_runtime_bench [num_iterations]
+// It needs IOMP preloaded, such as
+// LD_PRELOAD=<path>/libiomp5.so ./ipex_cpp_runtime_bench 100000
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int64_t trivial_function(int64_t input) {
+  return input + 1;
+}
+
+void report(const char* name, std::vector<double>& latencies_us) {
+  std::sort(latencies_us.begin(), latencies_us.end());
+  double sum = 0;
+  for (auto latency : latencies_us) {
+    sum += latency;
+  }
+  auto percentile = [&](double p) {
+    return latencies_us[std::min(
+        latencies_us.size() - 1, size_t(p * latencies_us.size()))];
+  };
+  printf(
+      "%-40s mean: %8.2f us  p50: %8.2f us  p99: %8.2f us  max: %8.2f us\n",
+      name,
+      sum / latencies_us.size(),
+      percentile(0.5),
+      percentile(0.99),
+      latencies_us.back());
+}
+
+// Submit with the Task API, then wait for the TaskFuture.
+void bench_task(
+    const char* name,
+    std::shared_ptr<torch_ipex::runtime::TaskExecutor> task_executor,
+    int64_t num_iterations) {
+  torch_ipex::runtime::Task<int64_t (*)(int64_t), int64_t> task(
+      trivial_function, task_executor);
+  std::vector<double> latencies_us(num_iterations);
+  for (int64_t i = 0; i < num_iterations; i++) {
+    auto start = Clock::now();
+    auto res_future = task(int64_t(i));
+    auto res = res_future.get();
+    auto end = Clock::now();
+    TORCH_CHECK(res == i + 1);
+    latencies_us[i] =
+        std::chrono::duration<double, std::micro>(end - start).count();
+  }
+  report(name, latencies_us);
+}
+
+// Reference: submit a std::packaged_task and wait for the std::future.
+void bench_packaged_task(
+    const char* name,
+    std::shared_ptr<torch_ipex::runtime::TaskExecutor> task_executor,
+    int64_t num_iterations) {
+  std::vector<double> latencies_us(num_iterations);
+  for (int64_t i = 0; i < num_iterations; i++) {
+    auto start = Clock::now();
+    auto task = std::make_shared<std::packaged_task<int64_t()>>(
+        [i]() { return trivial_function(i); });
+    std::future<int64_t> res_future = task->get_future();
+    task_executor->submit([task]() { (*task)(); });
+    auto res = res_future.get();
+    auto end = Clock::now();
+    TORCH_CHECK(res == i + 1);
+    latencies_us[i] =
+        std::chrono::duration<double, std::micro>(end - start).count();
+  }
+  report(name, latencies_us);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (!torch_ipex::runtime::is_runtime_ext_enabled()) {
+    printf("Skip the runtime benchmark. Didn't preload IOMP.\n");
+    return 0;
+  }
+  int64_t num_iterations = argc > 1 ? std::atoll(argv[1]) : 100000;
+
+  std::vector<int32_t> cpu_core_list({0, 1});
+  torch_ipex::runtime::CPUPool cpu_pool(cpu_core_list);
+  int32_t num_workers = cpu_pool.get_cpu_core_list().size();
+  auto task_executor =
+      std::make_shared<torch_ipex::runtime::TaskExecutor>(cpu_pool);
+  auto work_stealing_task_executor =
+      std::make_shared<torch_ipex::runtime::TaskExecutor>(
+          cpu_pool, num_workers);
+
+  printf("Submit-to-complete latency of %ld iterations\n", num_iterations);
+  bench_packaged_task(
+      "packaged_task, single worker", task_executor, num_iterations);
+  bench_task("Task, single worker", task_executor, num_iterations);
+  bench_packaged_task(
+      "packaged_task, work stealing",
+      work_stealing_task_executor,
+      num_iterations);
+  bench_task(
+      "Task, work stealing", work_stealing_task_executor, num_iterations);
+  return 0;
+}
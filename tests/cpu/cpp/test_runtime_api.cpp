@@ -1,4 +1,7 @@
+#include <sys/stat.h>
 #include <torch/torch.h>
+#include <fstream>
+#include <numeric>
 #include "csrc/cpu/runtime/CPUPool.h"
 #include "csrc/cpu/runtime/Task.h"
 #include "csrc/cpu/runtime/TaskExecutor.h"
@@ -430,3 +433,253 @@ TEST(TestRuntimeTaskAPI, TestTaskAPISameTasksMultiTensorInputs) {
   ASSERT_VARIABLE_EQ(res, res_ref);
   ASSERT_VARIABLE_EQ(res2, res_ref2);
 }
+
+TEST(TestRuntimeTaskAPI, TestTaskAPIWorkStealingTaskExecutor) {
+  if (!torch_ipex::runtime::is_runtime_ext_enabled()) {
+    GTEST_SKIP()
+        << "Skip TestRuntimeTaskAPI::TestTaskAPIWorkStealingTaskExecutor. Didn't preload IOMP.";
+  }
+  std::vector<int32_t> cpu_core_list({0, 1});
+  torch_ipex::runtime::CPUPool cpu_pool(cpu_core_list);
+  int32_t num_workers = cpu_pool.get_cpu_core_list().size();
+  std::shared_ptr<torch_ipex::runtime::TaskExecutor> task_executor =
+      std::make_shared<torch_ipex::runtime::TaskExecutor>(
+          cpu_pool, num_workers);
+  ASSERT_TRUE(task_executor->is_work_stealing());
+  ASSERT_EQ(task_executor->get_num_workers(), num_workers);
+
+  const int num_inputs = 16;
+  std::vector<at::Tensor> input_tensors;
+  std::vector<at::Tensor> res_refs;
+  for (int i = 0; i < num_inputs; i++) {
+    input_tensors.emplace_back(at::rand({100, 8276}));
+    res_refs.emplace_back(at::softmax(input_tensors[i], -1));
+  }
+  // Create the task
+  torch_ipex::runtime::
+      Task<at::Tensor (*)(const at::Tensor&), const at::Tensor&>
+          task(taskfunction_const_lvalue_reference, task_executor);
+  std::vector<torch_ipex::runtime::TaskFuture<at::Tensor>> res_futures;
+  for (int i = 0; i < num_inputs; i++) {
+    res_futures.emplace_back(task(input_tensors[i]));
+  }
+  // Assert the result
+  for (int i = 0; i < num_inputs; i++) {
+    ASSERT_VARIABLE_EQ(res_futures[i].get(), res_refs[i]);
+  }
+}
+
+TEST(TestRuntimeTaskAPI, TestTaskAPIPriorityAndDeadline) {
+  if (!torch_ipex::runtime::is_runtime_ext_enabled()) {
+    GTEST_SKIP()
+        << "Skip TestRuntimeTaskAPI::TestTaskAPIPriorityAndDeadline. Didn't preload IOMP.";
+  }
+  std::vector<int32_t> cpu_core_list({0});
+  torch_ipex::runtime::CPUPool cpu_pool(cpu_core_list);
+  std::shared_ptr<torch_ipex::runtime::TaskExecutor> task_executor =
+      std::make_shared<torch_ipex::runtime::TaskExecutor>(cpu_pool);
+  std::vector<int64_t> dispatch_order;
+  auto make_record_function = [&dispatch_order]() {
+    return [&dispatch_order](int64_t id) {
+      dispatch_order.emplace_back(id);
+      return id;
+    };
+  };
+  typedef torch_ipex::runtime::Task<decltype(make_record_function()), int64_t>
+      RecordTask;
+  RecordTask low_priority_task(
+      make_record_function(),
+      task_executor,
+      torch_ipex::runtime::TASK_PRIORITY_LOW);
+  RecordTask normal_priority_task(make_record_function(), task_executor);
+  RecordTask high_priority_task(
+      make_record_function(),
+      task_executor,
+      torch_ipex::runtime::TASK_PRIORITY_HIGH);
+
+  // Block the worker, so that all the tasks below are queued.
+  std::promise<void> gate;
+  std::shared_future<void> gate_future = gate.get_future().share();
+  task_executor->submit([gate_future]() { gate_future.wait(); });
+  auto now = std::chrono::steady_clock::now();
+  std::vector<torch_ipex::runtime::TaskFuture<int64_t>> res_futures;
+  res_futures.emplace_back(low_priority_task(5));
+  res_futures.emplace_back(normal_priority_task(3));
+  res_futures.emplace_back(normal_priority_task.run_with_deadline(
+      now + std::chrono::seconds(2), 2));
+  res_futures.emplace_back(normal_priority_task.run_with_deadline(
+      now + std::chrono::seconds(1), 1));
+  res_futures.emplace_back(normal_priority_task(4));
+  res_futures.emplace_back(high_priority_task(0));
+  gate.set_value();
+  for (auto& res_future : res_futures) {
+    res_future.get();
+  }
+  // Priority class first, then earliest deadline, then FIFO
+  ASSERT_EQ(dispatch_order, std::vector<int64_t>({0, 1, 2, 3, 4, 5}));
+}
+
+TEST(TestRuntimeTaskAPI, TestTaskExecutorTelemetry) {
+  if (!torch_ipex::runtime::is_runtime_ext_enabled()) {
+    GTEST_SKIP()
+        << "Skip TestRuntimeTaskAPI::TestTaskExecutorTelemetry. Didn't preload IOMP.";
+  }
+  std::vector<int32_t> cpu_core_list({0, 1});
+  torch_ipex::runtime::CPUPool cpu_pool(cpu_core_list);
+  std::shared_ptr<torch_ipex::runtime::TaskExecutor> task_executor =
+      std::make_shared<torch_ipex::runtime::TaskExecutor>(cpu_pool, 2);
+  torch_ipex::runtime::Task<at::Tensor (*)(at::Tensor), at::Tensor> task(
+      taskfunction_native_input, task_executor);
+  const int num_inputs = 16;
+  std::vector<torch_ipex::runtime::TaskFuture<at::Tensor>> res_futures;
+  for (int i = 0; i < num_inputs; i++) {
+    res_futures.emplace_back(task(at::rand({100, 8276})));
+  }
+  for (auto& res_future : res_futures) {
+    res_future.get();
+  }
+  // The TaskFuture is ready before the worker records the finish.
+  task_executor->stop_executor();
+  auto stats = task_executor->get_stats();
+  ASSERT_EQ(stats.num_submitted_tasks, num_inputs);
+  ASSERT_EQ(stats.num_completed_tasks, num_inputs);
+  ASSERT_EQ(stats.queue_length, 0);
+  ASSERT_GE(stats.queue_length_high_water_mark, 1);
+  ASSERT_GT(stats.exec_time_p50, 0);
+  ASSERT_LE(stats.exec_time_p50, stats.exec_time_p99);
+  ASSERT_LE(stats.exec_time_p99, stats.exec_time_max);
+  ASSERT_EQ(stats.worker_cores.size(), 2);
+  ASSERT_EQ(stats.worker_utilization.size(), 2);
+
+  task_executor->reset_stats();
+  stats = task_executor->get_stats();
+  ASSERT_EQ(stats.num_submitted_tasks, 0);
+  ASSERT_EQ(stats.exec_time_max, 0);
+}
+
+TEST(TestRuntimeAPI, TestLatencyHistogram) {
+  torch_ipex::runtime::LatencyHistogram histogram;
+  ASSERT_EQ(histogram.get_percentile(99), 0);
+  for (int64_t i = 1; i <= 1000; i++) {
+    histogram.record(i * 1000);
+  }
+  ASSERT_EQ(histogram.get_count(), 1000);
+  ASSERT_EQ(histogram.get_max(), 1000000);
+  ASSERT_DOUBLE_EQ(histogram.get_mean(), 500500);
+  // The relative error is less than 1/16
+  ASSERT_NEAR(histogram.get_percentile(50), 500000, 500000 / 16);
+  ASSERT_NEAR(histogram.get_percentile(99), 990000, 990000 / 16);
+  ASSERT_EQ(histogram.get_percentile(100), 1000000);
+}
+
+TEST(TestRuntimeAPI, TestNumaArenaWithCPUPool) {
+  if (!torch_ipex::runtime::is_runtime_ext_enabled()) {
+    GTEST_SKIP()
+        << "Skip TestRuntimeAPI::TestNumaArenaWithCPUPool. Didn't preload IOMP.";
+  }
+  std::vector<int32_t> cpu_core_list({0});
+  torch_ipex::runtime::CPUPool cpu_pool(cpu_core_list);
+  if (cpu_pool.get_numa_nodes().empty()) {
+    GTEST_SKIP()
+        << "Skip TestRuntimeAPI::TestNumaArenaWithCPUPool. NUMA information is not available.";
+  }
+  int32_t numa_node = cpu_pool.get_numa_nodes()[0];
+  auto numa_arena = torch_ipex::runtime::NumaArena::get_numa_arena(numa_node);
+  cpu_pool.enable_numa_arena();
+  at::Tensor input_tensor = at::rand({100, 8276});
+  auto res_ref = at::softmax(input_tensor, -1);
+  size_t allocated_bytes = numa_arena->get_allocated_bytes();
+  at::Tensor res;
+  {
+    torch_ipex::runtime::WithCPUPool with_cpu_pool(std::move(cpu_pool));
+    ASSERT_EQ(torch_ipex::runtime::get_current_numa_arena(), numa_arena);
+    res = at::softmax(input_tensor, -1);
+    ASSERT_GT(numa_arena->get_allocated_bytes(), allocated_bytes);
+  }
+  // The NumaArena is restored after exit the WithCPUPool
+  ASSERT_EQ(torch_ipex::runtime::get_current_numa_arena(), nullptr);
+  ASSERT_VARIABLE_EQ(res, res_ref);
+  res.reset();
+  ASSERT_EQ(numa_arena->get_allocated_bytes(), allocated_bytes);
+}
+
+void write_sysfs_file(const std::string& path, const std::string& content) {
+  // Create the parent directories, then the file.
+  for (size_t pos = path.find('/', 1); pos != std::string::npos;
+       pos = path.find('/', pos + 1)) {
+    mkdir(path.substr(0, pos).c_str(), 0755);
+  }
+  std::ofstream file(path);
+  file << content << "\n";
+}
+
+// Fake sysfs of 2 sockets, each socket is 1 NUMA node with 4 physical cores
+// sharing 1 L3 cache. The SMT sibling of core i is core i + 8.
+std::string create_fake_sysfs() {
+  char sysfs_template[] = "/tmp/ipex_fake_sysfs_XXXXXX";
+  std::string sysfs_root(mkdtemp(sysfs_template));
+  write_sysfs_file(sysfs_root + "/cpu/online", "0-15");
+  write_sysfs_file(sysfs_root + "/node/node0/cpulist", "0-3,8-11");
+  write_sysfs_file(sysfs_root + "/node/node1/cpulist", "4-7,12-15");
+  for (int32_t cpu = 0; cpu < 16; cpu++) {
+    int32_t physical_core = cpu % 8;
+    int32_t socket = physical_core / 4;
+    std::string cpu_root = sysfs_root + "/cpu/cpu" + std::to_string(cpu);
+    write_sysfs_file(
+        cpu_root + "/topology/physical_package_id", std::to_string(socket));
+    write_sysfs_file(
+        cpu_root + "/topology/thread_siblings_list",
+        std::to_string(physical_core) + "," +
+            std::to_string(physical_core + 8));
+    write_sysfs_file(cpu_root + "/cache/index0/level", "1");
+    write_sysfs_file(cpu_root + "/cache/index3/level", "3");
+    write_sysfs_file(
+        cpu_root + "/cache/index3/shared_cpu_list",
+        socket == 0 ? "0-3,8-11" : "4-7,12-15");
+  }
+  return sysfs_root;
+}
+
+TEST(TestRuntimeAPI, TestCPUTopologyPartition) {
+  torch_ipex::runtime::CPUTopology cpu_topology(create_fake_sysfs());
+  ASSERT_EQ(cpu_topology.get_cores().size(), 16);
+  ASSERT_EQ(cpu_topology.get_num_sockets(), 2);
+  ASSERT_EQ(cpu_topology.get_num_numa_nodes(), 2);
+  ASSERT_EQ(cpu_topology.get_num_l3_domains(), 2);
+  ASSERT_EQ(cpu_topology.get_core(12)->numa_node_id, 1);
+  ASSERT_EQ(cpu_topology.get_core(12)->physical_core_id, 4);
+  ASSERT_TRUE(cpu_topology.get_core(12)->is_smt_sibling);
+  ASSERT_EQ(cpu_topology.get_core(16), nullptr);
+
+  std::vector<int32_t> available_cores(16);
+  std::iota(available_cores.begin(), available_cores.end(), 0);
+  using CoreLists = std::vector<std::vector<int32_t>>;
+  // Instances never cross the NUMA node
+  ASSERT_EQ(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, available_cores, 4),
+      CoreLists({{0, 1}, {2, 3}, {4, 5}, {6, 7}}));
+  ASSERT_EQ(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, available_cores, 3),
+      CoreLists({{0, 1}, {2, 3}, {4, 5, 6, 7}}));
+  // SMT siblings stay with their physical cores
+  ASSERT_EQ(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, available_cores, 2, true),
+      CoreLists({{0, 1, 2, 3, 8, 9, 10, 11}, {4, 5, 6, 7, 12, 13, 14, 15}}));
+  // Fewer instances than NUMA nodes take whole nodes
+  ASSERT_EQ(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, available_cores, 1),
+      CoreLists({{0, 1, 2, 3, 4, 5, 6, 7}}));
+  // Only partition the available cores
+  ASSERT_EQ(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, {1, 2, 3, 5}, 2),
+      CoreLists({{1, 2, 3}, {5}}));
+  ASSERT_THROW(
+      torch_ipex::runtime::partition_cpu_cores(
+          cpu_topology, available_cores, 9),
+      std::runtime_error);
+}
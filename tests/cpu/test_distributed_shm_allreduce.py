@@ -0,0 +1,119 @@
+import os
+import unittest
+
+import torch
+import torch.distributed as dist
+import torch.multiprocessing as mp
+from torch.testing._internal.common_utils import TestCase
+
+import intel_extension_for_pytorch as ipex  # noqa: F401
+
+WORLD_SIZE = 4
+# 2 simulated nodes of 2 local processes each
+LOCAL_SIZE = 2
+
+
+def run_hierarchical_allreduce(rank, port, pipeline, results):
+    from intel_extension_for_pytorch.transformers.models.cpu.distributed.dist import (
+        all_reduce_cpu,
+    )
+
+    os.environ["MASTER_ADDR"] = "127.0.0.1"
+    os.environ["MASTER_PORT"] = str(port)
+    os.environ["IPEX_SHM_ALLREDUCE_LOCAL_SIZE"] = str(LOCAL_SIZE)
+    os.environ["TPP_SHM_ALLREDUCE_PIPELINE"] = str(pipeline)
+    dist.init_process_group("gloo", rank=rank, world_size=WORLD_SIZE)
+    passed = True
+    # Cover the small path, and the sliced or pipelined paths of the shared
+    # memory allreduce with a few chunks and a partial last block
+    for numel in [1000, 100003, 1000003]:
+        for dtype in [torch.float, torch.bfloat16]:
+            inputs = [
+                torch.arange(numel, dtype=torch.float).mul(r + 1).to(dtype)
+                for r in range(WORLD_SIZE)
+            ]
+            t = inputs[rank].clone()
+            all_reduce_cpu(t)
+            ref = torch.stack([x.float() for x in inputs]).sum(0).to(dtype)
+            passed = passed and torch.allclose(
+                t.float(), ref.float(), rtol=1e-2, atol=1e-2
+            )
+    results[rank] = passed
+    dist.destroy_process_group()
+
+
+def run_low_precision_allreduce(rank, port, results):
+    from intel_extension_for_pytorch.transformers.models.cpu.distributed.dist import (
+        all_reduce_cpu,
+    )
+
+    os.environ["MASTER_ADDR"] = "127.0.0.1"
+    os.environ["MASTER_PORT"] = str(port)
+    os.environ["IPEX_SHM_ALLREDUCE_LOCAL_SIZE"] = str(WORLD_SIZE)
+    dist.init_process_group("gloo", rank=rank, world_size=WORLD_SIZE)
+    passed = True
+    # Cover the direct and the sliced paths, the values are rounded to the
+    # wire type twice, before and after the reduction
+    for numel in [1000, 100003]:
+        for dtype, wire_dtype, tol in [
+            (torch.float, "bf16", 1e-2),
+            (torch.float, "fp16", 2e-3),
+            (torch.float, "fp8", 0.3),
+            (torch.bfloat16, "fp8", 0.3),
+        ]:
+            inputs = [
+                torch.arange(numel, dtype=torch.float)
+                .remainder(100)
+                .mul(r + 1)
+                .to(dtype)
+                for r in range(WORLD_SIZE)
+            ]
+            t = inputs[rank].clone()
+            all_reduce_cpu(t, wire_dtype=wire_dtype)
+            ref = torch.stack([x.float() for x in inputs]).sum(0)
+            passed = passed and torch.allclose(t.float(), ref, rtol=tol, atol=tol)
+            # All the ranks get the same result
+            gathered = [torch.empty_like(t) for _ in range(WORLD_SIZE)]
+            dist.all_gather(gathered, t)
+            passed = passed and all(torch.equal(x, t) for x in gathered)
+    results[rank] = passed
+    dist.destroy_process_group()
+
+
+class HierarchicalAllreduceTester(TestCase):
+    @unittest.skipIf(
+        not dist.is_available() or not dist.is_gloo_available(),
+        "torch.distributed with gloo is not available",
+    )
+    def test_hierarchical_allreduce_with_simulated_nodes(self):
+        for pipeline, port in [(0, 29533), (1, 29534)]:
+            manager = mp.Manager()
+            results = manager.dict()
+            mp.spawn(
+                run_hierarchical_allreduce,
+                args=(port, pipeline, results),
+                nprocs=WORLD_SIZE,
+                join=True,
+            )
+            self.assertEqual(
+                dict(results), {r: True for r in range(WORLD_SIZE)}
+            )
+
+    @unittest.skipIf(
+        not dist.is_available() or not dist.is_gloo_available(),
+        "torch.distributed with gloo is not available",
+    )
+    def test_low_precision_wire_allreduce(self):
+        manager = mp.Manager()
+        results = manager.dict()
+        mp.spawn(
+            run_low_precision_allreduce,
+            args=(29535, results),
+            nprocs=WORLD_SIZE,
+            join=True,
+        )
+        self.assertEqual(dict(results), {r: True for r in range(WORLD_SIZE)})
+
+
+if __name__ == "__main__":
+    test = unittest.main()
@@ -591,6 +591,68 @@ class OptimizeTransformersNightlyTester(TestCase):
                         keys_found
                     ), "Error: Format of checkpoint and config do not match"
 
+    @unittest.skipIf(
+        not core.isa_has_avx512_bf16_support(),
+        "The fused MoE kernels need avx512 bf16 support",
+    )
+    def test_weight_only_quant_mixed_precision_fused_moe(self):
+        config = AutoConfig.from_pretrained(
+            f"{curpath}/hf_configs/deepseekv2",
+            return_dict=False,
+            trust_remote_code=True,
+            _attn_implementation="eager",
+        )
+        config.num_hidden_layers = 3
+        config.use_fused_moe = True
+        config.use_fused_moe_woq = True
+        model = DeepseekV2ForCausalLM(config).eval().to(torch.bfloat16)
+        lowp_mode = ipex.quantization.WoqLowpMode
+        # A sensitivity plan gives a format to each linear of the experts
+        layer_plan = {
+            "model.layers.1.mlp.experts": {"lowp_mode": lowp_mode.INT8},
+            "model.layers.1.mlp.experts.3.gate_proj": {"lowp_mode": lowp_mode.BF16},
+            "model.layers.2.mlp.experts.5.down_proj": None,
+        }
+        qconfig = (
+            ipex.quantization.get_weight_only_quant_mixed_precision_qconfig_mapping(
+                layer_plan, lowp_mode=lowp_mode.INT8
+            )
+        )
+        with self.assertLogs("IPEX", level="WARNING") as logs:
+            ipex_m = ipex.llm.optimize(
+                model,
+                dtype=torch.bfloat16,
+                quantization_config=qconfig,
+                deployment_mode=False,
+                inplace=True,
+            )
+        self.assertTrue(
+            any("model.layers.2.mlp.experts.5.down_proj" in msg for msg in logs.output)
+        )
+        # The experts in mixed formats are quantized per plan and run with
+        # their own op contexts
+        layer = ipex_m.model.layers[1]
+        self.assertFalse(layer.use_fused_moe or layer.use_fused_moe_woq)
+        self.assertEqual(layer.moe_linear_type, 4)
+        self.assertEqual(layer.mlp.experts[3].gate_proj._lowp_mode, lowp_mode.BF16)
+        self.assertEqual(layer.mlp.experts[3].up_proj._lowp_mode, lowp_mode.INT8)
+        # The experts kept in float by the plan are quantized with the others
+        layer = ipex_m.model.layers[2]
+        self.assertTrue(layer.use_fused_moe_woq)
+        self.assertEqual(layer.woq_lowp_mode, lowp_mode.INT8)
+        input_ids = torch.ones(10).to(torch.long).unsqueeze(0)
+        with torch.no_grad(), torch.cpu.amp.autocast(
+            enabled=True, dtype=torch.bfloat16
+        ):
+            logits = ipex_m(
+                input_ids=input_ids,
+                attention_mask=torch.ones_like(input_ids),
+                position_ids=torch.arange(10).unsqueeze(0),
+                use_cache=True,
+            )[0]
+        self.assertEqual(logits.shape, (1, 10, config.vocab_size))
+        self.assertFalse(logits.isnan().any())
+
 
 if __name__ == "__main__":
     test = unittest.main()
@@ -493,6 +493,175 @@ class MaskedMHATest(TestCase):
                     value_cache_iakv_bf16[offset, :, :, :],
                 )
 
+    def _test_mha_long_context_decoding(self):
+        # batch * kv_head is less than the threads, so the next token uses
+        # the flash decoding which splits the long context across the threads.
+        # Pin the threads above the largest batch * kv_head of 16 so the flash
+        # decoding is taken whatever the number of cores.
+        num_threads = torch.get_num_threads()
+        torch.set_num_threads(32)
+        try:
+            head_num = 4
+            head_size = 64
+            first_seq_len = 1000
+            max_seq_len = first_seq_len + 8
+            for beam_size, head_num_kv in itertools.product([1, 4], [1, 4]):
+                mha = MaskedMHA(
+                    hidden_size=head_num * head_size,
+                    n_head=head_num,
+                    n_head_kv=head_num_kv,
+                    head_dim=head_size,
+                )
+                input_t = torch.randn(1, first_seq_len, head_num * head_size)
+                key_cache_iakv = torch.randn(
+                    max_seq_len, beam_size, head_num_kv, head_size
+                )
+                value_cache_iakv = torch.randn(
+                    max_seq_len, beam_size, head_num_kv, head_size
+                )
+                beam_idx = torch.zeros(max_seq_len, beam_size, dtype=torch.int64)
+                attention_mask = torch.full((first_seq_len, first_seq_len), -1e6)
+                attention_mask = attention_mask.triu(1).unsqueeze(0).unsqueeze(0)
+                offset = 0
+                with torch.inference_mode(), torch.no_grad():
+                    _, _, key_cache, value_cache, _ = mha(
+                        input_t, None, None, max_seq_len, attention_mask, None, None
+                    )
+                    _, _, key_cache_iakv, value_cache_iakv, beam_idx = mha(
+                        input_t,
+                        key_cache_iakv,
+                        value_cache_iakv,
+                        max_seq_len,
+                        attention_mask,
+                        beam_idx,
+                        True,
+                        torch.tensor(offset),
+                    )
+                    key_cache = key_cache.repeat_interleave(beam_size, dim=0)
+                    value_cache = value_cache.repeat_interleave(beam_size, dim=0)
+                    beam_idx_t = torch.zeros(beam_size, dtype=torch.int64)
+                    beam_idx[offset] = beam_idx_t
+                    offset = first_seq_len
+                    for step in range(3):
+                        input_t = torch.randn(beam_size, 1, head_num * head_size)
+                        attention_mask = torch.zeros(beam_size, 1, 1, offset + 1)
+                        attention_mask[:, :, :, : 8 * (step + 1)] = -1e6
+                        naive_output, _, key_cache, value_cache, _ = mha(
+                            input_t,
+                            key_cache,
+                            value_cache,
+                            max_seq_len,
+                            attention_mask,
+                            None,
+                            None,
+                        )
+                        (
+                            indirect_access_kv_cache_output,
+                            _,
+                            key_cache_iakv,
+                            value_cache_iakv,
+                            beam_idx,
+                        ) = mha(
+                            input_t,
+                            key_cache_iakv,
+                            value_cache_iakv,
+                            max_seq_len,
+                            attention_mask,
+                            beam_idx,
+                            True,
+                            torch.tensor(offset),
+                        )
+                        self.assertEqual(
+                            naive_output, indirect_access_kv_cache_output, prec=1e-4
+                        )
+                        self.assertEqual(
+                            key_cache.transpose(0, 1)[offset],
+                            key_cache_iakv[offset, :, :, :],
+                        )
+                        self.assertEqual(
+                            value_cache.transpose(0, 1)[offset],
+                            value_cache_iakv[offset, :, :, :],
+                        )
+                        if beam_size == 4:
+                            beam_idx_t = torch.tensor([1, 3, 0, 0])
+                        else:
+                            beam_idx_t = torch.arange(beam_size)
+                        beam_idx[offset] = beam_idx_t
+                        offset = offset + 1
+                        key_cache = torch.index_select(key_cache, 0, beam_idx_t)
+                        value_cache = torch.index_select(value_cache, 0, beam_idx_t)
+        finally:
+            torch.set_num_threads(num_threads)
+
+    def _test_compact_indirect_access_kv_cache(self):
+        batch_size = 2
+        beam_size = 4
+        head_num = 4
+        head_num_kv = 2
+        head_size = 64
+        prompt_len = 8
+        offset = 24
+        max_seq_len = 32
+        beam_batch = beam_size * batch_size
+        key_cache = torch.randn(max_seq_len, beam_batch, head_num_kv, head_size)
+        value_cache = torch.randn(max_seq_len, beam_batch, head_num_kv, head_size)
+        beam_idx = torch.zeros(max_seq_len + 2, beam_batch, dtype=torch.int64)
+        beam_idx[-2] = prompt_len
+        beam_idx[-1] = batch_size
+        for ti in range(prompt_len, offset):
+            beam_idx[ti] = (
+                torch.randint(0, beam_size, (beam_batch,))
+                + torch.arange(batch_size).repeat_interleave(beam_size) * beam_size
+            )
+        # resolve the beam history of the generated tokens as the kernel does
+        src_beam = torch.zeros(offset, beam_batch, dtype=torch.int64)
+        src_beam[offset - 1] = beam_idx[offset - 1]
+        for ti in range(offset - 2, prompt_len - 1, -1):
+            src_beam[ti] = beam_idx[ti][src_beam[ti + 1]]
+        query = torch.randn(beam_batch, 1, head_num, head_size)
+        key = torch.randn(beam_batch, 1, head_num_kv, head_size)
+        value = torch.randn(beam_batch, 1, head_num_kv, head_size)
+        attention_mask = torch.zeros(beam_batch, 1, 1, offset + 1)
+        with torch.inference_mode(), torch.no_grad():
+            ref_outputs = torch.ops.torch_ipex.masked_multihead_self_attention(
+                query,
+                key,
+                value,
+                key_cache.clone(),
+                value_cache.clone(),
+                beam_idx.clone(),
+                torch.tensor(offset),
+                head_size**0.5,
+                max_seq_len,
+                None,
+                attention_mask,
+            )
+            key_cache_compact = key_cache.clone()
+            value_cache_compact = value_cache.clone()
+            beam_idx_compact = beam_idx.clone()
+            torch.ops.torch_ipex.compact_indirect_access_kv_cache(
+                key_cache_compact, value_cache_compact, beam_idx_compact, offset
+            )
+            self.assertEqual(key_cache_compact[:prompt_len], key_cache[:prompt_len])
+            for ti in range(prompt_len, offset):
+                self.assertEqual(key_cache_compact[ti], key_cache[ti][src_beam[ti]])
+                self.assertEqual(value_cache_compact[ti], value_cache[ti][src_beam[ti]])
+                self.assertEqual(beam_idx_compact[ti], torch.arange(beam_batch))
+            outputs = torch.ops.torch_ipex.masked_multihead_self_attention(
+                query,
+                key,
+                value,
+                key_cache_compact,
+                value_cache_compact,
+                beam_idx_compact,
+                torch.tensor(offset),
+                head_size**0.5,
+                max_seq_len,
+                None,
+                attention_mask,
+            )
+            self.assertEqual(outputs[0], ref_outputs[0])
+
     def _test_mha_fp16(self, torchcompile=False):
         beam_size_list = [1, 4]
         batch_size_list = [1, 2, 4]
@@ -849,6 +1018,8 @@ class MaskedMHATest(TestCase):
     def test_mha(self):
         self._test_mha(torchcompile=False)
         self._test_mha_fp16(torchcompile=False)
+        self._test_mha_long_context_decoding()
+        self._test_compact_indirect_access_kv_cache()
         self._test_masked_multihead_self_attention()
         self._test_cross_attention()
 
@@ -4,6 +4,7 @@ from common_utils import TestCase
 import os
 import unittest
 import random
+import tempfile
 from typing import List, Optional, Tuple
 from itertools import product
 import intel_extension_for_pytorch._C as core
@@ -447,6 +448,978 @@ class PagedAttentionTest(TestCase):
                     is_compile,
                 )
 
+    def test_paged_attention_shared_prefix(self):
+        os.environ["PAGED_ATTENTION_SINGLE_QUERY_KERNEL"] = (
+            SingleQueryKernels.FLASH_DECODING
+        )
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 11, 8, 2, 64
+        block_size, num_blocks = 16, 256
+        scale = float(1.0 / (head_size**0.5))
+        # Two system prompts of 40 and 21 blocks are shared by the interleaved
+        # sequences, which have their own suffix blocks
+        prefixes = [torch.arange(40), torch.arange(40, 61)]
+        max_num_blocks_per_seq = 48
+        next_block = 61
+        block_tables = []
+        context_lens = []
+        for i in range(num_seqs):
+            prefix = prefixes[i % 2]
+            suffix_len = max_num_blocks_per_seq - prefix.numel()
+            suffix = torch.arange(next_block, next_block + suffix_len)
+            next_block += suffix_len
+            block_tables.append(torch.cat([prefix, suffix]))
+            context_lens.append(prefix.numel() * block_size + 1 + 11 * i)
+        block_tables = torch.stack(block_tables).int()
+        context_lens = torch.tensor(context_lens, dtype=torch.int)
+        max_context_len = int(context_lens.max())
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        for dtype in [torch.float, torch.bfloat16]:
+            key_caches, value_caches = self.create_kv_caches(
+                num_blocks, block_size, 1, num_kv_head, head_size, dtype, 0
+            )
+            query = torch.randn(num_seqs, num_head, head_size).to(dtype)
+            outputs = []
+            for prefix_sharing in ["1", "0"]:
+                os.environ["PAGED_ATTENTION_PREFIX_SHARING"] = prefix_sharing
+                output = torch.empty_like(query)
+                ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                    output,
+                    query,
+                    key_caches[0],
+                    value_caches[0],
+                    head_mapping,
+                    scale,
+                    block_tables,
+                    context_lens,
+                    block_size,
+                    max_context_len,
+                    None,
+                )
+                outputs.append(output)
+            os.environ.pop("PAGED_ATTENTION_PREFIX_SHARING")
+            ref_output = torch.empty_like(query)
+            self.ref_single_query_cached_kv_attention(
+                ref_output,
+                query,
+                num_head // num_kv_head,
+                key_caches[0],
+                value_caches[0],
+                block_tables,
+                context_lens,
+                scale,
+                None,
+                -1,
+                softcap=-1,
+            )
+            self.assertEqual(outputs[0], outputs[1])
+            self.assertEqual(outputs[0], ref_output, atol=5e-3, rtol=1e-3)
+
+    def test_paged_attention_autotune(self):
+        os.environ.pop("PAGED_ATTENTION_SINGLE_QUERY_KERNEL", None)
+        torch.manual_seed(0)
+        num_head, num_kv_head, head_size = 8, 2, 64
+        block_size, num_blocks = 16, 256
+        scale = float(1.0 / (head_size**0.5))
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            cache_path = os.path.join(tmp_dir, "paged_attention_autotune.txt")
+            os.environ["PAGED_ATTENTION_AUTOTUNE"] = "1"
+            os.environ["PAGED_ATTENTION_AUTOTUNE_CACHE"] = cache_path
+            # The buckets are tuned on first use and reused by the repeated
+            # calls, the output of any selected kernel should be correct
+            for dtype, num_seqs, max_seq_len in product(
+                [torch.float, torch.bfloat16], [1, 8], [100, 1000, 1000]
+            ):
+                key_caches, value_caches = self.create_kv_caches(
+                    num_blocks, block_size, 1, num_kv_head, head_size, dtype, 0
+                )
+                query = torch.randn(num_seqs, num_head, head_size).to(dtype)
+                context_lens = [
+                    random.randint(1, max_seq_len) for _ in range(num_seqs)
+                ]
+                context_lens[-1] = max_seq_len
+                max_context_len = max(context_lens)
+                context_lens = torch.tensor(context_lens, dtype=torch.int)
+                max_num_blocks_per_seq = (max_context_len + block_size - 1) // (
+                    block_size
+                )
+                block_tables = torch.randint(
+                    0, num_blocks, (num_seqs, max_num_blocks_per_seq)
+                ).int()
+                output = torch.empty_like(query)
+                ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                    output,
+                    query,
+                    key_caches[0],
+                    value_caches[0],
+                    head_mapping,
+                    scale,
+                    block_tables,
+                    context_lens,
+                    block_size,
+                    max_context_len,
+                    None,
+                )
+                ref_output = torch.empty_like(query)
+                self.ref_single_query_cached_kv_attention(
+                    ref_output,
+                    query,
+                    num_head // num_kv_head,
+                    key_caches[0],
+                    value_caches[0],
+                    block_tables,
+                    context_lens,
+                    scale,
+                    None,
+                    -1,
+                    softcap=-1,
+                )
+                self.assertEqual(output, ref_output, atol=5e-3, rtol=1e-3)
+            os.environ.pop("PAGED_ATTENTION_AUTOTUNE")
+            os.environ.pop("PAGED_ATTENTION_AUTOTUNE_CACHE")
+            # One decision per bucket: 2 dtypes x 2 batches x 2 contexts
+            with open(cache_path) as f:
+                decisions = [line.rstrip("\n").split("\t") for line in f]
+            self.assertEqual(len(decisions), 8)
+            for cpu_model, bucket, kernel, partition_size in decisions:
+                self.assertIn(int(kernel), [1, 2])
+                self.assertEqual(int(partition_size) % block_size, 0)
+
+    def test_evict_kv_blocks(self):
+        torch.manual_seed(0)
+        num_head, num_kv_head, head_size = 8, 2, 64
+        block_size, num_blocks = 16, 160
+        num_sink_tokens, window_size = 4, 100
+        scale = float(1.0 / (head_size**0.5))
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        # The sequences are entirely in, partly out of, or far out of the window
+        context_lens = torch.tensor([90, 300, 517, 131], dtype=torch.int)
+        num_seqs = context_lens.numel()
+        max_num_blocks_per_seq = 33
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        key_caches, value_caches = self.create_kv_caches(
+            num_blocks, block_size, 1, num_kv_head, head_size, torch.float, 0
+        )
+        key_cache, value_cache = key_caches[0], value_caches[0]
+        query = torch.randn(num_seqs, num_head, head_size)
+        alibi_slopes = torch.randn(num_head)
+        for use_alibi in [False, True]:
+            slopes = alibi_slopes if use_alibi else None
+            # Reference with the full cache: the sinks and the last window_size
+            # tokens are attended in their original positions
+            ref_output = torch.empty_like(query)
+            for i in range(num_seqs):
+                context_len = int(context_lens[i])
+                positions = torch.arange(context_len)
+                blocks = block_tables[i][positions // block_size].long()
+                keys = key_cache[blocks, :, positions % block_size]
+                values = value_cache[blocks, :, positions % block_size]
+                keys = torch.repeat_interleave(keys, num_head // num_kv_head, dim=1)
+                values = torch.repeat_interleave(
+                    values, num_head // num_kv_head, dim=1
+                )
+                attn_mask = torch.zeros(num_head, 1, context_len)
+                attn_mask[
+                    :,
+                    :,
+                    (positions >= num_sink_tokens)
+                    & (positions < context_len - window_size),
+                ] = -float("inf")
+                if use_alibi:
+                    attn_mask += alibi_slopes.view(-1, 1, 1) * (
+                        positions - context_len + 1
+                    ).float().view(1, 1, -1)
+                ref_output[i] = self.ref_masked_attention(
+                    query[i].unsqueeze(0), keys, values, scale, attn_mask
+                ).view(num_head, head_size)
+
+            evicted_tables = block_tables.clone()
+            evicted_context_lens = context_lens.clone()
+            evicted_lens = torch.zeros(num_seqs, dtype=torch.int)
+            evicted_blocks = ipex.llm.modules.PagedAttention.evict_kv_blocks(
+                evicted_tables,
+                evicted_context_lens,
+                evicted_lens,
+                block_size,
+                num_sink_tokens,
+                window_size,
+            )
+            # Evicting again is a no-op
+            self.assertEqual(
+                ipex.llm.modules.PagedAttention.evict_kv_blocks(
+                    evicted_tables,
+                    evicted_context_lens,
+                    evicted_lens,
+                    block_size,
+                    num_sink_tokens,
+                    window_size,
+                ).numel(),
+                0,
+            )
+            expected_evicted_blocks = []
+            for i in range(num_seqs):
+                context_len = int(context_lens[i])
+                num_evicted = max((context_len - window_size) // block_size - 1, 0)
+                num_blocks_of_seq = (context_len + block_size - 1) // block_size
+                expected_evicted_blocks.append(block_tables[i, 1 : 1 + num_evicted])
+                self.assertEqual(int(evicted_lens[i]), num_evicted * block_size)
+                self.assertEqual(
+                    int(evicted_context_lens[i]), context_len - num_evicted * block_size
+                )
+                self.assertEqual(
+                    evicted_tables[i, : num_blocks_of_seq - num_evicted],
+                    torch.cat(
+                        [block_tables[i, :1], block_tables[i, 1 + num_evicted :]]
+                    )[: num_blocks_of_seq - num_evicted],
+                )
+                self.assertTrue(
+                    (
+                        evicted_tables[
+                            i, num_blocks_of_seq - num_evicted : num_blocks_of_seq
+                        ]
+                        == -1
+                    ).all()
+                )
+            self.assertEqual(evicted_blocks, torch.cat(expected_evicted_blocks))
+
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                output,
+                query,
+                key_cache,
+                value_cache,
+                head_mapping,
+                scale,
+                evicted_tables,
+                evicted_context_lens,
+                block_size,
+                int(evicted_context_lens.max()),
+                slopes,
+                window_size,
+                evicted_lens=evicted_lens,
+                num_sink_tokens=num_sink_tokens,
+            )
+            self.assertEqual(output, ref_output, atol=5e-3, rtol=1e-3)
+
+    def test_multi_query_cached_kv_attention(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, max_num_blocks_per_seq = 16, 128, 24
+        scale = float(1.0 / (head_size**0.5))
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        # The first one has the draft tokens across a partition
+        context_lens = torch.tensor([130, 37, 300], dtype=torch.int)
+        max_context_len = int(context_lens.max())
+        # A draft token tree of 0 -> (1, 2), 1 -> 3
+        tree_mask = torch.tensor(
+            [[1, 0, 0, 0], [1, 1, 0, 0], [1, 0, 1, 0], [1, 1, 0, 1]],
+            dtype=torch.bool,
+        )
+        for dtype, num_queries, query_mask in [
+            (torch.float, 4, None),
+            (torch.float, 4, tree_mask),
+            (torch.bfloat16, 2, None),
+        ]:
+            key_caches, value_caches = self.create_kv_caches(
+                num_blocks, block_size, 1, num_kv_head, head_size, dtype, 0
+            )
+            key_cache, value_cache = key_caches[0], value_caches[0]
+            query = torch.randn(num_seqs * num_queries, num_head, head_size).to(dtype)
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.multi_query_cached_kv_attention(
+                output,
+                query,
+                key_cache,
+                value_cache,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+                num_queries,
+                query_mask,
+            )
+            mask = (
+                query_mask
+                if query_mask is not None
+                else torch.ones(num_queries, num_queries).tril().bool()
+            )
+            for i in range(num_seqs):
+                context_len = int(context_lens[i])
+                positions = torch.arange(context_len)
+                blocks = block_tables[i, positions // block_size].long()
+                offsets = positions % block_size
+                keys = key_cache[blocks, :, offsets, :]
+                values = value_cache[blocks, :, offsets, :]
+                keys = torch.repeat_interleave(keys, num_head // num_kv_head, dim=1)
+                values = torch.repeat_interleave(
+                    values, num_head // num_kv_head, dim=1
+                )
+                attn_mask = torch.zeros(num_queries, context_len)
+                attn_mask[:, context_len - num_queries :].masked_fill_(
+                    ~mask, -float("inf")
+                )
+                ref_output = self.ref_masked_attention(
+                    query[i * num_queries : (i + 1) * num_queries],
+                    keys,
+                    values,
+                    scale,
+                    attn_mask.unsqueeze(0),
+                )
+                self.assertEqual(
+                    output[i * num_queries : (i + 1) * num_queries],
+                    ref_output,
+                    atol=5e-3 if dtype == torch.float else 2e-2,
+                    rtol=1e-3,
+                )
+
+    def test_multi_query_cached_kv_attention_quantized_cache(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, max_num_blocks_per_seq = 16, 128, 24
+        num_queries = 4
+        scale = float(1.0 / (head_size**0.5))
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        context_lens = torch.tensor([130, 37, 300], dtype=torch.int)
+        max_context_len = int(context_lens.max())
+        slots = torch.cat(
+            [
+                block_tables[s, torch.arange(n) // block_size] * block_size
+                + torch.arange(n) % block_size
+                for s, n in enumerate(context_lens.tolist())
+            ]
+        ).int()
+        # The outputs are averages of the values, the error is a fraction of
+        # the quantization step
+        for dtype, kv_cache_dtype, atol in [
+            (torch.bfloat16, "fp8", 0.1),
+            (torch.float, "int8", 2e-2),
+            (torch.bfloat16, "int8", 2e-2),
+            (torch.float, "int4", 0.2),
+        ]:
+            shape = (num_blocks, num_kv_head, block_size, head_size)
+            key = torch.randn(slots.numel(), num_kv_head, head_size).to(dtype)
+            value = torch.randn(slots.numel(), num_kv_head, head_size).to(dtype)
+            key_cache = torch.zeros(shape, dtype=dtype)
+            value_cache = torch.zeros(shape, dtype=dtype)
+            ipex.llm.modules.PagedAttention.reshape_and_cache(
+                key, value, key_cache, value_cache, slots
+            )
+            if kv_cache_dtype == "fp8":
+                q_key_cache = key_cache.to(torch.float8_e5m2)
+                q_value_cache = value_cache.to(torch.float8_e5m2)
+                # The reference reads the same rounded values
+                key_cache = q_key_cache.to(dtype)
+                value_cache = q_value_cache.to(dtype)
+            else:
+                q_shape = ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                    num_blocks, num_kv_head, block_size, head_size, kv_cache_dtype
+                )
+                q_key_cache = torch.zeros(q_shape, dtype=torch.uint8)
+                q_value_cache = torch.zeros(q_shape, dtype=torch.uint8)
+                ipex.llm.modules.PagedAttention.reshape_and_cache(
+                    key, value, q_key_cache, q_value_cache, slots, kv_cache_dtype
+                )
+            query = torch.randn(num_seqs * num_queries, num_head, head_size).to(dtype)
+            outputs = []
+            for k_cache, v_cache in [
+                (key_cache, value_cache),
+                (q_key_cache, q_value_cache),
+            ]:
+                output = torch.empty_like(query)
+                ipex.llm.modules.PagedAttention.multi_query_cached_kv_attention(
+                    output,
+                    query,
+                    k_cache,
+                    v_cache,
+                    scale,
+                    block_tables,
+                    context_lens,
+                    block_size,
+                    max_context_len,
+                    num_queries,
+                )
+                outputs.append(output)
+            self.assertEqual(outputs[0], outputs[1], atol=atol, rtol=0)
+
+    def test_single_query_cached_kv_attention_with_rope(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, max_num_blocks_per_seq = 16, 64, 16
+        max_position = 512
+        scale = float(1.0 / (head_size**0.5))
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        context_lens = torch.tensor([37, 130, 201], dtype=torch.int)
+        max_context_len = int(context_lens.max())
+        # The new token is the last one of the context
+        positions = context_lens.long() - 1
+        slot_mapping = (
+            block_tables[torch.arange(num_seqs), positions // block_size].long()
+            * block_size
+            + positions % block_size
+        ).int()
+
+        def apply_rope(x, sin, cos, rotary_ndims, rotary_offset):
+            x = x.float()
+            rot, rest = x[..., :rotary_ndims], x[..., rotary_ndims:]
+            if rotary_offset == 1:
+                sin = torch.repeat_interleave(sin, 2, dim=-1)
+                cos = torch.repeat_interleave(cos, 2, dim=-1)
+                rotated = torch.stack((-rot[..., 1::2], rot[..., ::2]), dim=-1)
+                rotated = rotated.flatten(-2)
+            else:
+                sin = torch.cat((sin, sin), dim=-1)
+                cos = torch.cat((cos, cos), dim=-1)
+                half = rotary_ndims // 2
+                rotated = torch.cat((-rot[..., half:], rot[..., :half]), dim=-1)
+            return torch.cat((rot * cos + rotated * sin, rest), dim=-1)
+
+        # GPT-J style partial rotary, LLaMA style and partial rotate-half
+        for dtype, rotary_ndims, rotary_offset in [
+            (torch.float, 32, 1),
+            (torch.float, head_size, head_size // 2),
+            (torch.bfloat16, 32, 16),
+        ]:
+            inv_freq = 1.0 / (
+                10000 ** (torch.arange(0, rotary_ndims, 2).float() / rotary_ndims)
+            )
+            freqs = torch.outer(torch.arange(max_position).float(), inv_freq)
+            rope_emb_pos = torch.cat((freqs.sin(), freqs.cos()), dim=1)
+            sin = rope_emb_pos[positions, : rotary_ndims // 2].unsqueeze(1)
+            cos = rope_emb_pos[positions, rotary_ndims // 2 :].unsqueeze(1)
+            key_caches, value_caches = self.create_kv_caches(
+                num_blocks, block_size, 1, num_kv_head, head_size, dtype, 0
+            )
+            key_cache, value_cache = key_caches[0], value_caches[0]
+            query = torch.randn(num_seqs, num_head, head_size).to(dtype)
+            key = torch.randn(num_seqs, num_kv_head, head_size).to(dtype)
+            value = torch.randn(num_seqs, num_kv_head, head_size).to(dtype)
+
+            # Unfused reference: RoPE, then cache the key/value and attend
+            ref_key_cache, ref_value_cache = key_cache.clone(), value_cache.clone()
+            ref_query = apply_rope(query, sin, cos, rotary_ndims, rotary_offset)
+            ref_key = apply_rope(key, sin, cos, rotary_ndims, rotary_offset)
+            ipex.llm.modules.PagedAttention.reshape_and_cache(
+                ref_key.to(dtype),
+                value,
+                ref_key_cache,
+                ref_value_cache,
+                slot_mapping,
+            )
+            ref_output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                ref_output,
+                ref_query.to(dtype),
+                ref_key_cache,
+                ref_value_cache,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+                None,
+            )
+
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention_with_rope(
+                output,
+                query,
+                key,
+                value,
+                key_cache,
+                value_cache,
+                slot_mapping,
+                rope_emb_pos,
+                positions,
+                rotary_offset,
+                rotary_ndims,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+            )
+            atol = 5e-3 if dtype == torch.float else 2e-2
+            self.assertEqual(key_cache, ref_key_cache, atol=atol, rtol=1e-3)
+            self.assertEqual(value_cache, ref_value_cache)
+            self.assertEqual(output, ref_output, atol=atol, rtol=1e-3)
+
+    def test_single_query_cached_kv_attention_with_rope_quantized_cache(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, max_num_blocks_per_seq = 16, 64, 16
+        rotary_ndims, rotary_offset, max_position = 32, 16, 512
+        scale = float(1.0 / (head_size**0.5))
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        context_lens = torch.tensor([37, 130, 201], dtype=torch.int)
+        max_context_len = int(context_lens.max())
+        positions = context_lens.long() - 1
+        slot_mapping = (
+            block_tables[torch.arange(num_seqs), positions // block_size].long()
+            * block_size
+            + positions % block_size
+        ).int()
+        inv_freq = 1.0 / (
+            10000 ** (torch.arange(0, rotary_ndims, 2).float() / rotary_ndims)
+        )
+        freqs = torch.outer(torch.arange(max_position).float(), inv_freq)
+        rope_emb_pos = torch.cat((freqs.sin(), freqs.cos()), dim=1)
+        sin = rope_emb_pos[positions, : rotary_ndims // 2].unsqueeze(1)
+        cos = rope_emb_pos[positions, rotary_ndims // 2 :].unsqueeze(1)
+
+        def apply_rope(x):
+            # Rotate half of the first rotary_ndims dims
+            x = x.float()
+            rot, rest = x[..., :rotary_ndims], x[..., rotary_ndims:]
+            half = rotary_ndims // 2
+            rotated = torch.cat((-rot[..., half:], rot[..., :half]), dim=-1)
+            rot = rot * torch.cat((cos, cos), dim=-1)
+            rot = rot + rotated * torch.cat((sin, sin), dim=-1)
+            return torch.cat((rot, rest), dim=-1)
+
+        def create_caches(dtype, kv_cache_dtype):
+            if kv_cache_dtype == "fp8":
+                key_caches, value_caches = self.create_kv_caches(
+                    num_blocks, block_size, 1, num_kv_head, head_size, dtype, 0
+                )
+                return (
+                    key_caches[0].to(torch.float8_e5m2),
+                    value_caches[0].to(torch.float8_e5m2),
+                )
+            shape = ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                num_blocks, num_kv_head, block_size, head_size, kv_cache_dtype
+            )
+            return torch.zeros(shape, dtype=torch.uint8), torch.zeros(
+                shape, dtype=torch.uint8
+            )
+
+        # The outputs are averages of the values, the error is a fraction of
+        # the quantization step
+        for dtype, kv_cache_dtype, atol in [
+            (torch.bfloat16, "fp8", 0.1),
+            (torch.float, "int8", 2e-2),
+            (torch.bfloat16, "int4", 0.2),
+        ]:
+            op_cache_dtype = "auto" if kv_cache_dtype == "fp8" else kv_cache_dtype
+            key_cache, value_cache = create_caches(dtype, kv_cache_dtype)
+            query = torch.randn(num_seqs, num_head, head_size).to(dtype)
+            key = torch.randn(num_seqs, num_kv_head, head_size).to(dtype)
+            value = torch.randn(num_seqs, num_kv_head, head_size).to(dtype)
+
+            # Unfused reference: RoPE, then cache the key/value and attend
+            ref_key_cache, ref_value_cache = key_cache.clone(), value_cache.clone()
+            ipex.llm.modules.PagedAttention.reshape_and_cache(
+                apply_rope(key).to(dtype),
+                value,
+                ref_key_cache,
+                ref_value_cache,
+                slot_mapping,
+                op_cache_dtype,
+            )
+            ref_output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                ref_output,
+                apply_rope(query).to(dtype),
+                ref_key_cache,
+                ref_value_cache,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+                None,
+            )
+
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention_with_rope(
+                output,
+                query,
+                key,
+                value,
+                key_cache,
+                value_cache,
+                slot_mapping,
+                rope_emb_pos,
+                positions,
+                rotary_offset,
+                rotary_ndims,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+                kv_cache_dtype=op_cache_dtype,
+            )
+            self.assertEqual(value_cache.float(), ref_value_cache.float())
+            self.assertEqual(output, ref_output, atol=atol, rtol=0)
+
+        # The fp8 cache is only supported with the BFloat16 query, it is
+        # rejected before the cache is written
+        key_cache, value_cache = create_caches(torch.float, "fp8")
+        ref_key_cache, ref_value_cache = key_cache.clone(), value_cache.clone()
+        query = torch.randn(num_seqs, num_head, head_size)
+        key = torch.randn(num_seqs, num_kv_head, head_size)
+        value = torch.randn(num_seqs, num_kv_head, head_size)
+        output = torch.empty_like(query)
+        self.assertRaises(
+            RuntimeError,
+            lambda: ipex.llm.modules.PagedAttention.single_query_cached_kv_attention_with_rope(
+                output,
+                query,
+                key,
+                value,
+                key_cache,
+                value_cache,
+                slot_mapping,
+                rope_emb_pos,
+                positions,
+                rotary_offset,
+                rotary_ndims,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                max_context_len,
+            ),
+        )
+        self.assertEqual(key_cache.float(), ref_key_cache.float())
+        self.assertEqual(value_cache.float(), ref_value_cache.float())
+
+    def test_quantized_kv_cache(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, prompt_len, decode_steps = 16, 64, 37, 12
+        scale = float(1.0 / (head_size**0.5))
+        max_num_blocks_per_seq = (prompt_len + decode_steps) // block_size + 1
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        # The outputs are averages of the values, the error is a fraction of
+        # the quantization step
+        for dtype, (kv_cache_dtype, atol) in product(
+            [torch.float, torch.bfloat16], [("int8", 2e-2), ("int4", 0.2)]
+        ):
+            shape = (num_blocks, num_kv_head, block_size, head_size)
+            key_cache = torch.zeros(shape, dtype=dtype)
+            value_cache = torch.zeros(shape, dtype=dtype)
+            q_shape = ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                num_blocks, num_kv_head, block_size, head_size, kv_cache_dtype
+            )
+            q_key_cache = torch.zeros(q_shape, dtype=torch.uint8)
+            q_value_cache = torch.zeros(q_shape, dtype=torch.uint8)
+
+            def write(start, end):
+                positions = torch.arange(start, end)
+                slots = torch.cat(
+                    [
+                        block_tables[s, positions // block_size] * block_size
+                        + positions % block_size
+                        for s in range(num_seqs)
+                    ]
+                ).int()
+                num_tokens = slots.numel()
+                key = torch.randn(num_tokens, num_kv_head, head_size).to(dtype)
+                value = torch.randn(num_tokens, num_kv_head, head_size).to(dtype)
+                ipex.llm.modules.PagedAttention.reshape_and_cache(
+                    key, value, key_cache, value_cache, slots
+                )
+                ipex.llm.modules.PagedAttention.reshape_and_cache(
+                    key, value, q_key_cache, q_value_cache, slots, kv_cache_dtype
+                )
+
+            # Prefill then decode token by token, the range of the pages grows
+            write(0, prompt_len)
+            for step in range(decode_steps):
+                write(prompt_len + step, prompt_len + step + 1)
+            context_len = prompt_len + decode_steps
+            context_lens = torch.full((num_seqs,), context_len, dtype=torch.int)
+            head_mapping = torch.repeat_interleave(
+                torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+            )
+            query = torch.randn(num_seqs, num_head, head_size).to(dtype)
+            outputs = []
+            for k_cache, v_cache in [
+                (key_cache, value_cache),
+                (q_key_cache, q_value_cache),
+            ]:
+                output = torch.empty_like(query)
+                ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                    output,
+                    query,
+                    k_cache,
+                    v_cache,
+                    head_mapping,
+                    scale,
+                    block_tables,
+                    context_lens,
+                    block_size,
+                    context_len,
+                    None,
+                )
+                outputs.append(output)
+            self.assertEqual(outputs[0], outputs[1], atol=atol, rtol=0)
+
+            # The chunked prefill reads the same pages
+            query_len = 5
+            query = torch.randn(num_seqs * query_len, num_head, head_size).to(dtype)
+            cu_seqlens_q = torch.arange(num_seqs + 1, dtype=torch.int) * query_len
+            cu_seqlens_kv = torch.arange(num_seqs + 1, dtype=torch.int) * context_len
+            outputs = []
+            for k_cache, v_cache, cache_dtype in [
+                (key_cache, value_cache, "auto"),
+                (q_key_cache, q_value_cache, kv_cache_dtype),
+            ]:
+                output = torch.empty_like(query)
+                ipex.llm.modules.PagedAttention.flash_attn_varlen_func(
+                    output,
+                    query,
+                    k_cache,
+                    v_cache,
+                    cu_seqlens_q,
+                    cu_seqlens_kv,
+                    query_len,
+                    context_len,
+                    scale,
+                    True,
+                    block_tables,
+                    None,
+                    kv_cache_dtype=cache_dtype,
+                )
+                outputs.append(output)
+            self.assertEqual(outputs[0], outputs[1], atol=atol, rtol=0)
+
+    def test_vnni_kv_cache_layout(self):
+        torch.manual_seed(0)
+        num_seqs, num_head, num_kv_head, head_size = 3, 8, 2, 64
+        block_size, num_blocks, context_len = 16, 64, 49
+        scale = float(1.0 / (head_size**0.5))
+        max_num_blocks_per_seq = context_len // block_size + 1
+        block_tables = torch.randperm(num_blocks)[
+            : num_seqs * max_num_blocks_per_seq
+        ].view(num_seqs, max_num_blocks_per_seq)
+        block_tables = block_tables.int()
+        shape = (num_blocks, num_kv_head, block_size, head_size)
+        key_cache = torch.zeros(shape, dtype=torch.bfloat16)
+        value_cache = torch.zeros(shape, dtype=torch.bfloat16)
+        vnni_key_cache = torch.zeros(
+            ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                num_blocks, num_kv_head, block_size, head_size, "vnni", True
+            ),
+            dtype=torch.bfloat16,
+        )
+        vnni_value_cache = torch.zeros(
+            ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                num_blocks, num_kv_head, block_size, head_size, "vnni", False
+            ),
+            dtype=torch.bfloat16,
+        )
+        positions = torch.arange(context_len)
+        slots = torch.cat(
+            [
+                block_tables[s, positions // block_size] * block_size
+                + positions % block_size
+                for s in range(num_seqs)
+            ]
+        ).int()
+        key = torch.randn(slots.numel(), num_kv_head, head_size).bfloat16()
+        value = torch.randn(slots.numel(), num_kv_head, head_size).bfloat16()
+        ipex.llm.modules.PagedAttention.reshape_and_cache(
+            key, value, key_cache, value_cache, slots
+        )
+        ipex.llm.modules.PagedAttention.reshape_and_cache(
+            key, value, vnni_key_cache, vnni_value_cache, slots, "vnni"
+        )
+        # The key is K^T and the value is V of every page with every two rows
+        # interleaved
+        self.assertEqual(
+            vnni_key_cache,
+            key_cache.view(num_blocks, num_kv_head, block_size, -1, 2).transpose(
+                2, 3
+            ),
+        )
+        self.assertEqual(
+            vnni_value_cache,
+            value_cache.view(num_blocks, num_kv_head, -1, 2, head_size).transpose(
+                3, 4
+            ),
+        )
+
+        context_lens = torch.full((num_seqs,), context_len, dtype=torch.int)
+        head_mapping = torch.repeat_interleave(
+            torch.arange(num_kv_head, dtype=torch.int), num_head // num_kv_head
+        )
+        query = torch.randn(num_seqs, num_head, head_size).bfloat16()
+        outputs = []
+        for k_cache, v_cache in [
+            (key_cache, value_cache),
+            (vnni_key_cache, vnni_value_cache),
+        ]:
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.single_query_cached_kv_attention(
+                output,
+                query,
+                k_cache,
+                v_cache,
+                head_mapping,
+                scale,
+                block_tables,
+                context_lens,
+                block_size,
+                context_len,
+                None,
+            )
+            outputs.append(output)
+        self.assertEqual(outputs[0], outputs[1], atol=2e-2, rtol=1e-3)
+
+        # The chunked prefill unpacks the pages
+        query_len = 5
+        query = torch.randn(num_seqs * query_len, num_head, head_size).bfloat16()
+        cu_seqlens_q = torch.arange(num_seqs + 1, dtype=torch.int) * query_len
+        cu_seqlens_kv = torch.arange(num_seqs + 1, dtype=torch.int) * context_len
+        outputs = []
+        for k_cache, v_cache, cache_dtype in [
+            (key_cache, value_cache, "auto"),
+            (vnni_key_cache, vnni_value_cache, "vnni"),
+        ]:
+            output = torch.empty_like(query)
+            ipex.llm.modules.PagedAttention.flash_attn_varlen_func(
+                output,
+                query,
+                k_cache,
+                v_cache,
+                cu_seqlens_q,
+                cu_seqlens_kv,
+                query_len,
+                context_len,
+                scale,
+                True,
+                block_tables,
+                None,
+                kv_cache_dtype=cache_dtype,
+            )
+            outputs.append(output)
+        self.assertEqual(outputs[0], outputs[1])
+
+        # An odd block_size leaves the value page short of a row
+        odd_block_size = 15
+        odd_key_cache = torch.zeros(
+            num_blocks, num_kv_head, head_size // 2, odd_block_size, 2
+        ).bfloat16()
+        odd_value_cache = torch.zeros(
+            num_blocks, num_kv_head, odd_block_size // 2, head_size, 2
+        ).bfloat16()
+        self.assertRaises(
+            RuntimeError,
+            lambda: ipex.llm.modules.PagedAttention.reshape_and_cache(
+                key, value, odd_key_cache, odd_value_cache, slots, "vnni"
+            ),
+        )
+
+    def test_copy_and_swap_blocks(self):
+        torch.manual_seed(0)
+        num_layers, num_kv_head, head_size = 2, 2, 64
+        block_size, num_blocks, num_host_blocks = 16, 32, 8
+        shapes = {
+            "auto": (num_blocks, num_kv_head, block_size, head_size),
+            "int8": ipex.llm.modules.PagedAttention.get_kv_cache_shape(
+                num_blocks, num_kv_head, block_size, head_size, "int8"
+            ),
+        }
+        for dtype, kv_cache_dtype in [
+            (torch.float, "auto"),
+            (torch.bfloat16, "auto"),
+            (torch.float8_e5m2, "auto"),
+            (torch.uint8, "int8"),
+        ]:
+
+            def create_caches(n):
+                shape = (n,) + tuple(shapes[kv_cache_dtype][1:])
+                return [
+                    torch.randn(shape).mul(20).to(dtype) for _ in range(num_layers)
+                ]
+
+            key_caches = create_caches(num_blocks)
+            value_caches = create_caches(num_blocks)
+            ref_key_caches = [c.clone() for c in key_caches]
+            ref_value_caches = [c.clone() for c in value_caches]
+            # Copy on write of the blocks shared by the forked beams
+            block_mapping = torch.tensor([[3, 10], [3, 11], [5, 20], [7, 6]])
+            ipex.llm.modules.PagedAttention.copy_blocks(
+                key_caches, value_caches, block_mapping
+            )
+            # Compare the raw bytes as the blocks are copied
+            for ref in ref_key_caches + ref_value_caches:
+                ref = ref.view(torch.uint8)
+                ref[block_mapping[:, 1]] = ref[block_mapping[:, 0]]
+            for cache, ref in zip(
+                key_caches + value_caches, ref_key_caches + ref_value_caches
+            ):
+                self.assertEqual(cache.view(torch.uint8), ref.view(torch.uint8))
+
+            # Swap out to the host caches and back in to other blocks
+            host_caches = create_caches(num_host_blocks) + create_caches(
+                num_host_blocks
+            )
+            swap_out = torch.tensor([[10, 0], [20, 3], [31, 7]])
+            ipex.llm.modules.PagedAttention.swap_blocks(
+                key_caches + value_caches, host_caches, swap_out
+            )
+            swap_in = torch.tensor([[0, 1], [3, 2], [7, 30]])
+            ipex.llm.modules.PagedAttention.swap_blocks(
+                host_caches, key_caches + value_caches, swap_in
+            )
+            for cache in key_caches + value_caches:
+                cache = cache.view(torch.uint8)
+                self.assertEqual(cache[[1, 2, 30]], cache[[10, 20, 31]])
+
+            # The block ids are checked against every layer, and a block
+            # can only be written once
+            short_caches = host_caches[:-1] + create_caches(num_host_blocks - 1)[:1]
+            for dst_caches, mapping in [
+                (short_caches, torch.tensor([[0, num_host_blocks - 1]])),
+                (host_caches, torch.tensor([[0, 1], [2, 1]])),
+            ]:
+                self.assertRaises(
+                    RuntimeError,
+                    lambda: ipex.llm.modules.PagedAttention.swap_blocks(
+                        key_caches + value_caches, dst_caches, mapping
+                    ),
+                )
+
 
 if __name__ == "__main__":
     test = unittest.main()
@@ -1,4 +1,6 @@
 import itertools
+import subprocess
+import sys
 import tempfile
 import torch
 import torch.nn as nn
@@ -501,6 +503,272 @@ class WeightOnlyQuantizationTester(TestCase):
         for shape, use_bias, w_dtype in cases:
             test(shape, use_bias, w_dtype)
 
+    def test_weight_only_quantization_packed_weight_cache(self):
+        from intel_extension_for_pytorch.nn.modules import WoqPackedWeightCache
+
+        class M(nn.Module):
+            def __init__(self, has_bias):
+                super(M, self).__init__()
+                self.linear1 = torch.nn.Linear(64, 96, has_bias)
+                self.linear2 = torch.nn.Linear(96, 31, has_bias)
+
+            def forward(self, x):
+                return self.linear2(self.linear1(x))
+
+        data = torch.rand(4, 64)
+        cases = itertools.product(
+            [True, False],
+            [WoqWeightDtype.INT8, WoqWeightDtype.INT4],
+            [WoqLowpMode.NONE, WoqLowpMode.BF16, WoqLowpMode.INT8],
+        )
+        for has_bias, w_dtype, lowp_mode in cases:
+            m = M(has_bias).eval()
+            qconfig = ipex.quantization.get_weight_only_quant_qconfig_mapping(
+                weight_dtype=w_dtype, lowp_mode=lowp_mode
+            )
+            with tempfile.TemporaryDirectory() as tmp, torch.no_grad():
+                path = os.path.join(tmp, "woq_packed_weight.pt")
+                # Record
+                prepared_model = prepare(m, qconfig, example_inputs=data, inplace=False)
+                with WoqPackedWeightCache(path):
+                    woq_model = convert(prepared_model)
+                assert os.path.exists(path)
+                # Load
+                prepared_model = prepare(m, qconfig, example_inputs=data, inplace=False)
+                with WoqPackedWeightCache(path):
+                    loaded_model = convert(prepared_model)
+                torch.testing.assert_close(
+                    loaded_model.linear1._op_context.get_weight(),
+                    woq_model.linear1._op_context.get_weight(),
+                )
+                torch.testing.assert_close(loaded_model(data), woq_model(data))
+                # The temporary file of the save is not left behind
+                self.assertEqual(os.listdir(tmp), ["woq_packed_weight.pt"])
+                # Another checkpoint of the same model
+                m_other = copy.deepcopy(m)
+                m_other.linear2.weight.add_(0.1)
+                prepared_model = prepare(
+                    m_other, qconfig, example_inputs=data, inplace=False
+                )
+                with self.assertRaises(AssertionError):
+                    with WoqPackedWeightCache(path):
+                        convert(prepared_model)
+                # Entries not used by the model
+                prepared_model = prepare(
+                    nn.Sequential(copy.deepcopy(m.linear1)),
+                    qconfig,
+                    example_inputs=data,
+                    inplace=False,
+                )
+                with self.assertRaises(AssertionError):
+                    with WoqPackedWeightCache(path):
+                        convert(prepared_model)
+                # Mismatched recipe
+                qconfig = ipex.quantization.get_weight_only_quant_qconfig_mapping(
+                    weight_dtype=w_dtype, lowp_mode=lowp_mode, group_size=32
+                )
+                prepared_model = prepare(m, qconfig, example_inputs=data, inplace=False)
+                with self.assertRaises(AssertionError):
+                    with WoqPackedWeightCache(path):
+                        convert(prepared_model)
+
+    def test_weight_only_quantization_gemm_autotune(self):
+        # The autotuner is enabled by env var at the first GEMM, so run the
+        # cases in subprocesses and compare the saved outputs
+        script = """
+import sys
+import torch
+import intel_extension_for_pytorch as ipex
+from intel_extension_for_pytorch.quantization import prepare, convert
+
+torch.manual_seed(0)
+outputs = []
+for w_dtype in [ipex.quantization.WoqWeightDtype.INT8,
+                ipex.quantization.WoqWeightDtype.INT4]:
+    for lowp_mode in [ipex.quantization.WoqLowpMode.NONE,
+                      ipex.quantization.WoqLowpMode.BF16]:
+        m = torch.nn.Linear(256, 512).eval()
+        qconfig = ipex.quantization.get_weight_only_quant_qconfig_mapping(
+            weight_dtype=w_dtype, lowp_mode=lowp_mode
+        )
+        for M in [1, 4, 24, 150]:
+            x = torch.rand(M, 256)
+            prepared_model = prepare(m, qconfig, example_inputs=x, inplace=False)
+            with torch.no_grad():
+                woq_model = convert(prepared_model)
+                outputs.append(woq_model(x))
+                outputs.append(woq_model(x))
+torch.save(outputs, sys.argv[1])
+"""
+        with tempfile.TemporaryDirectory() as tmp:
+            cache_path = os.path.join(tmp, "woq_gemm_autotune.txt")
+
+            def run(output_name, autotune):
+                env = os.environ.copy()
+                env.pop("IPEX_WOQ_GEMM_AUTOTUNE", None)
+                env.pop("IPEX_WOQ_GEMM_AUTOTUNE_CACHE", None)
+                if autotune:
+                    env["IPEX_WOQ_GEMM_AUTOTUNE"] = "1"
+                    env["IPEX_WOQ_GEMM_AUTOTUNE_CACHE"] = cache_path
+                output_path = os.path.join(tmp, output_name)
+                subprocess.check_call(
+                    [sys.executable, "-c", script, output_path], env=env
+                )
+                return torch.load(output_path)
+
+            outputs_ref = run("ref.pt", False)
+            # Tune and save the configs
+            outputs_tuned = run("tuned.pt", True)
+            with open(cache_path) as f:
+                num_configs = len(f.readlines())
+            self.assertGreater(num_configs, 0)
+            # Load the configs without tuning again
+            outputs_loaded = run("loaded.pt", True)
+            with open(cache_path) as f:
+                self.assertEqual(len(f.readlines()), num_configs)
+            for ref, tuned, loaded in zip(outputs_ref, outputs_tuned, outputs_loaded):
+                torch.testing.assert_close(tuned, ref, atol=1e-2, rtol=1e-2)
+                torch.testing.assert_close(loaded, ref, atol=1e-2, rtol=1e-2)
+
+    def test_weight_only_quantization_shared_weight_cache(self):
+        # The budget of the shared weight cache is read from env var, so run
+        # the cases in subprocesses and compare the saved outputs. It fits
+        # 1 of the 3 BF16 weights, or 2 of the 3 INT8 weights.
+        script = """
+import sys
+import torch
+import intel_extension_for_pytorch as ipex
+from intel_extension_for_pytorch.quantization import prepare, convert
+
+torch.manual_seed(0)
+outputs = []
+stats = []
+for w_dtype, lowp_mode in [
+    (ipex.quantization.WoqWeightDtype.INT8, ipex.quantization.WoqLowpMode.BF16),
+    (ipex.quantization.WoqWeightDtype.INT4, ipex.quantization.WoqLowpMode.BF16),
+    (ipex.quantization.WoqWeightDtype.INT4, ipex.quantization.WoqLowpMode.INT8),
+]:
+    m = torch.nn.Sequential(
+        torch.nn.Linear(1024, 1024),
+        torch.nn.Linear(1024, 1024),
+        torch.nn.Linear(1024, 1024),
+    ).eval()
+    x = torch.rand(128, 1024)
+    qconfig = ipex.quantization.get_weight_only_quant_qconfig_mapping(
+        weight_dtype=w_dtype, lowp_mode=lowp_mode
+    )
+    prepared_model = prepare(m, qconfig, example_inputs=x, inplace=False)
+    # The packed weights are inference tensors without version counters
+    with torch.inference_mode():
+        woq_model = convert(prepared_model)
+        stats_begin = ipex._C._get_woq_weight_cache_stats()
+        for _ in range(3):
+            outputs.append(woq_model(x))
+        # The last layer is now used more often than the least used cached
+        # weight, so it evicts the weight
+        outputs.append(woq_model[2](x))
+        stats_end = ipex._C._get_woq_weight_cache_stats()
+    stats.append(
+        {k: stats_end[k] - stats_begin[k] for k in stats_end if k != "used_bytes"}
+    )
+torch.save((outputs, stats), sys.argv[1])
+"""
+        with tempfile.TemporaryDirectory() as tmp:
+
+            def run(output_name, cache_size_mb):
+                env = os.environ.copy()
+                env["IPEX_WOQ_WEIGHT_CACHE_SIZE_MB"] = str(cache_size_mb)
+                output_path = os.path.join(tmp, output_name)
+                subprocess.check_call(
+                    [sys.executable, "-c", script, output_path], env=env
+                )
+                return torch.load(output_path)
+
+            outputs_ref, stats_ref = run("ref.pt", 0)
+            outputs, stats = run("cached.pt", 3)
+            for ref, out in zip(outputs_ref, outputs):
+                torch.testing.assert_close(out, ref, atol=5e-2, rtol=5e-2)
+            no_cache = dict(hits=0, misses=0, admissions=0, refusals=0, evictions=0)
+            for s in stats_ref:
+                self.assertEqual(s, no_cache)
+            # BF16: the first layer is admitted and the others are refused,
+            # until the last layer evicts it
+            bf16_stats = dict(hits=2, misses=8, admissions=2, refusals=6, evictions=1)
+            # INT8: the first two layers are admitted and the last one is
+            # refused, until it evicts the first layer
+            int8_stats = dict(hits=4, misses=6, admissions=3, refusals=3, evictions=1)
+            self.assertEqual(stats, [bf16_stats, bf16_stats, int8_stats])
+
+    def test_weight_only_quantization_mixed_precision_plan(self):
+        class M(nn.Module):
+            def __init__(self):
+                super(M, self).__init__()
+                self.linear1 = torch.nn.Linear(256, 256)
+                self.linear2 = torch.nn.Linear(256, 256)
+                self.block = torch.nn.Sequential(
+                    torch.nn.Linear(256, 256), torch.nn.Linear(256, 256)
+                )
+                # out_proj is not quantizable
+                self.attn = torch.nn.MultiheadAttention(256, 4)
+
+            def forward(self, x):
+                y = self.block(self.linear2(self.linear1(x)))
+                return y + self.attn(x, x, x, need_weights=False)[0]
+
+        m = M().eval()
+        calib_inputs = [(torch.rand(4, 256),) for _ in range(2)]
+        int4_config = {
+            "weight_dtype": WoqWeightDtype.INT4,
+            "lowp_mode": WoqLowpMode.BF16,
+            "group_size": 64,
+        }
+        int8_config = {
+            "weight_dtype": WoqWeightDtype.INT8,
+            "lowp_mode": WoqLowpMode.BF16,
+        }
+        sensitivity = ipex.quantization.get_weight_only_quant_sensitivity(
+            m, calib_inputs, int4_config
+        )
+        self.assertEqual(
+            set(sensitivity.keys()),
+            {"linear1", "linear2", "block.0", "block.1"},
+        )
+        self.assertTrue(all(s > 0 for s in sensitivity.values()))
+
+        # Only the least sensitive layer fits in the budget
+        least_sensitive = min(sensitivity, key=sensitivity.get)
+        layer_plan = ipex.quantization.get_weight_only_quant_plan_by_sensitivity(
+            sensitivity, int4_config, int8_config, sensitivity[least_sensitive]
+        )
+        for name, config in layer_plan.items():
+            expected = int4_config if name == least_sensitive else int8_config
+            self.assertEqual(config, expected)
+
+        # A plan of a parent module applies to its children and None keeps float
+        layer_plan = {"linear1": int4_config, "block": int8_config, "block.1": None}
+        qconfig_mapping = (
+            ipex.quantization.get_weight_only_quant_mixed_precision_qconfig_mapping(
+                layer_plan, weight_dtype=WoqWeightDtype.NF4, lowp_mode=WoqLowpMode.BF16
+            )
+        )
+        x = torch.rand(4, 256)
+        prepared_model = prepare(m, qconfig_mapping, example_inputs=x, inplace=False)
+        with torch.no_grad():
+            woq_model = convert(prepared_model)
+            y = woq_model(x)
+            y_ref = m(x)
+        self.assertTrue(isinstance(woq_model.linear1, WeightOnlyQuantizedLinear))
+        self.assertEqual(woq_model.linear1.dtype, WoqWeightDtype.INT4)
+        self.assertEqual(woq_model.linear1._group_size, 64)
+        self.assertEqual(woq_model.linear2.dtype, WoqWeightDtype.NF4)
+        self.assertEqual(woq_model.block[0].dtype, WoqWeightDtype.INT8)
+        self.assertTrue(type(woq_model.block[1]) is torch.nn.Linear)
+        self.assertTrue(
+            type(woq_model.attn.out_proj)
+            is torch.nn.modules.linear.NonDynamicallyQuantizableLinear
+        )
+        torch.testing.assert_close(y, y_ref, atol=5e-2, rtol=5e-2)
+
     def test_weight_only_quantization_int4_weight(self):
         class M(nn.Module):
             def __init__(self, input_channel, output_channel, has_bias):
@@ -1315,6 +1583,66 @@ class WeightOnlyQuantizationTester(TestCase):
                     # This check is for the ref kernel, where x is not quantized
                     torch.testing.assert_close(y, y_ref_2, atol=atol, rtol=rtol)
 
+    def test_compute_with_g_idx_act_order(self):
+        # Input channels are gathered per A panel in kernel by the permutation
+        # of g_idx, check the activation dtypes, the remainder of M blocks and
+        # the reuse of panels over several M blocks per thread
+        ic, oc, group_size = 256, 64, 32
+        n_groups = ic // group_size
+        int4_weight = torch.randint(0, 15, (oc, ic), dtype=torch.uint8)
+        packed_weight = (
+            int4_weight[:, 1::2].bitwise_left_shift(4).bitwise_or_(int4_weight[:, ::2])
+        )
+        scales = torch.rand((oc, n_groups), dtype=torch.half) * 0.1
+        zeros = torch.randint(6, 9, (oc, n_groups), dtype=torch.uint8)
+        packed_zeros = torch.zeros((oc, n_groups * 4 // 32), dtype=torch.int32)
+        for i in range(n_groups):
+            packed_zeros[:, i // 8] = packed_zeros[:, i // 8].bitwise_or_(
+                zeros[:, i].int().bitwise_left_shift(4 * (i % 8))
+            )
+        g_idx = torch.arange(n_groups).repeat_interleave(group_size)
+        g_idx = g_idx[torch.randperm(ic)].to(torch.int32)
+        bias = torch.rand(oc)
+        cases = itertools.product(
+            [[1, 4], [2, 25], [4, 40]],
+            [torch.float, torch.bfloat16],
+            [WoqLowpMode.NONE, WoqLowpMode.BF16],
+        )
+        for shape, act_dtype, lowp_mode in cases:
+            compute_dtype = (
+                torch.bfloat16 if lowp_mode == WoqLowpMode.BF16 else act_dtype
+            )
+            qconfig_mapping = ipex.quantization.get_weight_only_quant_qconfig_mapping(
+                weight_dtype=WoqWeightDtype.INT4,
+                lowp_mode=lowp_mode,
+                group_size=group_size,
+            )
+            linear = torch.nn.Linear(ic, oc)
+            linear.qconfig = qconfig_mapping.global_qconfig
+            woq_linear = WeightOnlyQuantizedLinear.from_float_and_qweight(
+                linear,
+                packed_weight,
+                WoqWeightDtype.INT4,
+                scales,
+                packed_zeros,
+                bias,
+                group_size=group_size,
+                g_idx=g_idx,
+            )
+            x = torch.randn(shape + [ic]).to(act_dtype)
+            y = woq_linear(x)
+
+            scales_expanded = scales[:, g_idx].to(compute_dtype).float()
+            zeros_expanded = zeros[:, g_idx].float()
+            dqw = (int4_weight.float() - zeros_expanded) * scales_expanded
+            y_ref = torch.nn.functional.linear(x.float(), dqw, bias)
+            if compute_dtype == torch.float:
+                atol, rtol = 1e-3, 1e-4
+            else:
+                atol, rtol = 2e-1, 1e-2
+            self.assertEqual(y.dtype, act_dtype)
+            torch.testing.assert_close(y.float(), y_ref, atol=atol, rtol=rtol)
+
     def test_unpack_with_g_idx(self):
         class Mod(nn.Module):
             def __init__(self, ic, oc, has_bias):
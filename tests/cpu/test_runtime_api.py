@@ -1,3 +1,4 @@
+import collections
 import unittest
 import torch
 import intel_extension_for_pytorch as ipex
@@ -97,6 +98,51 @@ class TestCPUPool(TestCase):
         cpu_pool = ipex.cpu.runtime.CPUPool(core_list)
         self.assertEqual(cpu_pool.cpu_pool.get_core_list(), core_list)
 
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_cpupool_numa_arena(self):
+        cpu_pool = ipex.cpu.runtime.CPUPool(node_id=0)
+        if len(cpu_pool.numa_nodes) == 0:
+            self.skipTest("NUMA information is not available")
+        cpu_pool = ipex.cpu.runtime.CPUPool(node_id=0, use_numa_arena=True)
+        self.assertTrue(cpu_pool.cpu_pool.is_numa_arena_enabled())
+
+        model = SimpleNet()
+        model.eval()
+        x = torch.rand(64, 64, 3, 3)
+        y = model(x)
+        with ipex.cpu.runtime.pin(cpu_pool):
+            y_runtime = model(x)
+        self.assertEqual(y, y_runtime)
+        # Tensors allocated from the arena are still valid after the CPU pool
+        # is released
+        del cpu_pool
+        self.assertEqual(y, y_runtime)
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_get_cpu_pools(self):
+        available_cores = ipex._C.get_process_available_cores()
+        physical_cores = [
+            core["cpu_id"]
+            for core in ipex._C.get_cpu_topology()
+            if not core["is_smt_sibling"] and core["cpu_id"] in available_cores
+        ]
+        num_instances = min(2, len(physical_cores))
+        cpu_pools = ipex.cpu.runtime.get_cpu_pools(num_instances)
+        self.assertEqual(len(cpu_pools), num_instances)
+        # The CPU pools are disjoint and cover all the physical cores
+        core_ids = sorted(sum([cpu_pool.core_ids for cpu_pool in cpu_pools], []))
+        self.assertEqual(core_ids, sorted(physical_cores))
+        with self.assertRaises(RuntimeError):
+            ipex.cpu.runtime.get_cpu_pools(len(physical_cores) + 1)
+
 
 class TestCoreBinding(TestCase):
     @unittest.skipIf(
@@ -247,6 +293,161 @@ class TestRuntimeAPI(TestCase):
         self.assertEqual(y, y_runtime)
         self.assertEqual(y, y_runtime2)
 
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_work_stealing_imperative_model(self):
+        model = SimpleNet()
+        model.eval()
+        xs = [torch.rand(1, 64, 3, 3) for _ in range(16)]
+        # Calculate the reference result
+        ys = [model(x) for x in xs]
+
+        # Create task with multi workers
+        cpu_pool = ipex.cpu.runtime.CPUPool([0, 1])
+        task = ipex.cpu.runtime.Task(
+            model, cpu_pool, num_workers=len(cpu_pool.core_ids)
+        )
+
+        # Submit all the requests before waiting
+        y_runtime_futures = [task(x) for x in xs]
+        for y, y_runtime_future in zip(ys, y_runtime_futures):
+            self.assertEqual(y, y_runtime_future.get())
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_work_stealing_jit_model(self):
+        model = SimpleNet()
+        model.eval()
+        x = torch.rand(1, 64, 3, 3)
+        with torch.no_grad():
+            traced_model = torch.jit.trace(model, x)
+            traced_model = torch.jit.freeze(traced_model)
+            y = traced_model(x)
+
+        # Create task with multi workers
+        cpu_pool = ipex.cpu.runtime.CPUPool([0, 1])
+        task = ipex.cpu.runtime.Task(
+            traced_model, cpu_pool, num_workers=len(cpu_pool.core_ids)
+        )
+
+        y_runtime_futures = [task(x) for _ in range(8)]
+        for y_runtime_future in y_runtime_futures:
+            self.assertEqual(y, y_runtime_future.get())
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_stats(self):
+        model = SimpleNet()
+        model.eval()
+        x = torch.rand(1, 64, 3, 3)
+        cpu_pool = ipex.cpu.runtime.CPUPool([0, 1])
+        task = ipex.cpu.runtime.Task(model, cpu_pool, num_workers=2)
+
+        y_runtime_futures = [task(x) for _ in range(8)]
+        for y_runtime_future in y_runtime_futures:
+            y_runtime_future.get()
+        stats = task.get_stats()
+        self.assertEqual(stats["num_submitted_tasks"], 8)
+        self.assertEqual(stats["worker_cores"], [[0], [1]])
+        self.assertGreaterEqual(stats["queue_length_high_water_mark"], 1)
+        self.assertLessEqual(stats["wait_time_p50"], stats["wait_time_max"])
+        task.reset_stats()
+        self.assertEqual(task.get_stats()["num_submitted_tasks"], 0)
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_dynamic_batching_imperative_model(self):
+        model = SimpleNet()
+        model.eval()
+        xs = [torch.rand(bs, 64, 3, 3) for bs in [1, 2, 1, 3, 1]]
+        # Calculate the reference result
+        ys = [model(x) for x in xs]
+
+        # Create task with dynamic batching, use a large window so that all
+        # the requests fall into the batches
+        cpu_pool = ipex.cpu.runtime.CPUPool(node_id=0)
+        task = ipex.cpu.runtime.Task(
+            model, cpu_pool, max_batch_size=4, batch_timeout_us=100000
+        )
+        self.assertTrue(task._task.is_batching_enabled())
+
+        y_runtime_futures = [task(x) for x in xs]
+        for y, y_runtime_future in zip(ys, y_runtime_futures):
+            self.assertEqual(y, y_runtime_future.get())
+
+        # Requests with kwargs are not batchable and run individually
+        self.assertEqual(ys[0], task.run_sync(x=xs[0]))
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_dynamic_batching_jit_model(self):
+        model = SimpleNet()
+        model.eval()
+        x = torch.rand(1, 64, 3, 3)
+        x2 = torch.rand(1, 64, 5, 5)
+        with torch.no_grad():
+            traced_model = torch.jit.trace(model, x)
+            y = traced_model(x)
+            y2 = traced_model(x2)
+
+        cpu_pool = ipex.cpu.runtime.CPUPool(node_id=0)
+        task = ipex.cpu.runtime.Task(
+            traced_model, cpu_pool, max_batch_size=8, batch_timeout_us=100000
+        )
+        # Inputs with different non-batch sizes go into different batches
+        with torch.no_grad():
+            y_runtime_futures = [task(x), task(x2), task(x), task(x2)]
+        self.assertEqual(y, y_runtime_futures[0].get())
+        self.assertEqual(y2, y_runtime_futures[1].get())
+        self.assertEqual(y, y_runtime_futures[2].get())
+        self.assertEqual(y2, y_runtime_futures[3].get())
+
+    @unittest.skipIf(
+        not ipex.cpu.runtime.is_runtime_ext_enabled(),
+        "Skip when IPEX Runtime extension is not enabled",
+    )
+    @runtime_thread_affinity_test_env
+    def test_task_dynamic_batching_output_types(self):
+        Output = collections.namedtuple("Output", ["y", "y_sum"])
+
+        class NamedTupleNet(SimpleNet):
+            def forward(self, x):
+                y = super().forward(x)
+                return Output(y, [y.sum(dim=1)])
+
+        # The dict output can't be split, the requests run one by one
+        class DictNet(SimpleNet):
+            def forward(self, x):
+                return {"y": super().forward(x)}
+
+        xs = [torch.rand(bs, 64, 3, 3) for bs in [1, 2, 1]]
+        cpu_pool = ipex.cpu.runtime.CPUPool(node_id=0)
+        for model in [NamedTupleNet().eval(), DictNet().eval()]:
+            with torch.no_grad():
+                ys = [model(x) for x in xs]
+                task = ipex.cpu.runtime.Task(
+                    model, cpu_pool, max_batch_size=4, batch_timeout_us=100000
+                )
+                y_runtime_futures = [task(x) for x in xs]
+                for y, y_runtime_future in zip(ys, y_runtime_futures):
+                    y_runtime = y_runtime_future.get()
+                    self.assertEqual(type(y), type(y_runtime))
+                    self.assertEqual(y, y_runtime)
 
 class TestMultiStreamModule(TestCase):
     @unittest.skipIf(